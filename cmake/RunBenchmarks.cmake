@@ -0,0 +1,54 @@
+# Runs each benchmark scene (see Benchmark.hpp) and gathers their results into a single JSON file.
+# Invoked by the benchmarks target with:
+#
+#   SCENES      Comma-separated names of the scenes' executables
+#   SCENE_DIR   The directory containing them
+#   OUTPUT      The JSON file to write
+#   FRAMES      The number of frames measured per scene
+#   HEADLESS    Whether to render offscreen (see Window.hpp)
+
+string(REPLACE "," ";" SCENES "${SCENES}")
+get_filename_component(OUTPUT_DIR "${OUTPUT}" DIRECTORY)
+set(RESULTS_DIR "${OUTPUT_DIR}/benchmarks")
+file(MAKE_DIRECTORY "${RESULTS_DIR}")
+
+set(ENVIRONMENT "BENCHMARK_FRAMES=${FRAMES}")
+if (HEADLESS)
+  list(APPEND ENVIRONMENT "HEADLESS=1")
+endif()
+
+set(RESULTS "")
+set(FAILED "")
+
+foreach (SCENE ${SCENES})
+  set(RESULT "${RESULTS_DIR}/${SCENE}.json")
+  file(REMOVE "${RESULT}")
+  message(STATUS "Benchmarking ${SCENE}")
+
+  execute_process(
+      COMMAND ${CMAKE_COMMAND} -E env ${ENVIRONMENT} "BENCHMARK=${RESULT}" "BENCHMARK_NAME=${SCENE}"
+              "${SCENE_DIR}/${SCENE}"
+      RESULT_VARIABLE EXIT_CODE
+      OUTPUT_QUIET)
+
+  if (NOT EXIT_CODE EQUAL 0 OR NOT EXISTS "${RESULT}")
+    list(APPEND FAILED ${SCENE})
+    continue()
+  endif()
+
+  file(READ "${RESULT}" SCENE_RESULT)
+  string(STRIP "${SCENE_RESULT}" SCENE_RESULT)
+
+  if (RESULTS STREQUAL "")
+    set(RESULTS "${SCENE_RESULT}")
+  else()
+    set(RESULTS "${RESULTS},\n${SCENE_RESULT}")
+  endif()
+endforeach()
+
+file(WRITE "${OUTPUT}" "{\"scenes\": [\n${RESULTS}\n]}\n")
+message(STATUS "Benchmark results written to ${OUTPUT}")
+
+if (FAILED)
+  message(FATAL_ERROR "Failed to benchmark: ${FAILED}")
+endif()
@@ -9,6 +9,8 @@ layout (location = 1) in vec3 aNormal;
 out vec3 vertColor;
 
 uniform mat4 model;
+// Inverse transpose of the model matrix (up to a scale factor), computed on the CPU
+uniform mat3 normalMatrix;
 uniform mat4 view;
 uniform mat4 projection;
 
@@ -19,7 +21,7 @@ uniform vec3 objectColor;
 
 void main() {
   vec3 vertPos = vec3(model * vec4(aPos, 1.0));
-  vec3 normal = mat3(transpose(inverse(model))) * aNormal;
+  vec3 normal = normalMatrix * aNormal;
 
   // Ambient lighting
   float ambientStrength = 0.1;
@@ -0,0 +1,8 @@
+#version 330 core
+
+out vec4 fragColor;
+
+void main() {
+  // Only the depth test matters, color writes are disabled while drawing bounding boxes
+  fragColor = vec4(1.0);
+}
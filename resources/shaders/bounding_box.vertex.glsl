@@ -0,0 +1,11 @@
+#version 330 core
+
+// Corner of a unit cube centered on the origin
+layout (location = 0) in vec3 aPosition;
+
+// Maps the unit cube to the bounding box, then to clip space
+uniform mat4 transform;
+
+void main() {
+  gl_Position = transform * vec4(aPosition, 1.0);
+}
@@ -0,0 +1,27 @@
+#version 330 core
+
+// CASCADES and CASCADE_VERTICES (3 * CASCADES) are defined by the application
+
+layout (triangles) in;
+layout (triangle_strip, max_vertices = CASCADE_VERTICES) out;
+
+uniform mat4 lightSpaces[CASCADES];
+// Bit i is set if the object is visible in cascade i
+uniform int cascadeMask;
+
+void main() {
+  // Copy the triangle to the layer of every cascade the object is visible in
+  for (int cascade = 0; cascade < CASCADES; cascade++) {
+    if ((cascadeMask & (1 << cascade)) == 0) {
+      continue;
+    }
+
+    for (int i = 0; i < 3; i++) {
+      gl_Layer = cascade;
+      gl_Position = lightSpaces[cascade] * gl_in[i].gl_Position;
+      EmitVertex();
+    }
+
+    EndPrimitive();
+  }
+}
@@ -0,0 +1,10 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+
+void main() {
+  // World space, the geometry shader projects each triangle into the layers it is copied to
+  gl_Position = model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,130 @@
+#version 330 core
+
+in vec3 fragPos;
+in vec3 normal;
+in vec2 texCoords;
+in float viewDepth;
+
+out vec4 fragColor;
+
+uniform vec3 viewPos;
+
+struct Material {
+  sampler2D diffuse;
+  sampler2D specular;
+  float glossiness;
+};
+
+uniform Material material;
+
+struct DirectionalLight {
+  vec3 direction;
+
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+};
+
+uniform DirectionalLight directionalLight;
+
+// Light clusters (see LightClusters.hpp)
+// Offset and count of each cluster's lights in the index list
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLightIndices;
+// 4 texels per light:
+// - position, range
+// - color, type (0 = point, 1 = spot)
+// - spot direction, outer cutoff
+// - constant, linear and quadratic attenuation factors, inner cutoff
+uniform samplerBuffer clusterLightData;
+
+uniform ivec3 clusterCounts;
+// Size of a cluster tile in pixels
+uniform vec2 clusterTileSize;
+// Depth slice = log(viewDepth) * scale + bias
+uniform vec2 clusterSliceScaleBias;
+
+vec3 calcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir, vec3 albedo, vec3 specularColor) {
+  vec3 lightDir = normalize(-light.direction);
+
+  // Diffuse lighting
+  float diff = max(dot(normal, lightDir), 0.0);
+
+  // Specular lighting
+  vec3 reflectDir = reflect(-lightDir, normal);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.glossiness);
+
+  // Combine results
+  vec3 ambient = light.ambient * albedo;
+  vec3 diffuse = light.diffuse * diff * albedo;
+  vec3 specular = light.specular * spec * specularColor;
+
+  return ambient + diffuse + specular;
+}
+
+// Point and spot lights share the same attenuation, spot lights are also restricted to a cone
+vec3 calcClusterLight(int index, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularColor) {
+  vec4 positionRange = texelFetch(clusterLightData, index * 4);
+  vec3 lightVector = positionRange.xyz - fragPos;
+  float distance = length(lightVector);
+
+  if (distance > positionRange.w) {
+    // Out of range, even though the light reaches another part of the cluster
+    return vec3(0.0);
+  }
+
+  vec4 colorType = texelFetch(clusterLightData, index * 4 + 1);
+  vec4 attenuationFactors = texelFetch(clusterLightData, index * 4 + 3);
+  vec3 lightDir = lightVector / distance;
+  float intensity = 1.0;
+
+  if (colorType.w > 0.5) {
+    // Spot light computations
+    vec4 directionCutoff = texelFetch(clusterLightData, index * 4 + 2);
+    float theta = dot(lightDir, -directionCutoff.xyz);
+    float epsilon = attenuationFactors.w - directionCutoff.w;
+    intensity = clamp((theta - directionCutoff.w) / epsilon, 0.0, 1.0);
+  }
+
+  // Attenuation
+  float attenuation = intensity / (attenuationFactors.x + attenuationFactors.y * distance + attenuationFactors.z * pow(distance, 2.0));
+
+  // Diffuse lighting
+  float diff = max(dot(normal, lightDir), 0.0);
+
+  // Specular lighting
+  vec3 reflectDir = reflect(-lightDir, normal);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.glossiness);
+
+  // Combine results
+  vec3 diffuse = colorType.rgb * attenuation * diff * albedo;
+  vec3 specular = colorType.rgb * attenuation * spec * specularColor;
+
+  return diffuse + specular;
+}
+
+void main() {
+  vec3 normal = normalize(normal);
+  vec3 viewDir = normalize(viewPos - fragPos);
+
+  // Sample the material once for all lights
+  vec3 albedo = texture(material.diffuse, texCoords).rgb;
+  vec3 specularColor = texture(material.specular, texCoords).rgb;
+
+  // Directional light
+  vec3 result = calcDirectionalLight(directionalLight, normal, viewDir, albedo, specularColor);
+
+  // Find the fragment's cluster
+  ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterTileSize), clusterCounts.xy - 1);
+  int slice = clamp(int(log(viewDepth) * clusterSliceScaleBias.x + clusterSliceScaleBias.y), 0, clusterCounts.z - 1);
+  int cluster = (slice * clusterCounts.y + tile.y) * clusterCounts.x + tile.x;
+  uvec2 offsetCount = texelFetch(clusterGrid, cluster).xy;
+
+  // Point and spot lights reaching the cluster
+  for (uint i = 0u; i < offsetCount.y; i++) {
+    int index = int(texelFetch(clusterLightIndices, int(offsetCount.x + i)).x);
+    result += calcClusterLight(index, normal, fragPos, viewDir, albedo, specularColor);
+  }
+
+  fragColor = vec4(result, 1.0);
+}
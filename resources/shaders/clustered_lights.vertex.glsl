@@ -0,0 +1,29 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+out vec3 fragPos;
+out vec3 normal;
+out vec2 texCoords;
+// Distance from the camera plane, used to find the fragment's cluster
+out float viewDepth;
+
+uniform mat4 model;
+// Inverse transpose of the model matrix (up to a scale factor), computed on the CPU
+uniform mat3 normalMatrix;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+  // Pass the fragment position, normal and texture coordinates to the fragment shader
+  fragPos = vec3(model * vec4(aPos, 1.0));
+  normal = normalMatrix * aNormal;
+  texCoords = aTexCoord;
+
+  vec4 viewPos = view * vec4(fragPos, 1.0);
+  viewDepth = -viewPos.z;
+
+  gl_Position = projection * viewPos;
+}
@@ -0,0 +1,55 @@
+#version 330 core
+
+out vec4 fragColor;
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform vec2 screenSize;
+uniform mat4 inverseProjection;
+uniform float glossiness;
+
+struct DirectionalLight {
+  // In view space
+  vec3 direction;
+
+  vec3 ambient;
+  vec3 diffuse;
+  vec3 specular;
+};
+
+uniform DirectionalLight directionalLight;
+
+void main() {
+  vec2 uv = gl_FragCoord.xy / screenSize;
+  float depth = texture(gDepth, uv).r;
+
+  if (depth == 1.0) {
+    // Nothing was drawn here, keep the background color
+    discard;
+  }
+
+  // Reconstruct the view-space position from the depth buffer
+  vec4 position = inverseProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+  vec3 fragPos = position.xyz / position.w;
+
+  vec4 albedoSpecular = texture(gAlbedoSpecular, uv);
+  vec3 normal = texture(gNormal, uv).xyz;
+  vec3 viewDir = normalize(-fragPos);
+  vec3 lightDir = normalize(-directionalLight.direction);
+
+  // Diffuse lighting
+  float diff = max(dot(normal, lightDir), 0.0);
+
+  // Specular lighting
+  vec3 reflectDir = reflect(-lightDir, normal);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), glossiness);
+
+  // Combine results
+  vec3 ambient = directionalLight.ambient * albedoSpecular.rgb;
+  vec3 diffuse = directionalLight.diffuse * diff * albedoSpecular.rgb;
+  vec3 specular = directionalLight.specular * spec * albedoSpecular.a;
+
+  fragColor = vec4(ambient + diffuse + specular, 1.0);
+}
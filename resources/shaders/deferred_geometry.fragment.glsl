@@ -0,0 +1,21 @@
+#version 330 core
+
+in vec3 normal;
+in vec2 texCoords;
+
+layout (location = 0) out vec4 gAlbedoSpecular;
+layout (location = 1) out vec4 gNormal;
+
+struct Material {
+  sampler2D diffuse;
+  sampler2D specular;
+};
+
+uniform Material material;
+
+void main() {
+  // Sample the material once, the lighting passes read the results from the G-buffer
+  gAlbedoSpecular.rgb = texture(material.diffuse, texCoords).rgb;
+  gAlbedoSpecular.a = texture(material.specular, texCoords).r;
+  gNormal = vec4(normalize(normal), 0.0);
+}
@@ -0,0 +1,22 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+out vec3 normal;
+out vec2 texCoords;
+
+uniform mat4 model;
+// Inverse transpose of the model-view matrix (up to a scale factor), computed on the CPU
+uniform mat3 normalMatrix;
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+  // Lighting is computed in view space, so the normals are stored in view space
+  normal = normalMatrix * aNormal;
+  texCoords = aTexCoord;
+
+  gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
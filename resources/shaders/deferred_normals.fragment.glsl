@@ -0,0 +1,13 @@
+#version 330 core
+
+out vec4 fragColor;
+
+uniform sampler2D gNormal;
+
+uniform vec2 screenSize;
+
+void main() {
+  // Map the view-space normals from [-1, 1] to displayable colors
+  vec3 normal = texture(gNormal, gl_FragCoord.xy / screenSize).rgb;
+  fragColor = vec4(normal * 0.5 + 0.5, 1.0);
+}
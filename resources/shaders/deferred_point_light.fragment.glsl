@@ -0,0 +1,54 @@
+#version 330 core
+
+flat in vec3 lightPosition;
+flat in float lightRadius;
+flat in vec3 lightColor;
+// Constant, linear and quadratic attenuation factors
+flat in vec3 lightAttenuation;
+
+out vec4 fragColor;
+
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+
+uniform vec2 screenSize;
+uniform mat4 inverseProjection;
+uniform float glossiness;
+
+void main() {
+  vec2 uv = gl_FragCoord.xy / screenSize;
+  float depth = texture(gDepth, uv).r;
+
+  // Reconstruct the view-space position from the depth buffer
+  vec4 position = inverseProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+  vec3 fragPos = position.xyz / position.w;
+
+  // The light volume also covers pixels in front of or behind the light's influence
+  float distance = length(lightPosition - fragPos);
+
+  if (distance > lightRadius) {
+    discard;
+  }
+
+  vec4 albedoSpecular = texture(gAlbedoSpecular, uv);
+  vec3 normal = texture(gNormal, uv).xyz;
+  vec3 viewDir = normalize(-fragPos);
+  vec3 lightDir = (lightPosition - fragPos) / distance;
+
+  // Attenuation
+  float attenuation = 1.0 / (lightAttenuation.x + lightAttenuation.y * distance + lightAttenuation.z * pow(distance, 2.0));
+
+  // Diffuse lighting
+  float diff = max(dot(normal, lightDir), 0.0);
+
+  // Specular lighting
+  vec3 reflectDir = reflect(-lightDir, normal);
+  float spec = pow(max(dot(viewDir, reflectDir), 0.0), glossiness);
+
+  // Combine results (accumulated with additive blending)
+  vec3 diffuse = lightColor * attenuation * diff * albedoSpecular.rgb;
+  vec3 specular = lightColor * attenuation * spec * albedoSpecular.a;
+
+  fragColor = vec4(diffuse + specular, 1.0);
+}
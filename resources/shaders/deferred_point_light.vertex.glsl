@@ -0,0 +1,27 @@
+#version 330 core
+
+// A unit sphere enclosing the light's influence once scaled by its radius
+layout (location = 0) in vec3 aPos;
+// Per-light attributes
+layout (location = 1) in vec4 aLightPositionRadius;
+layout (location = 2) in vec3 aLightColor;
+layout (location = 3) in vec3 aLightAttenuation;
+
+flat out vec3 lightPosition;
+flat out float lightRadius;
+flat out vec3 lightColor;
+flat out vec3 lightAttenuation;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+  vec3 worldPosition = aLightPositionRadius.xyz + aPos * aLightPositionRadius.w;
+
+  lightPosition = vec3(view * vec4(aLightPositionRadius.xyz, 1.0));
+  lightRadius = aLightPositionRadius.w;
+  lightColor = aLightColor;
+  lightAttenuation = aLightAttenuation;
+
+  gl_Position = projection * view * vec4(worldPosition, 1.0);
+}
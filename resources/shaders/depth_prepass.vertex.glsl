@@ -0,0 +1,15 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+// Must match the shading pass' depth exactly, as it is tested with GL_EQUAL
+invariant gl_Position;
+
+void main() {
+  vec3 fragPos = vec3(model * vec4(aPos, 1.0));
+  gl_Position = projection * view * vec4(fragPos, 1.0);
+}
@@ -0,0 +1,128 @@
+#version 430 core
+
+layout (local_size_x = 64) in;
+
+struct Instance {
+  mat4 model;
+  // World-space bounding box
+  vec3 center;
+  uint drawIndex;
+  vec3 extents;
+  uint padding;
+};
+
+struct DrawCommand {
+  uint count;
+  uint instanceCount;
+  uint firstIndex;
+  int baseVertex;
+  uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Instances {
+  Instance instances[];
+};
+
+// Reset every frame with instanceCount = 0, then filled in by this shader
+layout (std430, binding = 1) buffer DrawCommands {
+  DrawCommand commands[];
+};
+
+// Compacted indices of the visible instances, grouped by draw command
+layout (std430, binding = 2) writeonly buffer VisibleInstances {
+  uint visibleInstances[];
+};
+
+uniform uint instanceCount;
+uniform vec4 frustumPlanes[6];
+
+// Occlusion culling against the previous frame's depth pyramid
+uniform bool occlusionCulling;
+uniform mat4 previousViewProjection;
+uniform sampler2D hiZ;
+
+bool isInFrustum(vec3 center, vec3 extents) {
+  for (int i = 0; i < 6; i++) {
+    vec4 plane = frustumPlanes[i];
+
+    if (dot(plane.xyz, center) + plane.w + dot(abs(plane.xyz), extents) < 0.0) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool isOccluded(vec3 center, vec3 extents) {
+  vec2 minUV = vec2(1.0);
+  vec2 maxUV = vec2(0.0);
+  float nearestDepth = 1.0;
+  bool crossesNearPlane = false;
+
+  for (int i = 0; i < 8; i++) {
+    vec3 corner = center + extents * vec3((i & 1) != 0 ? 1.0 : -1.0,
+                                          (i & 2) != 0 ? 1.0 : -1.0,
+                                          (i & 4) != 0 ? 1.0 : -1.0);
+    vec4 clip = previousViewProjection * vec4(corner, 1.0);
+
+    // Boxes crossing the near plane can't be projected reliably
+    crossesNearPlane = crossesNearPlane || clip.w <= 0.0001;
+    vec3 ndc = clip.xyz / max(clip.w, 0.0001);
+    minUV = min(minUV, ndc.xy * 0.5 + 0.5);
+    maxUV = max(maxUV, ndc.xy * 0.5 + 0.5);
+    nearestDepth = min(nearestDepth, ndc.z * 0.5 + 0.5);
+  }
+
+  // Parts of the box were outside the previous frame's view, where the Hi-Z buffer has no depth:
+  // clamping would test them against the edge texels and could cull objects coming into view
+  if (crossesNearPlane || any(lessThan(minUV, vec2(0.0))) || any(greaterThan(maxUV, vec2(1.0)))) {
+    return false;
+  }
+
+  // Pick the level where the box covers at most 2x2 texels
+  vec2 baseSize = vec2(textureSize(hiZ, 0));
+  vec2 size = (maxUV - minUV) * baseSize;
+  int levels = textureQueryLevels(hiZ);
+  int level = min(int(ceil(log2(max(max(size.x, size.y), 1.0)))), levels - 1);
+  float farthest = 0.0;
+
+  // Loop over all levels so that the level passed to texelFetch() is the same for every
+  // invocation: some drivers (such as llvmpipe) don't handle per-invocation levels
+  for (int i = 0; i < levels; i++) {
+    if (i != level) {
+      continue;
+    }
+
+    // Level texels cover 2^level base texels, except the last row/column which covers the rest
+    ivec2 levelSize = textureSize(hiZ, i);
+    ivec2 minTexel = min(ivec2(minUV * baseSize) >> i, levelSize - 1);
+    ivec2 maxTexel = min(ivec2(maxUV * baseSize) >> i, levelSize - 1);
+
+    for (int y = minTexel.y; y <= maxTexel.y; y++) {
+      for (int x = minTexel.x; x <= maxTexel.x; x++) {
+        farthest = max(farthest, texelFetch(hiZ, ivec2(x, y), i).r);
+      }
+    }
+  }
+
+  return nearestDepth > farthest;
+}
+
+void main() {
+  uint id = gl_GlobalInvocationID.x;
+
+  if (id >= instanceCount) {
+    return;
+  }
+
+  vec3 center = instances[id].center;
+  vec3 extents = instances[id].extents;
+
+  if (!isInFrustum(center, extents) || (occlusionCulling && isOccluded(center, extents))) {
+    return;
+  }
+
+  uint drawIndex = instances[id].drawIndex;
+  uint slot = atomicAdd(commands[drawIndex].instanceCount, 1u);
+  visibleInstances[commands[drawIndex].baseInstance + slot] = id;
+}
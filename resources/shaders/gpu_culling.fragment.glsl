@@ -0,0 +1,25 @@
+#version 430 core
+
+in vec3 fragPos;
+in vec3 normal;
+in vec2 texCoords;
+
+out vec4 fragColor;
+
+uniform vec3 viewPos;
+uniform sampler2D diffuseTexture;
+uniform sampler2D specularTexture;
+uniform vec3 lightDirection;
+
+void main() {
+  vec3 normal = normalize(normal);
+  vec3 lightDir = normalize(-lightDirection);
+  vec3 viewDir = normalize(viewPos - fragPos);
+  vec3 albedo = texture(diffuseTexture, texCoords).rgb;
+
+  float diff = max(dot(normal, lightDir), 0.0);
+  float spec = pow(max(dot(viewDir, reflect(-lightDir, normal)), 0.0), 24.0);
+
+  vec3 result = albedo * (0.15 + 0.85 * diff) + texture(specularTexture, texCoords).rgb * spec * 0.5;
+  fragColor = vec4(result, 1.0);
+}
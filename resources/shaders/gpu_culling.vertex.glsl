@@ -0,0 +1,41 @@
+#version 430 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+// Index of the instance, read from the compacted list written by the culling shader
+layout (location = 3) in uint aInstance;
+
+struct Instance {
+  mat4 model;
+  vec3 center;
+  uint drawIndex;
+  vec3 extents;
+  uint padding;
+};
+
+layout (std430, binding = 0) readonly buffer Instances {
+  Instance instances[];
+};
+
+out vec3 fragPos;
+out vec3 normal;
+out vec2 texCoords;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main() {
+  mat4 model = instances[aInstance].model;
+  fragPos = vec3(model * vec4(aPos, 1.0));
+  // Instances are scaled non-uniformly (by their height), so the normals are transformed by the
+  // cofactor matrix, the inverse transpose up to a positive factor like in NormalMatrix.hpp. The
+  // fragment shader normalizes them, and instances are never mirrored.
+  mat3 linear = mat3(model);
+  mat3 normalMatrix = mat3(cross(linear[1], linear[2]), cross(linear[2], linear[0]),
+                           cross(linear[0], linear[1]));
+  normal = normalMatrix * aNormal;
+  texCoords = aTexCoord;
+
+  gl_Position = projection * view * vec4(fragPos, 1.0);
+}
@@ -0,0 +1,38 @@
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// Either the depth buffer (to build level 0) or the previous pyramid level
+uniform sampler2D source;
+uniform int sourceLevel;
+
+layout (r32f, binding = 0) uniform writeonly image2D destination;
+
+void main() {
+  ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+  ivec2 destinationSize = imageSize(destination);
+
+  if (any(greaterThanEqual(texel, destinationSize))) {
+    return;
+  }
+
+  ivec2 sourceSize = textureSize(source, sourceLevel);
+  float farthest = 0.0;
+
+  if (sourceSize == destinationSize) {
+    farthest = texelFetch(source, texel, sourceLevel).r;
+  } else {
+    // Each texel keeps the farthest depth of the 2x2 source texels it covers. With odd source
+    // sizes, the last row/column also covers the extra source texel so nothing is lost.
+    ivec2 extent = ivec2(2) + ivec2(equal(texel, destinationSize - 1)) * (sourceSize - destinationSize * 2);
+
+    for (int y = 0; y < extent.y; y++) {
+      for (int x = 0; x < extent.x; x++) {
+        ivec2 sourceTexel = min(texel * 2 + ivec2(x, y), sourceSize - 1);
+        farthest = max(farthest, texelFetch(source, sourceTexel, sourceLevel).r);
+      }
+    }
+  }
+
+  imageStore(destination, texel, vec4(farthest));
+}
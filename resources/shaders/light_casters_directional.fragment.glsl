@@ -3,6 +3,9 @@
 in vec3 fragPos;
 in vec3 normal;
 in vec2 texCoords;
+#ifndef CASCADES
+in vec4 lightSpacePos;
+#endif
 
 out vec4 fragColor;
 
@@ -25,6 +28,68 @@ struct Light {
 
 uniform Light light;
 
+#ifdef CASCADES
+// One shadow map per cascade (see CascadedShadowMap.hpp), compared in hardware
+uniform sampler2DArrayShadow cascadeShadowMap;
+uniform mat4 cascadeLightSpaces[CASCADES];
+// The view-space distance where each cascade ends
+uniform float cascadeSplits[CASCADES];
+uniform mat4 view;
+
+// Returns the fraction of the light reaching the fragment, filtered over 3x3 bilinear samples of
+// the nearest cascade covering it
+float shadow() {
+  float viewDepth = -(view * vec4(fragPos, 1.0)).z;
+  int cascade = 0;
+
+  while (cascade < CASCADES && viewDepth > cascadeSplits[cascade]) {
+    cascade++;
+  }
+
+  // No shadows past the last cascade
+  if (cascade == CASCADES) {
+    return 1.0;
+  }
+
+  // Orthographic projection, no division by w needed
+  vec3 coords = (cascadeLightSpaces[cascade] * vec4(fragPos, 1.0)).xyz * 0.5 + 0.5;
+  vec2 texelSize = 1.0 / vec2(textureSize(cascadeShadowMap, 0).xy);
+  float lit = 0.0;
+
+  for (int x = -1; x <= 1; x++) {
+    for (int y = -1; y <= 1; y++) {
+      lit += texture(cascadeShadowMap, vec4(coords.xy + vec2(x, y) * texelSize, cascade, coords.z));
+    }
+  }
+
+  return lit / 9.0;
+}
+#else
+// Depth of the shadow casters as seen from the light, compared in hardware
+uniform sampler2DShadow shadowMap;
+
+// Returns the fraction of the light reaching the fragment, filtered over 3x3 bilinear samples
+float shadow() {
+  vec3 coords = lightSpacePos.xyz / lightSpacePos.w * 0.5 + 0.5;
+
+  // Beyond the light's far plane
+  if (coords.z > 1.0) {
+    return 1.0;
+  }
+
+  vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+  float lit = 0.0;
+
+  for (int x = -1; x <= 1; x++) {
+    for (int y = -1; y <= 1; y++) {
+      lit += texture(shadowMap, vec3(coords.xy + vec2(x, y) * texelSize, coords.z));
+    }
+  }
+
+  return lit / 9.0;
+}
+#endif
+
 void main() {
   // Ambient lighting
   vec3 ambient = light.ambient * texture(material.diffuse, texCoords).rgb;
@@ -41,5 +106,5 @@ void main() {
   float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.glossiness);
   vec3 specular = light.specular * texture(material.specular, texCoords).rgb * spec;
 
-  fragColor = vec4(ambient + diffuse + specular, 1.0);
+  fragColor = vec4(ambient + (diffuse + specular) * shadow(), 1.0);
 }
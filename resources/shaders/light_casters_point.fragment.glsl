@@ -33,6 +33,39 @@ struct Light {
 
 uniform Light light;
 
+#ifdef POINT_SHADOWS
+// The light's influence radius, the far plane distance of its cube map
+uniform float shadowFar;
+
+// One cube map per shadowed point light (see PointShadowMaps.hpp), compared in hardware
+uniform samplerCubeArrayShadow pointShadowMaps;
+// The near plane distance of the cube faces' projections
+uniform float pointShadowNear;
+
+// Returns the fraction of a point light reaching the fragment, filtered over 8 bilinear samples
+// around the direction from the light
+float pointShadow(vec3 lightPosition, int cubeMap, float far) {
+  vec3 direction = fragPos - lightPosition;
+  // Every face's perspective depth only depends on the distance along the major axis
+  vec3 absolute = abs(direction);
+  float axisDistance = max(absolute.x, max(absolute.y, absolute.z));
+  float near = pointShadowNear;
+  float depth = (far + near) / (far - near) - 2.0 * far * near / ((far - near) * axisDistance);
+  depth = depth * 0.5 + 0.5;
+
+  // About one texel at the center of a face
+  float offset = 2.0 * axisDistance / float(textureSize(pointShadowMaps, 0).x);
+  float lit = 0.0;
+
+  for (int i = 0; i < 8; i++) {
+    vec3 corner = vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1) * 2.0 - 1.0;
+    lit += texture(pointShadowMaps, vec4(direction + corner * offset, cubeMap), depth);
+  }
+
+  return lit / 8.0;
+}
+#endif
+
 void main() {
   // Distance and attenuation computations
   float distance = length(light.position - fragPos);
@@ -54,5 +87,9 @@ void main() {
   float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.glossiness);
   vec3 specular = light.specular * attenuation * texture(material.specular, texCoords).rgb * spec;
 
+#ifdef POINT_SHADOWS
+  fragColor = vec4(ambient + (diffuse + specular) * pointShadow(light.position, 0, shadowFar), 1.0);
+#else
   fragColor = vec4(ambient + diffuse + specular, 1.0);
+#endif
 }
@@ -3,6 +3,7 @@
 in vec3 fragPos;
 in vec3 normal;
 in vec2 texCoords;
+in vec4 lightSpacePos;
 
 out vec4 fragColor;
 
@@ -29,6 +30,30 @@ struct Light {
 
 uniform Light light;
 
+// Depth of the shadow casters as seen from the light, compared in hardware
+uniform sampler2DShadow shadowMap;
+
+// Returns the fraction of the light reaching the fragment, filtered over 3x3 bilinear samples
+float shadow() {
+  vec3 coords = lightSpacePos.xyz / lightSpacePos.w * 0.5 + 0.5;
+
+  // Beyond the light's far plane
+  if (coords.z > 1.0) {
+    return 1.0;
+  }
+
+  vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0));
+  float lit = 0.0;
+
+  for (int x = -1; x <= 1; x++) {
+    for (int y = -1; y <= 1; y++) {
+      lit += texture(shadowMap, vec3(coords.xy + vec2(x, y) * texelSize, coords.z));
+    }
+  }
+
+  return lit / 9.0;
+}
+
 void main() {
   // Ambient lighting
   vec3 ambient = light.ambient * texture(material.diffuse, texCoords).rgb;
@@ -51,7 +76,7 @@ void main() {
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.glossiness);
     vec3 specular = light.specular * intensity * texture(material.specular, texCoords).rgb * spec;
 
-    fragColor = vec4(ambient + diffuse + specular, 1.0);
+    fragColor = vec4(ambient + (diffuse + specular) * shadow(), 1.0);
   } else {
     fragColor = vec4(ambient, 1.0);
   }
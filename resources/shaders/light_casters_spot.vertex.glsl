@@ -7,16 +7,26 @@ layout (location = 2) in vec2 aTexCoord;
 out vec3 fragPos;
 out vec3 normal;
 out vec2 texCoords;
+// Position in the shadow map's clip space
+out vec4 lightSpacePos;
 
 uniform mat4 model;
+// Inverse transpose of the model matrix (up to a scale factor), computed on the CPU
+uniform mat3 normalMatrix;
 uniform mat4 view;
 uniform mat4 projection;
+// Transforms world space to the shadow map's clip space
+uniform mat4 lightSpace;
+
+// Matches the depth pre-pass exactly (see depth_prepass.vertex.glsl)
+invariant gl_Position;
 
 void main() {
   // Pass the fragment position, normal and texture coordinates to the fragment shader
   fragPos = vec3(model * vec4(aPos, 1.0));
-  normal = mat3(transpose(inverse(model))) * aNormal;
+  normal = normalMatrix * aNormal;
   texCoords = aTexCoord;
+  lightSpacePos = lightSpace * vec4(fragPos, 1.0);
 
   gl_Position = projection * view * vec4(fragPos, 1.0);
 }
@@ -7,13 +7,15 @@ out vec3 fragPos;
 out vec3 normal;
 
 uniform mat4 model;
+// Inverse transpose of the model matrix (up to a scale factor), computed on the CPU
+uniform mat3 normalMatrix;
 uniform mat4 view;
 uniform mat4 projection;
 
 void main() {
   // Pass the fragment position and normal to the fragment shader
   fragPos = vec3(model * vec4(aPos, 1.0));
-  normal = mat3(transpose(inverse(model))) * aNormal;
+  normal = normalMatrix * aNormal;
 
   gl_Position = projection * view * vec4(fragPos, 1.0);
 }
@@ -10,7 +10,11 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Matches the depth pre-pass exactly (see depth_prepass.vertex.glsl)
+invariant gl_Position;
+
 void main() {
   _texCoords = texCoords;
-  gl_Position = projection * view * model * vec4(position, 1.0);
+  vec3 fragPos = vec3(model * vec4(position, 1.0));
+  gl_Position = projection * view * vec4(fragPos, 1.0);
 }
@@ -37,10 +37,31 @@ struct PointLight {
   vec3 ambient;
   vec3 diffuse;
   vec3 specular;
+#ifdef POINT_SHADOWS
+
+  // The light's cube map in the shadow map array
+  int shadowMap;
+  // The light's influence radius, the far plane distance of its cube map
+  float shadowFar;
+#endif
 };
 
-#define POINT_LIGHTS 4
-uniform PointLight pointLights[POINT_LIGHTS];
+// The scene's point lights
+#ifndef SCENE_POINT_LIGHTS
+#define SCENE_POINT_LIGHTS 4
+#endif
+
+uniform PointLight pointLights[SCENE_POINT_LIGHTS];
+
+// The number of point lights shading the object can be overridden per shader variant, to only pay
+// for the lights that reach the object being drawn, picked among the scene's by objectLights
+#ifndef POINT_LIGHTS
+#define POINT_LIGHTS SCENE_POINT_LIGHTS
+#endif
+
+#if POINT_LIGHTS > 0
+uniform int objectLights[POINT_LIGHTS];
+#endif
 
 struct SpotLight {
   vec3 position;
@@ -57,6 +78,73 @@ struct SpotLight {
 
 uniform SpotLight spotLight;
 
+#ifdef POINT_SHADOWS
+// One cube map per shadowed point light (see PointShadowMaps.hpp), compared in hardware
+uniform samplerCubeArrayShadow pointShadowMaps;
+// The near plane distance of the cube faces' projections
+uniform float pointShadowNear;
+
+// Returns the fraction of a point light reaching the fragment, filtered over 8 bilinear samples
+// around the direction from the light
+float pointShadow(vec3 lightPosition, int cubeMap, float far) {
+  vec3 direction = fragPos - lightPosition;
+  // Every face's perspective depth only depends on the distance along the major axis
+  vec3 absolute = abs(direction);
+  float axisDistance = max(absolute.x, max(absolute.y, absolute.z));
+  float near = pointShadowNear;
+  float depth = (far + near) / (far - near) - 2.0 * far * near / ((far - near) * axisDistance);
+  depth = depth * 0.5 + 0.5;
+
+  // About one texel at the center of a face
+  float offset = 2.0 * axisDistance / float(textureSize(pointShadowMaps, 0).x);
+  float lit = 0.0;
+
+  for (int i = 0; i < 8; i++) {
+    vec3 corner = vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1) * 2.0 - 1.0;
+    lit += texture(pointShadowMaps, vec4(direction + corner * offset, cubeMap), depth);
+  }
+
+  return lit / 8.0;
+}
+#endif
+
+#ifdef CASCADES
+// One shadow map per cascade of the directional light (see CascadedShadowMap.hpp)
+uniform sampler2DArrayShadow cascadeShadowMap;
+uniform mat4 cascadeLightSpaces[CASCADES];
+// The view-space distance where each cascade ends
+uniform float cascadeSplits[CASCADES];
+uniform mat4 view;
+
+// Returns the fraction of the directional light reaching the fragment, filtered over 3x3 bilinear
+// samples of the nearest cascade covering it
+float directionalShadow() {
+  float viewDepth = -(view * vec4(fragPos, 1.0)).z;
+  int cascade = 0;
+
+  while (cascade < CASCADES && viewDepth > cascadeSplits[cascade]) {
+    cascade++;
+  }
+
+  // No shadows past the last cascade
+  if (cascade == CASCADES) {
+    return 1.0;
+  }
+
+  vec3 coords = (cascadeLightSpaces[cascade] * vec4(fragPos, 1.0)).xyz * 0.5 + 0.5;
+  vec2 texelSize = 1.0 / vec2(textureSize(cascadeShadowMap, 0).xy);
+  float lit = 0.0;
+
+  for (int x = -1; x <= 1; x++) {
+    for (int y = -1; y <= 1; y++) {
+      lit += texture(cascadeShadowMap, vec4(coords.xy + vec2(x, y) * texelSize, cascade, coords.z));
+    }
+  }
+
+  return lit / 9.0;
+}
+#endif
+
 vec3 calcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir) {
   vec3 lightDir = normalize(-light.direction);
 
@@ -72,7 +160,11 @@ vec3 calcDirectionalLight(DirectionalLight light, vec3 normal, vec3 viewDir) {
   vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, texCoords));
   vec3 specular = light.specular * spec * vec3(texture(material.specular, texCoords));
 
+#ifdef CASCADES
+  return ambient + (diffuse + specular) * directionalShadow();
+#else
   return ambient + diffuse + specular;
+#endif
 }
 
 vec3 calcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
@@ -94,7 +186,12 @@ vec3 calcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
   vec3 diffuse = light.diffuse * attenuation * diff * vec3(texture(material.diffuse, texCoords));
   vec3 specular = light.specular * attenuation * spec * vec3(texture(material.specular, texCoords));
 
+#ifdef POINT_SHADOWS
+  return ambient + (diffuse + specular) * pointShadow(light.position, light.shadowMap,
+                                                      light.shadowFar);
+#else
   return ambient + diffuse + specular;
+#endif
 }
 
 vec3 calcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir) {
@@ -133,9 +230,11 @@ void main() {
   vec3 result = calcDirectionalLight(directionalLight, normal, viewDir);
 
   // Point lights
+#if POINT_LIGHTS > 0
   for (int i = 0; i < POINT_LIGHTS; i++) {
-    result += calcPointLight(pointLights[i], normal, fragPos, viewDir);
+    result += calcPointLight(pointLights[objectLights[i]], normal, fragPos, viewDir);
   }
+#endif
 
   // Spot light
   result += calcSpotLight(spotLight, normal, fragPos, viewDir);
@@ -0,0 +1,28 @@
+#version 330 core
+
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 18) out;
+
+// The light's projection and view matrix of each cube face
+uniform mat4 faceSpaces[6];
+// Bit i is set if the object is visible in face i
+uniform int faceMask;
+// The layer-face of the light's first face in the cube map array
+uniform int firstLayer;
+
+void main() {
+  // Copy the triangle to every face the object is visible in
+  for (int face = 0; face < 6; face++) {
+    if ((faceMask & (1 << face)) == 0) {
+      continue;
+    }
+
+    for (int i = 0; i < 3; i++) {
+      gl_Layer = firstLayer + face;
+      gl_Position = faceSpaces[face] * gl_in[i].gl_Position;
+      EmitVertex();
+    }
+
+    EndPrimitive();
+  }
+}
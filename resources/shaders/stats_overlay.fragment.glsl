@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec2 _texCoords;
+in vec4 _color;
+
+out vec4 fragColor;
+
+// Glyph coverage in the red channel, with a fully covered cell for solid quads
+uniform sampler2D glyphAtlas;
+
+void main() {
+  fragColor = vec4(_color.rgb, _color.a * texture(glyphAtlas, _texCoords).r);
+}
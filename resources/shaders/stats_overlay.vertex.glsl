@@ -0,0 +1,18 @@
+#version 330 core
+
+// Position in pixels from the top left corner of the screen
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec2 texCoords;
+layout (location = 2) in vec4 color;
+
+out vec2 _texCoords;
+out vec4 _color;
+
+uniform vec2 screenSize;
+
+void main() {
+  _texCoords = texCoords;
+  _color = color;
+  vec2 ndc = position / screenSize * 2.0 - 1.0;
+  gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+}
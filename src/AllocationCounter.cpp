@@ -0,0 +1,37 @@
+#include <cstdlib>
+#include <new>
+#include "AllocationCounter.hpp"
+
+// The replacements of the global operator new and delete counting the allocations (see
+// AllocationCounter.hpp)
+
+static const bool countingAllocations = (allocationsCounted = true);
+
+void *operator new(std::size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+
+  while (true) {
+    // Allocating 0 bytes must still return a unique pointer
+    void *memory = std::malloc(size > 0 ? size : 1);
+
+    if (memory != nullptr) {
+      return memory;
+    }
+
+    std::new_handler handler = std::get_new_handler();
+
+    if (handler == nullptr) {
+      throw std::bad_alloc();
+    }
+
+    handler();
+  }
+}
+
+void operator delete(void *memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t size) noexcept {
+  std::free(memory);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Counts the heap allocations made with operator new, e.g. to find code
+ * allocating in every frame (see Benchmark.hpp). The global operator new and
+ * delete are replaced in AllocationCounter.cpp, which is only linked into the
+ * programs measuring allocations (the benchmark scenes and the
+ * microbenchmarks): the other programs keep the standard ones, and report no
+ * allocations. Allocations made with malloc() directly, e.g. by the drivers,
+ * aren't counted.
+ */
+
+inline std::atomic<uint64_t> allocationCount{0};
+// Set by AllocationCounter.cpp when it's linked into the program
+inline bool allocationsCounted = false;
+
+// The number of allocations made since the program started
+inline uint64_t allocations() {
+  return allocationCount.load(std::memory_order_relaxed);
+}
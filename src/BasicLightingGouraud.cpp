@@ -6,6 +6,8 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
 #include "Shader.hpp"
+#include "NormalMatrix.hpp"
+#include "Window.hpp"
 
 // Stored globally so it can be modified in framebufferSizeCallback() and used in main()
 glm::mat4 projection;
@@ -18,9 +20,9 @@ void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   projection = glm::perspective(glm::radians(FOV), (float) width / (float) height, 0.1f, 100.0f);
 }
 
-void processInput(GLFWwindow *window) {
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
   }
 }
 
@@ -29,29 +31,14 @@ int32_t main() {
   constexpr int32_t SCREEN_WIDTH = 1280;
   constexpr int32_t SCREEN_HEIGHT = 720;
 
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(SCREEN_WIDTH, SCREEN_HEIGHT, "Basic Lighting (Gouraud shading)");
 
-  GLFWwindow *window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT,
-                                        "Basic Lighting (Gouraud shading)", nullptr, nullptr);
-  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-
-  if (window == nullptr) {
-    std::cout << "Failed to create GLFW window." << std::endl;
-    glfwTerminate();
+  if (!window.isOpen()) {
     return -1;
   }
 
-  // GLFW doesn't mark the context as current automatically
-  // <https://stackoverflow.com/questions/48650497/glad-failing-to-initialize>
-  glfwMakeContextCurrent(window);
-
-  if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-    std::cout << "ERROR: Failed to initialize GLAD." << std::endl;
-    return -1;
-  }
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
 
   glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
@@ -147,7 +134,7 @@ int32_t main() {
   projection = glm::perspective(glm::radians(FOV), (float) SCREEN_WIDTH / (float) SCREEN_HEIGHT,
                                 0.1f, 100.0f);
 
-  while (!glfwWindowShouldClose(window)) {
+  while (!window.shouldClose()) {
     processInput(window);
 
     // Clear the viewport with a constant color
@@ -156,8 +143,8 @@ int32_t main() {
 
     // Make the camera rotate in a circle around the center point
     float radius = 3.0f;
-    double cameraX = sin(glfwGetTime() * 0.75f) * radius;
-    double cameraZ = cos(glfwGetTime() * 0.75f) * radius;
+    double cameraX = sin(window.time() * 0.75f) * radius;
+    double cameraZ = cos(window.time() * 0.75f) * radius;
     glm::vec3 cameraPosition = glm::vec3(cameraX, 0.0f, cameraZ);
     glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
     // Use an "up" vector to determine the camera's right axis using a cross product
@@ -168,10 +155,13 @@ int32_t main() {
     // Draw the container cube
     glm::mat4 model;
     // The container cube's position (bobbing up and down)
-    glm::vec3 containerPos = glm::vec3(0.0f, sin(glfwGetTime()) * 0.5f - 0.25f, 0.0f);
+    glm::vec3 containerPos = glm::vec3(0.0f, sin(window.time()) * 0.5f - 0.25f, 0.0f);
     model = glm::translate(model, containerPos);
     containerShader.use();
     containerShader.setMat4("model", model);
+    // The container is only translated, so its model matrix can transform normals directly
+    glm::mat3 containerNormalMatrix = normalMatrix(model, true);
+    containerShader.setMat3("normalMatrix", containerNormalMatrix);
     containerShader.setMat4("view", view);
     containerShader.setMat4("projection", projection);
     containerShader.setVec3("viewPos", cameraPosition);
@@ -192,15 +182,14 @@ int32_t main() {
     glBindVertexArray(lightVao);
     glDrawArrays(GL_TRIANGLES, 0, 36);
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    window.swapBuffers();
+    window.pollEvents();
   }
 
   // Clean up
   glDeleteVertexArrays(1, &vao);
   glDeleteVertexArrays(1, &lightVao);
   glDeleteBuffers(1, &vbo);
-  glfwTerminate();
 
   return 0;
 }
@@ -0,0 +1,492 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "AllocationCounter.hpp"
+#include "GL43.hpp"
+
+/**
+ * Measures a demo over a fixed number of frames and writes the results as
+ * JSON, for the benchmarks target (see CMakeLists.txt). The Window runs it
+ * when the BENCHMARK environment variable is set:
+ *
+ * - BENCHMARK=path.json enables it, and is where the results are written
+ * - BENCHMARK_FRAMES=N measures N frames (300 by default)
+ * - BENCHMARK_WARMUP=N skips N frames first (30 by default), e.g. the ones
+ *   compiling shaders or uploading textures lazily
+ * - BENCHMARK_NAME names the scene in the results (the window title by default)
+ *
+ * The clock advances by a fixed step each frame, so every run renders the
+ * same frames. The load time is measured from the window's creation until the
+ * first frame, and each frame records its CPU time (from the start of the frame
+ * until it's submitted), its total time (including the buffer swap), its GPU
+ * time (with GL_TIMESTAMP queries), the number of draw calls, the number of
+ * triangles (primitives generated, as the demos only draw triangles) and the
+ * number of heap allocations, in the programs counting them (see
+ * AllocationCounter.hpp). GPU
+ * results are read back from a ring of queries a few frames late, as in
+ * GpuTimer.hpp.
+ */
+class Benchmark {
+public:
+  // The clock's step per frame, in seconds
+  static constexpr double TIME_STEP = 1.0 / 60.0;
+
+  /**
+   * @param name The scene's name, unless set by BENCHMARK_NAME
+   * @param loadStart When the demo started loading, i.e. creating its window
+   * @return The benchmark configured by the environment, or nullptr if BENCHMARK isn't set
+   */
+  static std::unique_ptr<Benchmark>
+  fromEnvironment(const std::string &name, std::chrono::steady_clock::time_point loadStart) {
+    const char *output = std::getenv("BENCHMARK");
+
+    if (output == nullptr || output[0] == '\0') {
+      return nullptr;
+    }
+
+    const char *sceneName = std::getenv("BENCHMARK_NAME");
+    uint32_t frames = environmentCount("BENCHMARK_FRAMES", DEFAULT_FRAMES);
+    uint32_t warmup = environmentCount("BENCHMARK_WARMUP", DEFAULT_WARMUP);
+
+    auto benchmark = std::make_unique<Benchmark>(sceneName != nullptr ? sceneName : name, output,
+                                                 std::max(1u, frames), warmup);
+    benchmark->loadStart = loadStart;
+    return benchmark;
+  }
+
+  Benchmark(std::string name, std::string outputPath, uint32_t frames, uint32_t warmup)
+      : name(std::move(name)),
+        outputPath(std::move(outputPath)),
+        measuredFrames(frames),
+        warmupFrames(warmup) {
+    glGenQueries(QUERIES, startQueries);
+    glGenQueries(QUERIES, endQueries);
+    glGenQueries(QUERIES, primitiveQueries);
+    samples.reserve(frames);
+  }
+
+  Benchmark(const Benchmark &) = delete;
+  Benchmark &operator=(const Benchmark &) = delete;
+
+  ~Benchmark() {
+    uninstallDrawCounters();
+    glDeleteQueries(QUERIES, startQueries);
+    glDeleteQueries(QUERIES, endQueries);
+    glDeleteQueries(QUERIES, primitiveQueries);
+  }
+
+  // The benchmark's clock, in seconds
+  double time() const {
+    return frame * TIME_STEP;
+  }
+
+  // Whether every frame was measured
+  bool isComplete() const {
+    return frame >= warmupFrames + measuredFrames;
+  }
+
+  // Starts the next frame, called before the demo renders anything
+  void beginFrame() {
+    if (inFrame || isComplete()) {
+      return;
+    }
+
+    // The demos load their extra OpenGL functions (GL43.hpp) after creating the window
+    installDrawCounters();
+
+    auto now = std::chrono::steady_clock::now();
+
+    if (!lastFrameStart.has_value()) {
+      loadMilliseconds = std::chrono::duration<double, std::milli>(now - loadStart).count();
+    }
+
+    // The total time of the previous frame is only known now
+    if (lastFrameStart.has_value() && frame > warmupFrames) {
+      samples[frame - warmupFrames - 1].frameMilliseconds =
+          std::chrono::duration<double, std::milli>(now - *lastFrameStart).count();
+    }
+
+    lastFrameStart = now;
+    inFrame = true;
+    drawCalls = 0;
+    frameStartAllocations = allocations();
+
+    if (isMeasured()) {
+      // The GPU is too far behind, wait for the oldest frame rather than losing it
+      if (pending[next]) {
+        readQueries(next, true);
+      }
+
+      glQueryCounter(startQueries[next], GL_TIMESTAMP);
+      glBeginQuery(GL_PRIMITIVES_GENERATED, primitiveQueries[next]);
+    }
+  }
+
+  // Ends the frame, called before swapping the buffers
+  void endFrame() {
+    if (!inFrame) {
+      return;
+    }
+
+    if (isMeasured()) {
+      glEndQuery(GL_PRIMITIVES_GENERATED);
+      glQueryCounter(endQueries[next], GL_TIMESTAMP);
+
+      FrameSample sample;
+      sample.cpuMilliseconds =
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                    *lastFrameStart).count();
+      sample.drawCalls = drawCalls;
+      sample.allocations = allocations() - frameStartAllocations;
+      samples.push_back(sample);
+
+      pending[next] = true;
+      sampleIndices[next] = (uint32_t) samples.size() - 1;
+      next = (next + 1) % QUERIES;
+      collect();
+    }
+
+    inFrame = false;
+    frame++;
+  }
+
+  /**
+   * Reads back the remaining GPU results and writes the results, once.
+   *
+   * @param width The framebuffer's width, reported in the results
+   * @param height The framebuffer's height
+   */
+  void finish(int32_t width, int32_t height) {
+    if (finished) {
+      return;
+    }
+
+    finished = true;
+
+    for (uint32_t i = 0; i < QUERIES; i++) {
+      uint32_t index = (next + i) % QUERIES;
+
+      if (pending[index]) {
+        readQueries(index, true);
+      }
+    }
+
+    // The last frame's total time ends with its buffer swap
+    if (lastFrameStart.has_value() && !samples.empty() &&
+        samples.back().frameMilliseconds == 0.0) {
+      glFinish();
+      samples.back().frameMilliseconds =
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                    *lastFrameStart).count();
+    }
+
+    uninstallDrawCounters();
+    write(width, height);
+  }
+
+private:
+  static constexpr uint32_t DEFAULT_FRAMES = 300;
+  static constexpr uint32_t DEFAULT_WARMUP = 30;
+  // The number of frames the GPU results can lag behind
+  static constexpr uint32_t QUERIES = 4;
+
+  struct FrameSample {
+    double cpuMilliseconds = 0.0;
+    double frameMilliseconds = 0.0;
+    double gpuMilliseconds = 0.0;
+    uint64_t drawCalls = 0;
+    uint64_t primitives = 0;
+    uint64_t allocations = 0;
+  };
+
+  struct Statistics {
+    double mean = 0.0, p50 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0;
+  };
+
+  std::string name;
+  std::string outputPath;
+  uint32_t measuredFrames;
+  uint32_t warmupFrames;
+  std::chrono::steady_clock::time_point loadStart = std::chrono::steady_clock::now();
+  double loadMilliseconds = 0.0;
+
+  // The frames rendered so far, including the warm-up ones
+  uint32_t frame = 0;
+  bool inFrame = false;
+  bool finished = false;
+  std::optional<std::chrono::steady_clock::time_point> lastFrameStart;
+  std::vector<FrameSample> samples;
+  uint64_t frameStartAllocations = 0;
+
+  uint32_t startQueries[QUERIES];
+  uint32_t endQueries[QUERIES];
+  uint32_t primitiveQueries[QUERIES];
+  bool pending[QUERIES] = {};
+  // The sample each query in flight measures
+  uint32_t sampleIndices[QUERIES] = {};
+  // The queries used by the next frame, which are also the oldest ones in flight
+  uint32_t next = 0;
+
+  // Draw calls of the current frame, counted by the functions replacing glad's
+  static inline uint64_t drawCalls = 0;
+  static inline bool countersInstalled = false;
+  static inline PFNGLDRAWARRAYSPROC drawArrays = nullptr;
+  static inline PFNGLDRAWELEMENTSPROC drawElements = nullptr;
+  static inline PFNGLDRAWARRAYSINSTANCEDPROC drawArraysInstanced = nullptr;
+  static inline PFNGLDRAWELEMENTSINSTANCEDPROC drawElementsInstanced = nullptr;
+  static inline PFNGLMULTIDRAWELEMENTSINDIRECTPROC multiDrawElementsIndirect = nullptr;
+
+  static uint32_t environmentCount(const char *variable, uint32_t defaultValue) {
+    const char *value = std::getenv(variable);
+    return value != nullptr ? (uint32_t) std::max(0, std::atoi(value)) : defaultValue;
+  }
+
+  bool isMeasured() const {
+    return frame >= warmupFrames && frame < warmupFrames + measuredFrames;
+  }
+
+  // Reads back the available results, oldest first
+  void collect() {
+    for (uint32_t i = 0; i < QUERIES; i++) {
+      uint32_t index = (next + i) % QUERIES;
+
+      if (pending[index] && !readQueries(index, false)) {
+        // Later queries can't be ready either
+        break;
+      }
+    }
+  }
+
+  /**
+   * Reads back the results of a frame's queries into its sample.
+   *
+   * @param index The queries' index in the ring
+   * @param wait Whether to wait for the results rather than return if they aren't available
+   * @return Whether the results were read
+   */
+  bool readQueries(uint32_t index, bool wait) {
+    if (!wait) {
+      // The other results are available once the end timestamp is
+      int32_t available = 0;
+      glGetQueryObjectiv(endQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+
+      if (!available) {
+        return false;
+      }
+    }
+
+    uint64_t start, end, primitives;
+    glGetQueryObjectui64v(startQueries[index], GL_QUERY_RESULT, &start);
+    glGetQueryObjectui64v(endQueries[index], GL_QUERY_RESULT, &end);
+    glGetQueryObjectui64v(primitiveQueries[index], GL_QUERY_RESULT, &primitives);
+    pending[index] = false;
+
+    FrameSample &sample = samples[sampleIndices[index]];
+    sample.gpuMilliseconds = (double) (end - start) / 1.0e6;
+    sample.primitives = primitives;
+
+    return true;
+  }
+
+  static void APIENTRY countDrawArrays(GLenum mode, GLint first, GLsizei count) {
+    drawCalls++;
+    drawArrays(mode, first, count);
+  }
+
+  static void APIENTRY countDrawElements(GLenum mode, GLsizei count, GLenum type,
+                                         const void *indices) {
+    drawCalls++;
+    drawElements(mode, count, type, indices);
+  }
+
+  static void APIENTRY countDrawArraysInstanced(GLenum mode, GLint first, GLsizei count,
+                                                GLsizei instanceCount) {
+    drawCalls++;
+    drawArraysInstanced(mode, first, count, instanceCount);
+  }
+
+  static void APIENTRY countDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
+                                                  const void *indices, GLsizei instanceCount) {
+    drawCalls++;
+    drawElementsInstanced(mode, count, type, indices, instanceCount);
+  }
+
+  static void APIENTRY countMultiDrawElementsIndirect(GLenum mode, GLenum type,
+                                                      const void *indirect, GLsizei drawCount,
+                                                      GLsizei stride) {
+    drawCalls++;
+    multiDrawElementsIndirect(mode, type, indirect, drawCount, stride);
+  }
+
+  // Replaces the draw functions loaded by glad with ones counting the calls
+  static void installDrawCounters() {
+    if (countersInstalled) {
+      return;
+    }
+
+    countersInstalled = true;
+    drawArrays = glDrawArrays;
+    drawElements = glDrawElements;
+    drawArraysInstanced = glDrawArraysInstanced;
+    drawElementsInstanced = glDrawElementsInstanced;
+    multiDrawElementsIndirect = glMultiDrawElementsIndirect;
+    glDrawArrays = countDrawArrays;
+    glDrawElements = countDrawElements;
+    glDrawArraysInstanced = countDrawArraysInstanced;
+    glDrawElementsInstanced = countDrawElementsInstanced;
+
+    // Only loaded by the demos requiring OpenGL 4.3
+    if (multiDrawElementsIndirect != nullptr) {
+      glMultiDrawElementsIndirect = countMultiDrawElementsIndirect;
+    }
+  }
+
+  static void uninstallDrawCounters() {
+    if (!countersInstalled) {
+      return;
+    }
+
+    countersInstalled = false;
+    glDrawArrays = drawArrays;
+    glDrawElements = drawElements;
+    glDrawArraysInstanced = drawArraysInstanced;
+    glDrawElementsInstanced = drawElementsInstanced;
+
+    if (multiDrawElementsIndirect != nullptr) {
+      glMultiDrawElementsIndirect = multiDrawElementsIndirect;
+    }
+  }
+
+  // The mean, and the percentiles with the nearest-rank method
+  static Statistics statistics(std::vector<double> values) {
+    Statistics result;
+
+    if (values.empty()) {
+      return result;
+    }
+
+    std::sort(values.begin(), values.end());
+
+    for (double value : values) {
+      result.mean += value;
+    }
+
+    result.mean /= (double) values.size();
+
+    auto percentile = [&](double p) {
+      size_t rank = (size_t) std::ceil(p / 100.0 * (double) values.size());
+      return values[std::clamp(rank, (size_t) 1, values.size()) - 1];
+    };
+
+    result.p50 = percentile(50.0);
+    result.p95 = percentile(95.0);
+    result.p99 = percentile(99.0);
+    result.max = values.back();
+
+    return result;
+  }
+
+  static std::string escape(const std::string &text) {
+    std::string escaped;
+
+    for (char c : text) {
+      if (c == '"' || c == '\\') {
+        escaped += '\\';
+        escaped += c;
+      } else if ((unsigned char) c >= 0x20) {
+        escaped += c;
+      }
+    }
+
+    return escaped;
+  }
+
+  void writeStatistics(FILE *file, const char *key, double FrameSample::*field) const {
+    std::vector<double> values;
+    values.reserve(samples.size());
+
+    for (const FrameSample &sample : samples) {
+      values.push_back(sample.*field);
+    }
+
+    Statistics s = statistics(values);
+    std::fprintf(file,
+                 "  \"%s\": {\"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, "
+                 "\"max\": %.4f},\n", key, s.mean, s.p50, s.p95, s.p99, s.max);
+  }
+
+  void writeCountStatistics(FILE *file, const char *key, uint64_t FrameSample::*field) const {
+    std::vector<double> values;
+    values.reserve(samples.size());
+
+    for (const FrameSample &sample : samples) {
+      values.push_back((double) (sample.*field));
+    }
+
+    Statistics s = statistics(values);
+    std::fprintf(file,
+                 "  \"%s\": {\"mean\": %.1f, \"p50\": %.0f, \"p95\": %.0f, \"p99\": %.0f, "
+                 "\"max\": %.0f},\n", key, s.mean, s.p50, s.p95, s.p99, s.max);
+  }
+
+  // The per-frame values, for statistics over several runs
+  void writeSamples(FILE *file, const char *key, double FrameSample::*field,
+                    bool last) const {
+    std::fprintf(file, "    \"%s\": [", key);
+
+    for (size_t i = 0; i < samples.size(); i++) {
+      std::fprintf(file, i == 0 ? "%.4f" : ", %.4f", samples[i].*field);
+    }
+
+    std::fprintf(file, last ? "]\n" : "],\n");
+  }
+
+  void write(int32_t width, int32_t height) const {
+    FILE *file = std::fopen(outputPath.c_str(), "w");
+
+    if (file == nullptr) {
+      std::cout << "ERROR: Failed to write the benchmark results to " << outputPath << "."
+                << std::endl;
+      return;
+    }
+
+    const char *renderer = (const char *) glGetString(GL_RENDERER);
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"name\": \"%s\",\n", escape(name).c_str());
+    std::fprintf(file, "  \"renderer\": \"%s\",\n",
+                 escape(renderer != nullptr ? renderer : "").c_str());
+    std::fprintf(file, "  \"width\": %d,\n  \"height\": %d,\n", width, height);
+    std::fprintf(file, "  \"warmup_frames\": %u,\n  \"frames\": %zu,\n", warmupFrames,
+                 samples.size());
+    std::fprintf(file, "  \"load_ms\": %.4f,\n", loadMilliseconds);
+    writeStatistics(file, "cpu_ms", &FrameSample::cpuMilliseconds);
+    writeStatistics(file, "frame_ms", &FrameSample::frameMilliseconds);
+    writeStatistics(file, "gpu_ms", &FrameSample::gpuMilliseconds);
+    writeCountStatistics(file, "draw_calls", &FrameSample::drawCalls);
+    writeCountStatistics(file, "triangles", &FrameSample::primitives);
+
+    if (allocationsCounted) {
+      writeCountStatistics(file, "allocations", &FrameSample::allocations);
+    }
+
+    std::fprintf(file, "  \"samples\": {\n");
+    writeSamples(file, "cpu_ms", &FrameSample::cpuMilliseconds, false);
+    writeSamples(file, "frame_ms", &FrameSample::frameMilliseconds, false);
+    writeSamples(file, "gpu_ms", &FrameSample::gpuMilliseconds, true);
+    std::fprintf(file, "  }\n}\n");
+    std::fclose(file);
+
+    std::cout << "Benchmark results written to " << outputPath << "." << std::endl;
+  }
+};
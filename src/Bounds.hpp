@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+
+/**
+ * An axis-aligned bounding box. A default-constructed box is empty (min > max)
+ * so that it can be grown with expand().
+ */
+struct AABB {
+  glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+  glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+  bool isEmpty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+  }
+
+  void expand(const glm::vec3 &point) {
+    min = glm::min(min, point);
+    max = glm::max(max, point);
+  }
+
+  void expand(const AABB &other) {
+    min = glm::min(min, other.min);
+    max = glm::max(max, other.max);
+  }
+
+  glm::vec3 center() const {
+    return (min + max) * 0.5f;
+  }
+
+  // Half the size of the box on each axis
+  glm::vec3 extents() const {
+    return (max - min) * 0.5f;
+  }
+
+  /**
+   * Computes the box enclosing this box after it has been transformed.
+   * Uses Arvo's method, which avoids transforming all eight corners.
+   *
+   * @param matrix An affine transformation matrix
+   * @return The transformed box
+   */
+  AABB transform(const glm::mat4 &matrix) const {
+    glm::vec3 newCenter = glm::vec3(matrix * glm::vec4(center(), 1.0f));
+    glm::vec3 oldExtents = extents();
+    glm::vec3 newExtents;
+
+    for (int32_t i = 0; i < 3; i++) {
+      newExtents[i] = std::abs(matrix[0][i]) * oldExtents.x +
+                      std::abs(matrix[1][i]) * oldExtents.y +
+                      std::abs(matrix[2][i]) * oldExtents.z;
+    }
+
+    AABB result;
+    result.min = newCenter - newExtents;
+    result.max = newCenter + newExtents;
+    return result;
+  }
+};
+
+struct BoundingSphere {
+  glm::vec3 center = glm::vec3(0.0f);
+  float radius = 0.0f;
+
+  /**
+   * Computes the sphere enclosing this sphere after it has been transformed.
+   * Non-uniform scaling is handled by using the largest axis scale.
+   *
+   * @param matrix An affine transformation matrix
+   * @return The transformed sphere
+   */
+  BoundingSphere transform(const glm::mat4 &matrix) const {
+    float scaleX = glm::length(glm::vec3(matrix[0]));
+    float scaleY = glm::length(glm::vec3(matrix[1]));
+    float scaleZ = glm::length(glm::vec3(matrix[2]));
+
+    BoundingSphere result;
+    result.center = glm::vec3(matrix * glm::vec4(center, 1.0f));
+    result.radius = radius * std::fmax(scaleX, std::fmax(scaleY, scaleZ));
+    return result;
+  }
+};
+
+/**
+ * Computes the bounding box of a set of positions.
+ *
+ * @param positions Pointer to the first position
+ * @param count The number of positions
+ * @param stride The distance in bytes between two consecutive positions
+ * @return The bounding box (empty if count is 0)
+ */
+inline AABB computeAABB(const glm::vec3 *positions, size_t count, size_t stride) {
+  AABB aabb;
+  const auto *bytes = reinterpret_cast<const uint8_t *>(positions);
+
+  for (size_t i = 0; i < count; i++) {
+    aabb.expand(*reinterpret_cast<const glm::vec3 *>(bytes + i * stride));
+  }
+
+  return aabb;
+}
+
+/**
+ * Computes a bounding sphere of a set of positions. The sphere is centered on
+ * the bounding box, but its radius is the distance to the farthest position,
+ * which is tighter than the box's half-diagonal for most meshes.
+ *
+ * @param positions Pointer to the first position
+ * @param count The number of positions
+ * @param stride The distance in bytes between two consecutive positions
+ * @param aabb The bounding box of the positions (see computeAABB())
+ * @return The bounding sphere
+ */
+inline BoundingSphere computeBoundingSphere(const glm::vec3 *positions, size_t count, size_t stride,
+                                            const AABB &aabb) {
+  BoundingSphere sphere;
+
+  if (aabb.isEmpty()) {
+    return sphere;
+  }
+
+  sphere.center = aabb.center();
+  float radiusSquared = 0.0f;
+  const auto *bytes = reinterpret_cast<const uint8_t *>(positions);
+
+  for (size_t i = 0; i < count; i++) {
+    glm::vec3 offset = *reinterpret_cast<const glm::vec3 *>(bytes + i * stride) - sphere.center;
+    radiusSquared = std::fmax(radiusSquared, glm::dot(offset, offset));
+  }
+
+  sphere.radius = std::sqrt(radiusSquared);
+  return sphere;
+}
@@ -10,14 +10,15 @@
 
 #include <stb_image.h>
 #include "Shader.hpp"
+#include "Window.hpp"
 
 void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
 }
 
-void processInput(GLFWwindow *window) {
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
   }
 }
 
@@ -25,28 +26,14 @@ int32_t main() {
   constexpr int32_t screenWidth = 800;
   constexpr int32_t screenHeight = 800;
 
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(screenWidth, screenHeight, "Camera");
 
-  GLFWwindow *window = glfwCreateWindow(screenWidth, screenHeight, "Camera", nullptr, nullptr);
-  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-
-  if (window == nullptr) {
-    std::cout << "Failed to create GLFW window." << std::endl;
-    glfwTerminate();
+  if (!window.isOpen()) {
     return -1;
   }
 
-  // GLFW doesn't mark the context as current automatically
-  // <https://stackoverflow.com/questions/48650497/glad-failing-to-initialize>
-  glfwMakeContextCurrent(window);
-
-  if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-    std::cout << "ERROR: Failed to initialize GLAD." << std::endl;
-    return -1;
-  }
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
 
   glViewport(0, 0, screenWidth, screenHeight);
 
@@ -231,7 +218,7 @@ int32_t main() {
   projection = glm::perspective(glm::radians(45.0f), (float) screenWidth / (float) screenHeight,
                                 0.1f, 100.0f);
 
-  while (!glfwWindowShouldClose(window)) {
+  while (!window.shouldClose()) {
     processInput(window);
 
     // Clear the viewport with a constant color
@@ -240,8 +227,8 @@ int32_t main() {
 
     // Make the camera rotate in a circle around the center point
     float radius = 10.0f;
-    double cameraX = sin(glfwGetTime()) * radius;
-    double cameraZ = cos(glfwGetTime()) * radius;
+    double cameraX = sin(window.time()) * radius;
+    double cameraZ = cos(window.time()) * radius;
     glm::vec3 cameraPosition = glm::vec3(cameraX, 0.0f, cameraZ);
     glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
     // Use an "up" vector to determine the camera's right axis using a cross product
@@ -260,7 +247,7 @@ int32_t main() {
       glm::mat4 model;
       model = glm::translate(model, cubePositions[i]);
       float angle = 20.0f * i;
-      model = glm::rotate(model, glm::radians(angle) + (float) glfwGetTime() * glm::radians(30.0f),
+      model = glm::rotate(model, glm::radians(angle) + (float) window.time() * glm::radians(30.0f),
                           glm::vec3(1.0f, 0.3f, 0.5f));
 
       int32_t modelLoc = glGetUniformLocation(shaderProgram.id, "model");
@@ -269,14 +256,13 @@ int32_t main() {
       glDrawArrays(GL_TRIANGLES, 0, 36);
     }
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    window.swapBuffers();
+    window.pollEvents();
   }
 
   // Clean up
   glDeleteVertexArrays(1, &vao);
   glDeleteBuffers(1, &vbo);
-  glfwTerminate();
 
   return 0;
 }
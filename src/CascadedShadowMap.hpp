@@ -0,0 +1,293 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Bounds.hpp"
+#include "Culling.hpp"
+#include "Frustum.hpp"
+#include "Shader.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * Cascaded shadow maps for a directional light: the camera's view frustum is
+ * split into depth ranges, each covered by its own shadow map, so that the
+ * shadow resolution near the camera doesn't depend on how far the shadows
+ * reach.
+ *
+ * Each cascade's projection is fit around a bounding sphere of its slice of
+ * the view frustum, whose size doesn't change as the camera rotates, and is
+ * snapped to whole shadow map texels, so that shadow edges don't shimmer as
+ * the camera moves.
+ *
+ * The casters are culled against every cascade in parallel, one cascade per
+ * worker thread, and each visible caster is then drawn once: a geometry shader
+ * copies its triangles to the layers of the cascades it is visible in.
+ */
+class CascadedShadowMap {
+public:
+  static constexpr uint32_t MAX_CASCADES = 4;
+
+  /**
+   * A caster to draw, and the cascades it is visible in.
+   */
+  struct CasterDraw {
+    uint32_t caster;
+    // Bit i is set if the caster is visible in cascade i
+    int32_t cascadeMask;
+  };
+
+  uint32_t cascades;
+  int32_t size;
+  // The combined projection and view matrix of each cascade
+  glm::mat4 lightSpaces[MAX_CASCADES];
+  // The view-space distance where each cascade ends
+  float splits[MAX_CASCADES];
+
+  /**
+   * @param cascades The number of cascades, at most MAX_CASCADES
+   * @param size The width and height of each cascade's shadow map
+   * @param splitLambda How logarithmic (1) rather than uniform (0) the split distances are
+   */
+  CascadedShadowMap(ThreadPool &threadPool, uint32_t cascades = 4, int32_t size = 2048,
+                    float splitLambda = 0.75f)
+      : cascades(std::min(cascades, MAX_CASCADES)),
+        size(size),
+        threadPool(threadPool),
+        casterShader(Shader("../resources/shaders/cascade_shadow.vertex.glsl",
+                            "../resources/shaders/cascade_shadow.geometry.glsl",
+                            "../resources/shaders/depth_prepass.fragment.glsl",
+                            defines() + "#define CASCADE_VERTICES " +
+                            std::to_string(3 * this->cascades) + "\n")),
+        splitLambda(splitLambda) {
+    glGenTextures(1, &depthArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size,
+                 (GLsizei) this->cascades, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    // Sampled with hardware depth comparisons, which are bilinearly filtered
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // Attaching the whole array makes the framebuffer layered, the geometry shader selects the
+    // layer of each primitive
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cout << "ERROR: The cascaded shadow map framebuffer is incomplete." << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  /**
+   * Fits the cascades to the camera's view frustum, and culls the casters
+   * against each cascade on worker threads.
+   *
+   * @param view The camera's view matrix
+   * @param fov The camera's vertical field of view, in radians
+   * @param aspect The camera's aspect ratio
+   * @param near The camera's near plane distance
+   * @param shadowDistance The view-space distance up to which shadows are rendered
+   * @param lightDirection The direction the light shines in
+   * @param sceneBounds The world-space bounds of every caster, which must be included in each
+   *                    cascade's depth range even when outside of its slice
+   * @param casterBounds The world-space bounding box of each caster
+   */
+  void update(const glm::mat4 &view, float fov, float aspect, float near, float shadowDistance,
+              const glm::vec3 &lightDirection, const AABB &sceneBounds,
+              const std::vector<AABB> &casterBounds) {
+    glm::vec3 forward = glm::normalize(lightDirection);
+    // Any up vector works as long as it isn't parallel to the light
+    glm::vec3 up = std::fabs(forward.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f)
+                                                : glm::vec3(0.0f, 1.0f, 0.0f);
+    // Only rotates, so that snapping to texels in light space is independent of the scene
+    glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), forward, up);
+    glm::mat4 inverseView = glm::inverse(view);
+
+    // Depth range of the whole scene along the light
+    float minDepth = std::numeric_limits<float>::max();
+    float maxDepth = -std::numeric_limits<float>::max();
+
+    for (int32_t corner = 0; corner < 8; corner++) {
+      glm::vec3 position = glm::vec3(corner & 1 ? sceneBounds.max.x : sceneBounds.min.x,
+                                     corner & 2 ? sceneBounds.max.y : sceneBounds.min.y,
+                                     corner & 4 ? sceneBounds.max.z : sceneBounds.min.z);
+      float depth = (lightView * glm::vec4(position, 1.0f)).z;
+      minDepth = std::min(minDepth, depth);
+      maxDepth = std::max(maxDepth, depth);
+    }
+
+    float tanHalfFov = std::tan(fov * 0.5f);
+    float sliceNear = near;
+
+    for (uint32_t i = 0; i < cascades; i++) {
+      // Blend logarithmic splits, which match the perspective's resolution falloff, with uniform
+      // ones, which keep the first cascades from being too small
+      float fraction = (float) (i + 1) / (float) cascades;
+      float logarithmic = near * std::pow(shadowDistance / near, fraction);
+      float uniform = near + (shadowDistance - near) * fraction;
+      float sliceFar = splitLambda * logarithmic + (1.0f - splitLambda) * uniform;
+      splits[i] = sliceFar;
+
+      // Bounding sphere of the slice, computed in view space so that its size doesn't change as
+      // the camera rotates. Its center lies on the view axis, where the farthest points are the
+      // near and far corners.
+      float nearHalfDiagonal = sliceNear * tanHalfFov * std::sqrt(1.0f + aspect * aspect);
+      float farHalfDiagonal = sliceFar * tanHalfFov * std::sqrt(1.0f + aspect * aspect);
+      // Distance along the view axis minimizing the larger of the two distances
+      float centerDistance = std::min(
+          sliceFar,
+          0.5f * (sliceNear + sliceFar) +
+          (farHalfDiagonal * farHalfDiagonal - nearHalfDiagonal * nearHalfDiagonal) /
+          (2.0f * (sliceFar - sliceNear)));
+      float radius = std::sqrt((sliceFar - centerDistance) * (sliceFar - centerDistance) +
+                               farHalfDiagonal * farHalfDiagonal);
+      // Round up so that floating-point noise doesn't change the texel size
+      radius = std::ceil(radius * 16.0f) / 16.0f;
+      glm::vec3 center = glm::vec3(inverseView * glm::vec4(0.0f, 0.0f, -centerDistance, 1.0f));
+
+      // Snap the center to whole texels in light space
+      float texelSize = 2.0f * radius / (float) size;
+      glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+      lightCenter.x = std::floor(lightCenter.x / texelSize) * texelSize;
+      lightCenter.y = std::floor(lightCenter.y / texelSize) * texelSize;
+
+      // The view looks down -Z, the depth range covers every caster of the scene
+      glm::mat4 projection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius,
+                                        lightCenter.y - radius, lightCenter.y + radius,
+                                        -std::max(maxDepth, lightCenter.z + radius),
+                                        -std::min(minDepth, lightCenter.z - radius));
+      lightSpaces[i] = projection * lightView;
+      sliceNear = sliceFar;
+    }
+
+    cullCasters(casterBounds);
+  }
+
+  // The casters to draw, in the order they were given to update()
+  const std::vector<CasterDraw> &draws() const {
+    return casterDraws;
+  }
+
+  /**
+   * Binds and clears the shadow map array, and binds the caster shader. Its
+   * "model" and "cascadeMask" uniforms must be set for each caster drawn (see
+   * draws()).
+   */
+  Shader &begin() {
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, size, size);
+    glDepthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    // Slope-scaled bias, pushing the casters' depth back to avoid self-shadowing artifacts
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+
+    casterShader.use();
+
+    for (uint32_t i = 0; i < cascades; i++) {
+      casterShader.setMat4("lightSpaces[" + std::to_string(i) + "]", lightSpaces[i]);
+    }
+
+    return casterShader;
+  }
+
+  // Restores the default framebuffer and the viewport
+  void end() {
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  }
+
+  /**
+   * Sets the uniforms read by the lighting shaders' cascade sampling code, and
+   * binds the shadow map array.
+   *
+   * @param shader The lighting shader, which must be bound
+   * @param unit The texture unit to bind the shadow map array to
+   */
+  void setUniforms(Shader &shader, int32_t unit) {
+    for (uint32_t i = 0; i < cascades; i++) {
+      std::string index = "[" + std::to_string(i) + "]";
+      shader.setMat4("cascadeLightSpaces" + index, lightSpaces[i]);
+      shader.setFloat("cascadeSplits" + index, splits[i]);
+    }
+
+    shader.setInt("cascadeShadowMap", unit);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, depthArray);
+  }
+
+  // The preprocessor definitions the lighting shaders must be compiled with
+  std::string defines() const {
+    return "#define CASCADES " + std::to_string(cascades) + "\n";
+  }
+
+private:
+  ThreadPool &threadPool;
+  Shader casterShader;
+  float splitLambda;
+  uint32_t fbo, depthArray;
+  int32_t viewport[4];
+
+  BoundsBatch casterBatch;
+  std::vector<uint32_t> visibleCasters[MAX_CASCADES];
+  std::vector<int32_t> casterMasks;
+  std::vector<CasterDraw> casterDraws;
+  std::vector<std::future<void>> cullJobs;
+
+  void cullCasters(const std::vector<AABB> &casterBounds) {
+    casterBatch.clear();
+
+    for (const AABB &bounds : casterBounds) {
+      casterBatch.add(bounds);
+    }
+
+    // One job per cascade
+    for (uint32_t i = 0; i < cascades; i++) {
+      cullJobs.push_back(threadPool.submit([this, i] {
+        casterBatch.cull(Frustum(lightSpaces[i]), visibleCasters[i]);
+      }));
+    }
+
+    for (std::future<void> &job : cullJobs) {
+      job.get();
+    }
+
+    cullJobs.clear();
+
+    // Merge the cascades' lists into one draw per caster
+    casterMasks.assign(casterBounds.size(), 0);
+
+    for (uint32_t i = 0; i < cascades; i++) {
+      for (uint32_t caster : visibleCasters[i]) {
+        casterMasks[caster] |= 1 << i;
+      }
+    }
+
+    casterDraws.clear();
+
+    for (uint32_t caster = 0; caster < (uint32_t) casterMasks.size(); caster++) {
+      if (casterMasks[caster] != 0) {
+        casterDraws.push_back({caster, casterMasks[caster]});
+      }
+    }
+  }
+};
@@ -0,0 +1,279 @@
+#include <iostream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cmath>
+#include <vector>
+#include "Model.hpp"
+#include "LightClusters.hpp"
+#include "NormalMatrix.hpp"
+#include "Window.hpp"
+
+// Stored globally so it can be modified in framebufferSizeCallback() and used in main()
+glm::mat4 projection;
+
+// The field of view
+constexpr float FOV = 50.0f;
+
+// Near and far plane distances, also used to slice the clusters
+constexpr float NEAR_PLANE = 0.1f;
+constexpr float FAR_PLANE = 100.0f;
+
+// The number of point and spot lights moving around the scene
+constexpr uint32_t POINT_LIGHTS = 1000;
+constexpr uint32_t SPOT_LIGHTS = 64;
+
+// The number of cubes on each side of the grid
+constexpr int32_t GRID_SIZE = 12;
+
+void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+  glViewport(0, 0, width, height);
+  projection = glm::perspective(glm::radians(FOV), (float) width / (float) height, NEAR_PLANE,
+                                FAR_PLANE);
+}
+
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
+  }
+}
+
+// Returns a fully saturated color for a hue between 0 and 1
+glm::vec3 hueColor(float hue) {
+  hue *= 6.0f;
+  return glm::clamp(glm::vec3(std::abs(hue - 3.0f) - 1.0f, 2.0f - std::abs(hue - 2.0f),
+                              2.0f - std::abs(hue - 4.0f)), 0.0f, 1.0f);
+}
+
+int32_t main() {
+  // The initial window size
+  constexpr int32_t SCREEN_WIDTH = 1280;
+  constexpr int32_t SCREEN_HEIGHT = 720;
+
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(SCREEN_WIDTH, SCREEN_HEIGHT, "Clustered Lighting");
+
+  if (!window.isOpen()) {
+    return -1;
+  }
+
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
+
+  glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+  Shader containerShader = Shader(
+      "../resources/shaders/clustered_lights.vertex.glsl",
+      "../resources/shaders/clustered_lights.fragment.glsl"
+  );
+
+  // The cube's vertice and normal coordinates
+  float vertices[] = {
+      // Positions          // Normals           // Texture coordinates
+      -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+      0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f,
+      -0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+
+      -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
+      -0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+
+      -0.5f, 0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+      -0.5f, 0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+      -0.5f, 0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+
+      0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
+      0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, -0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+
+      -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+      -0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+      -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+
+      -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+      -0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+      -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+  };
+
+  // Lay out a grid of cubes
+  std::vector<glm::mat4> cubeModels;
+
+  for (int32_t x = 0; x < GRID_SIZE; x++) {
+    for (int32_t z = 0; z < GRID_SIZE; z++) {
+      glm::mat4 model;
+      model = glm::translate(model, glm::vec3(x - GRID_SIZE / 2, 0.0f, z - GRID_SIZE / 2) * 2.0f);
+      model = glm::rotate(model, glm::radians(15.0f * (x + z)), glm::vec3(0.0f, 1.0f, 0.0f));
+      cubeModels.push_back(model);
+    }
+  }
+
+  // The cubes are only rotated and translated, so their normal matrices are the model matrices'
+  // upper 3x3 part
+  std::vector<glm::mat3> cubeNormalMatrices(cubeModels.size());
+  computeNormalMatrices(cubeModels.data(), cubeNormalMatrices.data(), cubeModels.size(), true);
+
+  // Scatter small, quickly attenuated colored point lights between the cubes
+  std::vector<PointLight> pointLights(POINT_LIGHTS);
+  std::vector<float> lightOrbits(POINT_LIGHTS);
+
+  for (uint32_t i = 0; i < POINT_LIGHTS; i++) {
+    pointLights[i].color = hueColor((float) i / (float) POINT_LIGHTS);
+    pointLights[i].linear = 0.7f;
+    pointLights[i].quadratic = 1.8f;
+    lightOrbits[i] = 1.0f + (float) ((i * 7919) % 1000) / 1000.0f * GRID_SIZE;
+  }
+
+  // Spot lights hanging above the grid, sweeping the cubes
+  std::vector<SpotLight> spotLights(SPOT_LIGHTS);
+
+  for (uint32_t i = 0; i < SPOT_LIGHTS; i++) {
+    int32_t x = (int32_t) (i % 8) - 4;
+    int32_t z = (int32_t) (i / 8) - 4;
+    spotLights[i].position = glm::vec3(x * 3.0f + 1.5f, 4.0f, z * 3.0f + 1.5f);
+    spotLights[i].color = glm::vec3(0.6f) + hueColor((float) i / (float) SPOT_LIGHTS) * 0.4f;
+    spotLights[i].linear = 0.09f;
+    spotLights[i].quadratic = 0.032f;
+    spotLights[i].innerCutoff = glm::cos(glm::radians(15.0f));
+    spotLights[i].outerCutoff = glm::cos(glm::radians(20.0f));
+  }
+
+  ThreadPool threadPool;
+  LightClusters lightClusters = LightClusters(threadPool);
+
+  // Load textures
+  uint32_t textureDiffuse = textureFromFile("container2_diffuse.png", "../resources/textures");
+  uint32_t textureSpecular = textureFromFile("container2_specular.png", "../resources/textures");
+
+  glEnable(GL_DEPTH_TEST);
+
+  // Initialize buffers (vertex array, vertex buffer)
+  uint32_t vao, vbo;
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &vbo);
+
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+  // Position attribute
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) nullptr);
+  glEnableVertexAttribArray(0);
+  // Normal attribute
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (3 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+  // Texture coordinates attribute
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (6 * sizeof(float)));
+  glEnableVertexAttribArray(2);
+
+  // Set the projection matrix here so it's defined on application start too
+  projection = glm::perspective(glm::radians(FOV), (float) SCREEN_WIDTH / (float) SCREEN_HEIGHT,
+                                NEAR_PLANE, FAR_PLANE);
+  uint32_t previousAverage = UINT32_MAX;
+
+  while (!window.shouldClose()) {
+    processInput(window);
+
+    // Clear the viewport with a constant color
+    glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // Make the camera rotate in a circle around the grid
+    float radius = 22.0f;
+    double cameraX = sin(window.time() * 0.2f) * radius;
+    double cameraZ = cos(window.time() * 0.2f) * radius;
+    glm::vec3 cameraPosition = glm::vec3(cameraX, 9.0f, cameraZ);
+    glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
+    // Use an "up" vector to determine the camera's right axis using a cross product
+    glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 view;
+    view = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
+
+    // Move the lights
+    float time = (float) window.time();
+
+    for (uint32_t i = 0; i < POINT_LIGHTS; i++) {
+      float angle = time * (0.2f + 0.3f * (float) (i % 5) / 5.0f) + (float) i;
+      pointLights[i].position = glm::vec3(std::sin(angle) * lightOrbits[i],
+                                          0.2f + 1.5f * (0.5f + 0.5f * std::sin(angle * 3.0f)),
+                                          std::cos(angle) * lightOrbits[i]);
+    }
+
+    for (uint32_t i = 0; i < SPOT_LIGHTS; i++) {
+      float angle = time + (float) i;
+      spotLights[i].direction = glm::vec3(std::sin(angle) * 0.5f, -1.0f, std::cos(angle) * 0.5f);
+    }
+
+    // Assign the lights to the clusters of this frame's view
+    int32_t windowWidth, windowHeight;
+    window.getFramebufferSize(&windowWidth, &windowHeight);
+    lightClusters.update(view, projection, NEAR_PLANE, FAR_PLANE, pointLights, spotLights);
+
+    containerShader.use();
+    containerShader.setMat4("view", view);
+    containerShader.setMat4("projection", projection);
+    containerShader.setVec3("viewPos", cameraPosition);
+    lightClusters.bind(containerShader, windowWidth, windowHeight);
+
+    // Set material properties
+    containerShader.setInt("material.diffuse", 0);
+    containerShader.setInt("material.specular", 1);
+    containerShader.setFloat("material.glossiness", 24.0f);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textureDiffuse);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, textureSpecular);
+
+    // Set directional light properties
+    containerShader.setVec3("directionalLight.direction", -0.2f, -1.0f, -0.3f);
+    containerShader.setVec3("directionalLight.ambient", 0.1f, 0.1f, 0.1f);
+    containerShader.setVec3("directionalLight.diffuse", 0.15f, 0.15f, 0.15f);
+    containerShader.setVec3("directionalLight.specular", 0.15f, 0.15f, 0.15f);
+
+    glBindVertexArray(vao);
+
+    for (size_t i = 0; i < cubeModels.size(); i++) {
+      containerShader.setMat4("model", cubeModels[i]);
+      containerShader.setMat3("normalMatrix", cubeNormalMatrices[i]);
+      glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
+
+    uint32_t clusters = (uint32_t) (lightClusters.tilesX * lightClusters.tilesY *
+                                    lightClusters.slices);
+    uint32_t average = lightClusters.indexCount() / clusters;
+
+    if (average != previousAverage) {
+      std::string title = "Clustered Lighting (" + std::to_string(POINT_LIGHTS + SPOT_LIGHTS) +
+                          " lights, " + std::to_string(average) + " per cluster on average)";
+      window.setTitle(title);
+      previousAverage = average;
+    }
+
+    window.swapBuffers();
+    window.pollEvents();
+  }
+
+  // Clean up
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+
+  return 0;
+}
@@ -10,14 +10,15 @@
 
 #include <stb_image.h>
 #include "Shader.hpp"
+#include "Window.hpp"
 
 void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
 }
 
-void processInput(GLFWwindow *window) {
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
   }
 }
 
@@ -25,29 +26,14 @@ int32_t main() {
   constexpr int32_t screenWidth = 800;
   constexpr int32_t screenHeight = 800;
 
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(screenWidth, screenHeight, "Coordinate Systems");
 
-  GLFWwindow *window = glfwCreateWindow(screenWidth, screenHeight, "Coordinate Systems", nullptr,
-                                        nullptr);
-  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-
-  if (window == nullptr) {
-    std::cout << "Failed to create GLFW window." << std::endl;
-    glfwTerminate();
+  if (!window.isOpen()) {
     return -1;
   }
 
-  // GLFW doesn't mark the context as current automatically
-  // <https://stackoverflow.com/questions/48650497/glad-failing-to-initialize>
-  glfwMakeContextCurrent(window);
-
-  if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-    std::cout << "ERROR: Failed to initialize GLAD." << std::endl;
-    return -1;
-  }
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
 
   glViewport(0, 0, screenWidth, screenHeight);
 
@@ -220,7 +206,7 @@ int32_t main() {
   // Set the texture unit that should be sampled as the overlay texture
   shaderProgram.setInt("textureOverlay", 1);
 
-  while (!glfwWindowShouldClose(window)) {
+  while (!window.shouldClose()) {
     processInput(window);
 
     // Clear the viewport with a constant color
@@ -244,7 +230,7 @@ int32_t main() {
       glm::mat4 model;
       model = glm::translate(model, cubePositions[i]);
       float angle = 20.0f * i;
-      model = glm::rotate(model, glm::radians(angle) + (float) glfwGetTime() * glm::radians(30.0f),
+      model = glm::rotate(model, glm::radians(angle) + (float) window.time() * glm::radians(30.0f),
                           glm::vec3(1.0f, 0.3f, 0.5f));
 
       int32_t modelLoc = glGetUniformLocation(shaderProgram.id, "model");
@@ -253,14 +239,13 @@ int32_t main() {
       glDrawArrays(GL_TRIANGLES, 0, 36);
     }
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    window.swapBuffers();
+    window.pollEvents();
   }
 
   // Clean up
   glDeleteVertexArrays(1, &vao);
   glDeleteBuffers(1, &vbo);
-  glfwTerminate();
 
   return 0;
 }
@@ -0,0 +1,205 @@
+#pragma once
+
+/*
+ * Scoped CPU timing, exported as a Chrome trace_event JSON file that can be
+ * opened in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Instrument code with:
+ *
+ *   CPU_PROFILE_SCOPE("culling");  // Times the rest of the enclosing block
+ *   CPU_PROFILE_FUNCTION();        // Same, named after the function
+ *
+ * The macros expand to nothing unless CPU_PROFILING is defined (the
+ * CPU_PROFILING CMake option), so the instrumentation costs nothing in normal
+ * builds. When enabled, the demos write the trace to the file named by the
+ * CPU_TRACE environment variable when their window is destroyed (see
+ * Window.hpp), frames appearing as "frame" events.
+ */
+
+#ifdef CPU_PROFILING
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Collects the timed scopes of every thread.
+ *
+ * Each thread appends to its own buffer without locking: the registry's mutex
+ * is only taken the first time a thread records an event, and when writing
+ * the trace, which must happen while no other thread is recording. Names must
+ * outlive the profiler, e.g. string literals.
+ */
+class CpuProfiler {
+public:
+  // The time since the profiler started, in nanoseconds
+  static int64_t now() {
+    static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch).count();
+  }
+
+  /**
+   * Records a timed event on the calling thread.
+   *
+   * @param name The event's name, which must outlive the profiler
+   * @param start The start time, from now()
+   * @param end The end time, from now()
+   */
+  static void record(const char *name, int64_t start, int64_t end) {
+    ThreadBuffer &buffer = threadBuffer();
+
+    // Bound the memory used by long runs, keeping the beginning of the trace
+    if (buffer.events.size() < MAX_EVENTS_PER_THREAD) {
+      buffer.events.push_back({name, start, end});
+    } else {
+      buffer.dropped++;
+    }
+  }
+
+  // Names the calling thread in the trace
+  static void setThreadName(const std::string &name) {
+    threadBuffer().name = name;
+  }
+
+  /**
+   * Writes the events recorded so far as a Chrome trace_event JSON file.
+   *
+   * @return Whether the file was written
+   */
+  static bool writeTrace(const std::string &path) {
+    FILE *file = std::fopen(path.c_str(), "w");
+
+    if (file == nullptr) {
+      std::cout << "ERROR: Failed to write the CPU trace to " << path << std::endl;
+      return false;
+    }
+
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    std::fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    bool first = true;
+    uint64_t dropped = 0;
+
+    for (const std::unique_ptr<ThreadBuffer> &buffer : registry.threads) {
+      std::fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, "
+                         "\"args\": {\"name\": \"%s\"}}",
+                   first ? "" : ",\n", buffer->id, buffer->name.c_str());
+      first = false;
+
+      // Complete events, with microsecond timestamps
+      for (const Event &event : buffer->events) {
+        std::fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, "
+                           "\"ts\": %.3f, \"dur\": %.3f}",
+                     event.name, buffer->id, (double) event.start / 1000.0,
+                     (double) (event.end - event.start) / 1000.0);
+      }
+
+      dropped += buffer->dropped;
+    }
+
+    std::fprintf(file, "\n]}\n");
+    std::fclose(file);
+
+    if (dropped > 0) {
+      std::cout << "WARNING: " << dropped << " CPU trace events were dropped" << std::endl;
+    }
+
+    return true;
+  }
+
+  // Writes the trace to the file named by the CPU_TRACE environment variable, if set
+  static void writeTraceFromEnvironment() {
+    const char *path = std::getenv("CPU_TRACE");
+
+    if (path != nullptr && path[0] != '\0' && writeTrace(path)) {
+      std::cout << "Wrote the CPU trace to " << path << std::endl;
+    }
+  }
+
+private:
+  static constexpr size_t MAX_EVENTS_PER_THREAD = 1 << 20;
+  // Events reserved up front, so that short runs don't reallocate while recording
+  static constexpr size_t INITIAL_EVENTS = 1 << 14;
+
+  struct Event {
+    const char *name;
+    int64_t start;
+    int64_t end;
+  };
+
+  struct ThreadBuffer {
+    uint32_t id;
+    std::string name;
+    std::vector<Event> events;
+    uint64_t dropped = 0;
+  };
+
+  // Owns the buffers, so that the events of finished threads are kept
+  struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> threads;
+  };
+
+  // Static initialization runs on the main thread
+  static inline const std::thread::id mainThread = std::this_thread::get_id();
+
+  static Registry &getRegistry() {
+    static Registry registry;
+    return registry;
+  }
+
+  static ThreadBuffer &threadBuffer() {
+    thread_local ThreadBuffer *buffer = registerThread();
+    return *buffer;
+  }
+
+  static ThreadBuffer *registerThread() {
+    Registry &registry = getRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    auto buffer = std::make_unique<ThreadBuffer>();
+    buffer->id = (uint32_t) registry.threads.size() + 1;
+    bool main = std::this_thread::get_id() == mainThread;
+    buffer->name = main ? "main" : "thread " + std::to_string(buffer->id);
+    buffer->events.reserve(INITIAL_EVENTS);
+    registry.threads.push_back(std::move(buffer));
+    return registry.threads.back().get();
+  }
+};
+
+// Records the time between its construction and destruction
+class CpuProfileScope {
+public:
+  explicit CpuProfileScope(const char *name) : name(name), start(CpuProfiler::now()) {
+  }
+
+  ~CpuProfileScope() {
+    CpuProfiler::record(name, start, CpuProfiler::now());
+  }
+
+  CpuProfileScope(const CpuProfileScope &) = delete;
+  CpuProfileScope &operator=(const CpuProfileScope &) = delete;
+
+private:
+  const char *name;
+  int64_t start;
+};
+
+#define CPU_PROFILE_JOIN_DETAIL(a, b) a##b
+#define CPU_PROFILE_JOIN(a, b) CPU_PROFILE_JOIN_DETAIL(a, b)
+#define CPU_PROFILE_SCOPE(name) CpuProfileScope CPU_PROFILE_JOIN(cpuProfileScope, __LINE__)(name)
+
+#else
+
+#define CPU_PROFILE_SCOPE(name) ((void) 0)
+
+#endif
+
+#define CPU_PROFILE_FUNCTION() CPU_PROFILE_SCOPE(__func__)
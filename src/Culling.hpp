@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Bounds.hpp"
+#include "CpuProfiler.hpp"
+#include "Frustum.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+/**
+ * World-space bounding boxes stored as structure-of-arrays (one array per
+ * component), so that several boxes can be tested against a frustum plane with
+ * a single SIMD instruction. Boxes are stored as center and extents since this
+ * is what the plane test needs.
+ */
+class BoundsBatch {
+public:
+  void clear() {
+    centerX.clear();
+    centerY.clear();
+    centerZ.clear();
+    extentX.clear();
+    extentY.clear();
+    extentZ.clear();
+  }
+
+  void reserve(size_t count) {
+    centerX.reserve(count);
+    centerY.reserve(count);
+    centerZ.reserve(count);
+    extentX.reserve(count);
+    extentY.reserve(count);
+    extentZ.reserve(count);
+  }
+
+  size_t size() const {
+    return centerX.size();
+  }
+
+  /**
+   * Appends a world-space bounding box to the batch.
+   *
+   * @return The index of the box in the batch
+   */
+  uint32_t add(const AABB &aabb) {
+    glm::vec3 center = aabb.center();
+    glm::vec3 extents = aabb.extents();
+    centerX.push_back(center.x);
+    centerY.push_back(center.y);
+    centerZ.push_back(center.z);
+    extentX.push_back(extents.x);
+    extentY.push_back(extents.y);
+    extentZ.push_back(extents.z);
+
+    return (uint32_t) (centerX.size() - 1);
+  }
+
+  // Adds a sphere as the cube enclosing it
+  uint32_t add(const BoundingSphere &sphere) {
+    AABB aabb;
+    aabb.min = sphere.center - glm::vec3(sphere.radius);
+    aabb.max = sphere.center + glm::vec3(sphere.radius);
+    return add(aabb);
+  }
+
+  /**
+   * Tests every box in the batch against the frustum.
+   *
+   * @param frustum The view frustum
+   * @param visible Receives the indices of the boxes that intersect the frustum (cleared first)
+   */
+  void cull(const Frustum &frustum, std::vector<uint32_t> &visible) const {
+    CPU_PROFILE_SCOPE("BoundsBatch::cull");
+    visible.clear();
+    const size_t count = size();
+    size_t i = 0;
+
+#if defined(__AVX__)
+    for (; i + 8 <= count; i += 8) {
+      appendVisible(visible, i, cullAVX(frustum, i), 8);
+    }
+#endif
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+    for (; i + 4 <= count; i += 4) {
+      appendVisible(visible, i, cullSSE(frustum, i), 4);
+    }
+#endif
+
+    // Remaining boxes that don't fill a whole SIMD register
+    for (; i < count; i++) {
+      if (isVisible(frustum, i)) {
+        visible.push_back((uint32_t) i);
+      }
+    }
+  }
+
+private:
+  std::vector<float> centerX, centerY, centerZ;
+  std::vector<float> extentX, extentY, extentZ;
+
+  static void appendVisible(std::vector<uint32_t> &visible, size_t first, uint32_t mask,
+                            uint32_t width) {
+    for (uint32_t lane = 0; lane < width; lane++) {
+      if (mask & (1u << lane)) {
+        visible.push_back((uint32_t) (first + lane));
+      }
+    }
+  }
+
+  bool isVisible(const Frustum &frustum, size_t i) const {
+    for (const glm::vec4 &plane : frustum.planes) {
+      float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+      float radius = std::abs(plane.x) * extentX[i] + std::abs(plane.y) * extentY[i] +
+                     std::abs(plane.z) * extentZ[i];
+
+      if (distance + radius < 0.0f) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+  // Returns a bit mask of the visible boxes among the four starting at `first`
+  uint32_t cullSSE(const Frustum &frustum, size_t first) const {
+    const __m128 cx = _mm_loadu_ps(&centerX[first]);
+    const __m128 cy = _mm_loadu_ps(&centerY[first]);
+    const __m128 cz = _mm_loadu_ps(&centerZ[first]);
+    const __m128 ex = _mm_loadu_ps(&extentX[first]);
+    const __m128 ey = _mm_loadu_ps(&extentY[first]);
+    const __m128 ez = _mm_loadu_ps(&extentZ[first]);
+    const __m128 zero = _mm_setzero_ps();
+    __m128 outside = zero;
+
+    for (const glm::vec4 &plane : frustum.planes) {
+      const __m128 nx = _mm_set1_ps(plane.x);
+      const __m128 ny = _mm_set1_ps(plane.y);
+      const __m128 nz = _mm_set1_ps(plane.z);
+      const __m128 nw = _mm_set1_ps(plane.w);
+      const __m128 ax = _mm_set1_ps(std::abs(plane.x));
+      const __m128 ay = _mm_set1_ps(std::abs(plane.y));
+      const __m128 az = _mm_set1_ps(std::abs(plane.z));
+
+      __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+          _mm_add_ps(_mm_mul_ps(nz, cz), nw));
+      __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, ex), _mm_mul_ps(ay, ey)),
+                                 _mm_mul_ps(az, ez));
+
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), zero));
+    }
+
+    return ~(uint32_t) _mm_movemask_ps(outside) & 0xFu;
+  }
+#endif
+
+#if defined(__AVX__)
+  // Returns a bit mask of the visible boxes among the eight starting at `first`
+  uint32_t cullAVX(const Frustum &frustum, size_t first) const {
+    const __m256 cx = _mm256_loadu_ps(&centerX[first]);
+    const __m256 cy = _mm256_loadu_ps(&centerY[first]);
+    const __m256 cz = _mm256_loadu_ps(&centerZ[first]);
+    const __m256 ex = _mm256_loadu_ps(&extentX[first]);
+    const __m256 ey = _mm256_loadu_ps(&extentY[first]);
+    const __m256 ez = _mm256_loadu_ps(&extentZ[first]);
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 outside = zero;
+
+    for (const glm::vec4 &plane : frustum.planes) {
+      const __m256 nx = _mm256_set1_ps(plane.x);
+      const __m256 ny = _mm256_set1_ps(plane.y);
+      const __m256 nz = _mm256_set1_ps(plane.z);
+      const __m256 nw = _mm256_set1_ps(plane.w);
+      const __m256 ax = _mm256_set1_ps(std::abs(plane.x));
+      const __m256 ay = _mm256_set1_ps(std::abs(plane.y));
+      const __m256 az = _mm256_set1_ps(std::abs(plane.z));
+
+      __m256 distance = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(nx, cx), _mm256_mul_ps(ny, cy)),
+          _mm256_add_ps(_mm256_mul_ps(nz, cz), nw));
+      __m256 radius = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(ax, ex), _mm256_mul_ps(ay, ey)), _mm256_mul_ps(az, ez));
+
+      outside = _mm256_or_ps(outside,
+                             _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_LT_OQ));
+    }
+
+    return ~(uint32_t) _mm256_movemask_ps(outside) & 0xFFu;
+  }
+#endif
+};
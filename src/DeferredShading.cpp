@@ -0,0 +1,487 @@
+#include <iostream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include "GpuProfiler.hpp"
+#include "Model.hpp"
+#include "Lights.hpp"
+#include "NormalMatrix.hpp"
+#include "RenderGraph.hpp"
+#include "Window.hpp"
+
+// Stored globally so it can be modified in framebufferSizeCallback() and used in main()
+glm::mat4 projection;
+
+// The field of view
+constexpr float FOV = 50.0f;
+
+// The number of point lights moving around the scene
+constexpr uint32_t LIGHTS = 400;
+
+// The number of cubes on each side of the grid
+constexpr int32_t GRID_SIZE = 12;
+
+// Texture units the G-buffer textures are bound to for the lighting shaders
+constexpr int32_t ALBEDO_SPECULAR_UNIT = 0;
+constexpr int32_t NORMAL_UNIT = 1;
+constexpr int32_t DEPTH_UNIT = 2;
+
+// Whether to display the G-buffer normals instead of the lit image, toggled with N
+bool showNormals = false;
+
+// Whether to print the GPU time of the passes, requested with G
+bool printGpuProfile = false;
+
+void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+  glViewport(0, 0, width, height);
+  projection = glm::perspective(glm::radians(FOV), (float) width / (float) height, 0.1f, 100.0f);
+}
+
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  if (key == GLFW_KEY_N && action == GLFW_PRESS) {
+    showNormals = !showNormals;
+  }
+
+  if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+    printGpuProfile = true;
+  }
+}
+
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
+  }
+}
+
+/**
+ * Generates the triangles of a sphere enclosing the unit sphere: the vertices
+ * are pushed out so that the flat faces never cut into the sphere, as a light
+ * volume must cover every pixel the light can reach.
+ */
+std::vector<glm::vec3> createLightVolume(int32_t segments, int32_t rings) {
+  const float pi = glm::pi<float>();
+  float scale = 1.0f / (std::cos(pi / (float) segments) * std::cos(pi / (2.0f * (float) rings)));
+  std::vector<glm::vec3> vertices;
+
+  auto point = [&](int32_t segment, int32_t ring) {
+    float theta = 2.0f * pi * (float) segment / (float) segments;
+    float phi = pi * (float) ring / (float) rings;
+    return glm::vec3(std::cos(theta) * std::sin(phi), std::cos(phi),
+                     std::sin(theta) * std::sin(phi)) * scale;
+  };
+
+  for (int32_t ring = 0; ring < rings; ring++) {
+    for (int32_t segment = 0; segment < segments; segment++) {
+      // Counter-clockwise when seen from outside the sphere
+      glm::vec3 a = point(segment, ring);
+      glm::vec3 b = point(segment + 1, ring);
+      glm::vec3 c = point(segment + 1, ring + 1);
+      glm::vec3 d = point(segment, ring + 1);
+      vertices.insert(vertices.end(), {a, b, c, c, d, a});
+    }
+  }
+
+  return vertices;
+}
+
+// Matches the per-light attributes of deferred_point_light.vertex.glsl
+struct LightInstance {
+  glm::vec4 positionRadius;
+  glm::vec3 color;
+  glm::vec3 attenuation;
+};
+
+int32_t main() {
+  // The initial window size
+  constexpr int32_t SCREEN_WIDTH = 1280;
+  constexpr int32_t SCREEN_HEIGHT = 720;
+
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(SCREEN_WIDTH, SCREEN_HEIGHT, "Deferred Shading");
+
+  if (!window.isOpen()) {
+    return -1;
+  }
+
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
+  window.setKeyCallback(keyCallback);
+
+  glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+  Shader geometryShader = Shader(
+      "../resources/shaders/deferred_geometry.vertex.glsl",
+      "../resources/shaders/deferred_geometry.fragment.glsl"
+  );
+  Shader directionalShader = Shader(
+      "../resources/shaders/deferred_directional.vertex.glsl",
+      "../resources/shaders/deferred_directional.fragment.glsl"
+  );
+  Shader pointLightShader = Shader(
+      "../resources/shaders/deferred_point_light.vertex.glsl",
+      "../resources/shaders/deferred_point_light.fragment.glsl"
+  );
+  Shader normalsShader = Shader(
+      "../resources/shaders/deferred_directional.vertex.glsl",
+      "../resources/shaders/deferred_normals.fragment.glsl"
+  );
+
+  // The G-buffer textures are always bound to the same texture units
+  for (Shader *shader : {&directionalShader, &pointLightShader}) {
+    shader->use();
+    shader->setInt("gAlbedoSpecular", ALBEDO_SPECULAR_UNIT);
+    shader->setInt("gNormal", NORMAL_UNIT);
+    shader->setInt("gDepth", DEPTH_UNIT);
+    shader->setFloat("glossiness", 24.0f);
+  }
+
+  normalsShader.use();
+  normalsShader.setInt("gNormal", NORMAL_UNIT);
+
+  // The cube's vertice and normal coordinates
+  float vertices[] = {
+      // Positions          // Normals           // Texture coordinates
+      -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+      0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f,
+      -0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+
+      -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
+      -0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+
+      -0.5f, 0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+      -0.5f, 0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+      -0.5f, 0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+
+      0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
+      0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, -0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+
+      -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+      -0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+      -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+
+      -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+      -0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+      -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+  };
+
+  // Lay out a grid of cubes
+  std::vector<glm::mat4> cubeModels;
+
+  for (int32_t x = 0; x < GRID_SIZE; x++) {
+    for (int32_t z = 0; z < GRID_SIZE; z++) {
+      glm::mat4 model;
+      model = glm::translate(model, glm::vec3(x - GRID_SIZE / 2, 0.0f, z - GRID_SIZE / 2) * 2.0f);
+      model = glm::rotate(model, glm::radians(15.0f * (x + z)), glm::vec3(0.0f, 1.0f, 0.0f));
+      cubeModels.push_back(model);
+    }
+  }
+
+  // Normals are transformed to view space, so the normal matrices are recomputed every frame
+  std::vector<glm::mat4> cubeModelViews(cubeModels.size());
+  std::vector<glm::mat3> cubeNormalMatrices(cubeModels.size());
+
+  // Scatter small, quickly attenuated colored lights between the cubes
+  std::vector<PointLight> pointLights(LIGHTS);
+  std::vector<float> lightOrbits(LIGHTS);
+
+  for (uint32_t i = 0; i < LIGHTS; i++) {
+    float hue = (float) i / (float) LIGHTS * 6.0f;
+    pointLights[i].color = glm::clamp(glm::vec3(std::abs(hue - 3.0f) - 1.0f,
+                                                2.0f - std::abs(hue - 2.0f),
+                                                2.0f - std::abs(hue - 4.0f)), 0.0f, 1.0f);
+    pointLights[i].linear = 0.7f;
+    pointLights[i].quadratic = 1.8f;
+    lightOrbits[i] = 1.0f + (float) ((i * 7919) % 1000) / 1000.0f * GRID_SIZE;
+  }
+
+  std::vector<LightInstance> lightInstances(LIGHTS);
+
+  // Load textures
+  uint32_t textureDiffuse = textureFromFile("container2_diffuse.png", "../resources/textures");
+  uint32_t textureSpecular = textureFromFile("container2_specular.png", "../resources/textures");
+
+  // Initialize buffers (vertex array, vertex buffer)
+  uint32_t vao, vbo;
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &vbo);
+
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+
+  // Position attribute
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) nullptr);
+  glEnableVertexAttribArray(0);
+  // Normal attribute
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (3 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+  // Texture coordinates attribute
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (6 * sizeof(float)));
+  glEnableVertexAttribArray(2);
+
+  // The light volumes are drawn instanced, one instance per light
+  std::vector<glm::vec3> lightVolume = createLightVolume(16, 8);
+  uint32_t lightVao, lightVbo, lightInstanceVbo;
+  glGenVertexArrays(1, &lightVao);
+  glGenBuffers(1, &lightVbo);
+  glGenBuffers(1, &lightInstanceVbo);
+
+  glBindVertexArray(lightVao);
+  glBindBuffer(GL_ARRAY_BUFFER, lightVbo);
+  glBufferData(GL_ARRAY_BUFFER, lightVolume.size() * sizeof(glm::vec3), lightVolume.data(),
+               GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *) nullptr);
+  glEnableVertexAttribArray(0);
+
+  glBindBuffer(GL_ARRAY_BUFFER, lightInstanceVbo);
+  glBufferData(GL_ARRAY_BUFFER, LIGHTS * sizeof(LightInstance), nullptr, GL_STREAM_DRAW);
+  glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(LightInstance),
+                        (void *) offsetof(LightInstance, positionRadius));
+  glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(LightInstance),
+                        (void *) offsetof(LightInstance, color));
+  glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(LightInstance),
+                        (void *) offsetof(LightInstance, attenuation));
+
+  for (uint32_t attribute = 1; attribute <= 3; attribute++) {
+    glEnableVertexAttribArray(attribute);
+    glVertexAttribDivisor(attribute, 1);
+  }
+
+  // Vertex-less draws still need a vertex array to be bound in a core profile
+  uint32_t emptyVao;
+  glGenVertexArrays(1, &emptyVao);
+  glBindVertexArray(0);
+
+  // The frame is described again every frame, the graph keeping its textures between frames
+  RenderGraph graph;
+  // Times each pass of the graph
+  GpuProfiler profiler;
+  graph.setProfiler(&profiler);
+  bool dumpGraph = true;
+  bool showedNormals = showNormals;
+  glm::vec3 clearColor = glm::vec3(0.15f, 0.15f, 0.15f);
+
+  // Set the projection matrix here so it's defined on application start too
+  projection = glm::perspective(glm::radians(FOV), (float) SCREEN_WIDTH / (float) SCREEN_HEIGHT,
+                                0.1f, 100.0f);
+
+  window.setTitle("Deferred Shading (" + std::to_string(LIGHTS) + " point lights)");
+
+  while (!window.shouldClose()) {
+    processInput(window);
+
+    int32_t windowWidth, windowHeight;
+    window.getFramebufferSize(&windowWidth, &windowHeight);
+
+    // Make the camera rotate in a circle around the grid
+    float radius = 22.0f;
+    double cameraX = sin(window.time() * 0.2f) * radius;
+    double cameraZ = cos(window.time() * 0.2f) * radius;
+    glm::vec3 cameraPosition = glm::vec3(cameraX, 9.0f, cameraZ);
+    glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
+    // Use an "up" vector to determine the camera's right axis using a cross product
+    glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 view;
+    view = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
+
+    // Describe the frame. The G-buffer holds the surface attributes of the visible fragments:
+    // albedo and specular intensity, view-space normals, and the depth from which view-space
+    // positions are reconstructed. The lighting passes accumulate into a separate target, whose
+    // depth buffer is a copy of the G-buffer's so that light volumes can be depth tested without
+    // sampling and testing against the same texture.
+    graph.reset();
+    uint32_t backbuffer = graph.importBackbuffer("backbuffer", windowWidth, windowHeight);
+    uint32_t albedoSpecular = graph.createTexture(
+        "albedoSpecular", {windowWidth, windowHeight, GL_RGBA8});
+    uint32_t normal = graph.createTexture("normal", {windowWidth, windowHeight, GL_RGBA16F});
+    // Same format as the lighting depth buffer, as required to blit between them
+    uint32_t depth = graph.createTexture("depth", {windowWidth, windowHeight, GL_DEPTH24_STENCIL8});
+    uint32_t lightingDepth = graph.createTexture(
+        "lightingDepth", {windowWidth, windowHeight, GL_DEPTH24_STENCIL8});
+    uint32_t lit = graph.createTexture("lit", {windowWidth, windowHeight, GL_RGBA8});
+    uint32_t normalView = graph.createTexture("normalView", {windowWidth, windowHeight, GL_RGBA8});
+
+    graph.addPass("geometry", {}, {albedoSpecular, normal, depth}, [&](RenderGraph &) {
+      glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+      // The lighting passes disable depth writes, which would also prevent clearing the depth
+      glDepthMask(GL_TRUE);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+      glEnable(GL_DEPTH_TEST);
+      glDisable(GL_BLEND);
+
+      geometryShader.use();
+      geometryShader.setMat4("view", view);
+      geometryShader.setMat4("projection", projection);
+      geometryShader.setInt("material.diffuse", 0);
+      geometryShader.setInt("material.specular", 1);
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, textureDiffuse);
+      glActiveTexture(GL_TEXTURE1);
+      glBindTexture(GL_TEXTURE_2D, textureSpecular);
+
+      glBindVertexArray(vao);
+
+      // The cubes and the camera are only rotated and translated, so the normal matrices are the
+      // model-view matrices' upper 3x3 part
+      for (size_t i = 0; i < cubeModels.size(); i++) {
+        cubeModelViews[i] = view * cubeModels[i];
+      }
+
+      computeNormalMatrices(cubeModelViews.data(), cubeNormalMatrices.data(), cubeModels.size(),
+                            true);
+
+      for (size_t i = 0; i < cubeModels.size(); i++) {
+        geometryShader.setMat4("model", cubeModels[i]);
+        geometryShader.setMat3("normalMatrix", cubeNormalMatrices[i]);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+      }
+    });
+
+    graph.addPass("depth copy", {depth}, {lightingDepth}, [&](RenderGraph &graph) {
+      graph.blit(depth, lightingDepth, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
+    });
+
+    // Lighting passes: accumulate every light's contribution with additive blending
+    graph.addPass("lighting", {albedoSpecular, normal, depth, lightingDepth}, {lit, lightingDepth},
+                  [&](RenderGraph &graph) {
+      glClearColor(clearColor.x, clearColor.y, clearColor.z, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT);
+      graph.bindTexture(albedoSpecular, ALBEDO_SPECULAR_UNIT);
+      graph.bindTexture(normal, NORMAL_UNIT);
+      graph.bindTexture(depth, DEPTH_UNIT);
+      glm::mat4 inverseProjection = glm::inverse(projection);
+      glDepthMask(GL_FALSE);
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_ONE, GL_ONE);
+
+      // The directional light (and ambient lighting) covers every pixel that has geometry
+      glDisable(GL_DEPTH_TEST);
+      directionalShader.use();
+      directionalShader.setVec2("screenSize", (float) windowWidth, (float) windowHeight);
+      directionalShader.setMat4("inverseProjection", inverseProjection);
+      glm::vec3 lightDirection = glm::vec3(view * glm::vec4(-0.2f, -1.0f, -0.3f, 0.0f));
+      directionalShader.setVec3("directionalLight.direction", lightDirection);
+      directionalShader.setVec3("directionalLight.ambient", 0.1f, 0.1f, 0.1f);
+      directionalShader.setVec3("directionalLight.diffuse", 0.15f, 0.15f, 0.15f);
+      directionalShader.setVec3("directionalLight.specular", 0.15f, 0.15f, 0.15f);
+      glBindVertexArray(emptyVao);
+      glDrawArrays(GL_TRIANGLES, 0, 3);
+
+      // Move the point lights and upload their volumes
+      float time = (float) window.time();
+
+      for (uint32_t i = 0; i < LIGHTS; i++) {
+        float angle = time * (0.2f + 0.3f * (float) (i % 5) / 5.0f) + (float) i;
+        pointLights[i].position = glm::vec3(std::sin(angle) * lightOrbits[i],
+                                            0.2f + 1.5f * (0.5f + 0.5f * std::sin(angle * 3.0f)),
+                                            std::cos(angle) * lightOrbits[i]);
+
+        const PointLight &light = pointLights[i];
+        lightInstances[i].positionRadius = glm::vec4(light.position, light.radius());
+        lightInstances[i].color = light.color;
+        lightInstances[i].attenuation = glm::vec3(light.constant, light.linear, light.quadratic);
+      }
+
+      glBindBuffer(GL_ARRAY_BUFFER, lightInstanceVbo);
+      // Orphan the previous frame's data rather than waiting for the GPU to finish using it
+      glBufferData(GL_ARRAY_BUFFER, LIGHTS * sizeof(LightInstance), nullptr, GL_STREAM_DRAW);
+      glBufferSubData(GL_ARRAY_BUFFER, 0, LIGHTS * sizeof(LightInstance), lightInstances.data());
+
+      // Only the back faces of each light volume are drawn, so that the volumes are still drawn
+      // when the camera is inside them. They are depth tested with the inverted comparison so
+      // that only the pixels whose geometry is in front of the volume's back side are shaded.
+      glEnable(GL_DEPTH_TEST);
+      glDepthFunc(GL_GEQUAL);
+      glEnable(GL_CULL_FACE);
+      glCullFace(GL_FRONT);
+
+      pointLightShader.use();
+      pointLightShader.setVec2("screenSize", (float) windowWidth, (float) windowHeight);
+      pointLightShader.setMat4("inverseProjection", inverseProjection);
+      pointLightShader.setMat4("view", view);
+      pointLightShader.setMat4("projection", projection);
+      glBindVertexArray(lightVao);
+      glDrawArraysInstanced(GL_TRIANGLES, 0, (GLsizei) lightVolume.size(), LIGHTS);
+
+      // Restore the state expected by the geometry pass
+      glDepthFunc(GL_LESS);
+      glDisable(GL_CULL_FACE);
+      glDisable(GL_BLEND);
+      glBindVertexArray(0);
+    });
+
+    // A debug view of the G-buffer normals, culled as nothing reads it unless enabled
+    graph.addPass("normal view", {normal}, {normalView}, [&](RenderGraph &graph) {
+      glDisable(GL_DEPTH_TEST);
+      graph.bindTexture(normal, NORMAL_UNIT);
+      normalsShader.use();
+      normalsShader.setVec2("screenSize", (float) windowWidth, (float) windowHeight);
+      glBindVertexArray(emptyVao);
+      glDrawArrays(GL_TRIANGLES, 0, 3);
+      glBindVertexArray(0);
+    });
+
+    // Only the image presented is kept, the graph culls the passes leading to the other one
+    uint32_t presented = showNormals ? normalView : lit;
+    graph.addPass("present", {presented}, {backbuffer}, [&](RenderGraph &graph) {
+      graph.blit(presented, backbuffer, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    });
+
+    profiler.beginFrame();
+
+    if (graph.compile()) {
+      graph.execute();
+    }
+
+    profiler.endFrame();
+
+    if (printGpuProfile) {
+      std::cout << profiler.report();
+      printGpuProfile = false;
+    }
+
+    if (dumpGraph || showedNormals != showNormals) {
+      std::cout << graph.dump();
+      dumpGraph = false;
+      showedNormals = showNormals;
+    }
+
+    window.swapBuffers();
+    window.pollEvents();
+  }
+
+  // Clean up
+  glDeleteVertexArrays(1, &vao);
+  glDeleteVertexArrays(1, &lightVao);
+  glDeleteVertexArrays(1, &emptyVao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteBuffers(1, &lightVbo);
+  glDeleteBuffers(1, &lightInstanceVbo);
+
+  return 0;
+}
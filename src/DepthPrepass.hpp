@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "GpuTimer.hpp"
+#include "Shader.hpp"
+
+/**
+ * Copies the positions out of interleaved vertex data, so that depth-only
+ * passes fetch 12 bytes per vertex instead of the whole vertex.
+ *
+ * @param vertices The interleaved vertex data, starting with the position
+ * @param count The number of vertices
+ * @param stride The number of floats per vertex
+ */
+inline std::vector<glm::vec3> deinterleavePositions(const float *vertices, size_t count,
+                                                    size_t stride) {
+  std::vector<glm::vec3> positions(count);
+
+  for (size_t i = 0; i < count; i++) {
+    positions[i] = glm::vec3(vertices[i * stride], vertices[i * stride + 1],
+                             vertices[i * stride + 2]);
+  }
+
+  return positions;
+}
+
+/**
+ * Creates a vertex array reading only positions (attribute 0) from a tightly
+ * packed buffer.
+ *
+ * @param positions The vertex positions
+ * @param vbo Receives the vertex buffer
+ * @return The vertex array
+ */
+inline uint32_t createPositionVao(const std::vector<glm::vec3> &positions, uint32_t &vbo) {
+  uint32_t vao;
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &vbo);
+
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(),
+               GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *) nullptr);
+  glEnableVertexAttribArray(0);
+  glBindVertexArray(0);
+
+  return vao;
+}
+
+/**
+ * An optional depth-only pre-pass, which lays down the scene's depth with a
+ * trivial shader so that the expensive shading pass only runs once per pixel:
+ * it is drawn with GL_EQUAL depth testing and depth writes off, so hidden
+ * fragments are rejected before shading.
+ *
+ * The shading pass must compute gl_Position with the same expression as
+ * depth_prepass.vertex.glsl, and declare it invariant, for the depths to match
+ * exactly.
+ *
+ * The GPU time of each frame's scene rendering is measured separately with and
+ * without the pre-pass, for comparison.
+ */
+class DepthPrepass {
+public:
+  DepthPrepass()
+      : depthShader(Shader("../resources/shaders/depth_prepass.vertex.glsl",
+                           "../resources/shaders/depth_prepass.fragment.glsl")) {
+  }
+
+  /**
+   * Starts timing the frame's scene rendering. Must be called before
+   * beginDepthPass(), after clearing.
+   *
+   * @param enable Whether the pre-pass is rendered this frame
+   */
+  void beginFrame(bool enable) {
+    enabled = enable;
+    timers[enabled].begin();
+  }
+
+  bool isEnabled() const {
+    return enabled;
+  }
+
+  /**
+   * Binds the depth-only shader, with color writes disabled. Its "model"
+   * uniform must be set for each object drawn.
+   */
+  Shader &beginDepthPass(glm::mat4 view, glm::mat4 projection) {
+    depthShader.use();
+    depthShader.setMat4("view", view);
+    depthShader.setMat4("projection", projection);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    return depthShader;
+  }
+
+  // Restores color writes and only lets the fragments at the pre-pass' depth through
+  void beginShadingPass() {
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthFunc(GL_EQUAL);
+    glDepthMask(GL_FALSE);
+  }
+
+  // Restores the default depth state and stops timing the frame
+  void endFrame() {
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    timers[enabled].end();
+  }
+
+  // The average frame times with and without the pre-pass, for display
+  std::string frameTimes() const {
+    char text[96];
+    snprintf(text, sizeof(text), "depth pre-pass %s (P) - with: %s, without: %s",
+             enabled ? "on" : "off", formatTime(timers[1]).c_str(),
+             formatTime(timers[0]).c_str());
+    return text;
+  }
+
+private:
+  Shader depthShader;
+  // Indexed by whether the pre-pass is enabled
+  GpuTimer timers[2];
+  bool enabled = false;
+
+  static std::string formatTime(const GpuTimer &timer) {
+    if (!timer.hasResult()) {
+      return "-";
+    }
+
+    char text[32];
+    snprintf(text, sizeof(text), "%.2f ms", timer.averageMilliseconds());
+    return text;
+  }
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <glad/glad.h>
+#include "GpuTimer.hpp"
+
+/**
+ * Renders the scene into an offscreen framebuffer whose resolution follows a
+ * GPU frame time budget, then upscales it to the window.
+ *
+ * The GPU time of each frame is measured with a GpuTimer, and the resolution
+ * scale adjusted by a controller with hysteresis: the scale only drops after a
+ * few consecutive frames over the budget, and only rises after more frames
+ * comfortably under it, so that noise in the measurements doesn't make the
+ * resolution oscillate. As the shading cost is roughly proportional to the
+ * number of pixels, each adjustment aims for the middle of the band between
+ * both thresholds.
+ *
+ * The render targets are allocated at the maximum scale, and smaller scales
+ * render into their lower left corner, so changing the scale never
+ * reallocates them.
+ */
+class DynamicResolution {
+public:
+  // The GPU time to stay under, in milliseconds
+  float targetMilliseconds;
+  float minScale, maxScale;
+  // Whether the scale follows the budget, otherwise it stays at the maximum
+  bool enabled = true;
+
+  /**
+   * @param targetMilliseconds The GPU time per frame to stay under
+   * @param minScale The smallest resolution scale, relative to the window size
+   * @param maxScale The largest resolution scale, relative to the window size
+   */
+  explicit DynamicResolution(float targetMilliseconds, float minScale = 0.5f,
+                             float maxScale = 1.0f)
+      : targetMilliseconds(targetMilliseconds),
+        minScale(minScale),
+        maxScale(maxScale),
+        scale(maxScale) {
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &color);
+    glGenRenderbuffers(1, &depth);
+  }
+
+  /**
+   * Starts measuring the frame's GPU time, reallocating the render targets if
+   * the window was resized. Must be called before any of the frame's commands.
+   */
+  void beginFrame(int32_t newWindowWidth, int32_t newWindowHeight) {
+    if (newWindowWidth != windowWidth || newWindowHeight != windowHeight) {
+      resize(newWindowWidth, newWindowHeight);
+    }
+
+    timer.begin();
+  }
+
+  // Binds the offscreen framebuffer, with the viewport set to the current scale
+  void bindTarget() {
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, renderWidth(), renderHeight());
+  }
+
+  /**
+   * Upscales the rendered image to the default framebuffer, restores the
+   * window's viewport, and adjusts the scale from the measured GPU times.
+   */
+  void endFrame() {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, renderWidth(), renderHeight(), 0, 0, windowWidth, windowHeight,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, windowWidth, windowHeight);
+    timer.end();
+
+    if (timer.resultCount() != handledResults) {
+      handledResults = timer.resultCount();
+      updateScale(timer.milliseconds());
+    }
+  }
+
+  float currentScale() const {
+    return enabled ? scale : maxScale;
+  }
+
+  int32_t renderWidth() const {
+    return std::max(1, (int32_t) std::lround((float) windowWidth * currentScale()));
+  }
+
+  int32_t renderHeight() const {
+    return std::max(1, (int32_t) std::lround((float) windowHeight * currentScale()));
+  }
+
+  // The smoothed GPU time per frame, in milliseconds
+  double gpuMilliseconds() const {
+    return timer.averageMilliseconds();
+  }
+
+  // A summary of the scale and the GPU time, e.g. for the window title
+  std::string status() const {
+    char text[96];
+    snprintf(text, sizeof(text), "resolution %s (R): %d%%, GPU: %.2f ms",
+             enabled ? "dynamic" : "fixed", (int32_t) std::lround(currentScale() * 100.0f),
+             gpuMilliseconds());
+    return text;
+  }
+
+private:
+  // Below this fraction of the budget, the frame is considered comfortably under it
+  static constexpr float UNDER_BUDGET = 0.8f;
+  // Consecutive measurements needed before lowering and raising the scale
+  static constexpr uint32_t FRAMES_BEFORE_LOWERING = 3;
+  static constexpr uint32_t FRAMES_BEFORE_RAISING = 15;
+  // Measurements ignored after a change, as they were issued before it
+  static constexpr uint32_t SETTLING_FRAMES = 4;
+  // The largest change of the scale at once
+  static constexpr float MAX_STEP = 0.15f;
+
+  GpuTimer timer;
+  uint32_t fbo, color, depth;
+  int32_t windowWidth = 0, windowHeight = 0;
+  float scale;
+  uint64_t handledResults = 0;
+  uint32_t framesOverBudget = 0, framesUnderBudget = 0, framesSettling = 0;
+
+  void resize(int32_t width, int32_t height) {
+    windowWidth = width;
+    windowHeight = height;
+    int32_t maxWidth = std::max(1, (int32_t) std::ceil((float) width * maxScale));
+    int32_t maxHeight = std::max(1, (int32_t) std::ceil((float) height * maxScale));
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, maxWidth, maxHeight);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, maxWidth, maxHeight);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER,
+                              depth);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cout << "ERROR: The dynamic resolution framebuffer is incomplete." << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  void updateScale(double milliseconds) {
+    if (!enabled || milliseconds <= 0.0) {
+      return;
+    }
+
+    if (framesSettling > 0) {
+      framesSettling--;
+      return;
+    }
+
+    if (milliseconds > targetMilliseconds) {
+      framesOverBudget++;
+      framesUnderBudget = 0;
+    } else if (milliseconds < targetMilliseconds * UNDER_BUDGET) {
+      framesUnderBudget++;
+      framesOverBudget = 0;
+    } else {
+      framesOverBudget = 0;
+      framesUnderBudget = 0;
+    }
+
+    if (framesOverBudget < FRAMES_BEFORE_LOWERING && framesUnderBudget < FRAMES_BEFORE_RAISING) {
+      return;
+    }
+
+    // The cost scales with the number of pixels, the square of the scale
+    float goal = targetMilliseconds * (1.0f + UNDER_BUDGET) * 0.5f;
+    float newScale = scale * std::sqrt(goal / (float) milliseconds);
+    newScale = std::clamp(newScale, scale - MAX_STEP, scale + MAX_STEP);
+    newScale = std::clamp(newScale, minScale, maxScale);
+    framesOverBudget = 0;
+    framesUnderBudget = 0;
+
+    if (newScale != scale) {
+      scale = newScale;
+      framesSettling = SETTLING_FRAMES;
+    }
+  }
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "Bounds.hpp"
+
+/**
+ * The six clipping planes of a view frustum, extracted from a combined
+ * projection and view matrix (Gribb/Hartmann). Plane normals point inwards,
+ * so a point is inside the frustum when its signed distance to every plane
+ * is positive.
+ */
+class Frustum {
+public:
+  enum Plane {
+    PLANE_LEFT = 0,
+    PLANE_RIGHT,
+    PLANE_BOTTOM,
+    PLANE_TOP,
+    PLANE_NEAR,
+    PLANE_FAR,
+    PLANE_COUNT,
+  };
+
+  // Each plane is stored as (normal.x, normal.y, normal.z, distance)
+  glm::vec4 planes[PLANE_COUNT];
+  // The matrix the planes were extracted from
+  glm::mat4 viewProjection;
+
+  Frustum() = default;
+
+  explicit Frustum(const glm::mat4 &viewProjection) : viewProjection(viewProjection) {
+    // glm matrices are column-major, so gather the rows first
+    glm::vec4 rows[4];
+
+    for (int32_t i = 0; i < 4; i++) {
+      rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i],
+                          viewProjection[3][i]);
+    }
+
+    planes[PLANE_LEFT] = rows[3] + rows[0];
+    planes[PLANE_RIGHT] = rows[3] - rows[0];
+    planes[PLANE_BOTTOM] = rows[3] + rows[1];
+    planes[PLANE_TOP] = rows[3] - rows[1];
+    planes[PLANE_NEAR] = rows[3] + rows[2];
+    planes[PLANE_FAR] = rows[3] - rows[2];
+
+    // Normalize the planes so that distances are in world units
+    for (glm::vec4 &plane : planes) {
+      plane /= glm::length(glm::vec3(plane));
+    }
+  }
+
+  float distance(int32_t plane, const glm::vec3 &point) const {
+    return glm::dot(glm::vec3(planes[plane]), point) + planes[plane].w;
+  }
+
+  bool intersects(const BoundingSphere &sphere) const {
+    for (int32_t i = 0; i < PLANE_COUNT; i++) {
+      if (distance(i, sphere.center) < -sphere.radius) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+  bool intersects(const AABB &aabb) const {
+    glm::vec3 center = aabb.center();
+    glm::vec3 extents = aabb.extents();
+
+    for (int32_t i = 0; i < PLANE_COUNT; i++) {
+      // Projected "radius" of the box onto the plane normal
+      float radius = glm::dot(glm::abs(glm::vec3(planes[i])), extents);
+
+      if (distance(i, center) < -radius) {
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <iostream>
+#include <glad/glad.h>
+
+// The bundled glad loader only covers OpenGL 3.3 core. This header declares and
+// loads the few OpenGL 4.x entry points used by the GPU-driven rendering paths.
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint numGroupsX, GLuint numGroupsY,
+                                                  GLuint numGroupsZ);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type,
+                                                            const void *indirect,
+                                                            GLsizei drawCount, GLsizei stride);
+typedef void (APIENTRYP PFNGLBINDIMAGETEXTUREPROC)(GLuint unit, GLuint texture, GLint level,
+                                                   GLboolean layered, GLint layer, GLenum access,
+                                                   GLenum format);
+
+inline PFNGLDISPATCHCOMPUTEPROC glDispatchCompute = nullptr;
+inline PFNGLMEMORYBARRIERPROC glMemoryBarrier = nullptr;
+inline PFNGLMULTIDRAWELEMENTSINDIRECTPROC glMultiDrawElementsIndirect = nullptr;
+inline PFNGLBINDIMAGETEXTUREPROC glBindImageTexture = nullptr;
+
+// Layout of the commands read by glMultiDrawElementsIndirect()
+struct DrawElementsIndirectCommand {
+  uint32_t count;
+  uint32_t instanceCount;
+  uint32_t firstIndex;
+  int32_t baseVertex;
+  uint32_t baseInstance;
+};
+
+/**
+ * Loads the OpenGL 4.3 functions declared above. Must be called after
+ * gladLoadGLLoader(), with a 4.3 (or later) context current.
+ *
+ * @param load The same loader function passed to gladLoadGLLoader()
+ * @return Whether every function could be loaded
+ */
+inline bool loadGL43(GLADloadproc load) {
+  glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC) load("glDispatchCompute");
+  glMemoryBarrier = (PFNGLMEMORYBARRIERPROC) load("glMemoryBarrier");
+  glMultiDrawElementsIndirect =
+      (PFNGLMULTIDRAWELEMENTSINDIRECTPROC) load("glMultiDrawElementsIndirect");
+  glBindImageTexture = (PFNGLBINDIMAGETEXTUREPROC) load("glBindImageTexture");
+
+  if (!glDispatchCompute || !glMemoryBarrier || !glMultiDrawElementsIndirect ||
+      !glBindImageTexture) {
+    std::cout << "ERROR: Failed to load OpenGL 4.3 functions." << std::endl;
+    return false;
+  }
+
+  return true;
+}
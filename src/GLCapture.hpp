@@ -0,0 +1,1238 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "GLFunctions.hpp"
+
+/*
+ * Capture and replay of the OpenGL command stream.
+ *
+ * GlCapture records the calls a demo makes from the creation of its window
+ * (so that the resources it sets up are included) through its first N frames
+ * into a binary file, with the data uploaded to buffers and textures. The
+ * Replay executable (Replay.cpp) reissues them with GlReplay as fast as it
+ * can, which measures the driver and the GPU on that exact command stream,
+ * without the demo's CPU work in between.
+ *
+ * The file starts with a Header, followed by the calls, each as its index in
+ * GL_FUNCTIONS (uint16_t) and its arguments' values. Pointers to client memory
+ * are followed by the data they point to, aligned so that the replay can use
+ * it in place. Frames end with FRAME_END, the first one ending the setup.
+ *
+ * Queries (glGet*, glIs*, ...) aren't recorded, as they don't change any
+ * state. Neither are the few calls whose client memory can't be captured
+ * without knowing more of their semantics, e.g. glMapBuffer; they are
+ * reported when the capture ends. The replay doesn't remap object names and
+ * uniform locations, but checks that the driver returns the same ones as
+ * during the capture, which holds when replaying on the same driver.
+ */
+
+namespace gl_capture_detail {
+enum Call : uint16_t {
+#define GL_CAPTURE_ENUM(name) CALL_##name,
+  GL_FUNCTIONS(GL_CAPTURE_ENUM)
+#undef GL_CAPTURE_ENUM
+  CALL_COUNT
+};
+
+inline const char *const CALL_NAMES[CALL_COUNT] = {
+#define GL_CAPTURE_NAME(name) #name,
+    GL_FUNCTIONS(GL_CAPTURE_NAME)
+#undef GL_CAPTURE_NAME
+};
+
+// Ends a frame in place of a call
+constexpr uint16_t FRAME_END = 0xffff;
+constexpr char MAGIC[8] = {'G', 'L', 'C', 'A', 'P', 'T', 'U', '1'};
+constexpr uint64_t PAYLOAD_ALIGNMENT = 16;
+
+struct Header {
+  char magic[8];
+  // The number of functions in GL_FUNCTIONS, whose indices identify the calls
+  uint32_t callCount;
+  int32_t width, height;
+  int32_t majorVersion, minorVersion;
+  uint32_t frames;
+};
+
+// Where the data of a pointer argument is
+enum DataSource : uint8_t {
+  DATA_NONE,
+  // In the file
+  DATA_PAYLOAD,
+  // In the bound buffer, at the offset given instead of a pointer
+  DATA_BUFFER,
+};
+
+enum class Mode : uint8_t {
+  // Queries, which don't change any state
+  SKIPPED,
+  // Recorded as their arguments' values, their pointers being offsets into bound buffers
+  RECORDED,
+  // Recorded by a wrapper, with the data they point to
+  WRAPPED,
+  // Pointing to client memory whose size or lifetime isn't known
+  UNSUPPORTED,
+};
+
+// Capture state, shared by the hooks
+inline FILE *file = nullptr;
+inline bool recording = false;
+inline uint64_t position = 0;
+inline uint64_t recordedCalls = 0;
+inline uint64_t payloadBytes = 0;
+inline Mode modes[CALL_COUNT];
+inline uint64_t unsupportedCalls[CALL_COUNT];
+
+inline void writeRaw(const void *data, size_t size) {
+  std::fwrite(data, 1, size, file);
+  position += size;
+}
+
+template <typename T>
+void write(T value) {
+  if constexpr (std::is_pointer_v<T>) {
+    // Pointers recorded by value are offsets into the bound buffer
+    uint64_t offset = (uint64_t) (uintptr_t) value;
+    writeRaw(&offset, sizeof(offset));
+  } else {
+    writeRaw(&value, sizeof(value));
+  }
+}
+
+inline void writePayload(const void *data, size_t size) {
+  static const uint8_t padding[PAYLOAD_ALIGNMENT] = {};
+  write((uint64_t) size);
+  writeRaw(padding, (PAYLOAD_ALIGNMENT - position % PAYLOAD_ALIGNMENT) % PAYLOAD_ALIGNMENT);
+  writeRaw(data, size);
+  payloadBytes += size;
+}
+
+/**
+ * Writes the data a pointer argument points to.
+ *
+ * @param bufferBinding The binding whose buffer the pointer is an offset into
+ *        if one is bound, e.g. GL_PIXEL_UNPACK_BUFFER_BINDING, or 0 if there
+ *        is none for the call
+ */
+inline void writeData(const void *data, size_t size, GLenum bufferBinding = 0) {
+  int32_t buffer = 0;
+
+  if (bufferBinding != 0) {
+    glGetIntegerv(bufferBinding, &buffer);
+  }
+
+  if (buffer != 0) {
+    write((uint8_t) DATA_BUFFER);
+    write(data);
+  } else if (data == nullptr) {
+    write((uint8_t) DATA_NONE);
+  } else {
+    write((uint8_t) DATA_PAYLOAD);
+    writePayload(data, size);
+  }
+}
+
+// Starts the record of a call, returns false if not recording
+inline bool beginRecord(Call call) {
+  if (!recording) {
+    return false;
+  }
+
+  write((uint16_t) call);
+  recordedCalls++;
+  return true;
+}
+
+inline Mode modeOf(const char *name, bool takesPointers) {
+  const char *unsupported[] = {"glMapBuffer", "glMapBufferRange", "glUnmapBuffer",
+                               "glFlushMappedBufferRange"};
+  // Calls whose pointers are offsets into the bound buffers in core profiles
+  const char *offsets[] = {"glVertexAttribPointer", "glVertexAttribIPointer", "glDrawElements",
+                           "glDrawElementsInstanced", "glDrawRangeElements",
+                           "glDrawElementsBaseVertex", "glDrawRangeElementsBaseVertex",
+                           "glDrawElementsInstancedBaseVertex", "glMultiDrawElementsIndirect"};
+
+  if (std::strncmp(name, "glGet", 5) == 0 || std::strncmp(name, "glIs", 4) == 0 ||
+      std::strcmp(name, "glCheckFramebufferStatus") == 0) {
+    return Mode::SKIPPED;
+  }
+
+  for (const char *call : unsupported) {
+    if (std::strcmp(name, call) == 0) {
+      return Mode::UNSUPPORTED;
+    }
+  }
+
+  if (!takesPointers) {
+    return Mode::RECORDED;
+  }
+
+  for (const char *call : offsets) {
+    if (std::strcmp(name, call) == 0) {
+      return Mode::RECORDED;
+    }
+  }
+
+  return Mode::UNSUPPORTED;
+}
+
+/**
+ * Replaces a glad function pointer with call(), which records the call
+ * according to its mode before calling the original function.
+ */
+template <uint32_t Index, typename Function>
+struct Hook;
+
+template <uint32_t Index, typename Result, typename... Args>
+struct Hook<Index, Result (APIENTRY *)(Args...)> {
+  static inline Result (APIENTRY *original)(Args...) = nullptr;
+
+  static Result APIENTRY call(Args... args) {
+    if (recording) {
+      if (modes[Index] == Mode::RECORDED) {
+        beginRecord((Call) Index);
+        (write(args), ...);
+      } else if (modes[Index] == Mode::UNSUPPORTED) {
+        unsupportedCalls[Index]++;
+      }
+    }
+
+    return original(args...);
+  }
+
+  static void install(Result (APIENTRY *&pointer)(Args...)) {
+    if (pointer != nullptr && original == nullptr) {
+      modes[Index] = modeOf(CALL_NAMES[Index], (std::is_pointer_v<Args> || ...));
+      original = pointer;
+      pointer = &call;
+    }
+  }
+
+  static void uninstall(Result (APIENTRY *&pointer)(Args...)) {
+    if (original != nullptr) {
+      pointer = original;
+      original = nullptr;
+    }
+  }
+};
+
+#define GL_CAPTURE_ORIGINAL(name) \
+  gl_capture_detail::Hook<gl_capture_detail::CALL_##name, decltype(name)>::original
+
+// Replaces a hooked function with a wrapper that records it and calls the original
+template <typename Function>
+void wrap(Call call, Function &pointer, Function wrapper) {
+  if (pointer != nullptr) {
+    modes[call] = Mode::WRAPPED;
+    pointer = wrapper;
+  }
+}
+
+// The size of a pixel in client memory
+inline size_t pixelSize(GLenum format, GLenum type) {
+  switch (type) {
+    case GL_UNSIGNED_BYTE_3_3_2:
+    case GL_UNSIGNED_BYTE_2_3_3_REV:
+      return 1;
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_5_6_5_REV:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+    case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+      return 2;
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_10_10_10_2:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_24_8:
+    case GL_UNSIGNED_INT_10F_11F_11F_REV:
+    case GL_UNSIGNED_INT_5_9_9_9_REV:
+      return 4;
+    case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+      return 8;
+    default:
+      break;
+  }
+
+  size_t components;
+
+  switch (format) {
+    case GL_RG:
+    case GL_RG_INTEGER:
+    case GL_DEPTH_STENCIL:
+      components = 2;
+      break;
+    case GL_RGB:
+    case GL_BGR:
+    case GL_RGB_INTEGER:
+    case GL_BGR_INTEGER:
+      components = 3;
+      break;
+    case GL_RGBA:
+    case GL_BGRA:
+    case GL_RGBA_INTEGER:
+    case GL_BGRA_INTEGER:
+      components = 4;
+      break;
+    default:
+      components = 1;
+      break;
+  }
+
+  switch (type) {
+    case GL_UNSIGNED_BYTE:
+    case GL_BYTE:
+      return components;
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:
+      return components * 2;
+    default:
+      return components * 4;
+  }
+}
+
+/**
+ * The size of an image in client memory, according to the pixel store state.
+ * The skip parameters (GL_UNPACK_SKIP_PIXELS, ...) are assumed to be 0.
+ *
+ * @param unpack Whether the image is read by OpenGL (GL_UNPACK_*) rather than written
+ */
+inline size_t imageSize(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type,
+                        bool unpack) {
+  if (width <= 0 || height <= 0 || depth <= 0) {
+    return 0;
+  }
+
+  int32_t alignment, rowLength, imageHeight = 0;
+  glGetIntegerv(unpack ? GL_UNPACK_ALIGNMENT : GL_PACK_ALIGNMENT, &alignment);
+  glGetIntegerv(unpack ? GL_UNPACK_ROW_LENGTH : GL_PACK_ROW_LENGTH, &rowLength);
+
+  if (depth > 1) {
+    glGetIntegerv(unpack ? GL_UNPACK_IMAGE_HEIGHT : GL_PACK_IMAGE_HEIGHT, &imageHeight);
+  }
+
+  size_t pixel = pixelSize(format, type);
+  size_t rowBytes = (size_t) (rowLength > 0 ? rowLength : width) * pixel;
+  rowBytes = (rowBytes + alignment - 1) / alignment * alignment;
+  size_t imageBytes = rowBytes * (size_t) (imageHeight > 0 ? imageHeight : height);
+  // The last row of the last image ends with its last pixel
+  return imageBytes * (depth - 1) + rowBytes * (height - 1) + (size_t) width * pixel;
+}
+
+// The wrappers of the calls taking pointers to client memory, recording the data
+
+template <Call Index>
+void APIENTRY generate(GLsizei n, GLuint *names) {
+  Hook<Index, void (APIENTRY *)(GLsizei, GLuint *)>::original(n, names);
+
+  // The names are recorded to check that the replay gets the same ones
+  if (beginRecord(Index)) {
+    write(n);
+    writeData(names, (size_t) std::max(n, 0) * sizeof(GLuint));
+  }
+}
+
+template <Call Index>
+void APIENTRY deleteNames(GLsizei n, const GLuint *names) {
+  if (beginRecord(Index)) {
+    write(n);
+    writeData(names, (size_t) std::max(n, 0) * sizeof(GLuint));
+  }
+
+  Hook<Index, void (APIENTRY *)(GLsizei, const GLuint *)>::original(n, names);
+}
+
+inline GLuint APIENTRY createShader(GLenum type) {
+  GLuint shader = GL_CAPTURE_ORIGINAL(glCreateShader)(type);
+
+  if (beginRecord(CALL_glCreateShader)) {
+    write(type);
+    write(shader);
+  }
+
+  return shader;
+}
+
+inline GLuint APIENTRY createProgram() {
+  GLuint program = GL_CAPTURE_ORIGINAL(glCreateProgram)();
+
+  if (beginRecord(CALL_glCreateProgram)) {
+    write(program);
+  }
+
+  return program;
+}
+
+inline void APIENTRY shaderSource(GLuint shader, GLsizei count, const GLchar *const *strings,
+                                  const GLint *lengths) {
+  if (beginRecord(CALL_glShaderSource)) {
+    write(shader);
+    write(count);
+
+    for (GLsizei i = 0; i < count; i++) {
+      bool terminated = lengths == nullptr || lengths[i] < 0;
+      writePayload(strings[i], terminated ? std::strlen(strings[i]) : (size_t) lengths[i]);
+    }
+  }
+
+  GL_CAPTURE_ORIGINAL(glShaderSource)(shader, count, strings, lengths);
+}
+
+// glGetUniformLocation() and the like, recorded as the replay needs the same locations
+template <Call Index, typename Result>
+Result APIENTRY getLocation(GLuint program, const GLchar *name) {
+  Result location = Hook<Index, Result (APIENTRY *)(GLuint, const GLchar *)>::original(program,
+                                                                                       name);
+
+  if (beginRecord(Index)) {
+    write(program);
+    writePayload(name, std::strlen(name) + 1);
+    write(location);
+  }
+
+  return location;
+}
+
+inline void APIENTRY bufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+  if (beginRecord(CALL_glBufferData)) {
+    write(target);
+    write(size);
+    write(usage);
+    writeData(data, (size_t) size);
+  }
+
+  GL_CAPTURE_ORIGINAL(glBufferData)(target, size, data, usage);
+}
+
+inline void APIENTRY bufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
+                                   const void *data) {
+  if (beginRecord(CALL_glBufferSubData)) {
+    write(target);
+    write(offset);
+    write(size);
+    writeData(data, (size_t) size);
+  }
+
+  GL_CAPTURE_ORIGINAL(glBufferSubData)(target, offset, size, data);
+}
+
+inline void APIENTRY texImage2D(GLenum target, GLint level, GLint internalFormat, GLsizei width,
+                                GLsizei height, GLint border, GLenum format, GLenum type,
+                                const void *pixels) {
+  if (beginRecord(CALL_glTexImage2D)) {
+    write(target);
+    write(level);
+    write(internalFormat);
+    write(width);
+    write(height);
+    write(border);
+    write(format);
+    write(type);
+    writeData(pixels, imageSize(width, height, 1, format, type, true),
+              GL_PIXEL_UNPACK_BUFFER_BINDING);
+  }
+
+  GL_CAPTURE_ORIGINAL(glTexImage2D)(target, level, internalFormat, width, height, border, format,
+                                    type, pixels);
+}
+
+inline void APIENTRY texImage3D(GLenum target, GLint level, GLint internalFormat, GLsizei width,
+                                GLsizei height, GLsizei depth, GLint border, GLenum format,
+                                GLenum type, const void *pixels) {
+  if (beginRecord(CALL_glTexImage3D)) {
+    write(target);
+    write(level);
+    write(internalFormat);
+    write(width);
+    write(height);
+    write(depth);
+    write(border);
+    write(format);
+    write(type);
+    writeData(pixels, imageSize(width, height, depth, format, type, true),
+              GL_PIXEL_UNPACK_BUFFER_BINDING);
+  }
+
+  GL_CAPTURE_ORIGINAL(glTexImage3D)(target, level, internalFormat, width, height, depth, border,
+                                    format, type, pixels);
+}
+
+inline void APIENTRY texSubImage2D(GLenum target, GLint level, GLint xOffset, GLint yOffset,
+                                   GLsizei width, GLsizei height, GLenum format, GLenum type,
+                                   const void *pixels) {
+  if (beginRecord(CALL_glTexSubImage2D)) {
+    write(target);
+    write(level);
+    write(xOffset);
+    write(yOffset);
+    write(width);
+    write(height);
+    write(format);
+    write(type);
+    writeData(pixels, imageSize(width, height, 1, format, type, true),
+              GL_PIXEL_UNPACK_BUFFER_BINDING);
+  }
+
+  GL_CAPTURE_ORIGINAL(glTexSubImage2D)(target, level, xOffset, yOffset, width, height, format,
+                                       type, pixels);
+}
+
+inline void APIENTRY texSubImage3D(GLenum target, GLint level, GLint xOffset, GLint yOffset,
+                                   GLint zOffset, GLsizei width, GLsizei height, GLsizei depth,
+                                   GLenum format, GLenum type, const void *pixels) {
+  if (beginRecord(CALL_glTexSubImage3D)) {
+    write(target);
+    write(level);
+    write(xOffset);
+    write(yOffset);
+    write(zOffset);
+    write(width);
+    write(height);
+    write(depth);
+    write(format);
+    write(type);
+    writeData(pixels, imageSize(width, height, depth, format, type, true),
+              GL_PIXEL_UNPACK_BUFFER_BINDING);
+  }
+
+  GL_CAPTURE_ORIGINAL(glTexSubImage3D)(target, level, xOffset, yOffset, zOffset, width, height,
+                                       depth, format, type, pixels);
+}
+
+// Recorded with the size of the pixels, which the replay reads back too, as it may stall
+inline void APIENTRY readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format,
+                                GLenum type, void *pixels) {
+  if (beginRecord(CALL_glReadPixels)) {
+    int32_t buffer;
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &buffer);
+    write(x);
+    write(y);
+    write(width);
+    write(height);
+    write(format);
+    write(type);
+    write((uint8_t) (buffer != 0 ? DATA_BUFFER : DATA_PAYLOAD));
+    write(buffer != 0 ? (uint64_t) (uintptr_t) pixels
+                      : (uint64_t) imageSize(width, height, 1, format, type, false));
+  }
+
+  GL_CAPTURE_ORIGINAL(glReadPixels)(x, y, width, height, format, type, pixels);
+}
+
+inline void APIENTRY drawBuffers(GLsizei n, const GLenum *buffers) {
+  if (beginRecord(CALL_glDrawBuffers)) {
+    write(n);
+    writeData(buffers, (size_t) std::max(n, 0) * sizeof(GLenum));
+  }
+
+  GL_CAPTURE_ORIGINAL(glDrawBuffers)(n, buffers);
+}
+
+template <Call Index, typename T>
+void APIENTRY texParameterv(GLenum target, GLenum name, const T *values) {
+  if (beginRecord(Index)) {
+    bool vector = name == GL_TEXTURE_BORDER_COLOR || name == GL_TEXTURE_SWIZZLE_RGBA;
+    write(target);
+    write(name);
+    writeData(values, (vector ? 4 : 1) * sizeof(T));
+  }
+
+  Hook<Index, void (APIENTRY *)(GLenum, GLenum, const T *)>::original(target, name, values);
+}
+
+// glUniform*v(), with the given number of components per value
+template <Call Index, typename T, size_t Components>
+void APIENTRY uniformVector(GLint location, GLsizei count, const T *values) {
+  if (beginRecord(Index)) {
+    write(location);
+    write(count);
+    writeData(values, (size_t) std::max(count, 0) * Components * sizeof(T));
+  }
+
+  Hook<Index, void (APIENTRY *)(GLint, GLsizei, const T *)>::original(location, count, values);
+}
+
+// glUniformMatrix*fv(), with the given number of floats per matrix
+template <Call Index, size_t Floats>
+void APIENTRY uniformMatrix(GLint location, GLsizei count, GLboolean transpose,
+                            const GLfloat *values) {
+  if (beginRecord(Index)) {
+    write(location);
+    write(count);
+    write(transpose);
+    writeData(values, (size_t) std::max(count, 0) * Floats * sizeof(GLfloat));
+  }
+
+  Hook<Index, void (APIENTRY *)(GLint, GLsizei, GLboolean, const GLfloat *)>::original(
+      location, count, transpose, values);
+}
+
+/**
+ * Reads the calls of a capture file and issues them.
+ */
+class ReplayStream {
+public:
+  explicit ReplayStream(std::vector<uint8_t> data) : data(std::move(data)) {
+  }
+
+  const Header &header() const {
+    return *(const Header *) data.data();
+  }
+
+  template <typename T>
+  T read() {
+    if constexpr (std::is_pointer_v<T>) {
+      return (T) (uintptr_t) read<uint64_t>();
+    } else {
+      T value{};
+
+      if (offset + sizeof(T) > data.size()) {
+        fail("The capture ends in the middle of a call");
+        return value;
+      }
+
+      std::memcpy(&value, &data[offset], sizeof(T));
+      offset += sizeof(T);
+      return value;
+    }
+  }
+
+  // The data a pointer argument points to, see writeData()
+  const void *readData() {
+    auto source = (DataSource) read<uint8_t>();
+
+    if (source == DATA_BUFFER) {
+      return read<const void *>();
+    }
+
+    return source == DATA_PAYLOAD ? readPayload() : nullptr;
+  }
+
+  const void *readPayload(uint64_t *size = nullptr) {
+    uint64_t payloadSize = read<uint64_t>();
+    offset += (PAYLOAD_ALIGNMENT - offset % PAYLOAD_ALIGNMENT) % PAYLOAD_ALIGNMENT;
+
+    if (failed() || offset + payloadSize > data.size()) {
+      fail("The capture ends in the middle of a call");
+      return nullptr;
+    }
+
+    const void *payload = &data[offset];
+    offset += payloadSize;
+    payloadBytes += payloadSize;
+
+    if (size != nullptr) {
+      *size = payloadSize;
+    }
+
+    return payload;
+  }
+
+  // Checks a name or location returned by the driver against the captured one
+  void check(Call call, int64_t captured, int64_t replayed) {
+    if (verifying && captured != replayed) {
+      fail(std::string(CALL_NAMES[call]) + " returned " + std::to_string(replayed) +
+           " instead of " + std::to_string(captured) + " during the capture, replaying " +
+           "requires the same driver");
+    }
+  }
+
+  void fail(const std::string &message) {
+    if (error.empty()) {
+      error = message;
+    }
+  }
+
+  bool failed() const {
+    return !error.empty();
+  }
+
+  // Issues the calls up to the end of the next frame, returns false at the end of the capture
+  bool replayFrame();
+
+  // Marks the current position, after the setup, as the first frame's start
+  void markFirstFrame() {
+    firstFrame = offset;
+  }
+
+  // The next frame replayed is the first one again, and names aren't checked anymore
+  void rewind() {
+    offset = firstFrame;
+    verifying = false;
+  }
+
+  // The scratch memory glReadPixels() reads into
+  std::vector<uint8_t> readBack;
+  std::string error;
+  uint64_t calls = 0;
+  uint64_t payloadBytes = 0;
+
+private:
+  std::vector<uint8_t> data;
+  size_t offset = sizeof(Header);
+  size_t firstFrame = sizeof(Header);
+  bool verifying = true;
+};
+
+using ReplayFunction = void (*)(ReplayStream &);
+
+// Issues a call recorded as its arguments' values
+template <typename Result, typename... Args>
+void issue(ReplayStream &stream, Result (APIENTRY *function)(Args...)) {
+  // Braced initialization evaluates the reads in order
+  std::tuple<Args...> args{stream.read<Args>()...};
+
+  if (!stream.failed()) {
+    std::apply(function, args);
+  }
+}
+
+// Issues a call recorded as its arguments' values but for the last one, a pointer to its data
+template <typename... Args, size_t... Indices>
+void issueWithData(ReplayStream &stream, void (APIENTRY *function)(Args...),
+                   std::index_sequence<Indices...>) {
+  using Arguments = std::tuple<Args...>;
+  using Data = std::tuple_element_t<sizeof...(Args) - 1, Arguments>;
+  std::tuple<std::tuple_element_t<Indices, Arguments>...> args{
+      stream.read<std::tuple_element_t<Indices, Arguments>>()...};
+  auto data = static_cast<Data>(stream.readData());
+
+  if (!stream.failed()) {
+    function(std::get<Indices>(args)..., data);
+  }
+}
+
+template <typename... Args>
+void issueWithData(ReplayStream &stream, void (APIENTRY *function)(Args...)) {
+  issueWithData(stream, function, std::make_index_sequence<sizeof...(Args) - 1>());
+}
+
+template <Call Index>
+void replayGenerate(ReplayStream &stream, void (APIENTRY *function)(GLsizei, GLuint *)) {
+  auto n = stream.read<GLsizei>();
+  auto captured = (const GLuint *) stream.readData();
+
+  if (stream.failed()) {
+    return;
+  }
+
+  std::vector<GLuint> names((size_t) std::max(n, 0));
+  function(n, names.data());
+
+  for (GLsizei i = 0; i < n; i++) {
+    stream.check(Index, captured[i], names[i]);
+  }
+}
+
+template <Call Index, typename Result>
+void replayGetLocation(ReplayStream &stream,
+                       Result (APIENTRY *function)(GLuint, const GLchar *)) {
+  auto program = stream.read<GLuint>();
+  auto name = (const GLchar *) stream.readPayload();
+  auto captured = stream.read<Result>();
+
+  if (!stream.failed()) {
+    stream.check(Index, (int64_t) captured, (int64_t) function(program, name));
+  }
+}
+
+// The replays of the wrapped calls, null for the calls recorded as their arguments
+inline std::array<ReplayFunction, CALL_COUNT> wrappedReplays() {
+  std::array<ReplayFunction, CALL_COUNT> replays{};
+
+#define GL_CAPTURE_REPLAY_GENERATE(name) \
+  replays[CALL_##name] = [](ReplayStream &stream) { replayGenerate<CALL_##name>(stream, name); };
+#define GL_CAPTURE_REPLAY_WITH_DATA(name) \
+  replays[CALL_##name] = [](ReplayStream &stream) { issueWithData(stream, name); };
+  GL_CAPTURE_REPLAY_GENERATE(glGenBuffers)
+  GL_CAPTURE_REPLAY_GENERATE(glGenVertexArrays)
+  GL_CAPTURE_REPLAY_GENERATE(glGenTextures)
+  GL_CAPTURE_REPLAY_GENERATE(glGenFramebuffers)
+  GL_CAPTURE_REPLAY_GENERATE(glGenRenderbuffers)
+  GL_CAPTURE_REPLAY_GENERATE(glGenQueries)
+  GL_CAPTURE_REPLAY_GENERATE(glGenSamplers)
+  GL_CAPTURE_REPLAY_WITH_DATA(glDeleteBuffers)
+  GL_CAPTURE_REPLAY_WITH_DATA(glDeleteVertexArrays)
+  GL_CAPTURE_REPLAY_WITH_DATA(glDeleteTextures)
+  GL_CAPTURE_REPLAY_WITH_DATA(glDeleteFramebuffers)
+  GL_CAPTURE_REPLAY_WITH_DATA(glDeleteRenderbuffers)
+  GL_CAPTURE_REPLAY_WITH_DATA(glDeleteQueries)
+  GL_CAPTURE_REPLAY_WITH_DATA(glDeleteSamplers)
+  GL_CAPTURE_REPLAY_WITH_DATA(glBufferSubData)
+  GL_CAPTURE_REPLAY_WITH_DATA(glTexImage2D)
+  GL_CAPTURE_REPLAY_WITH_DATA(glTexImage3D)
+  GL_CAPTURE_REPLAY_WITH_DATA(glTexSubImage2D)
+  GL_CAPTURE_REPLAY_WITH_DATA(glTexSubImage3D)
+  GL_CAPTURE_REPLAY_WITH_DATA(glDrawBuffers)
+  GL_CAPTURE_REPLAY_WITH_DATA(glTexParameterfv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glTexParameteriv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniform1fv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniform2fv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniform3fv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniform4fv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniform1iv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniform2iv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniform3iv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniform4iv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniform1uiv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniform2uiv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniform3uiv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniform4uiv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniformMatrix2fv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniformMatrix3fv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniformMatrix4fv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniformMatrix2x3fv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniformMatrix3x2fv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniformMatrix2x4fv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniformMatrix4x2fv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniformMatrix3x4fv)
+  GL_CAPTURE_REPLAY_WITH_DATA(glUniformMatrix4x3fv)
+#undef GL_CAPTURE_REPLAY_GENERATE
+#undef GL_CAPTURE_REPLAY_WITH_DATA
+
+  replays[CALL_glCreateShader] = [](ReplayStream &stream) {
+    auto type = stream.read<GLenum>();
+    auto captured = stream.read<GLuint>();
+
+    if (!stream.failed()) {
+      stream.check(CALL_glCreateShader, captured, glCreateShader(type));
+    }
+  };
+  replays[CALL_glCreateProgram] = [](ReplayStream &stream) {
+    auto captured = stream.read<GLuint>();
+
+    if (!stream.failed()) {
+      stream.check(CALL_glCreateProgram, captured, glCreateProgram());
+    }
+  };
+  replays[CALL_glShaderSource] = [](ReplayStream &stream) {
+    auto shader = stream.read<GLuint>();
+    auto count = stream.read<GLsizei>();
+    std::vector<const GLchar *> strings;
+    std::vector<GLint> lengths;
+
+    for (GLsizei i = 0; i < count && !stream.failed(); i++) {
+      uint64_t length = 0;
+      strings.push_back((const GLchar *) stream.readPayload(&length));
+      lengths.push_back((GLint) length);
+    }
+
+    if (!stream.failed()) {
+      glShaderSource(shader, count, strings.data(), lengths.data());
+    }
+  };
+  replays[CALL_glGetUniformLocation] = [](ReplayStream &stream) {
+    replayGetLocation<CALL_glGetUniformLocation>(stream, glGetUniformLocation);
+  };
+  replays[CALL_glGetAttribLocation] = [](ReplayStream &stream) {
+    replayGetLocation<CALL_glGetAttribLocation>(stream, glGetAttribLocation);
+  };
+  replays[CALL_glGetUniformBlockIndex] = [](ReplayStream &stream) {
+    replayGetLocation<CALL_glGetUniformBlockIndex>(stream, glGetUniformBlockIndex);
+  };
+  replays[CALL_glBufferData] = [](ReplayStream &stream) {
+    auto target = stream.read<GLenum>();
+    auto size = stream.read<GLsizeiptr>();
+    auto usage = stream.read<GLenum>();
+    const void *data = stream.readData();
+
+    if (!stream.failed()) {
+      glBufferData(target, size, data, usage);
+    }
+  };
+  replays[CALL_glReadPixels] = [](ReplayStream &stream) {
+    std::tuple<GLint, GLint, GLsizei, GLsizei, GLenum, GLenum> args{
+        stream.read<GLint>(), stream.read<GLint>(), stream.read<GLsizei>(),
+        stream.read<GLsizei>(), stream.read<GLenum>(), stream.read<GLenum>()};
+    auto source = (DataSource) stream.read<uint8_t>();
+    auto value = stream.read<uint64_t>();
+    void *pixels = (void *) (uintptr_t) value;
+
+    // Into client memory, the value being its size
+    if (source == DATA_PAYLOAD) {
+      stream.readBack.resize(value);
+      pixels = stream.readBack.data();
+    }
+
+    if (!stream.failed()) {
+      std::apply(glReadPixels, std::tuple_cat(args, std::make_tuple(pixels)));
+    }
+  };
+
+  return replays;
+}
+
+inline bool ReplayStream::replayFrame() {
+  static const std::array<ReplayFunction, CALL_COUNT> replays = wrappedReplays();
+
+  while (!failed()) {
+    if (offset == data.size()) {
+      return false;
+    }
+
+    auto call = read<uint16_t>();
+
+    if (call == FRAME_END) {
+      return true;
+    }
+
+    if (call >= CALL_COUNT) {
+      fail("Invalid call " + std::to_string(call));
+      return false;
+    }
+
+    calls++;
+
+    if (replays[call] != nullptr) {
+      replays[call](*this);
+      continue;
+    }
+
+    switch (call) {
+#define GL_CAPTURE_ISSUE(name)                        \
+  case CALL_##name:                                   \
+    if (name == nullptr) {                            \
+      fail(std::string(#name) + " isn't available");  \
+    } else {                                          \
+      issue(*this, name);                             \
+    }                                                 \
+    break;
+      GL_FUNCTIONS(GL_CAPTURE_ISSUE)
+#undef GL_CAPTURE_ISSUE
+      default:
+        break;
+    }
+  }
+
+  return false;
+}
+} // namespace gl_capture_detail
+
+/**
+ * Records the OpenGL calls made through the glad function pointers (and those
+ * of GL43.hpp) into a capture file, see the top of this file.
+ *
+ * The hooks are installed when it's created, right after the context, and
+ * again by the first frame for the functions the demo loads later (GL43.hpp).
+ * Only one capture can be recording at a time.
+ *
+ * Window enables it when the GL_CAPTURE environment variable names the file,
+ * capturing GL_CAPTURE_FRAMES frames (10 by default) before closing the window
+ * (see Window.hpp).
+ */
+class GlCapture {
+public:
+  static constexpr uint32_t DEFAULT_FRAMES = 10;
+
+  /**
+   * A capture configured by the environment, or null if GL_CAPTURE isn't set.
+   *
+   * @param width, height The size of the window, for the replay
+   * @param majorVersion, minorVersion The OpenGL version of the context
+   */
+  static std::unique_ptr<GlCapture> fromEnvironment(int32_t width, int32_t height,
+                                                    int32_t majorVersion, int32_t minorVersion) {
+    const char *path = std::getenv("GL_CAPTURE");
+
+    if (path == nullptr || path[0] == '\0') {
+      return nullptr;
+    }
+
+    const char *frames = std::getenv("GL_CAPTURE_FRAMES");
+    auto capture = std::make_unique<GlCapture>(
+        path, frames != nullptr ? (uint32_t) std::max(1, std::atoi(frames)) : DEFAULT_FRAMES);
+
+    if (!capture->start(width, height, majorVersion, minorVersion)) {
+      return nullptr;
+    }
+
+    return capture;
+  }
+
+  GlCapture(std::string path, uint32_t frames) : path(std::move(path)), frames(frames) {
+  }
+
+  GlCapture(const GlCapture &) = delete;
+  GlCapture &operator=(const GlCapture &) = delete;
+
+  ~GlCapture() {
+    finish();
+  }
+
+  // Opens the file and starts recording, returns false if the file can't be written
+  bool start(int32_t width, int32_t height, int32_t majorVersion, int32_t minorVersion) {
+    using namespace gl_capture_detail;
+
+    if (file != nullptr) {
+      std::cout << "ERROR: Another capture is already recording." << std::endl;
+      return false;
+    }
+
+    file = std::fopen(path.c_str(), "wb");
+
+    if (file == nullptr) {
+      std::cout << "ERROR: Failed to write the capture to " << path << std::endl;
+      return false;
+    }
+
+    // Large writes, as the payloads can be large and the calls are small
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+    header.callCount = CALL_COUNT;
+    header.width = width;
+    header.height = height;
+    header.majorVersion = majorVersion;
+    header.minorVersion = minorVersion;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    position = 0;
+    recordedCalls = 0;
+    payloadBytes = 0;
+    std::fill(std::begin(unsupportedCalls), std::end(unsupportedCalls), 0);
+    writeRaw(&header, sizeof(header));
+    install();
+    recording = true;
+    return true;
+  }
+
+  // Ends the setup or the current frame, called at the start of each frame
+  void endFrame() {
+    using namespace gl_capture_detail;
+
+    if (!recording) {
+      return;
+    }
+
+    if (!setupDone) {
+      // The demo has loaded all its functions by now
+      install();
+      setupDone = true;
+    } else {
+      header.frames++;
+    }
+
+    write(FRAME_END);
+
+    if (isComplete()) {
+      finish();
+    }
+  }
+
+  // Whether every frame was recorded
+  bool isComplete() const {
+    return header.frames >= frames;
+  }
+
+  // Stops recording, restores the function pointers and completes the file
+  void finish() {
+    using namespace gl_capture_detail;
+
+    if (!recording) {
+      return;
+    }
+
+    recording = false;
+
+#define GL_CAPTURE_UNINSTALL(name) \
+  gl_capture_detail::Hook<gl_capture_detail::CALL_##name, decltype(name)>::uninstall(name);
+    GL_FUNCTIONS(GL_CAPTURE_UNINSTALL)
+#undef GL_CAPTURE_UNINSTALL
+
+    // The frame count is only known now
+    std::fseek(file, 0, SEEK_SET);
+    std::fwrite(&header, sizeof(header), 1, file);
+    std::fclose(file);
+    file = nullptr;
+
+    char line[160];
+    snprintf(line, sizeof(line), "Captured %u frames to %s: %llu calls, %.1f MB of data\n",
+             header.frames, path.c_str(), (unsigned long long) recordedCalls,
+             (double) payloadBytes / 1.0e6);
+    std::string text = line;
+
+    for (uint32_t call = 0; call < CALL_COUNT; call++) {
+      if (unsupportedCalls[call] > 0) {
+        snprintf(line, sizeof(line), "  WARNING: %s isn't captured (%llu calls), the replay may "
+                                     "differ\n", CALL_NAMES[call],
+                 (unsigned long long) unsupportedCalls[call]);
+        text += line;
+      }
+    }
+
+    std::cout << text << std::flush;
+  }
+
+private:
+  std::string path;
+  uint32_t frames;
+  gl_capture_detail::Header header{};
+  bool setupDone = false;
+
+  // Hooks the loaded functions that aren't yet
+  static void install() {
+    using namespace gl_capture_detail;
+    // Not a GL_CAPTURE_ORIGINAL-like macro, which would get the expanded pointer name
+#define GL_CAPTURE_INSTALL(name) Hook<CALL_##name, decltype(name)>::install(name);
+    GL_FUNCTIONS(GL_CAPTURE_INSTALL)
+#undef GL_CAPTURE_INSTALL
+
+    wrap(CALL_glGenBuffers, glGenBuffers, generate<CALL_glGenBuffers>);
+    wrap(CALL_glGenVertexArrays, glGenVertexArrays, generate<CALL_glGenVertexArrays>);
+    wrap(CALL_glGenTextures, glGenTextures, generate<CALL_glGenTextures>);
+    wrap(CALL_glGenFramebuffers, glGenFramebuffers, generate<CALL_glGenFramebuffers>);
+    wrap(CALL_glGenRenderbuffers, glGenRenderbuffers, generate<CALL_glGenRenderbuffers>);
+    wrap(CALL_glGenQueries, glGenQueries, generate<CALL_glGenQueries>);
+    wrap(CALL_glGenSamplers, glGenSamplers, generate<CALL_glGenSamplers>);
+    wrap(CALL_glDeleteBuffers, glDeleteBuffers, deleteNames<CALL_glDeleteBuffers>);
+    wrap(CALL_glDeleteVertexArrays, glDeleteVertexArrays,
+         deleteNames<CALL_glDeleteVertexArrays>);
+    wrap(CALL_glDeleteTextures, glDeleteTextures, deleteNames<CALL_glDeleteTextures>);
+    wrap(CALL_glDeleteFramebuffers, glDeleteFramebuffers,
+         deleteNames<CALL_glDeleteFramebuffers>);
+    wrap(CALL_glDeleteRenderbuffers, glDeleteRenderbuffers,
+         deleteNames<CALL_glDeleteRenderbuffers>);
+    wrap(CALL_glDeleteQueries, glDeleteQueries, deleteNames<CALL_glDeleteQueries>);
+    wrap(CALL_glDeleteSamplers, glDeleteSamplers, deleteNames<CALL_glDeleteSamplers>);
+    wrap(CALL_glCreateShader, glCreateShader, createShader);
+    wrap(CALL_glCreateProgram, glCreateProgram, createProgram);
+    wrap(CALL_glShaderSource, glShaderSource, shaderSource);
+    wrap(CALL_glGetUniformLocation, glGetUniformLocation,
+         getLocation<CALL_glGetUniformLocation, GLint>);
+    wrap(CALL_glGetAttribLocation, glGetAttribLocation,
+         getLocation<CALL_glGetAttribLocation, GLint>);
+    wrap(CALL_glGetUniformBlockIndex, glGetUniformBlockIndex,
+         getLocation<CALL_glGetUniformBlockIndex, GLuint>);
+    wrap(CALL_glBufferData, glBufferData, bufferData);
+    wrap(CALL_glBufferSubData, glBufferSubData, bufferSubData);
+    wrap(CALL_glTexImage2D, glTexImage2D, texImage2D);
+    wrap(CALL_glTexImage3D, glTexImage3D, texImage3D);
+    wrap(CALL_glTexSubImage2D, glTexSubImage2D, texSubImage2D);
+    wrap(CALL_glTexSubImage3D, glTexSubImage3D, texSubImage3D);
+    wrap(CALL_glReadPixels, glReadPixels, readPixels);
+    wrap(CALL_glDrawBuffers, glDrawBuffers, drawBuffers);
+    wrap(CALL_glTexParameterfv, glTexParameterfv, texParameterv<CALL_glTexParameterfv, GLfloat>);
+    wrap(CALL_glTexParameteriv, glTexParameteriv, texParameterv<CALL_glTexParameteriv, GLint>);
+    wrap(CALL_glUniform1fv, glUniform1fv, uniformVector<CALL_glUniform1fv, GLfloat, 1>);
+    wrap(CALL_glUniform2fv, glUniform2fv, uniformVector<CALL_glUniform2fv, GLfloat, 2>);
+    wrap(CALL_glUniform3fv, glUniform3fv, uniformVector<CALL_glUniform3fv, GLfloat, 3>);
+    wrap(CALL_glUniform4fv, glUniform4fv, uniformVector<CALL_glUniform4fv, GLfloat, 4>);
+    wrap(CALL_glUniform1iv, glUniform1iv, uniformVector<CALL_glUniform1iv, GLint, 1>);
+    wrap(CALL_glUniform2iv, glUniform2iv, uniformVector<CALL_glUniform2iv, GLint, 2>);
+    wrap(CALL_glUniform3iv, glUniform3iv, uniformVector<CALL_glUniform3iv, GLint, 3>);
+    wrap(CALL_glUniform4iv, glUniform4iv, uniformVector<CALL_glUniform4iv, GLint, 4>);
+    wrap(CALL_glUniform1uiv, glUniform1uiv, uniformVector<CALL_glUniform1uiv, GLuint, 1>);
+    wrap(CALL_glUniform2uiv, glUniform2uiv, uniformVector<CALL_glUniform2uiv, GLuint, 2>);
+    wrap(CALL_glUniform3uiv, glUniform3uiv, uniformVector<CALL_glUniform3uiv, GLuint, 3>);
+    wrap(CALL_glUniform4uiv, glUniform4uiv, uniformVector<CALL_glUniform4uiv, GLuint, 4>);
+    wrap(CALL_glUniformMatrix2fv, glUniformMatrix2fv, uniformMatrix<CALL_glUniformMatrix2fv, 4>);
+    wrap(CALL_glUniformMatrix3fv, glUniformMatrix3fv, uniformMatrix<CALL_glUniformMatrix3fv, 9>);
+    wrap(CALL_glUniformMatrix4fv, glUniformMatrix4fv,
+         uniformMatrix<CALL_glUniformMatrix4fv, 16>);
+    wrap(CALL_glUniformMatrix2x3fv, glUniformMatrix2x3fv,
+         uniformMatrix<CALL_glUniformMatrix2x3fv, 6>);
+    wrap(CALL_glUniformMatrix3x2fv, glUniformMatrix3x2fv,
+         uniformMatrix<CALL_glUniformMatrix3x2fv, 6>);
+    wrap(CALL_glUniformMatrix2x4fv, glUniformMatrix2x4fv,
+         uniformMatrix<CALL_glUniformMatrix2x4fv, 8>);
+    wrap(CALL_glUniformMatrix4x2fv, glUniformMatrix4x2fv,
+         uniformMatrix<CALL_glUniformMatrix4x2fv, 8>);
+    wrap(CALL_glUniformMatrix3x4fv, glUniformMatrix3x4fv,
+         uniformMatrix<CALL_glUniformMatrix3x4fv, 12>);
+    wrap(CALL_glUniformMatrix4x3fv, glUniformMatrix4x3fv,
+         uniformMatrix<CALL_glUniformMatrix4x3fv, 12>);
+  }
+};
+
+/**
+ * Loads a capture file and replays it, see Replay.cpp.
+ */
+class GlReplay {
+public:
+  // The replay of the file, or null if it can't be read or isn't a capture (the error is printed)
+  static std::unique_ptr<GlReplay> load(const std::string &path) {
+    using namespace gl_capture_detail;
+    FILE *file = std::fopen(path.c_str(), "rb");
+
+    if (file == nullptr) {
+      std::cout << "ERROR: Failed to read " << path << std::endl;
+      return nullptr;
+    }
+
+    // The whole file is read up front, so that replaying doesn't wait for the disk
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    std::vector<uint8_t> data((size_t) std::max(size, 0L));
+    bool read = std::fread(data.data(), 1, data.size(), file) == data.size();
+    std::fclose(file);
+    const auto *header = (const Header *) data.data();
+
+    if (!read || data.size() < sizeof(Header) ||
+        std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0) {
+      std::cout << "ERROR: " << path << " isn't a capture file" << std::endl;
+      return nullptr;
+    }
+
+    if (header->callCount != CALL_COUNT) {
+      std::cout << "ERROR: " << path << " was captured by another version of the demos"
+                << std::endl;
+      return nullptr;
+    }
+
+    return std::unique_ptr<GlReplay>(new GlReplay(std::move(data)));
+  }
+
+  const gl_capture_detail::Header &header() const {
+    return stream.header();
+  }
+
+  // Issues the calls made before the first frame, which create the resources
+  bool replaySetup() {
+    bool frames = stream.replayFrame();
+    stream.markFirstFrame();
+    return frames && !stream.failed();
+  }
+
+  // Issues the calls of the next frame, returns false after the last one or on errors
+  bool replayFrame() {
+    return stream.replayFrame() && !stream.failed();
+  }
+
+  // Starts replaying the frames again, after the setup
+  void rewind() {
+    stream.rewind();
+  }
+
+  // The error that stopped the replay, empty if none did
+  const std::string &error() const {
+    return stream.error;
+  }
+
+  // The number of calls issued so far
+  uint64_t calls() const {
+    return stream.calls;
+  }
+
+  // The number of bytes of data passed to the calls so far
+  uint64_t payloadBytes() const {
+    return stream.payloadBytes;
+  }
+
+private:
+  gl_capture_detail::ReplayStream stream;
+
+  explicit GlReplay(std::vector<uint8_t> data) : stream(std::move(data)) {
+  }
+};
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "GL43.hpp"
+
+/*
+ * Every OpenGL function the demos can call, i.e. the OpenGL 3.3 core functions
+ * loaded by glad (include/glad/glad.h) and the 4.3 ones loaded by GL43.hpp, as
+ * an X macro: GL_FUNCTIONS(X) expands to X(glCullFace) X(glFrontFace) ...
+ * Inside X, the argument expands to the function pointer variable (e.g.
+ * glad_glCullFace), while #name and name##... use the function's name.
+ */
+
+#define GL_FUNCTIONS(X) \
+  X(glCullFace) X(glFrontFace) X(glHint) X(glLineWidth) X(glPointSize) X(glPolygonMode) \
+  X(glScissor) X(glTexParameterf) X(glTexParameterfv) X(glTexParameteri) X(glTexParameteriv) \
+  X(glTexImage1D) X(glTexImage2D) X(glDrawBuffer) X(glClear) X(glClearColor) X(glClearStencil) \
+  X(glClearDepth) X(glStencilMask) X(glColorMask) X(glDepthMask) X(glDisable) X(glEnable) \
+  X(glFinish) X(glFlush) X(glBlendFunc) X(glLogicOp) X(glStencilFunc) X(glStencilOp) \
+  X(glDepthFunc) X(glPixelStoref) X(glPixelStorei) X(glReadBuffer) X(glReadPixels) \
+  X(glGetBooleanv) X(glGetDoublev) X(glGetError) X(glGetFloatv) X(glGetIntegerv) X(glGetString) \
+  X(glGetTexImage) X(glGetTexParameterfv) X(glGetTexParameteriv) X(glGetTexLevelParameterfv) \
+  X(glGetTexLevelParameteriv) X(glIsEnabled) X(glDepthRange) X(glViewport) X(glDrawArrays) \
+  X(glDrawElements) X(glPolygonOffset) X(glCopyTexImage1D) X(glCopyTexImage2D) \
+  X(glCopyTexSubImage1D) X(glCopyTexSubImage2D) X(glTexSubImage1D) X(glTexSubImage2D) \
+  X(glBindTexture) X(glDeleteTextures) X(glGenTextures) X(glIsTexture) X(glDrawRangeElements) \
+  X(glTexImage3D) X(glTexSubImage3D) X(glCopyTexSubImage3D) X(glActiveTexture) \
+  X(glSampleCoverage) X(glCompressedTexImage3D) X(glCompressedTexImage2D) \
+  X(glCompressedTexImage1D) X(glCompressedTexSubImage3D) X(glCompressedTexSubImage2D) \
+  X(glCompressedTexSubImage1D) X(glGetCompressedTexImage) X(glBlendFuncSeparate) \
+  X(glMultiDrawArrays) X(glMultiDrawElements) X(glPointParameterf) X(glPointParameterfv) \
+  X(glPointParameteri) X(glPointParameteriv) X(glBlendColor) X(glBlendEquation) X(glGenQueries) \
+  X(glDeleteQueries) X(glIsQuery) X(glBeginQuery) X(glEndQuery) X(glGetQueryiv) \
+  X(glGetQueryObjectiv) X(glGetQueryObjectuiv) X(glBindBuffer) X(glDeleteBuffers) X(glGenBuffers) \
+  X(glIsBuffer) X(glBufferData) X(glBufferSubData) X(glGetBufferSubData) X(glMapBuffer) \
+  X(glUnmapBuffer) X(glGetBufferParameteriv) X(glGetBufferPointerv) X(glBlendEquationSeparate) \
+  X(glDrawBuffers) X(glStencilOpSeparate) X(glStencilFuncSeparate) X(glStencilMaskSeparate) \
+  X(glAttachShader) X(glBindAttribLocation) X(glCompileShader) X(glCreateProgram) \
+  X(glCreateShader) X(glDeleteProgram) X(glDeleteShader) X(glDetachShader) \
+  X(glDisableVertexAttribArray) X(glEnableVertexAttribArray) X(glGetActiveAttrib) \
+  X(glGetActiveUniform) X(glGetAttachedShaders) X(glGetAttribLocation) X(glGetProgramiv) \
+  X(glGetProgramInfoLog) X(glGetShaderiv) X(glGetShaderInfoLog) X(glGetShaderSource) \
+  X(glGetUniformLocation) X(glGetUniformfv) X(glGetUniformiv) X(glGetVertexAttribdv) \
+  X(glGetVertexAttribfv) X(glGetVertexAttribiv) X(glGetVertexAttribPointerv) X(glIsProgram) \
+  X(glIsShader) X(glLinkProgram) X(glShaderSource) X(glUseProgram) X(glUniform1f) X(glUniform2f) \
+  X(glUniform3f) X(glUniform4f) X(glUniform1i) X(glUniform2i) X(glUniform3i) X(glUniform4i) \
+  X(glUniform1fv) X(glUniform2fv) X(glUniform3fv) X(glUniform4fv) X(glUniform1iv) X(glUniform2iv) \
+  X(glUniform3iv) X(glUniform4iv) X(glUniformMatrix2fv) X(glUniformMatrix3fv) \
+  X(glUniformMatrix4fv) X(glValidateProgram) X(glVertexAttrib1d) X(glVertexAttrib1dv) \
+  X(glVertexAttrib1f) X(glVertexAttrib1fv) X(glVertexAttrib1s) X(glVertexAttrib1sv) \
+  X(glVertexAttrib2d) X(glVertexAttrib2dv) X(glVertexAttrib2f) X(glVertexAttrib2fv) \
+  X(glVertexAttrib2s) X(glVertexAttrib2sv) X(glVertexAttrib3d) X(glVertexAttrib3dv) \
+  X(glVertexAttrib3f) X(glVertexAttrib3fv) X(glVertexAttrib3s) X(glVertexAttrib3sv) \
+  X(glVertexAttrib4Nbv) X(glVertexAttrib4Niv) X(glVertexAttrib4Nsv) X(glVertexAttrib4Nub) \
+  X(glVertexAttrib4Nubv) X(glVertexAttrib4Nuiv) X(glVertexAttrib4Nusv) X(glVertexAttrib4bv) \
+  X(glVertexAttrib4d) X(glVertexAttrib4dv) X(glVertexAttrib4f) X(glVertexAttrib4fv) \
+  X(glVertexAttrib4iv) X(glVertexAttrib4s) X(glVertexAttrib4sv) X(glVertexAttrib4ubv) \
+  X(glVertexAttrib4uiv) X(glVertexAttrib4usv) X(glVertexAttribPointer) X(glUniformMatrix2x3fv) \
+  X(glUniformMatrix3x2fv) X(glUniformMatrix2x4fv) X(glUniformMatrix4x2fv) X(glUniformMatrix3x4fv) \
+  X(glUniformMatrix4x3fv) X(glColorMaski) X(glGetBooleani_v) X(glGetIntegeri_v) X(glEnablei) \
+  X(glDisablei) X(glIsEnabledi) X(glBeginTransformFeedback) X(glEndTransformFeedback) \
+  X(glBindBufferRange) X(glBindBufferBase) X(glTransformFeedbackVaryings) \
+  X(glGetTransformFeedbackVarying) X(glClampColor) X(glBeginConditionalRender) \
+  X(glEndConditionalRender) X(glVertexAttribIPointer) X(glGetVertexAttribIiv) \
+  X(glGetVertexAttribIuiv) X(glVertexAttribI1i) X(glVertexAttribI2i) X(glVertexAttribI3i) \
+  X(glVertexAttribI4i) X(glVertexAttribI1ui) X(glVertexAttribI2ui) X(glVertexAttribI3ui) \
+  X(glVertexAttribI4ui) X(glVertexAttribI1iv) X(glVertexAttribI2iv) X(glVertexAttribI3iv) \
+  X(glVertexAttribI4iv) X(glVertexAttribI1uiv) X(glVertexAttribI2uiv) X(glVertexAttribI3uiv) \
+  X(glVertexAttribI4uiv) X(glVertexAttribI4bv) X(glVertexAttribI4sv) X(glVertexAttribI4ubv) \
+  X(glVertexAttribI4usv) X(glGetUniformuiv) X(glBindFragDataLocation) X(glGetFragDataLocation) \
+  X(glUniform1ui) X(glUniform2ui) X(glUniform3ui) X(glUniform4ui) X(glUniform1uiv) \
+  X(glUniform2uiv) X(glUniform3uiv) X(glUniform4uiv) X(glTexParameterIiv) X(glTexParameterIuiv) \
+  X(glGetTexParameterIiv) X(glGetTexParameterIuiv) X(glClearBufferiv) X(glClearBufferuiv) \
+  X(glClearBufferfv) X(glClearBufferfi) X(glGetStringi) X(glIsRenderbuffer) X(glBindRenderbuffer) \
+  X(glDeleteRenderbuffers) X(glGenRenderbuffers) X(glRenderbufferStorage) \
+  X(glGetRenderbufferParameteriv) X(glIsFramebuffer) X(glBindFramebuffer) X(glDeleteFramebuffers) \
+  X(glGenFramebuffers) X(glCheckFramebufferStatus) X(glFramebufferTexture1D) \
+  X(glFramebufferTexture2D) X(glFramebufferTexture3D) X(glFramebufferRenderbuffer) \
+  X(glGetFramebufferAttachmentParameteriv) X(glGenerateMipmap) X(glBlitFramebuffer) \
+  X(glRenderbufferStorageMultisample) X(glFramebufferTextureLayer) X(glMapBufferRange) \
+  X(glFlushMappedBufferRange) X(glBindVertexArray) X(glDeleteVertexArrays) X(glGenVertexArrays) \
+  X(glIsVertexArray) X(glDrawArraysInstanced) X(glDrawElementsInstanced) X(glTexBuffer) \
+  X(glPrimitiveRestartIndex) X(glCopyBufferSubData) X(glGetUniformIndices) \
+  X(glGetActiveUniformsiv) X(glGetActiveUniformName) X(glGetUniformBlockIndex) \
+  X(glGetActiveUniformBlockiv) X(glGetActiveUniformBlockName) X(glUniformBlockBinding) \
+  X(glDrawElementsBaseVertex) X(glDrawRangeElementsBaseVertex) \
+  X(glDrawElementsInstancedBaseVertex) X(glMultiDrawElementsBaseVertex) X(glProvokingVertex) \
+  X(glFenceSync) X(glIsSync) X(glDeleteSync) X(glClientWaitSync) X(glWaitSync) X(glGetInteger64v) \
+  X(glGetSynciv) X(glGetInteger64i_v) X(glGetBufferParameteri64v) X(glFramebufferTexture) \
+  X(glTexImage2DMultisample) X(glTexImage3DMultisample) X(glGetMultisamplefv) X(glSampleMaski) \
+  X(glBindFragDataLocationIndexed) X(glGetFragDataIndex) X(glGenSamplers) X(glDeleteSamplers) \
+  X(glIsSampler) X(glBindSampler) X(glSamplerParameteri) X(glSamplerParameteriv) \
+  X(glSamplerParameterf) X(glSamplerParameterfv) X(glSamplerParameterIiv) \
+  X(glSamplerParameterIuiv) X(glGetSamplerParameteriv) X(glGetSamplerParameterIiv) \
+  X(glGetSamplerParameterfv) X(glGetSamplerParameterIuiv) X(glQueryCounter) \
+  X(glGetQueryObjecti64v) X(glGetQueryObjectui64v) X(glVertexAttribDivisor) X(glVertexAttribP1ui) \
+  X(glVertexAttribP1uiv) X(glVertexAttribP2ui) X(glVertexAttribP2uiv) X(glVertexAttribP3ui) \
+  X(glVertexAttribP3uiv) X(glVertexAttribP4ui) X(glVertexAttribP4uiv) X(glVertexP2ui) \
+  X(glVertexP2uiv) X(glVertexP3ui) X(glVertexP3uiv) X(glVertexP4ui) X(glVertexP4uiv) \
+  X(glTexCoordP1ui) X(glTexCoordP1uiv) X(glTexCoordP2ui) X(glTexCoordP2uiv) X(glTexCoordP3ui) \
+  X(glTexCoordP3uiv) X(glTexCoordP4ui) X(glTexCoordP4uiv) X(glMultiTexCoordP1ui) \
+  X(glMultiTexCoordP1uiv) X(glMultiTexCoordP2ui) X(glMultiTexCoordP2uiv) X(glMultiTexCoordP3ui) \
+  X(glMultiTexCoordP3uiv) X(glMultiTexCoordP4ui) X(glMultiTexCoordP4uiv) X(glNormalP3ui) \
+  X(glNormalP3uiv) X(glColorP3ui) X(glColorP3uiv) X(glColorP4ui) X(glColorP4uiv) \
+  X(glSecondaryColorP3ui) X(glSecondaryColorP3uiv) X(glDispatchCompute) X(glMemoryBarrier) \
+  X(glMultiDrawElementsIndirect) X(glBindImageTexture)
@@ -0,0 +1,555 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "GLFunctions.hpp"
+
+namespace gl_interceptor_detail {
+enum Call : uint32_t {
+#define GL_INTERCEPTOR_ENUM(name) CALL_##name,
+  GL_FUNCTIONS(GL_INTERCEPTOR_ENUM)
+#undef GL_INTERCEPTOR_ENUM
+  CALL_COUNT
+};
+
+struct CallCounter {
+  const char *name = nullptr;
+  // Whether the call may wait for the driver or the GPU, and is therefore timed
+  bool synchronous = false;
+  uint64_t calls = 0;
+  // Calls that didn't change the state, e.g. binding the bound VAO
+  uint64_t redundant = 0;
+  int64_t nanoseconds = 0;
+};
+
+// The largest uniform value tracked, a mat4
+constexpr size_t MAX_UNIFORM_SIZE = 64;
+
+struct UniformValue {
+  uint8_t bytes[MAX_UNIFORM_SIZE];
+  size_t size = 0;
+};
+
+// The bindings the redundancy checks compare against, the textures and buffers unknown until bound
+struct TrackedState {
+  GLuint program = 0;
+  GLuint vertexArray = 0;
+  GLenum activeTexture = GL_TEXTURE0;
+  // By texture unit (high 32 bits) and target
+  std::unordered_map<uint64_t, GLuint> textures;
+  std::unordered_map<GLenum, GLuint> buffers;
+  GLuint drawFramebuffer = 0;
+  GLuint readFramebuffer = 0;
+  // The last value set by program (high 32 bits) and location
+  std::unordered_map<uint64_t, UniformValue> uniforms;
+};
+
+inline CallCounter counters[CALL_COUNT];
+inline TrackedState state;
+
+/**
+ * Replaces a glad function pointer with call(), which counts the calls
+ * (and times them if synchronous) before calling the original function.
+ */
+template <uint32_t Index, typename Function>
+struct Hook;
+
+template <uint32_t Index, typename Result, typename... Args>
+struct Hook<Index, Result (APIENTRY *)(Args...)> {
+  static inline Result (APIENTRY *original)(Args...) = nullptr;
+
+  static Result APIENTRY call(Args... args) {
+    CallCounter &counter = counters[Index];
+    counter.calls++;
+
+    if (!counter.synchronous) {
+      return original(args...);
+    }
+
+    // Stops the timer when the call returns, with or without a result
+    struct Timer {
+      CallCounter &counter;
+      std::chrono::steady_clock::time_point start;
+
+      ~Timer() {
+        counter.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+      }
+    } timer{counter, std::chrono::steady_clock::now()};
+
+    return original(args...);
+  }
+
+  static void install(Result (APIENTRY *&pointer)(Args...), const char *name) {
+    counters[Index].name = name;
+    counters[Index].synchronous = isSynchronous(name);
+
+    if (pointer != nullptr && original == nullptr) {
+      original = pointer;
+      pointer = &call;
+    }
+  }
+
+  static void uninstall(Result (APIENTRY *&pointer)(Args...)) {
+    if (original != nullptr) {
+      pointer = original;
+      original = nullptr;
+    }
+  }
+
+  // Queries and reads back may wait for the driver or the GPU
+  static bool isSynchronous(const char *name) {
+    const char *calls[] = {"glReadPixels", "glFinish", "glClientWaitSync", "glMapBuffer",
+                           "glMapBufferRange"};
+
+    if (std::strncmp(name, "glGet", 5) == 0) {
+      return true;
+    }
+
+    for (const char *call : calls) {
+      if (std::strcmp(name, call) == 0) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+};
+
+#define GL_INTERCEPTOR_HOOK(name) \
+  gl_interceptor_detail::Hook<gl_interceptor_detail::CALL_##name, decltype(name)>
+
+inline void countRedundant(Call call, bool redundant) {
+  if (redundant) {
+    counters[call].redundant++;
+  }
+}
+
+// Remembers a uniform value of the current program, and returns whether it was already set to it
+inline bool setUniform(GLint location, const void *data, size_t size) {
+  if (location < 0 || state.program == 0 || size > MAX_UNIFORM_SIZE) {
+    return false;
+  }
+
+  UniformValue &value = state.uniforms[(uint64_t) state.program << 32 | (uint32_t) location];
+  bool same = value.size == size && std::memcmp(value.bytes, data, size) == 0;
+  std::memcpy(value.bytes, data, size);
+  value.size = size;
+  return same;
+}
+
+inline void forgetUniforms(GLuint program) {
+  for (auto entry = state.uniforms.begin(); entry != state.uniforms.end();) {
+    entry = entry->first >> 32 == program ? state.uniforms.erase(entry) : std::next(entry);
+  }
+}
+
+// The wrappers below check for redundant calls, then call the counting hooks
+
+inline void APIENTRY useProgram(GLuint program) {
+  countRedundant(CALL_glUseProgram, program == state.program);
+  state.program = program;
+  GL_INTERCEPTOR_HOOK(glUseProgram)::call(program);
+}
+
+inline void APIENTRY linkProgram(GLuint program) {
+  // Linking resets the uniforms
+  forgetUniforms(program);
+  GL_INTERCEPTOR_HOOK(glLinkProgram)::call(program);
+}
+
+inline void APIENTRY deleteProgram(GLuint program) {
+  if (program == state.program) {
+    state.program = 0;
+  }
+
+  forgetUniforms(program);
+  GL_INTERCEPTOR_HOOK(glDeleteProgram)::call(program);
+}
+
+inline void APIENTRY bindVertexArray(GLuint array) {
+  countRedundant(CALL_glBindVertexArray, array == state.vertexArray);
+  state.vertexArray = array;
+  GL_INTERCEPTOR_HOOK(glBindVertexArray)::call(array);
+}
+
+inline void APIENTRY deleteVertexArrays(GLsizei n, const GLuint *arrays) {
+  for (GLsizei i = 0; i < n; i++) {
+    if (arrays[i] == state.vertexArray) {
+      state.vertexArray = 0;
+    }
+  }
+
+  GL_INTERCEPTOR_HOOK(glDeleteVertexArrays)::call(n, arrays);
+}
+
+inline void APIENTRY activeTexture(GLenum texture) {
+  countRedundant(CALL_glActiveTexture, texture == state.activeTexture);
+  state.activeTexture = texture;
+  GL_INTERCEPTOR_HOOK(glActiveTexture)::call(texture);
+}
+
+inline void APIENTRY bindTexture(GLenum target, GLuint texture) {
+  uint64_t key = (uint64_t) (state.activeTexture - GL_TEXTURE0) << 32 | target;
+  auto bound = state.textures.find(key);
+  countRedundant(CALL_glBindTexture, bound != state.textures.end() && bound->second == texture);
+  state.textures[key] = texture;
+  GL_INTERCEPTOR_HOOK(glBindTexture)::call(target, texture);
+}
+
+inline void APIENTRY deleteTextures(GLsizei n, const GLuint *textures) {
+  for (GLsizei i = 0; i < n; i++) {
+    for (auto &entry : state.textures) {
+      if (entry.second == textures[i]) {
+        entry.second = 0;
+      }
+    }
+  }
+
+  GL_INTERCEPTOR_HOOK(glDeleteTextures)::call(n, textures);
+}
+
+inline void APIENTRY bindBuffer(GLenum target, GLuint buffer) {
+  // The element array buffer binding belongs to the bound VAO, so isn't tracked
+  if (target != GL_ELEMENT_ARRAY_BUFFER) {
+    auto bound = state.buffers.find(target);
+    countRedundant(CALL_glBindBuffer, bound != state.buffers.end() && bound->second == buffer);
+    state.buffers[target] = buffer;
+  }
+
+  GL_INTERCEPTOR_HOOK(glBindBuffer)::call(target, buffer);
+}
+
+// Binding an indexed target also binds the buffer to its generic binding. The indexed bindings
+// themselves aren't tracked, so these calls are never counted as redundant.
+inline void APIENTRY bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+  state.buffers[target] = buffer;
+  GL_INTERCEPTOR_HOOK(glBindBufferBase)::call(target, index, buffer);
+}
+
+inline void APIENTRY bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset,
+                                     GLsizeiptr size) {
+  state.buffers[target] = buffer;
+  GL_INTERCEPTOR_HOOK(glBindBufferRange)::call(target, index, buffer, offset, size);
+}
+
+inline void APIENTRY deleteBuffers(GLsizei n, const GLuint *buffers) {
+  for (GLsizei i = 0; i < n; i++) {
+    for (auto &entry : state.buffers) {
+      if (entry.second == buffers[i]) {
+        entry.second = 0;
+      }
+    }
+  }
+
+  GL_INTERCEPTOR_HOOK(glDeleteBuffers)::call(n, buffers);
+}
+
+inline void APIENTRY bindFramebuffer(GLenum target, GLuint framebuffer) {
+  bool draw = target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER;
+  bool read = target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER;
+  countRedundant(CALL_glBindFramebuffer, (!draw || state.drawFramebuffer == framebuffer) &&
+                                         (!read || state.readFramebuffer == framebuffer));
+
+  if (draw) {
+    state.drawFramebuffer = framebuffer;
+  }
+
+  if (read) {
+    state.readFramebuffer = framebuffer;
+  }
+
+  GL_INTERCEPTOR_HOOK(glBindFramebuffer)::call(target, framebuffer);
+}
+
+inline void APIENTRY deleteFramebuffers(GLsizei n, const GLuint *framebuffers) {
+  for (GLsizei i = 0; i < n; i++) {
+    if (framebuffers[i] == state.drawFramebuffer) {
+      state.drawFramebuffer = 0;
+    }
+
+    if (framebuffers[i] == state.readFramebuffer) {
+      state.readFramebuffer = 0;
+    }
+  }
+
+  GL_INTERCEPTOR_HOOK(glDeleteFramebuffers)::call(n, framebuffers);
+}
+
+inline void APIENTRY uniform1i(GLint location, GLint v0) {
+  countRedundant(CALL_glUniform1i, setUniform(location, &v0, sizeof(v0)));
+  GL_INTERCEPTOR_HOOK(glUniform1i)::call(location, v0);
+}
+
+inline void APIENTRY uniform1f(GLint location, GLfloat v0) {
+  countRedundant(CALL_glUniform1f, setUniform(location, &v0, sizeof(v0)));
+  GL_INTERCEPTOR_HOOK(glUniform1f)::call(location, v0);
+}
+
+inline void APIENTRY uniform2f(GLint location, GLfloat v0, GLfloat v1) {
+  const GLfloat values[] = {v0, v1};
+  countRedundant(CALL_glUniform2f, setUniform(location, values, sizeof(values)));
+  GL_INTERCEPTOR_HOOK(glUniform2f)::call(location, v0, v1);
+}
+
+inline void APIENTRY uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+  const GLfloat values[] = {v0, v1, v2};
+  countRedundant(CALL_glUniform3f, setUniform(location, values, sizeof(values)));
+  GL_INTERCEPTOR_HOOK(glUniform3f)::call(location, v0, v1, v2);
+}
+
+inline void APIENTRY uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {
+  const GLfloat values[] = {v0, v1, v2, v3};
+  countRedundant(CALL_glUniform4f, setUniform(location, values, sizeof(values)));
+  GL_INTERCEPTOR_HOOK(glUniform4f)::call(location, v0, v1, v2, v3);
+}
+
+// The array setters only compare single values, the others are rarely set again unchanged
+inline void APIENTRY uniform1fv(GLint location, GLsizei count, const GLfloat *value) {
+  countRedundant(CALL_glUniform1fv, count == 1 && setUniform(location, value, sizeof(GLfloat)));
+  GL_INTERCEPTOR_HOOK(glUniform1fv)::call(location, count, value);
+}
+
+inline void APIENTRY uniform2fv(GLint location, GLsizei count, const GLfloat *value) {
+  countRedundant(CALL_glUniform2fv,
+                 count == 1 && setUniform(location, value, 2 * sizeof(GLfloat)));
+  GL_INTERCEPTOR_HOOK(glUniform2fv)::call(location, count, value);
+}
+
+inline void APIENTRY uniform3fv(GLint location, GLsizei count, const GLfloat *value) {
+  countRedundant(CALL_glUniform3fv,
+                 count == 1 && setUniform(location, value, 3 * sizeof(GLfloat)));
+  GL_INTERCEPTOR_HOOK(glUniform3fv)::call(location, count, value);
+}
+
+inline void APIENTRY uniform4fv(GLint location, GLsizei count, const GLfloat *value) {
+  countRedundant(CALL_glUniform4fv,
+                 count == 1 && setUniform(location, value, 4 * sizeof(GLfloat)));
+  GL_INTERCEPTOR_HOOK(glUniform4fv)::call(location, count, value);
+}
+
+inline void APIENTRY uniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose,
+                                      const GLfloat *value) {
+  countRedundant(CALL_glUniformMatrix2fv,
+                 count == 1 && !transpose && setUniform(location, value, 4 * sizeof(GLfloat)));
+  GL_INTERCEPTOR_HOOK(glUniformMatrix2fv)::call(location, count, transpose, value);
+}
+
+inline void APIENTRY uniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose,
+                                      const GLfloat *value) {
+  countRedundant(CALL_glUniformMatrix3fv,
+                 count == 1 && !transpose && setUniform(location, value, 9 * sizeof(GLfloat)));
+  GL_INTERCEPTOR_HOOK(glUniformMatrix3fv)::call(location, count, transpose, value);
+}
+
+inline void APIENTRY uniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose,
+                                      const GLfloat *value) {
+  countRedundant(CALL_glUniformMatrix4fv,
+                 count == 1 && !transpose && setUniform(location, value, 16 * sizeof(GLfloat)));
+  GL_INTERCEPTOR_HOOK(glUniformMatrix4fv)::call(location, count, transpose, value);
+}
+} // namespace gl_interceptor_detail
+
+/**
+ * Counts every OpenGL call made per frame, by replacing the glad function
+ * pointers (and those of GL43.hpp) with counting wrappers, and reports:
+ *
+ * - the most frequent calls, which are candidates for batching
+ * - redundant calls that didn't change the state: binding the bound program,
+ *   VAO, texture, buffer or framebuffer, selecting the active texture unit
+ *   again, or setting a uniform to the value it already has
+ * - the time spent in calls that may stall on the driver or the GPU, i.e.
+ *   glGet*, glReadPixels, glFinish, glClientWaitSync and glMapBuffer*
+ * - uniform and attribute location lookups, which belong after linking
+ *   rather than in the frame loop
+ *
+ * The redundancy checks assume that the program makes every call through the
+ * glad pointers, and treat the texture and buffer bindings and the values of
+ * the uniforms as unknown until the program sets them. Only the calls of the
+ * frame loop are counted: the hooks are installed by the first frame, once
+ * the demo has loaded its functions. The wrappers add some overhead to every
+ * call, so the frame times measured with them aren't representative.
+ *
+ * Window enables it when the GL_INTERCEPT environment variable is set (see
+ * Window.hpp), reporting the calls of every GL_INTERCEPT-th frame.
+ */
+class GlInterceptor {
+public:
+  // An interceptor reporting every GL_INTERCEPT frames, or null if it isn't set
+  static std::unique_ptr<GlInterceptor> fromEnvironment() {
+    const char *interval = std::getenv("GL_INTERCEPT");
+
+    if (interval == nullptr || interval[0] == '\0' || std::string(interval) == "0") {
+      return nullptr;
+    }
+
+    return std::make_unique<GlInterceptor>((uint32_t) std::max(1, std::atoi(interval)));
+  }
+
+  // @param reportInterval The number of frames between reports, the first frame being reported
+  explicit GlInterceptor(uint32_t reportInterval) : reportInterval(reportInterval) {
+  }
+
+  GlInterceptor(const GlInterceptor &) = delete;
+  GlInterceptor &operator=(const GlInterceptor &) = delete;
+
+  ~GlInterceptor() {
+    if (!installed) {
+      return;
+    }
+
+// Not GL_INTERCEPTOR_HOOK(name), which would get the expanded pointer name (glad_glCullFace)
+#define GL_INTERCEPTOR_UNINSTALL(name) \
+  gl_interceptor_detail::Hook<gl_interceptor_detail::CALL_##name, decltype(name)>::uninstall(name);
+    GL_FUNCTIONS(GL_INTERCEPTOR_UNINSTALL)
+#undef GL_INTERCEPTOR_UNINSTALL
+  }
+
+  // Ends the previous frame, reporting it if due, and starts counting the next one
+  void beginFrame() {
+    using namespace gl_interceptor_detail;
+
+    if (!installed) {
+      install();
+      installed = true;
+      return;
+    }
+
+    if (frame % reportInterval == 0) {
+      std::cout << report(frame) << std::flush;
+    }
+
+    for (CallCounter &counter : counters) {
+      counter.calls = 0;
+      counter.redundant = 0;
+      counter.nanoseconds = 0;
+    }
+
+    frame++;
+  }
+
+  /**
+   * The calls of the current frame so far, as a table of the most frequent
+   * ones followed by the redundant and synchronous ones.
+   *
+   * @param frame The frame's number, for the title
+   */
+  static std::string report(uint64_t frame) {
+    using namespace gl_interceptor_detail;
+    std::vector<const CallCounter *> calls;
+    uint64_t total = 0, redundant = 0;
+    int64_t nanoseconds = 0;
+
+    for (const CallCounter &counter : counters) {
+      if (counter.calls > 0) {
+        calls.push_back(&counter);
+        total += counter.calls;
+        redundant += counter.redundant;
+        nanoseconds += counter.nanoseconds;
+      }
+    }
+
+    std::sort(calls.begin(), calls.end(), [](const CallCounter *a, const CallCounter *b) {
+      return a->calls > b->calls;
+    });
+
+    char line[160];
+    snprintf(line, sizeof(line),
+             "GL calls of frame %llu: %llu calls, %llu redundant, %.3f ms in synchronous calls\n",
+             (unsigned long long) frame, (unsigned long long) total,
+             (unsigned long long) redundant, (double) nanoseconds / 1.0e6);
+    std::string text = line;
+    snprintf(line, sizeof(line), "  %-32s %8s %10s %10s\n", "Call", "Count", "Redundant",
+             "Sync ms");
+    text += line;
+
+    for (size_t i = 0; i < calls.size(); i++) {
+      const CallCounter &counter = *calls[i];
+
+      // Beyond the most frequent calls, only those worth attention
+      if (i >= TOP_CALLS && counter.redundant == 0 && counter.nanoseconds == 0) {
+        continue;
+      }
+
+      snprintf(line, sizeof(line), "  %-32s %8llu %10llu %10.3f\n", counter.name,
+               (unsigned long long) counter.calls, (unsigned long long) counter.redundant,
+               (double) counter.nanoseconds / 1.0e6);
+      text += line;
+    }
+
+    for (Call lookup : {CALL_glGetUniformLocation, CALL_glGetAttribLocation}) {
+      if (counters[lookup].calls > 0) {
+        text += "  " + std::string(counters[lookup].name) + " is called every frame, look the " +
+                "locations up once after linking instead\n";
+      }
+    }
+
+    return text;
+  }
+
+private:
+  // The number of most frequent calls always reported
+  static constexpr size_t TOP_CALLS = 12;
+
+  uint32_t reportInterval;
+  bool installed = false;
+  uint64_t frame = 0;
+
+  static void install() {
+    using namespace gl_interceptor_detail;
+    // The bindings made while setting up
+    int32_t binding;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &binding);
+    state.program = (GLuint) binding;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &binding);
+    state.vertexArray = (GLuint) binding;
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &binding);
+    state.activeTexture = (GLenum) binding;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &binding);
+    state.drawFramebuffer = (GLuint) binding;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &binding);
+    state.readFramebuffer = (GLuint) binding;
+
+#define GL_INTERCEPTOR_INSTALL(name) \
+  Hook<CALL_##name, decltype(name)>::install(name, #name);
+    GL_FUNCTIONS(GL_INTERCEPTOR_INSTALL)
+#undef GL_INTERCEPTOR_INSTALL
+
+    // The calls checked for redundancy go through their wrapper first
+    glUseProgram = useProgram;
+    glLinkProgram = linkProgram;
+    glDeleteProgram = deleteProgram;
+    glBindVertexArray = bindVertexArray;
+    glDeleteVertexArrays = deleteVertexArrays;
+    glActiveTexture = activeTexture;
+    glBindTexture = bindTexture;
+    glDeleteTextures = deleteTextures;
+    glBindBuffer = bindBuffer;
+    glBindBufferBase = bindBufferBase;
+    glBindBufferRange = bindBufferRange;
+    glDeleteBuffers = deleteBuffers;
+    glBindFramebuffer = bindFramebuffer;
+    glDeleteFramebuffers = deleteFramebuffers;
+    glUniform1i = uniform1i;
+    glUniform1f = uniform1f;
+    glUniform2f = uniform2f;
+    glUniform3f = uniform3f;
+    glUniform4f = uniform4f;
+    glUniform1fv = uniform1fv;
+    glUniform2fv = uniform2fv;
+    glUniform3fv = uniform3fv;
+    glUniform4fv = uniform4fv;
+    glUniformMatrix2fv = uniformMatrix2fv;
+    glUniformMatrix3fv = uniformMatrix3fv;
+    glUniformMatrix4fv = uniformMatrix4fv;
+  }
+};
@@ -0,0 +1,268 @@
+#include <iostream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cmath>
+#include "Model.hpp"
+#include "GpuCulling.hpp"
+#include "Window.hpp"
+
+// Stored globally so it can be modified in framebufferSizeCallback() and used in main()
+glm::mat4 projection;
+
+// The field of view
+constexpr float FOV = 50.0f;
+
+// The number of cubes on each side of the grid
+constexpr int32_t GRID_SIZE = 160;
+
+void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+  glViewport(0, 0, width, height);
+  projection = glm::perspective(glm::radians(FOV), (float) width / (float) height, 0.1f, 300.0f);
+}
+
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
+  }
+}
+
+int32_t main() {
+  // The initial window size
+  constexpr int32_t SCREEN_WIDTH = 1280;
+  constexpr int32_t SCREEN_HEIGHT = 720;
+
+  // A window, or an offscreen context when the HEADLESS environment variable is set. Compute
+  // shaders and indirect draws require OpenGL 4.3.
+  Window window(SCREEN_WIDTH, SCREEN_HEIGHT, "GPU Culling", 4, 3);
+
+  if (!window.isOpen()) {
+    return -1;
+  }
+
+  if (!loadGL43(window.procAddressLoader())) {
+    std::cout << "ERROR: Failed to load the OpenGL 4.3 functions." << std::endl;
+    return -1;
+  }
+
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
+
+  glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+
+  Shader cubeShader = Shader(
+      "../resources/shaders/gpu_culling.vertex.glsl",
+      "../resources/shaders/gpu_culling.fragment.glsl"
+  );
+
+  // The cube's vertice and normal coordinates
+  float vertices[] = {
+      // Positions          // Normals           // Texture coordinates
+      -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+      0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f,
+      -0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f,
+
+      -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
+      -0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+
+      -0.5f, 0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+      -0.5f, 0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      -0.5f, -0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+      -0.5f, 0.5f, 0.5f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+
+      0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f,
+      0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, -0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f,
+
+      -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 1.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+      -0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f,
+      -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f,
+
+      -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f,
+      -0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+      -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
+  };
+
+  // Indirect draws are indexed, so index the cube's vertices in order
+  uint32_t indices[36];
+
+  for (uint32_t i = 0; i < 36; i++) {
+    indices[i] = i;
+  }
+
+  // Lay out a grid of cubes of varying heights, which occlude each other when seen from the side
+  AABB cubeAabb;
+  cubeAabb.min = glm::vec3(-0.5f);
+  cubeAabb.max = glm::vec3(0.5f);
+  std::vector<GpuInstance> instances;
+
+  for (int32_t x = 0; x < GRID_SIZE; x++) {
+    for (int32_t z = 0; z < GRID_SIZE; z++) {
+      glm::vec3 position = glm::vec3(x - GRID_SIZE / 2, 0.0f, z - GRID_SIZE / 2) * 1.5f;
+      float height = 1.0f + 2.0f * (0.5f + 0.5f * sin(x * 0.7f) * cos(z * 0.45f));
+
+      glm::mat4 model;
+      model = glm::translate(model, position + glm::vec3(0.0f, height * 0.5f - 2.0f, 0.0f));
+      model = glm::scale(model, glm::vec3(1.0f, height, 1.0f));
+      instances.emplace_back(model, cubeAabb, 0);
+    }
+  }
+
+  // A single draw command for the single mesh
+  DrawElementsIndirectCommand cubeDraw = {36, 0, 0, 0, 0};
+  GpuCuller culler = GpuCuller({cubeDraw}, instances);
+
+  // Load textures
+  uint32_t textureDiffuse = textureFromFile("container2_diffuse.png", "../resources/textures");
+  uint32_t textureSpecular = textureFromFile("container2_specular.png", "../resources/textures");
+
+  // Initialize buffers (vertex array, vertex buffer, element buffer)
+  uint32_t vao, vbo, ebo;
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &vbo);
+  glGenBuffers(1, &ebo);
+
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+  // Position attribute
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) nullptr);
+  glEnableVertexAttribArray(0);
+  // Normal attribute
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (3 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+  // Texture coordinates attribute
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (6 * sizeof(float)));
+  glEnableVertexAttribArray(2);
+  glBindVertexArray(0);
+
+  // Instance index attribute, sourced from the culling output
+  culler.setupInstanceAttribute(vao, 3);
+
+  // The scene is rendered into a framebuffer with a depth texture, as the depth of the default
+  // framebuffer can't be sampled to build the depth pyramid
+  uint32_t fbo, colorRenderbuffer, depthTexture;
+  glGenFramebuffers(1, &fbo);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+  glGenRenderbuffers(1, &colorRenderbuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorRenderbuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, SCREEN_WIDTH, SCREEN_HEIGHT);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                            colorRenderbuffer);
+
+  glGenTextures(1, &depthTexture);
+  glBindTexture(GL_TEXTURE_2D, depthTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32F, SCREEN_WIDTH, SCREEN_HEIGHT, 0,
+               GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+  // No mipmaps, so the texture must not use a mipmapped filter to be complete
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cout << "ERROR: The scene framebuffer is incomplete." << std::endl;
+  }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  HiZPyramid hiZ = HiZPyramid(SCREEN_WIDTH, SCREEN_HEIGHT);
+  // There is no depth pyramid to test against on the first frame
+  bool hasPreviousFrame = false;
+  glm::mat4 previousViewProjection;
+
+  // Set the projection matrix here so it's defined on application start too
+  projection = glm::perspective(glm::radians(FOV), (float) SCREEN_WIDTH / (float) SCREEN_HEIGHT,
+                                0.1f, 300.0f);
+
+  while (!window.shouldClose()) {
+    processInput(window);
+
+    // Fly around the grid, low enough for the cubes to hide each other
+    float radius = 60.0f;
+    double cameraX = sin(window.time() * 0.15f) * radius;
+    double cameraZ = cos(window.time() * 0.15f) * radius;
+    glm::vec3 cameraPosition = glm::vec3(cameraX, 2.5f, cameraZ);
+    glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
+    // Use an "up" vector to determine the camera's right axis using a cross product
+    glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 view;
+    view = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
+    glm::mat4 viewProjection = projection * view;
+
+    // Fill the indirect draw commands on the GPU
+    culler.cull(viewProjection, hasPreviousFrame ? &hiZ : nullptr, previousViewProjection);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
+    glEnable(GL_DEPTH_TEST);
+
+    // Clear the viewport with a constant color
+    glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    cubeShader.use();
+    cubeShader.setMat4("view", view);
+    cubeShader.setMat4("projection", projection);
+    cubeShader.setVec3("viewPos", cameraPosition);
+    cubeShader.setVec3("lightDirection", -0.2f, -1.0f, -0.3f);
+    cubeShader.setInt("diffuseTexture", 0);
+    cubeShader.setInt("specularTexture", 1);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, textureDiffuse);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, textureSpecular);
+
+    glBindVertexArray(vao);
+    culler.draw();
+    glBindVertexArray(0);
+
+    // Build the depth pyramid the next frame will be culled against
+    hiZ.build(depthTexture);
+    previousViewProjection = viewProjection;
+    hasPreviousFrame = true;
+
+    // Present the frame, scaled to the current window size
+    int32_t windowWidth, windowHeight;
+    window.getFramebufferSize(&windowWidth, &windowHeight);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, 0, 0, windowWidth, windowHeight,
+                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
+
+    window.swapBuffers();
+    window.pollEvents();
+  }
+
+  // Clean up
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteBuffers(1, &ebo);
+  glDeleteFramebuffers(1, &fbo);
+  glDeleteRenderbuffers(1, &colorRenderbuffer);
+  glDeleteTextures(1, &depthTexture);
+
+  return 0;
+}
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Bounds.hpp"
+#include "Frustum.hpp"
+#include "GL43.hpp"
+#include "Shader.hpp"
+
+// Matches the Instance struct in the GPU culling shaders (std430 layout)
+struct GpuInstance {
+  glm::mat4 model;
+  // World-space bounding box
+  glm::vec3 center;
+  // Index of the draw command (mesh) this instance is drawn with
+  uint32_t drawIndex;
+  glm::vec3 extents;
+  uint32_t padding;
+
+  GpuInstance(const glm::mat4 &model, const AABB &localBounds, uint32_t drawIndex)
+      : model(model), drawIndex(drawIndex), padding(0) {
+    AABB worldBounds = localBounds.transform(model);
+    center = worldBounds.center();
+    extents = worldBounds.extents();
+  }
+};
+
+/**
+ * A hierarchical depth buffer: level 0 is a copy of the depth buffer, and each
+ * following level stores the farthest depth of the 2x2 texels below it. Built
+ * on the GPU with a compute shader.
+ */
+class HiZPyramid {
+public:
+  uint32_t texture = 0;
+  int32_t width, height;
+  int32_t levels;
+
+  HiZPyramid(int32_t width, int32_t height)
+      : width(width), height(height),
+        downsampleShader(Shader("../resources/shaders/hiz_downsample.compute.glsl")) {
+    levels = 1 + (int32_t) std::floor(std::log2((float) std::max(width, height)));
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    for (int32_t level = 0; level < levels; level++) {
+      glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, levelSize(width, level),
+                   levelSize(height, level), 0, GL_RED, GL_FLOAT, nullptr);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+
+  /**
+   * Rebuilds the pyramid from a depth texture of the same size.
+   *
+   * @param depthTexture The depth texture the frame was rendered with
+   */
+  void build(uint32_t depthTexture) {
+    downsampleShader.use();
+    downsampleShader.setInt("source", 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    for (int32_t level = 0; level < levels; level++) {
+      // Level 0 is copied from the depth buffer, the other ones are reduced from the level above
+      glBindTexture(GL_TEXTURE_2D, level == 0 ? depthTexture : texture);
+      downsampleShader.setInt("sourceLevel", level == 0 ? 0 : level - 1);
+      glBindImageTexture(0, texture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+      glDispatchCompute((levelSize(width, level) + 7) / 8, (levelSize(height, level) + 7) / 8, 1);
+      glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    }
+  }
+
+private:
+  Shader downsampleShader;
+
+  static int32_t levelSize(int32_t size, int32_t level) {
+    return std::max(1, size >> level);
+  }
+};
+
+/**
+ * GPU-driven culling: instance transforms and bounds live in a shader storage
+ * buffer, and a compute shader tests them against the frustum and the previous
+ * frame's depth pyramid. Visible instances are appended to a compacted list and
+ * counted directly into indirect draw commands, so the CPU never reads back
+ * per-instance visibility.
+ *
+ * Requires OpenGL 4.3 (see GL43.hpp).
+ */
+class GpuCuller {
+public:
+  /**
+   * @param draws One command per mesh (count, firstIndex and baseVertex are used as is)
+   * @param instances The instances to cull, each referencing one of the draw commands
+   */
+  GpuCuller(std::vector<DrawElementsIndirectCommand> draws,
+            const std::vector<GpuInstance> &instances)
+      : cullingShader(Shader("../resources/shaders/gpu_culling.compute.glsl")) {
+    instanceCount = (uint32_t) instances.size();
+    drawCount = (uint32_t) draws.size();
+
+    // Reserve a contiguous range of the visible instance list for each draw command
+    std::vector<uint32_t> instancesPerDraw(draws.size(), 0);
+
+    for (const GpuInstance &instance : instances) {
+      instancesPerDraw[instance.drawIndex]++;
+    }
+
+    uint32_t baseInstance = 0;
+
+    for (size_t i = 0; i < draws.size(); i++) {
+      draws[i].instanceCount = 0;
+      draws[i].baseInstance = baseInstance;
+      baseInstance += instancesPerDraw[i];
+    }
+
+    glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(GpuInstance),
+                 instances.data(), GL_STATIC_DRAW);
+
+    // The commands are reset from this copy every frame without going through the CPU
+    glGenBuffers(1, &commandTemplateBuffer);
+    glBindBuffer(GL_COPY_READ_BUFFER, commandTemplateBuffer);
+    glBufferData(GL_COPY_READ_BUFFER, draws.size() * sizeof(DrawElementsIndirectCommand),
+                 draws.data(), GL_STATIC_DRAW);
+
+    glGenBuffers(1, &commandBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, draws.size() * sizeof(DrawElementsIndirectCommand),
+                 nullptr, GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &visibleBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max(1u, instanceCount) * sizeof(uint32_t),
+                 nullptr, GL_DYNAMIC_COPY);
+  }
+
+  /**
+   * Sets up an instanced integer vertex attribute sourcing the visible instance
+   * indices. The draw commands' baseInstance selects each mesh's range.
+   *
+   * @param vao The vertex array the instances are drawn with
+   * @param attribute The attribute location (`aInstance` in gpu_culling.vertex.glsl)
+   */
+  void setupInstanceAttribute(uint32_t vao, uint32_t attribute) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+    glEnableVertexAttribArray(attribute);
+    glVertexAttribIPointer(attribute, 1, GL_UNSIGNED_INT, sizeof(uint32_t), nullptr);
+    glVertexAttribDivisor(attribute, 1);
+    glBindVertexArray(0);
+  }
+
+  /**
+   * Culls the instances and fills the indirect draw commands.
+   *
+   * @param viewProjection The combined projection and view matrix of the frame being rendered
+   * @param hiZ The previous frame's depth pyramid, or nullptr to only frustum cull
+   * @param previousViewProjection The matrix the previous frame was rendered with
+   */
+  void cull(const glm::mat4 &viewProjection, const HiZPyramid *hiZ,
+            const glm::mat4 &previousViewProjection) {
+    glBindBuffer(GL_COPY_READ_BUFFER, commandTemplateBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, commandBuffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                        drawCount * sizeof(DrawElementsIndirectCommand));
+
+    Frustum frustum = Frustum(viewProjection);
+    cullingShader.use();
+    glUniform1ui(glGetUniformLocation(cullingShader.id, "instanceCount"), instanceCount);
+    glUniform4fv(glGetUniformLocation(cullingShader.id, "frustumPlanes"), Frustum::PLANE_COUNT,
+                 &frustum.planes[0][0]);
+    cullingShader.setBool("occlusionCulling", hiZ != nullptr);
+
+    if (hiZ != nullptr) {
+      glm::mat4 matrix = previousViewProjection;
+      cullingShader.setMat4("previousViewProjection", matrix);
+      cullingShader.setInt("hiZ", 0);
+      glActiveTexture(GL_TEXTURE0);
+      glBindTexture(GL_TEXTURE_2D, hiZ->texture);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, visibleBuffer);
+    glDispatchCompute((instanceCount + 63) / 64, 1, 1);
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+                    GL_SHADER_STORAGE_BARRIER_BIT);
+  }
+
+  /**
+   * Draws the visible instances. The vertex array passed to
+   * setupInstanceAttribute() and a shader reading the instance buffer (binding
+   * 0) must be bound.
+   */
+  void draw() {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei) drawCount, 0);
+  }
+
+private:
+  Shader cullingShader;
+  uint32_t instanceCount, drawCount;
+  uint32_t instanceBuffer, commandTemplateBuffer, commandBuffer, visibleBuffer;
+};
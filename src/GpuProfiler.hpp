@@ -0,0 +1,261 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+
+/**
+ * Measures the GPU time of named, nested scopes within each frame, e.g. the
+ * passes of a render graph or the meshes of a model.
+ *
+ * Each scope is delimited by two GL_TIMESTAMP queries rather than a
+ * GL_TIME_ELAPSED query, as only one of those can be active at a time and
+ * scopes nest. The queries of a frame are kept in a ring several frames deep
+ * and read back once the last one is available, so the CPU never waits for
+ * the GPU: the timings are those of the latest frame whose results arrived.
+ * If the GPU falls further behind than the ring, the oldest frame is dropped.
+ *
+ * Usage, every frame:
+ *
+ *   profiler.beginFrame();
+ *   {
+ *     GpuProfiler::Scope scope(&profiler, "shadows");
+ *     ...
+ *   }
+ *   profiler.endFrame();
+ *   profiler.timings(); // A few frames late
+ */
+class GpuProfiler {
+public:
+  struct Timing {
+    std::string name;
+    // The number of enclosing scopes, the whole frame being at depth 0
+    uint32_t depth;
+    double milliseconds;
+  };
+
+  /**
+   * Times the commands issued during its lifetime. Does nothing if the
+   * profiler is null, so that profiling can be optional.
+   */
+  class Scope {
+  public:
+    Scope(GpuProfiler *profiler, const char *name) : profiler(profiler) {
+      if (profiler) {
+        profiler->begin(name);
+      }
+    }
+
+    ~Scope() {
+      if (profiler) {
+        profiler->end();
+      }
+    }
+
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    GpuProfiler *profiler;
+  };
+
+  GpuProfiler() = default;
+  GpuProfiler(const GpuProfiler &) = delete;
+  GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+  ~GpuProfiler() {
+    for (const Frame &frame : frames) {
+      if (!frame.queries.empty()) {
+        glDeleteQueries((GLsizei) frame.queries.size(), frame.queries.data());
+      }
+    }
+  }
+
+  // Reads back the finished frames and starts the "frame" scope enclosing the others
+  void beginFrame() {
+    collect();
+    Frame &frame = frames[next];
+
+    // Its queries are still in flight, drop the frame rather than waiting for it
+    if (frame.pending) {
+      frame.pending = false;
+      dropped++;
+    }
+
+    frame.scopeCount = 0;
+    frame.queryCount = 0;
+    open.clear();
+    recording = true;
+    begin("frame");
+  }
+
+  void endFrame() {
+    if (!recording) {
+      return;
+    }
+
+    // Close the scopes left open too, so that every scope has an end timestamp
+    while (!open.empty()) {
+      end();
+    }
+
+    frames[next].pending = true;
+    next = (next + 1) % FRAMES;
+    recording = false;
+  }
+
+  // Starts a scope ended by the next end(), see Scope
+  void begin(const char *name) {
+    if (!recording) {
+      return;
+    }
+
+    Frame &frame = frames[next];
+
+    if (frame.scopeCount == frame.scopes.size()) {
+      frame.scopes.emplace_back();
+    }
+
+    // Assigning keeps the string's capacity, so steady frames don't allocate
+    ScopeQueries &scope = frame.scopes[frame.scopeCount];
+    scope.name.assign(name);
+    scope.depth = (uint32_t) open.size();
+    scope.start = timestamp(frame);
+    open.push_back(frame.scopeCount++);
+  }
+
+  void end() {
+    if (!recording || open.empty()) {
+      return;
+    }
+
+    Frame &frame = frames[next];
+    frame.scopes[open.back()].end = timestamp(frame);
+    open.pop_back();
+  }
+
+  // The scopes of the latest measured frame in the order they began, empty until one is measured
+  const std::vector<Timing> &timings() const {
+    return results;
+  }
+
+  // The time of the latest measured scope with the given name, 0 if there is none
+  double milliseconds(const std::string &name) const {
+    for (const Timing &timing : results) {
+      if (timing.name == name) {
+        return timing.milliseconds;
+      }
+    }
+
+    return 0.0;
+  }
+
+  // The number of frames measured so far, to tell when new timings arrive
+  uint64_t measuredFrames() const {
+    return measured;
+  }
+
+  // The number of frames dropped because the GPU was too far behind
+  uint64_t droppedFrames() const {
+    return dropped;
+  }
+
+  // The timings of the latest measured frame as an indented table
+  std::string report() const {
+    std::string text = "GPU profile (" + std::to_string(measured) + " frames measured, " +
+                       std::to_string(dropped) + " dropped):\n";
+    char line[160];
+
+    for (const Timing &timing : results) {
+      int32_t indent = 2 + 2 * (int32_t) timing.depth;
+      int32_t width = std::max(32 - indent, 1);
+      snprintf(line, sizeof(line), "%*s%-*s %8.3f ms\n", indent, "", width, timing.name.c_str(),
+               timing.milliseconds);
+      text += line;
+    }
+
+    return text;
+  }
+
+private:
+  // The number of frames whose queries can be in flight at the same time
+  static constexpr uint32_t FRAMES = 4;
+
+  struct ScopeQueries {
+    std::string name;
+    uint32_t depth;
+    // Indices of the frame queries holding the scope's timestamps
+    uint32_t start;
+    uint32_t end;
+  };
+
+  // The queries of one frame, grown as needed and reused when the ring comes back to it
+  struct Frame {
+    std::vector<uint32_t> queries;
+    uint32_t queryCount = 0;
+    std::vector<ScopeQueries> scopes;
+    uint32_t scopeCount = 0;
+    bool pending = false;
+  };
+
+  Frame frames[FRAMES];
+  // The frame recorded next, which is also the oldest one in flight
+  uint32_t next = 0;
+  bool recording = false;
+  // The scopes begun but not ended yet, innermost last
+  std::vector<uint32_t> open;
+  std::vector<Timing> results;
+  uint64_t measured = 0;
+  uint64_t dropped = 0;
+
+  // Records a timestamp in the next query of the frame, and returns the query's index
+  uint32_t timestamp(Frame &frame) {
+    if (frame.queryCount == frame.queries.size()) {
+      uint32_t query;
+      glGenQueries(1, &query);
+      frame.queries.push_back(query);
+    }
+
+    glQueryCounter(frame.queries[frame.queryCount], GL_TIMESTAMP);
+    return frame.queryCount++;
+  }
+
+  // Reads back the frames whose queries are available, oldest first
+  void collect() {
+    for (uint32_t i = 0; i < FRAMES; i++) {
+      Frame &frame = frames[(next + i) % FRAMES];
+
+      if (!frame.pending) {
+        continue;
+      }
+
+      // The timestamps complete in order, so the others are available once the last one is
+      int32_t available = 0;
+      glGetQueryObjectiv(frame.queries[frame.queryCount - 1], GL_QUERY_RESULT_AVAILABLE,
+                         &available);
+
+      if (!available) {
+        // Later frames can't be ready either
+        break;
+      }
+
+      results.resize(frame.scopeCount);
+
+      for (uint32_t scope = 0; scope < frame.scopeCount; scope++) {
+        const ScopeQueries &queries = frame.scopes[scope];
+        uint64_t start, end;
+        glGetQueryObjectui64v(frame.queries[queries.start], GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(frame.queries[queries.end], GL_QUERY_RESULT, &end);
+        results[scope].name.assign(queries.name);
+        results[scope].depth = queries.depth;
+        results[scope].milliseconds = (double) (end - start) / 1.0e6;
+      }
+
+      frame.pending = false;
+      measured++;
+    }
+  }
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+
+/**
+ * Measures the GPU time taken by a sequence of commands with pairs of
+ * GL_TIMESTAMP queries.
+ *
+ * Results only become available a few frames after the commands are issued,
+ * so the queries are kept in a ring and read back once available instead of
+ * stalling the CPU. Unlike GL_TIME_ELAPSED queries, timestamps let timers be
+ * nested or overlap.
+ */
+class GpuTimer {
+public:
+  GpuTimer() {
+    glGenQueries(QUERIES, startQueries);
+    glGenQueries(QUERIES, endQueries);
+  }
+
+  // Starts timing the commands issued until end()
+  void begin() {
+    // All the queries are still in flight: drop the oldest measurement without reading it, which
+    // would block until the GPU catches up. Reissuing its queries discards the result.
+    if (pending[next]) {
+      pending[next] = false;
+      dropped++;
+    }
+
+    glQueryCounter(startQueries[next], GL_TIMESTAMP);
+  }
+
+  void end() {
+    glQueryCounter(endQueries[next], GL_TIMESTAMP);
+    pending[next] = true;
+    next = (next + 1) % QUERIES;
+    collect();
+  }
+
+  // The most recent measurement, in milliseconds (0 until one is available)
+  double milliseconds() const {
+    return latest;
+  }
+
+  // An exponential moving average of the measurements, in milliseconds
+  double averageMilliseconds() const {
+    return average;
+  }
+
+  // Whether at least one measurement is available
+  bool hasResult() const {
+    return measured;
+  }
+
+  // The number of measurements read back so far, to tell when a new one arrives
+  uint64_t resultCount() const {
+    return results;
+  }
+
+  // The number of measurements dropped because the GPU was too far behind
+  uint64_t droppedCount() const {
+    return dropped;
+  }
+
+private:
+  static constexpr uint32_t QUERIES = 4;
+  // Weight of each new measurement in the average
+  static constexpr double SMOOTHING = 0.05;
+
+  uint32_t startQueries[QUERIES];
+  uint32_t endQueries[QUERIES];
+  bool pending[QUERIES] = {};
+  // The query used by the next begin(), which is also the oldest one in flight
+  uint32_t next = 0;
+  double latest = 0.0;
+  double average = 0.0;
+  bool measured = false;
+  uint64_t results = 0;
+  uint64_t dropped = 0;
+
+  // Reads back the available results, oldest first
+  void collect() {
+    for (uint32_t i = 0; i < QUERIES; i++) {
+      uint32_t index = (next + i) % QUERIES;
+
+      if (!pending[index]) {
+        continue;
+      }
+
+      // The start timestamp is available once the end one is
+      int32_t available = 0;
+      glGetQueryObjectiv(endQueries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+
+      if (!available) {
+        // Later queries can't be ready either
+        break;
+      }
+
+      uint64_t start, end;
+      glGetQueryObjectui64v(startQueries[index], GL_QUERY_RESULT, &start);
+      glGetQueryObjectui64v(endQueries[index], GL_QUERY_RESULT, &end);
+      pending[index] = false;
+      latest = (double) (end - start) / 1.0e6;
+      results++;
+      average = measured ? average + (latest - average) * SMOOTHING : latest;
+      measured = true;
+    }
+  }
+};
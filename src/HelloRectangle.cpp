@@ -1,6 +1,7 @@
 #include <iostream>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include "Window.hpp"
 
 const char *vertexShaderSource =
     "#version 330 core\n"
@@ -22,35 +23,21 @@ void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
 }
 
-void processInput(GLFWwindow *window) {
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
   }
 }
 
 int32_t main() {
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(800, 600, "Hello Rectangle");
 
-  GLFWwindow *window = glfwCreateWindow(800, 600, "Hello Rectangle", nullptr, nullptr);
-  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-
-  if (window == nullptr) {
-    std::cout << "Failed to create GLFW window." << std::endl;
-    glfwTerminate();
+  if (!window.isOpen()) {
     return -1;
   }
 
-  // GLFW doesn't mark the context as current automatically
-  // <https://stackoverflow.com/questions/48650497/glad-failing-to-initialize>
-  glfwMakeContextCurrent(window);
-
-  if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-    std::cout << "Failed to initialize GLAD." << std::endl;
-    return -1;
-  }
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
 
   glViewport(0, 0, 800, 600);
 
@@ -137,7 +124,7 @@ int32_t main() {
   glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *) nullptr);
   glEnableVertexAttribArray(0);
 
-  while (!glfwWindowShouldClose(window)) {
+  while (!window.shouldClose()) {
     processInput(window);
 
     // Clear the viewport with a constant color
@@ -147,15 +134,14 @@ int32_t main() {
     // Draw the rectangle
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    window.swapBuffers();
+    window.pollEvents();
   }
 
   // Clean up
   glDeleteVertexArrays(1, &vao);
   glDeleteBuffers(1, &vbo);
   glDeleteBuffers(1, &ebo);
-  glfwTerminate();
 
   return 0;
 }
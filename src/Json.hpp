@@ -0,0 +1,275 @@
+#pragma once
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * A parsed JSON value, for reading the benchmark results (see PerfGate.cpp).
+ *
+ * Missing members and array elements read as null values, so that nested
+ * lookups don't need checks at every level.
+ */
+class JsonValue {
+public:
+  enum class Type {
+    NULL_VALUE,
+    BOOLEAN,
+    NUMBER,
+    STRING,
+    ARRAY,
+    OBJECT,
+  };
+
+  Type type = Type::NULL_VALUE;
+  bool boolean = false;
+  double number = 0.0;
+  std::string string;
+  std::vector<JsonValue> elements;
+  std::vector<std::pair<std::string, JsonValue>> members;
+
+  /**
+   * Parses a JSON document.
+   *
+   * @param text The document
+   * @param error Receives a description of the first syntax error, if any
+   * @return The document's value, or a null value if it's invalid
+   */
+  static JsonValue parse(const std::string &text, std::string &error) {
+    Parser parser{text, 0, ""};
+    JsonValue value = parser.parseValue();
+    parser.skipWhitespace();
+
+    if (parser.error.empty() && parser.position < text.size()) {
+      parser.fail("unexpected characters after the value");
+    }
+
+    error = parser.error;
+    return error.empty() ? value : JsonValue();
+  }
+
+  /**
+   * Parses a JSON file.
+   *
+   * @param path The file's path
+   * @param error Receives a description of the read or syntax error, if any
+   */
+  static JsonValue parseFile(const std::string &path, std::string &error) {
+    std::ifstream file(path);
+
+    if (!file) {
+      error = "couldn't read " + path;
+      return JsonValue();
+    }
+
+    std::stringstream stream;
+    stream << file.rdbuf();
+    return parse(stream.str(), error);
+  }
+
+  bool isNull() const {
+    return type == Type::NULL_VALUE;
+  }
+
+  // The member with the given key, or a null value
+  const JsonValue &operator[](const std::string &key) const {
+    for (const auto &member : members) {
+      if (member.first == key) {
+        return member.second;
+      }
+    }
+
+    return null();
+  }
+
+  // The element at the given index, or a null value
+  const JsonValue &operator[](size_t index) const {
+    return index < elements.size() ? elements[index] : null();
+  }
+
+  // The number, or the given value if this isn't a number
+  double asNumber(double defaultValue = 0.0) const {
+    return type == Type::NUMBER ? number : defaultValue;
+  }
+
+  // The elements of an array of numbers, skipping other elements
+  std::vector<double> asNumbers() const {
+    std::vector<double> numbers;
+
+    for (const JsonValue &element : elements) {
+      if (element.type == Type::NUMBER) {
+        numbers.push_back(element.number);
+      }
+    }
+
+    return numbers;
+  }
+
+private:
+  static const JsonValue &null() {
+    static const JsonValue value;
+    return value;
+  }
+
+  struct Parser {
+    const std::string &text;
+    size_t position;
+    std::string error;
+
+    void fail(const std::string &message) {
+      if (error.empty()) {
+        error = message + " at offset " + std::to_string(position);
+      }
+
+      // Stops parsing
+      position = text.size();
+    }
+
+    void skipWhitespace() {
+      while (position < text.size() && std::isspace((unsigned char) text[position])) {
+        position++;
+      }
+    }
+
+    bool consume(char c) {
+      skipWhitespace();
+
+      if (position < text.size() && text[position] == c) {
+        position++;
+        return true;
+      }
+
+      return false;
+    }
+
+    bool consumeWord(const char *word) {
+      size_t length = std::char_traits<char>::length(word);
+
+      if (position <= text.size() && text.compare(position, length, word) == 0) {
+        position += length;
+        return true;
+      }
+
+      return false;
+    }
+
+    JsonValue parseValue() {
+      JsonValue value;
+      skipWhitespace();
+
+      if (position >= text.size()) {
+        fail("unexpected end of the document");
+      } else if (text[position] == '{') {
+        position++;
+        value.type = Type::OBJECT;
+
+        if (!consume('}')) {
+          do {
+            skipWhitespace();
+            std::string key = parseString();
+
+            if (!consume(':')) {
+              fail("expected ':'");
+            }
+
+            value.members.emplace_back(key, parseValue());
+          } while (consume(','));
+
+          if (!consume('}')) {
+            fail("expected ',' or '}'");
+          }
+        }
+      } else if (text[position] == '[') {
+        position++;
+        value.type = Type::ARRAY;
+
+        if (!consume(']')) {
+          do {
+            value.elements.push_back(parseValue());
+          } while (consume(','));
+
+          if (!consume(']')) {
+            fail("expected ',' or ']'");
+          }
+        }
+      } else if (text[position] == '"') {
+        value.type = Type::STRING;
+        value.string = parseString();
+      } else if (consumeWord("true")) {
+        value.type = Type::BOOLEAN;
+        value.boolean = true;
+      } else if (consumeWord("false")) {
+        value.type = Type::BOOLEAN;
+      } else if (consumeWord("null")) {
+        value.type = Type::NULL_VALUE;
+      } else {
+        const char *start = text.c_str() + position;
+        char *end;
+        value.type = Type::NUMBER;
+        value.number = std::strtod(start, &end);
+
+        if (end == start) {
+          fail("unexpected character");
+        }
+
+        position += end - start;
+      }
+
+      return value;
+    }
+
+    // Parses a string, keeping escaped characters other than the standard ones as is
+    std::string parseString() {
+      std::string result;
+
+      if (position >= text.size() || text[position] != '"') {
+        fail("expected a string");
+        return result;
+      }
+
+      position++;
+
+      while (position < text.size() && text[position] != '"') {
+        char c = text[position++];
+
+        if (c == '\\' && position < text.size()) {
+          c = text[position++];
+
+          switch (c) {
+            case 'n':
+              c = '\n';
+              break;
+            case 't':
+              c = '\t';
+              break;
+            case 'r':
+              c = '\r';
+              break;
+            case 'b':
+              c = '\b';
+              break;
+            case 'f':
+              c = '\f';
+              break;
+            default:
+              break;
+          }
+        }
+
+        result += c;
+      }
+
+      if (position >= text.size()) {
+        fail("unterminated string");
+        return result;
+      }
+
+      position++;
+      return result;
+    }
+  };
+};
@@ -5,11 +5,18 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
+#include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
 
 #include <stb_image.h>
 #include "Shader.hpp"
+#include "NormalMatrix.hpp"
+#include "DepthPrepass.hpp"
+#include "ShadowMap.hpp"
+#include "CascadedShadowMap.hpp"
+#include "ThreadPool.hpp"
+#include "Window.hpp"
 
 // Stored globally so it can be modified in framebufferSizeCallback() and used in main()
 glm::mat4 projection;
@@ -17,14 +24,39 @@ glm::mat4 projection;
 // The field of view
 constexpr float FOV = 50.0f;
 
+// Whether to lay down the depth in a pre-pass before shading, toggled with P
+bool depthPrepassEnabled = true;
+
+// Whether the light rotates around the scene, toggled with L. Moving the light invalidates the
+// cached shadow map.
+bool animateLight = false;
+
+// Whether the shadows come from cascaded shadow maps fit to the camera, or from a single cached
+// shadow map covering the whole scene, toggled with C
+bool cascadedShadows = true;
+
 void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
   projection = glm::perspective(glm::radians(FOV), (float) width / (float) height, 0.1f, 100.0f);
 }
 
-void processInput(GLFWwindow *window) {
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+    depthPrepassEnabled = !depthPrepassEnabled;
+  }
+
+  if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+    animateLight = !animateLight;
+  }
+
+  if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+    cascadedShadows = !cascadedShadows;
+  }
+}
+
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
   }
 }
 
@@ -75,34 +107,19 @@ int32_t main() {
   constexpr int32_t SCREEN_WIDTH = 1280;
   constexpr int32_t SCREEN_HEIGHT = 720;
 
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(SCREEN_WIDTH, SCREEN_HEIGHT, "Light Casters (Directional)");
 
-  GLFWwindow *window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Light Casters (Directional)",
-                                        nullptr,
-                                        nullptr);
-  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-
-  if (window == nullptr) {
-    std::cout << "Failed to create GLFW window." << std::endl;
-    glfwTerminate();
+  if (!window.isOpen()) {
     return -1;
   }
 
-  // GLFW doesn't mark the context as current automatically
-  // <https://stackoverflow.com/questions/48650497/glad-failing-to-initialize>
-  glfwMakeContextCurrent(window);
-
-  if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-    std::cout << "ERROR: Failed to initialize GLAD." << std::endl;
-    return -1;
-  }
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
+  window.setKeyCallback(keyCallback);
 
   glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
-  Shader containerShader = Shader(
+  Shader cachedContainerShader = Shader(
       "../resources/shaders/light_casters_directional.vertex.glsl",
       "../resources/shaders/light_casters_directional.fragment.glsl"
   );
@@ -167,8 +184,21 @@ int32_t main() {
       glm::vec3(0.0f, 0.0f, -1.0f),
   };
 
-  // The light's direction
-  glm::vec3 lightDir = glm::vec3(-0.2f, -1.0f, -0.3f);
+  // The floor under the cubes, receiving most of the shadows. The texture repeats every 2 units.
+  float floorVertices[] = {
+      // Positions            // Normals        // Texture coordinates
+      -8.0f, -3.5f, -14.0f, 0.0f, 1.0f, 0.0f, 0.0f, 10.0f,
+      8.0f, -3.5f, -14.0f, 0.0f, 1.0f, 0.0f, 8.0f, 10.0f,
+      8.0f, -3.5f, 6.0f, 0.0f, 1.0f, 0.0f, 8.0f, 0.0f,
+      8.0f, -3.5f, 6.0f, 0.0f, 1.0f, 0.0f, 8.0f, 0.0f,
+      -8.0f, -3.5f, 6.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+      -8.0f, -3.5f, -14.0f, 0.0f, 1.0f, 0.0f, 0.0f, 10.0f,
+  };
+
+  // The light's direction, before it is rotated
+  glm::vec3 initialLightDir = glm::vec3(-0.2f, -1.0f, -0.3f);
+  float lightAngle = 0.0f;
+  double previousTime = window.time();
 
   // Load textures
   unsigned int textureDiffuse = loadTexture("../resources/textures/container2_diffuse.png");
@@ -203,6 +233,31 @@ int32_t main() {
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (6 * sizeof(float)));
   glEnableVertexAttribArray(2);
 
+  // The depth pre-pass only reads the positions
+  uint32_t depthVbo;
+  uint32_t depthVao = createPositionVao(deinterleavePositions(vertices, 36, 8), depthVbo);
+
+  // The floor's buffers, with the same layout
+  uint32_t floorVao, floorVbo;
+  glGenVertexArrays(1, &floorVao);
+  glGenBuffers(1, &floorVbo);
+  glBindVertexArray(floorVao);
+  glBindBuffer(GL_ARRAY_BUFFER, floorVbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(floorVertices), floorVertices, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) nullptr);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (3 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (6 * sizeof(float)));
+  glEnableVertexAttribArray(2);
+
+  uint32_t floorDepthVbo;
+  uint32_t floorDepthVao = createPositionVao(deinterleavePositions(floorVertices, 6, 8),
+                                             floorDepthVbo);
+  // The floor's vertices are already in world space
+  glm::mat4 floorModel;
+  glm::mat3 floorNormalMatrix = glm::mat3(floorModel);
+
   // Create the light VAO
   uint32_t lightVao;
   glGenVertexArrays(1, &lightVao);
@@ -215,7 +270,66 @@ int32_t main() {
   projection = glm::perspective(glm::radians(FOV), (float) SCREEN_WIDTH / (float) SCREEN_HEIGHT,
                                 0.1f, 100.0f);
 
-  while (!glfwWindowShouldClose(window)) {
+  // The cubes never move, so their model and normal matrices are computed once. They are only
+  // rotated and translated, so their normal matrices are the model matrices' upper 3x3 part.
+  glm::mat4 cubeModels[10];
+  glm::mat3 cubeNormalMatrices[10];
+
+  for (uint32_t i = 0; i < 10; i++) {
+    glm::mat4 model;
+    model = glm::translate(model, cubePositions[i]);
+    float angle = 20.0f * i;
+    model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+    cubeModels[i] = model;
+  }
+
+  computeNormalMatrices(cubeModels, cubeNormalMatrices, 10, true);
+
+  // The shadow map covers the cubes, the floor and the orbit of the moving cube
+  AABB sceneBounds = computeAABB((const glm::vec3 *) floorVertices, 6, 8 * sizeof(float));
+  AABB cubeAabb;
+  cubeAabb.min = glm::vec3(-0.5f);
+  cubeAabb.max = glm::vec3(0.5f);
+
+  for (uint32_t i = 0; i < 10; i++) {
+    sceneBounds.expand(cubeAabb.transform(cubeModels[i]));
+  }
+
+  sceneBounds.expand(glm::vec3(-2.0f, 1.0f, -3.0f));
+  sceneBounds.expand(glm::vec3(2.0f, 2.0f, 1.0f));
+
+  // The cubes and the floor are static shadow casters, rendered once into the shadow map's cache.
+  // Only the moving cube is rendered every frame.
+  ShadowMap shadowMap = ShadowMap(2048);
+  constexpr int32_t SHADOW_MAP_UNIT = 2;
+
+  // The cascades are re-rendered every frame as they follow the camera. Each of them is culled on
+  // its own worker thread.
+  ThreadPool threadPool;
+  CascadedShadowMap cascadedShadowMap = CascadedShadowMap(threadPool, 4, 2048);
+  constexpr float SHADOW_DISTANCE = 30.0f;
+  Shader cascadedContainerShader = Shader(
+      "../resources/shaders/light_casters_directional.vertex.glsl",
+      "../resources/shaders/light_casters_directional.fragment.glsl",
+      cascadedShadowMap.defines()
+  );
+
+  // The casters of the cascades: the cubes, the moving cube and the floor
+  constexpr uint32_t MOVING_CUBE_CASTER = 10;
+  constexpr uint32_t FLOOR_CASTER = 11;
+  std::vector<AABB> casterBounds = std::vector<AABB>(12);
+
+  for (uint32_t i = 0; i < 10; i++) {
+    casterBounds[i] = cubeAabb.transform(cubeModels[i]);
+  }
+
+  casterBounds[FLOOR_CASTER] = computeAABB((const glm::vec3 *) floorVertices, 6,
+                                           8 * sizeof(float));
+
+  DepthPrepass depthPrepass;
+  double lastTitleUpdate = 0.0;
+
+  while (!window.shouldClose()) {
     processInput(window);
 
     // Clear the viewport with a constant color
@@ -224,8 +338,8 @@ int32_t main() {
 
     // Make the camera rotate in a circle around the center point
     float radius = 3.0f;
-    double cameraX = sin(glfwGetTime() * 0.75f) * radius;
-    double cameraZ = cos(glfwGetTime() * 0.75f) * radius;
+    double cameraX = sin(window.time() * 0.75f) * radius;
+    double cameraZ = cos(window.time() * 0.75f) * radius;
     glm::vec3 cameraPosition = glm::vec3(cameraX, 0.0f, cameraZ);
     glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
     // Use an "up" vector to determine the camera's right axis using a cross product
@@ -233,11 +347,103 @@ int32_t main() {
     glm::mat4 view;
     view = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
 
+    // Rotate the light around the vertical axis if enabled
+    double time = window.time();
+
+    if (animateLight) {
+      lightAngle += (float) (time - previousTime) * 0.5f;
+    }
+
+    previousTime = time;
+    glm::mat4 lightRotation;
+    lightRotation = glm::rotate(lightRotation, lightAngle, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec3 lightDir = glm::vec3(lightRotation * glm::vec4(initialLightDir, 0.0f));
+
+    // The moving cube orbits above the others
+    glm::mat4 movingCubeModel;
+    movingCubeModel = glm::translate(movingCubeModel, glm::vec3(sin(time) * 1.5f, 1.5f,
+                                                                cos(time) * 1.5f - 1.0f));
+    movingCubeModel = glm::rotate(movingCubeModel, (float) time, glm::vec3(0.3f, 1.0f, 0.2f));
+    movingCubeModel = glm::scale(movingCubeModel, glm::vec3(0.5f));
+    glm::mat3 movingCubeNormalMatrix = normalMatrix(movingCubeModel, true);
+
+    if (cascadedShadows) {
+      // Fit the cascades to the camera and cull the casters against each of them, then draw each
+      // visible caster once into every cascade it is visible in
+      casterBounds[MOVING_CUBE_CASTER] = cubeAabb.transform(movingCubeModel);
+      GLint viewport[4];
+      glGetIntegerv(GL_VIEWPORT, viewport);
+      cascadedShadowMap.update(view, glm::radians(FOV), (float) viewport[2] / (float) viewport[3],
+                               0.1f, SHADOW_DISTANCE, lightDir, sceneBounds, casterBounds);
+      Shader &casterShader = cascadedShadowMap.begin();
+
+      for (const CascadedShadowMap::CasterDraw &draw : cascadedShadowMap.draws()) {
+        casterShader.setInt("cascadeMask", draw.cascadeMask);
+
+        if (draw.caster == FLOOR_CASTER) {
+          glBindVertexArray(floorDepthVao);
+          casterShader.setMat4("model", floorModel);
+          glDrawArrays(GL_TRIANGLES, 0, 6);
+        } else {
+          glBindVertexArray(depthVao);
+          glm::mat4 &model = draw.caster == MOVING_CUBE_CASTER ? movingCubeModel
+                                                               : cubeModels[draw.caster];
+          casterShader.setMat4("model", model);
+          glDrawArrays(GL_TRIANGLES, 0, 36);
+        }
+      }
+
+      cascadedShadowMap.end();
+    } else {
+      // Render the shadow map, re-rendering the static casters only if the light moved
+      shadowMap.setLightSpace(directionalLightSpace(lightDir, sceneBounds));
+
+      if (Shader *staticCasterShader = shadowMap.beginStaticCasters()) {
+        glBindVertexArray(depthVao);
+
+        for (uint32_t i = 0; i < 10; i++) {
+          staticCasterShader->setMat4("model", cubeModels[i]);
+          glDrawArrays(GL_TRIANGLES, 0, 36);
+        }
+
+        glBindVertexArray(floorDepthVao);
+        staticCasterShader->setMat4("model", floorModel);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+      }
+
+      Shader &dynamicCasterShader = shadowMap.beginDynamicCasters();
+      glBindVertexArray(depthVao);
+      dynamicCasterShader.setMat4("model", movingCubeModel);
+      glDrawArrays(GL_TRIANGLES, 0, 36);
+      shadowMap.end();
+    }
+
     glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
     glm::vec3 ambientColor = lightColor * glm::vec3(0.15f);
     glm::vec3 diffuseColor = lightColor * glm::vec3(0.65f);
     glm::vec3 specularColor = lightColor;
 
+    depthPrepass.beginFrame(depthPrepassEnabled);
+
+    if (depthPrepass.isEnabled()) {
+      Shader &depthShader = depthPrepass.beginDepthPass(view, projection);
+      glBindVertexArray(depthVao);
+
+      for (uint32_t i = 0; i < 10; i++) {
+        depthShader.setMat4("model", cubeModels[i]);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+      }
+
+      depthShader.setMat4("model", movingCubeModel);
+      glDrawArrays(GL_TRIANGLES, 0, 36);
+      glBindVertexArray(floorDepthVao);
+      depthShader.setMat4("model", floorModel);
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+
+      depthPrepass.beginShadingPass();
+    }
+
+    Shader &containerShader = cascadedShadows ? cascadedContainerShader : cachedContainerShader;
     containerShader.use();
     containerShader.setMat4("view", view);
     containerShader.setMat4("projection", projection);
@@ -255,27 +461,61 @@ int32_t main() {
     containerShader.setVec3("light.diffuse", diffuseColor);
     containerShader.setVec3("light.specular", specularColor);
 
+    // Set shadow properties
+    if (cascadedShadows) {
+      cascadedShadowMap.setUniforms(containerShader, SHADOW_MAP_UNIT);
+    } else {
+      containerShader.setMat4("lightSpace", shadowMap.lightSpace);
+      containerShader.setInt("shadowMap", SHADOW_MAP_UNIT);
+      shadowMap.bindTexture(SHADOW_MAP_UNIT);
+    }
+
     // Draw container cubes
     glBindVertexArray(vao);
 
     for (uint32_t i = 0; i < 10; i++) {
-      glm::mat4 model;
-      model = glm::translate(model, cubePositions[i]);
-      float angle = 20.0f * i;
-      model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-      containerShader.setMat4("model", model);
+      containerShader.setMat4("model", cubeModels[i]);
+      containerShader.setMat3("normalMatrix", cubeNormalMatrices[i]);
       glDrawArrays(GL_TRIANGLES, 0, 36);
     }
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    containerShader.setMat4("model", movingCubeModel);
+    containerShader.setMat3("normalMatrix", movingCubeNormalMatrix);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+
+    // Draw the floor
+    glBindVertexArray(floorVao);
+    containerShader.setMat4("model", floorModel);
+    containerShader.setMat3("normalMatrix", floorNormalMatrix);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    depthPrepass.endFrame();
+
+    // Show the measured frame times twice per second
+    if (window.time() - lastTitleUpdate >= 0.5) {
+      std::string title = "Light Casters (Directional) | " + depthPrepass.frameTimes() + " | " +
+                          (cascadedShadows ? "cascaded shadows (C), casters drawn: " +
+                                             std::to_string(cascadedShadowMap.draws().size())
+                                           : "cached shadows (C), static renders: " +
+                                             std::to_string(shadowMap.staticRenders));
+      window.setTitle(title);
+      lastTitleUpdate = window.time();
+    }
+
+    window.swapBuffers();
+    window.pollEvents();
   }
 
   // Clean up
   glDeleteVertexArrays(1, &vao);
+  glDeleteVertexArrays(1, &depthVao);
+  glDeleteVertexArrays(1, &floorVao);
+  glDeleteVertexArrays(1, &floorDepthVao);
   glDeleteVertexArrays(1, &lightVao);
   glDeleteBuffers(1, &vbo);
-  glfwTerminate();
+  glDeleteBuffers(1, &depthVbo);
+  glDeleteBuffers(1, &floorVbo);
+  glDeleteBuffers(1, &floorDepthVbo);
 
   return 0;
 }
@@ -5,11 +5,18 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
+#include <memory>
+#include <vector>
 
 #define STB_IMAGE_IMPLEMENTATION
 
 #include <stb_image.h>
 #include "Shader.hpp"
+#include "NormalMatrix.hpp"
+#include "DepthPrepass.hpp"
+#include "Lights.hpp"
+#include "PointShadowMaps.hpp"
+#include "Window.hpp"
 
 // Stored globally so it can be modified in framebufferSizeCallback() and used in main()
 glm::mat4 projection;
@@ -17,14 +24,23 @@ glm::mat4 projection;
 // The field of view
 constexpr float FOV = 50.0f;
 
+// Whether to lay down the depth in a pre-pass before shading, toggled with P
+bool depthPrepassEnabled = true;
+
 void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
   projection = glm::perspective(glm::radians(FOV), (float) width / (float) height, 0.1f, 100.0f);
 }
 
-void processInput(GLFWwindow *window) {
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+    depthPrepassEnabled = !depthPrepassEnabled;
+  }
+}
+
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
   }
 }
 
@@ -75,36 +91,30 @@ int32_t main() {
   constexpr int32_t SCREEN_WIDTH = 1280;
   constexpr int32_t SCREEN_HEIGHT = 720;
 
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-  GLFWwindow *window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Light Casters (Point)",
-                                        nullptr,
-                                        nullptr);
-  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(SCREEN_WIDTH, SCREEN_HEIGHT, "Light Casters (Point)");
 
-  if (window == nullptr) {
-    std::cout << "Failed to create GLFW window." << std::endl;
-    glfwTerminate();
+  if (!window.isOpen()) {
     return -1;
   }
 
-  // GLFW doesn't mark the context as current automatically
-  // <https://stackoverflow.com/questions/48650497/glad-failing-to-initialize>
-  glfwMakeContextCurrent(window);
-
-  if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-    std::cout << "ERROR: Failed to initialize GLAD." << std::endl;
-    return -1;
-  }
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
+  window.setKeyCallback(keyCallback);
 
   glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
+  // The light's shadows need cube map arrays, without them the scene is rendered unshadowed
+  bool pointShadowsSupported = PointShadowMaps::isSupported();
+
+  if (!pointShadowsSupported) {
+    std::cout << "WARNING: Cube map arrays are not supported, point light shadows are disabled."
+              << std::endl;
+  }
+
   Shader containerShader = Shader(
       "../resources/shaders/light_casters_point.vertex.glsl",
-      "../resources/shaders/light_casters_point.fragment.glsl"
+      "../resources/shaders/light_casters_point.fragment.glsl",
+      pointShadowsSupported ? PointShadowMaps::defines() : ""
   );
 
   Shader lightShader = Shader(
@@ -172,8 +182,25 @@ int32_t main() {
       glm::vec3(0.0f, 0.0f, -1.0f),
   };
 
-  // The light's position
-  glm::vec3 lightPos = glm::vec3(0.0f, 0.0f, 0.0f);
+  // The floor under the cubes, receiving most of the shadows. The texture repeats every 2 units.
+  float floorVertices[] = {
+      // Positions            // Normals        // Texture coordinates
+      -8.0f, -3.5f, -14.0f, 0.0f, 1.0f, 0.0f, 0.0f, 10.0f,
+      8.0f, -3.5f, -14.0f, 0.0f, 1.0f, 0.0f, 8.0f, 10.0f,
+      8.0f, -3.5f, 6.0f, 0.0f, 1.0f, 0.0f, 8.0f, 0.0f,
+      8.0f, -3.5f, 6.0f, 0.0f, 1.0f, 0.0f, 8.0f, 0.0f,
+      -8.0f, -3.5f, 6.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f,
+      -8.0f, -3.5f, -14.0f, 0.0f, 1.0f, 0.0f, 0.0f, 10.0f,
+  };
+
+  // The light's position and attenuation. The light is above the nearest cube, so that it doesn't
+  // hide the others.
+  glm::vec3 lightPos = glm::vec3(0.0f, 1.0f, 0.5f);
+  PointLight light;
+  light.position = lightPos;
+  light.constant = 1.0f;
+  light.linear = 0.09f;
+  light.quadratic = 0.032f;
 
   // Load textures
   unsigned int textureDiffuse = loadTexture("../resources/textures/container2_diffuse.png");
@@ -208,6 +235,31 @@ int32_t main() {
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (6 * sizeof(float)));
   glEnableVertexAttribArray(2);
 
+  // The depth pre-pass only reads the positions
+  uint32_t depthVbo;
+  uint32_t depthVao = createPositionVao(deinterleavePositions(vertices, 36, 8), depthVbo);
+
+  // The floor's buffers, with the same layout
+  uint32_t floorVao, floorVbo;
+  glGenVertexArrays(1, &floorVao);
+  glGenBuffers(1, &floorVbo);
+  glBindVertexArray(floorVao);
+  glBindBuffer(GL_ARRAY_BUFFER, floorVbo);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(floorVertices), floorVertices, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) nullptr);
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (3 * sizeof(float)));
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (6 * sizeof(float)));
+  glEnableVertexAttribArray(2);
+
+  uint32_t floorDepthVbo;
+  uint32_t floorDepthVao = createPositionVao(deinterleavePositions(floorVertices, 6, 8),
+                                             floorDepthVbo);
+  // The floor's vertices are already in world space
+  glm::mat4 floorModel;
+  glm::mat3 floorNormalMatrix = glm::mat3(floorModel);
+
   // Create the light VAO
   uint32_t lightVao;
   glGenVertexArrays(1, &lightVao);
@@ -220,7 +272,42 @@ int32_t main() {
   projection = glm::perspective(glm::radians(FOV), (float) SCREEN_WIDTH / (float) SCREEN_HEIGHT,
                                 0.1f, 100.0f);
 
-  while (!glfwWindowShouldClose(window)) {
+  // The cubes never move, so their model and normal matrices are computed once. They are only
+  // rotated and translated, so their normal matrices are the model matrices' upper 3x3 part.
+  glm::mat4 cubeModels[10];
+  glm::mat3 cubeNormalMatrices[10];
+
+  for (uint32_t i = 0; i < 10; i++) {
+    glm::mat4 model;
+    model = glm::translate(model, cubePositions[i]);
+    float angle = 20.0f * i;
+    model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+    cubeModels[i] = model;
+  }
+
+  computeNormalMatrices(cubeModels, cubeNormalMatrices, 10, true);
+
+  // The cubes cast shadows in every direction around the light, into a single cube map rendered
+  // in one pass
+  std::unique_ptr<PointShadowMaps> pointShadowMaps;
+  std::vector<AABB> cubeWorldBounds;
+  AABB cubeAabb;
+  cubeAabb.min = glm::vec3(-0.5f);
+  cubeAabb.max = glm::vec3(0.5f);
+  constexpr int32_t SHADOW_MAP_UNIT = 2;
+
+  for (uint32_t i = 0; i < 10; i++) {
+    cubeWorldBounds.push_back(cubeAabb.transform(cubeModels[i]));
+  }
+
+  if (pointShadowsSupported) {
+    pointShadowMaps = std::make_unique<PointShadowMaps>(1, 1024);
+  }
+
+  DepthPrepass depthPrepass;
+  double lastTitleUpdate = 0.0;
+
+  while (!window.shouldClose()) {
     processInput(window);
 
     // Clear the viewport with a constant color
@@ -229,8 +316,8 @@ int32_t main() {
 
     // Make the camera rotate in a circle around the center point
     float radius = 3.0f;
-    double cameraX = sin(glfwGetTime() * 0.75f) * radius;
-    double cameraZ = cos(glfwGetTime() * 0.75f) * radius;
+    double cameraX = sin(window.time() * 0.75f) * radius;
+    double cameraZ = cos(window.time() * 0.75f) * radius;
     glm::vec3 cameraPosition = glm::vec3(cameraX, 0.0f, cameraZ);
     glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
     // Use an "up" vector to determine the camera's right axis using a cross product
@@ -238,11 +325,45 @@ int32_t main() {
     glm::mat4 view;
     view = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
 
+    // Render the light's cube map, drawing each cube once into every face it is visible in
+    if (pointShadowMaps) {
+      pointShadowMaps->begin();
+      Shader &casterShader = pointShadowMaps->renderLight(0, lightPos, light.radius(),
+                                                          cubeWorldBounds);
+      glBindVertexArray(depthVao);
+
+      for (const PointShadowMaps::CasterDraw &draw : pointShadowMaps->draws()) {
+        casterShader.setInt("faceMask", draw.faceMask);
+        casterShader.setMat4("model", cubeModels[draw.caster]);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+      }
+
+      pointShadowMaps->end();
+    }
+
     glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
     glm::vec3 ambientColor = lightColor * glm::vec3(0.15f);
     glm::vec3 diffuseColor = lightColor * glm::vec3(0.65f);
     glm::vec3 specularColor = lightColor;
 
+    depthPrepass.beginFrame(depthPrepassEnabled);
+
+    if (depthPrepass.isEnabled()) {
+      Shader &depthShader = depthPrepass.beginDepthPass(view, projection);
+      glBindVertexArray(depthVao);
+
+      for (uint32_t i = 0; i < 10; i++) {
+        depthShader.setMat4("model", cubeModels[i]);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+      }
+
+      glBindVertexArray(floorDepthVao);
+      depthShader.setMat4("model", floorModel);
+      glDrawArrays(GL_TRIANGLES, 0, 6);
+
+      depthPrepass.beginShadingPass();
+    }
+
     containerShader.use();
     containerShader.setMat4("view", view);
     containerShader.setMat4("projection", projection);
@@ -255,26 +376,44 @@ int32_t main() {
     containerShader.setFloat("material.glossiness", 24.0f);
 
     // Set light properties
-    containerShader.setFloat("light.constant", 1.0f);
-    containerShader.setFloat("light.linear", 0.09f);
-    containerShader.setFloat("light.quadratic", 0.032f);
+    containerShader.setFloat("light.constant", light.constant);
+    containerShader.setFloat("light.linear", light.linear);
+    containerShader.setFloat("light.quadratic", light.quadratic);
     containerShader.setVec3("light.position", lightPos);
     containerShader.setVec3("light.ambient", ambientColor);
     containerShader.setVec3("light.diffuse", diffuseColor);
     containerShader.setVec3("light.specular", specularColor);
 
+    // Set shadow properties
+    if (pointShadowMaps) {
+      containerShader.setFloat("shadowFar", light.radius());
+      pointShadowMaps->setUniforms(containerShader, SHADOW_MAP_UNIT);
+    }
+
     // Draw container cubes
     glBindVertexArray(vao);
 
     for (uint32_t i = 0; i < 10; i++) {
-      glm::mat4 model;
-      model = glm::translate(model, cubePositions[i]);
-      float angle = 20.0f * i;
-      model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-      containerShader.setMat4("model", model);
+      containerShader.setMat4("model", cubeModels[i]);
+      containerShader.setMat3("normalMatrix", cubeNormalMatrices[i]);
       glDrawArrays(GL_TRIANGLES, 0, 36);
     }
 
+    // Draw the floor
+    glBindVertexArray(floorVao);
+    containerShader.setMat4("model", floorModel);
+    containerShader.setMat3("normalMatrix", floorNormalMatrix);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    depthPrepass.endFrame();
+
+    // Show the measured frame times twice per second
+    if (window.time() - lastTitleUpdate >= 0.5) {
+      std::string title = "Light Casters (Point) | " + depthPrepass.frameTimes();
+      window.setTitle(title);
+      lastTitleUpdate = window.time();
+    }
+
     // Draw the light cube
     glm::mat4 model;
     model = glm::translate(model, lightPos);
@@ -286,15 +425,20 @@ int32_t main() {
     glBindVertexArray(lightVao);
     glDrawArrays(GL_TRIANGLES, 0, 36);
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    window.swapBuffers();
+    window.pollEvents();
   }
 
   // Clean up
   glDeleteVertexArrays(1, &vao);
+  glDeleteVertexArrays(1, &depthVao);
+  glDeleteVertexArrays(1, &floorVao);
+  glDeleteVertexArrays(1, &floorDepthVao);
   glDeleteVertexArrays(1, &lightVao);
   glDeleteBuffers(1, &vbo);
-  glfwTerminate();
+  glDeleteBuffers(1, &depthVbo);
+  glDeleteBuffers(1, &floorVbo);
+  glDeleteBuffers(1, &floorDepthVbo);
 
   return 0;
 }
@@ -10,6 +10,10 @@
 
 #include <stb_image.h>
 #include "Shader.hpp"
+#include "NormalMatrix.hpp"
+#include "DepthPrepass.hpp"
+#include "ShadowMap.hpp"
+#include "Window.hpp"
 
 // Stored globally so it can be modified in framebufferSizeCallback() and used in main()
 glm::mat4 projection;
@@ -17,14 +21,31 @@ glm::mat4 projection;
 // The field of view
 constexpr float FOV = 50.0f;
 
+// Whether to lay down the depth in a pre-pass before shading, toggled with P
+bool depthPrepassEnabled = true;
+
+// Whether the spot light sweeps from side to side, toggled with L. Moving the light invalidates
+// the cached shadow map.
+bool animateLight = false;
+
 void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
   projection = glm::perspective(glm::radians(FOV), (float) width / (float) height, 0.1f, 100.0f);
 }
 
-void processInput(GLFWwindow *window) {
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+    depthPrepassEnabled = !depthPrepassEnabled;
+  }
+
+  if (key == GLFW_KEY_L && action == GLFW_PRESS) {
+    animateLight = !animateLight;
+  }
+}
+
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
   }
 }
 
@@ -74,30 +95,15 @@ int32_t main() {
   constexpr int32_t SCREEN_WIDTH = 1280;
   constexpr int32_t SCREEN_HEIGHT = 720;
 
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(SCREEN_WIDTH, SCREEN_HEIGHT, "Light Casters (Spot)");
 
-  GLFWwindow *window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Light Casters (Spot)",
-                                        nullptr,
-                                        nullptr);
-  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-
-  if (window == nullptr) {
-    std::cout << "Failed to create GLFW window." << std::endl;
-    glfwTerminate();
+  if (!window.isOpen()) {
     return -1;
   }
 
-  // GLFW doesn't mark the context as current automatically
-  // <https://stackoverflow.com/questions/48650497/glad-failing-to-initialize>
-  glfwMakeContextCurrent(window);
-
-  if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-    std::cout << "ERROR: Failed to initialize GLAD." << std::endl;
-    return -1;
-  }
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
+  window.setKeyCallback(keyCallback);
 
   glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
@@ -199,11 +205,50 @@ int32_t main() {
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (6 * sizeof(float)));
   glEnableVertexAttribArray(2);
 
+  // The depth pre-pass only reads the positions
+  uint32_t depthVbo;
+  uint32_t depthVao = createPositionVao(deinterleavePositions(vertices, 36, 8), depthVbo);
+
   // Set the projection matrix here so it's defined on application start too
   projection = glm::perspective(glm::radians(FOV), (float) SCREEN_WIDTH / (float) SCREEN_HEIGHT,
                                 0.1f, 100.0f);
 
-  while (!glfwWindowShouldClose(window)) {
+  // The cubes never move, so their model and normal matrices are computed once. They are only
+  // rotated and translated, so their normal matrices are the model matrices' upper 3x3 part.
+  glm::mat4 cubeModels[10];
+  glm::mat3 cubeNormalMatrices[10];
+
+  for (uint32_t i = 0; i < 10; i++) {
+    glm::mat4 model;
+    model = glm::translate(model, cubePositions[i]);
+    float angle = 20.0f * i;
+    model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+    cubeModels[i] = model;
+  }
+
+  computeNormalMatrices(cubeModels, cubeNormalMatrices, 10, true);
+
+  // A flashlight held next to the camera, offset so that the shadows it casts are visible
+  SpotLight spotLight;
+  spotLight.position = glm::vec3(0.4f, 0.4f, 3.0f);
+  spotLight.direction = glm::vec3(0.0f, 0.0f, -1.0f);
+  spotLight.innerCutoff = glm::cos(glm::radians(6.0f));
+  spotLight.outerCutoff = glm::cos(glm::radians(9.0f));
+  spotLight.constant = 1.0f;
+  spotLight.linear = 0.09f;
+  spotLight.quadratic = 0.032f;
+  float lightAngle = 0.0f;
+  double previousTime = window.time();
+
+  // The cubes are static shadow casters, rendered once into the shadow map's cache. Only the
+  // moving cube is rendered every frame.
+  ShadowMap shadowMap = ShadowMap(2048);
+  constexpr int32_t SHADOW_MAP_UNIT = 2;
+
+  DepthPrepass depthPrepass;
+  double lastTitleUpdate = 0.0;
+
+  while (!window.shouldClose()) {
     processInput(window);
 
     // Clear the viewport with a constant color
@@ -218,11 +263,64 @@ int32_t main() {
     glm::mat4 view;
     view = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
 
+    // Sweep the light if enabled
+    double time = window.time();
+
+    if (animateLight) {
+      lightAngle += (float) (time - previousTime);
+    }
+
+    previousTime = time;
+    spotLight.direction = glm::vec3(sin(lightAngle) * 0.3f, 0.0f, -1.0f);
+
+    // The moving cube circles in front of the light
+    glm::mat4 movingCubeModel;
+    movingCubeModel = glm::translate(movingCubeModel, glm::vec3(cos(time) * 0.4f,
+                                                                sin(time) * 0.4f, 1.0f));
+    movingCubeModel = glm::rotate(movingCubeModel, (float) time, glm::vec3(0.3f, 1.0f, 0.2f));
+    movingCubeModel = glm::scale(movingCubeModel, glm::vec3(0.3f));
+    glm::mat3 movingCubeNormalMatrix = normalMatrix(movingCubeModel, true);
+
+    // Render the shadow map, re-rendering the static casters only if the light moved
+    shadowMap.setLightSpace(spotLightSpace(spotLight));
+
+    if (Shader *staticCasterShader = shadowMap.beginStaticCasters()) {
+      glBindVertexArray(depthVao);
+
+      for (uint32_t i = 0; i < 10; i++) {
+        staticCasterShader->setMat4("model", cubeModels[i]);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+      }
+    }
+
+    Shader &dynamicCasterShader = shadowMap.beginDynamicCasters();
+    glBindVertexArray(depthVao);
+    dynamicCasterShader.setMat4("model", movingCubeModel);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    shadowMap.end();
+
     glm::vec3 lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
     glm::vec3 ambientColor = lightColor * glm::vec3(0.15f);
     glm::vec3 diffuseColor = lightColor * glm::vec3(0.65f);
     glm::vec3 specularColor = lightColor;
 
+    depthPrepass.beginFrame(depthPrepassEnabled);
+
+    if (depthPrepass.isEnabled()) {
+      Shader &depthShader = depthPrepass.beginDepthPass(view, projection);
+      glBindVertexArray(depthVao);
+
+      for (uint32_t i = 0; i < 10; i++) {
+        depthShader.setMat4("model", cubeModels[i]);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+      }
+
+      depthShader.setMat4("model", movingCubeModel);
+      glDrawArrays(GL_TRIANGLES, 0, 36);
+
+      depthPrepass.beginShadingPass();
+    }
+
     containerShader.use();
     containerShader.setMat4("view", view);
     containerShader.setMat4("projection", projection);
@@ -235,37 +333,54 @@ int32_t main() {
     containerShader.setFloat("material.glossiness", 24.0f);
 
     // Set light properties
-    containerShader.setFloat("light.constant", 1.0f);
-    containerShader.setFloat("light.linear", 0.09f);
-    containerShader.setFloat("light.quadratic", 0.032f);
-    containerShader.setVec3("light.position", cameraPosition);
-    containerShader.setVec3("light.direction", 0.0f, 0.0f, -1.0f);
-    containerShader.setFloat("light.innerCutoff", glm::cos(glm::radians(6.0f)));
-    containerShader.setFloat("light.outerCutoff", glm::cos(glm::radians(9.0f)));
+    containerShader.setFloat("light.constant", spotLight.constant);
+    containerShader.setFloat("light.linear", spotLight.linear);
+    containerShader.setFloat("light.quadratic", spotLight.quadratic);
+    containerShader.setVec3("light.position", spotLight.position);
+    containerShader.setVec3("light.direction", spotLight.direction);
+    containerShader.setFloat("light.innerCutoff", spotLight.innerCutoff);
+    containerShader.setFloat("light.outerCutoff", spotLight.outerCutoff);
     containerShader.setVec3("light.ambient", ambientColor);
     containerShader.setVec3("light.diffuse", diffuseColor);
     containerShader.setVec3("light.specular", specularColor);
 
+    // Set shadow properties
+    containerShader.setMat4("lightSpace", shadowMap.lightSpace);
+    containerShader.setInt("shadowMap", SHADOW_MAP_UNIT);
+    shadowMap.bindTexture(SHADOW_MAP_UNIT);
+
     // Draw container cubes
     glBindVertexArray(vao);
 
     for (uint32_t i = 0; i < 10; i++) {
-      glm::mat4 model;
-      model = glm::translate(model, cubePositions[i]);
-      float angle = 20.0f * i;
-      model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-      containerShader.setMat4("model", model);
+      containerShader.setMat4("model", cubeModels[i]);
+      containerShader.setMat3("normalMatrix", cubeNormalMatrices[i]);
       glDrawArrays(GL_TRIANGLES, 0, 36);
     }
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    containerShader.setMat4("model", movingCubeModel);
+    containerShader.setMat3("normalMatrix", movingCubeNormalMatrix);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+
+    depthPrepass.endFrame();
+
+    // Show the measured frame times twice per second
+    if (window.time() - lastTitleUpdate >= 0.5) {
+      std::string title = "Light Casters (Spot) | " + depthPrepass.frameTimes() +
+                          " | static shadow renders: " + std::to_string(shadowMap.staticRenders);
+      window.setTitle(title);
+      lastTitleUpdate = window.time();
+    }
+
+    window.swapBuffers();
+    window.pollEvents();
   }
 
   // Clean up
   glDeleteVertexArrays(1, &vao);
+  glDeleteVertexArrays(1, &depthVao);
   glDeleteBuffers(1, &vbo);
-  glfwTerminate();
+  glDeleteBuffers(1, &depthVbo);
 
   return 0;
 }
@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Bounds.hpp"
+#include "CpuProfiler.hpp"
+#include "Lights.hpp"
+#include "Shader.hpp"
+#include "ThreadPool.hpp"
+
+/**
+ * Clustered light binning for forward rendering. The view frustum is split
+ * into a grid of screen tiles and exponentially distributed depth slices, and
+ * each cluster receives the list of lights whose influence reaches it. Lighting
+ * shaders then only evaluate the lights of the fragment's cluster.
+ *
+ * Binning runs on the CPU, one group of depth slices per worker thread. The
+ * results are uploaded as buffer textures (bound by bind()):
+ *
+ * - Cluster grid (RG32UI): offset and count in the light index list
+ * - Light index list (R16UI)
+ * - Light data (RGBA32F), LIGHT_TEXELS texels per light (see clustered_lights.fragment.glsl)
+ */
+class LightClusters {
+public:
+  // The number of RGBA32F texels describing each light in the light data buffer
+  static constexpr int32_t LIGHT_TEXELS = 4;
+  // Light indices are stored as 16-bit integers
+  static constexpr uint32_t MAX_LIGHTS = 65535;
+
+  // Texture units the buffer textures are bound to by bind()
+  static constexpr int32_t GRID_UNIT = 4;
+  static constexpr int32_t INDEX_UNIT = 5;
+  static constexpr int32_t LIGHT_UNIT = 6;
+
+  int32_t tilesX, tilesY, slices;
+
+  LightClusters(ThreadPool &threadPool, int32_t tilesX = 16, int32_t tilesY = 9,
+                int32_t slices = 24)
+      : tilesX(tilesX), tilesY(tilesY), slices(slices), threadPool(threadPool),
+        clusterLights((size_t) (tilesX * tilesY * slices)) {
+    glGenBuffers(3, buffers);
+    glGenTextures(3, textures);
+  }
+
+  /**
+   * Assigns the lights to the clusters of the given camera and uploads the
+   * results.
+   *
+   * @param view The camera's view matrix
+   * @param projection A symmetric perspective projection matrix
+   * @param near The projection's near plane distance
+   * @param far The projection's far plane distance
+   */
+  void update(const glm::mat4 &view, const glm::mat4 &projection, float near, float far,
+              const std::vector<PointLight> &pointLights,
+              const std::vector<SpotLight> &spotLights) {
+    CPU_PROFILE_SCOPE("LightClusters::update");
+    setupClusters(projection, near, far);
+    prepareLights(view, pointLights, spotLights);
+
+    // Each job owns a range of depth slices, so the per-cluster lists are written without locking
+    threadPool.parallelFor((uint32_t) slices, [this](uint32_t begin, uint32_t end) {
+      binSlices((int32_t) begin, (int32_t) end);
+    });
+
+    upload();
+  }
+
+  // Binds the buffer textures and sets the uniforms clustered_lights.fragment.glsl expects
+  void bind(Shader &shader, int32_t screenWidth, int32_t screenHeight) {
+    shader.setInt("clusterGrid", GRID_UNIT);
+    shader.setInt("clusterLightIndices", INDEX_UNIT);
+    shader.setInt("clusterLightData", LIGHT_UNIT);
+    glUniform3i(glGetUniformLocation(shader.id, "clusterCounts"), tilesX, tilesY, slices);
+    shader.setVec2("clusterTileSize", (float) screenWidth / (float) tilesX,
+                   (float) screenHeight / (float) tilesY);
+    // Slice = log(depth) * scale + bias
+    float logRatio = std::log(clusterFar / clusterNear);
+    shader.setVec2("clusterSliceScaleBias", (float) slices / logRatio,
+                   -(float) slices * std::log(clusterNear) / logRatio);
+
+    const GLenum formats[] = {GL_RG32UI, GL_R16UI, GL_RGBA32F};
+    const int32_t units[] = {GRID_UNIT, INDEX_UNIT, LIGHT_UNIT};
+
+    for (int32_t i = 0; i < 3; i++) {
+      glActiveTexture(GL_TEXTURE0 + units[i]);
+      glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+      glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+    }
+  }
+
+  // The number of light references across all clusters in the last update
+  uint32_t indexCount() const {
+    return referenceCount;
+  }
+
+private:
+  // View-space bounding sphere and cluster range of a light
+  struct BinnedLight {
+    glm::vec3 center;
+    float radius;
+    int32_t minTileX, maxTileX, minTileY, maxTileY, minSlice, maxSlice;
+  };
+
+  ThreadPool &threadPool;
+  uint32_t buffers[3], textures[3];
+
+  // The projection the cluster bounds were computed for
+  glm::mat4 clusterProjection = glm::mat4(0.0f);
+  float clusterNear = 0.0f, clusterFar = 0.0f;
+  // View-space bounds of each cluster, indexed by (slice * tilesY + y) * tilesX + x
+  std::vector<AABB> clusterBounds;
+
+  std::vector<BinnedLight> binnedLights;
+  std::vector<std::vector<uint16_t>> clusterLights;
+  std::vector<glm::vec4> lightData;
+  std::vector<uint32_t> grid;
+  std::vector<uint16_t> lightIndices;
+  uint32_t referenceCount = 0;
+
+  float sliceDepth(int32_t slice) const {
+    return clusterNear * std::pow(clusterFar / clusterNear, (float) slice / (float) slices);
+  }
+
+  int32_t depthSlice(float depth) const {
+    float slice = std::log(depth / clusterNear) / std::log(clusterFar / clusterNear) *
+                  (float) slices;
+    return std::clamp((int32_t) std::floor(slice), 0, slices - 1);
+  }
+
+  // Recomputes the clusters' view-space bounds when the projection changes
+  void setupClusters(const glm::mat4 &projection, float near, float far) {
+    if (projection == clusterProjection && near == clusterNear && far == clusterFar) {
+      return;
+    }
+
+    clusterProjection = projection;
+    clusterNear = near;
+    clusterFar = far;
+    clusterBounds.assign(clusterLights.size(), AABB());
+
+    for (int32_t slice = 0; slice < slices; slice++) {
+      float depths[2] = {sliceDepth(slice), sliceDepth(slice + 1)};
+
+      for (int32_t y = 0; y < tilesY; y++) {
+        for (int32_t x = 0; x < tilesX; x++) {
+          AABB &bounds = clusterBounds[clusterIndex(x, y, slice)];
+
+          // Extend the tile's corner rays to the slice's near and far depths
+          for (float depth : depths) {
+            for (int32_t corner = 0; corner < 4; corner++) {
+              float ndcX = (float) (x + (corner & 1)) / (float) tilesX * 2.0f - 1.0f;
+              float ndcY = (float) (y + (corner >> 1)) / (float) tilesY * 2.0f - 1.0f;
+              bounds.expand(glm::vec3(ndcX * depth / projection[0][0],
+                                      ndcY * depth / projection[1][1], -depth));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  size_t clusterIndex(int32_t x, int32_t y, int32_t slice) const {
+    return (size_t) ((slice * tilesY + y) * tilesX + x);
+  }
+
+  // Computes each light's view-space bounds and cluster range, and packs its shading data
+  void prepareLights(const glm::mat4 &view, const std::vector<PointLight> &pointLights,
+                     const std::vector<SpotLight> &spotLights) {
+    size_t lightCount = std::min<size_t>(pointLights.size() + spotLights.size(), MAX_LIGHTS);
+    binnedLights.clear();
+    lightData.clear();
+    binnedLights.reserve(lightCount);
+    lightData.reserve(lightCount * LIGHT_TEXELS);
+
+    for (size_t i = 0; i < lightCount; i++) {
+      bool spot = i >= pointLights.size();
+      const PointLight &light = spot ? spotLights[i - pointLights.size()] : pointLights[i];
+      float range = light.radius();
+      glm::vec3 center = light.position;
+      float sphereRadius = range;
+
+      if (spot) {
+        const SpotLight &spotLight = spotLights[i - pointLights.size()];
+        sphereRadius = spotLight.boundingSphere(center);
+        lightData.push_back(glm::vec4(light.position, range));
+        lightData.push_back(glm::vec4(light.color, 1.0f));
+        lightData.push_back(glm::vec4(glm::normalize(spotLight.direction),
+                                      spotLight.outerCutoff));
+        lightData.push_back(glm::vec4(light.constant, light.linear, light.quadratic,
+                                      spotLight.innerCutoff));
+      } else {
+        lightData.push_back(glm::vec4(light.position, range));
+        lightData.push_back(glm::vec4(light.color, 0.0f));
+        lightData.push_back(glm::vec4(0.0f));
+        lightData.push_back(glm::vec4(light.constant, light.linear, light.quadratic, 0.0f));
+      }
+
+      BinnedLight binned;
+      binned.center = glm::vec3(view * glm::vec4(center, 1.0f));
+      binned.radius = sphereRadius;
+      float minDepth = -binned.center.z - sphereRadius;
+      float maxDepth = -binned.center.z + sphereRadius;
+
+      if (maxDepth < clusterNear || minDepth > clusterFar || !(sphereRadius > 0.0f)) {
+        // Entirely in front of the near plane or behind the far plane
+        binned.minSlice = 0;
+        binned.maxSlice = -1;
+      } else {
+        binned.minSlice = minDepth <= clusterNear ? 0 : depthSlice(minDepth);
+        binned.maxSlice = depthSlice(std::min(maxDepth, clusterFar));
+      }
+
+      if (minDepth <= clusterNear) {
+        // The sphere crosses the camera plane and can't be projected, so cover every tile
+        binned.minTileX = 0;
+        binned.maxTileX = tilesX - 1;
+        binned.minTileY = 0;
+        binned.maxTileY = tilesY - 1;
+      } else {
+        // Conservative screen-space bounds of the sphere's view-space bounding box: the box's
+        // extreme coordinates are divided by the depth that makes them largest
+        auto tileRange = [&](float center, float scale, int32_t tiles, int32_t &minTile,
+                             int32_t &maxTile) {
+          float low = center - sphereRadius;
+          float high = center + sphereRadius;
+          float minNdc = low * scale / (low < 0.0f ? minDepth : maxDepth);
+          float maxNdc = high * scale / (high > 0.0f ? minDepth : maxDepth);
+          minTile = std::clamp((int32_t) std::floor((minNdc * 0.5f + 0.5f) * (float) tiles), 0,
+                               tiles - 1);
+          maxTile = std::clamp((int32_t) std::floor((maxNdc * 0.5f + 0.5f) * (float) tiles), 0,
+                               tiles - 1);
+
+          if (maxNdc < -1.0f || minNdc > 1.0f) {
+            // Off screen
+            maxTile = minTile - 1;
+          }
+        };
+
+        tileRange(binned.center.x, clusterProjection[0][0], tilesX, binned.minTileX,
+                  binned.maxTileX);
+        tileRange(binned.center.y, clusterProjection[1][1], tilesY, binned.minTileY,
+                  binned.maxTileY);
+      }
+
+      binnedLights.push_back(binned);
+    }
+  }
+
+  void binSlices(int32_t beginSlice, int32_t endSlice) {
+    CPU_PROFILE_SCOPE("LightClusters::binSlices");
+
+    for (int32_t slice = beginSlice; slice < endSlice; slice++) {
+      for (int32_t tile = 0; tile < tilesX * tilesY; tile++) {
+        clusterLights[(size_t) (slice * tilesX * tilesY + tile)].clear();
+      }
+    }
+
+    for (size_t i = 0; i < binnedLights.size(); i++) {
+      const BinnedLight &light = binnedLights[i];
+      int32_t firstSlice = std::max(light.minSlice, beginSlice);
+      int32_t lastSlice = std::min(light.maxSlice, endSlice - 1);
+
+      for (int32_t slice = firstSlice; slice <= lastSlice; slice++) {
+        for (int32_t y = light.minTileY; y <= light.maxTileY; y++) {
+          for (int32_t x = light.minTileX; x <= light.maxTileX; x++) {
+            size_t cluster = clusterIndex(x, y, slice);
+            const AABB &bounds = clusterBounds[cluster];
+            // Squared distance from the sphere's center to the cluster's box
+            glm::vec3 closest = glm::clamp(light.center, bounds.min, bounds.max);
+            glm::vec3 offset = closest - light.center;
+
+            if (glm::dot(offset, offset) <= light.radius * light.radius) {
+              clusterLights[cluster].push_back((uint16_t) i);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  void upload() {
+    grid.resize(clusterLights.size() * 2);
+    lightIndices.clear();
+
+    for (size_t cluster = 0; cluster < clusterLights.size(); cluster++) {
+      grid[cluster * 2] = (uint32_t) lightIndices.size();
+      grid[cluster * 2 + 1] = (uint32_t) clusterLights[cluster].size();
+      lightIndices.insert(lightIndices.end(), clusterLights[cluster].begin(),
+                          clusterLights[cluster].end());
+    }
+
+    referenceCount = (uint32_t) lightIndices.size();
+
+    // Buffer textures can't be empty
+    if (lightIndices.empty()) {
+      lightIndices.push_back(0);
+    }
+
+    if (lightData.empty()) {
+      lightData.push_back(glm::vec4(0.0f));
+    }
+
+    // Reallocating the buffers orphans the previous frame's data rather than waiting for the GPU
+    // to finish using it
+    uploadBuffer(buffers[0], grid.size() * sizeof(uint32_t), grid.data());
+    uploadBuffer(buffers[1], lightIndices.size() * sizeof(uint16_t), lightIndices.data());
+    uploadBuffer(buffers[2], lightData.size() * sizeof(glm::vec4), lightData.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+  }
+
+  static void uploadBuffer(uint32_t buffer, size_t size, const void *data) {
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, (GLsizeiptr) size, data, GL_STREAM_DRAW);
+  }
+};
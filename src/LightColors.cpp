@@ -6,14 +6,15 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <cmath>
 #include "Shader.hpp"
+#include "Window.hpp"
 
 void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
 }
 
-void processInput(GLFWwindow *window) {
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
   }
 }
 
@@ -21,29 +22,14 @@ int32_t main() {
   constexpr int32_t screenWidth = 800;
   constexpr int32_t screenHeight = 800;
 
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(screenWidth, screenHeight, "Lights (Colors)");
 
-  GLFWwindow *window = glfwCreateWindow(screenWidth, screenHeight, "Lights (Colors)", nullptr,
-                                        nullptr);
-  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-
-  if (window == nullptr) {
-    std::cout << "Failed to create GLFW window." << std::endl;
-    glfwTerminate();
+  if (!window.isOpen()) {
     return -1;
   }
 
-  // GLFW doesn't mark the context as current automatically
-  // <https://stackoverflow.com/questions/48650497/glad-failing-to-initialize>
-  glfwMakeContextCurrent(window);
-
-  if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-    std::cout << "ERROR: Failed to initialize GLAD." << std::endl;
-    return -1;
-  }
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
 
   glViewport(0, 0, screenWidth, screenHeight);
 
@@ -139,7 +125,7 @@ int32_t main() {
   projection = glm::perspective(glm::radians(45.0f), (float) screenWidth / (float) screenHeight,
                                 0.1f, 100.0f);
 
-  while (!glfwWindowShouldClose(window)) {
+  while (!window.shouldClose()) {
     processInput(window);
 
     // Clear the viewport with a constant color
@@ -148,8 +134,8 @@ int32_t main() {
 
     // Make the camera rotate in a circle around the center point
     float radius = 10.0f;
-    double cameraX = sin(glfwGetTime()) * radius;
-    double cameraZ = cos(glfwGetTime()) * radius;
+    double cameraX = sin(window.time()) * radius;
+    double cameraZ = cos(window.time()) * radius;
     glm::vec3 cameraPosition = glm::vec3(cameraX, 0.0f, cameraZ);
     glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
     // Use an "up" vector to determine the camera's right axis using a cross product
@@ -180,15 +166,14 @@ int32_t main() {
     glBindVertexArray(lightVao);
     glDrawArrays(GL_TRIANGLES, 0, 36);
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    window.swapBuffers();
+    window.pollEvents();
   }
 
   // Clean up
   glDeleteVertexArrays(1, &vao);
   glDeleteVertexArrays(1, &lightVao);
   glDeleteBuffers(1, &vbo);
-  glfwTerminate();
 
   return 0;
 }
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Bounds.hpp"
+
+// The attenuated light intensity below which a light is considered to have no effect (one step
+// of an 8-bit color channel)
+constexpr float LIGHT_CUTOFF = 1.0f / 256.0f;
+
+/**
+ * A point light with the same attenuation model as the lighting shaders:
+ * 1 / (constant + linear * d + quadratic * d²).
+ */
+struct PointLight {
+  glm::vec3 position = glm::vec3(0.0f);
+  // Used for both diffuse and specular lighting
+  glm::vec3 color = glm::vec3(1.0f);
+
+  // Attenuation factors
+  float constant = 1.0f;
+  float linear = 0.14f;
+  float quadratic = 0.07f;
+
+  /**
+   * Computes the distance past which the light's contribution drops below the
+   * cutoff, so that it can be ignored for anything farther away.
+   *
+   * @param cutoff The attenuated intensity considered negligible
+   * @return The influence radius (infinite if the light isn't attenuated)
+   */
+  float radius(float cutoff = LIGHT_CUTOFF) const {
+    float brightness = std::max(color.x, std::max(color.y, color.z));
+    // Solve quadratic * d² + linear * d + (constant - brightness / cutoff) = 0
+    float c = constant - brightness / cutoff;
+
+    if (c >= 0.0f) {
+      // Never bright enough to matter
+      return 0.0f;
+    }
+
+    if (quadratic > 0.0f) {
+      return (-linear + std::sqrt(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+    }
+
+    if (linear > 0.0f) {
+      return -c / linear;
+    }
+
+    return std::numeric_limits<float>::infinity();
+  }
+};
+
+/**
+ * A spot light: a point light restricted to a cone, fading out between the
+ * inner and outer cutoff angles.
+ */
+struct SpotLight : PointLight {
+  glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+
+  // Cutoff angles (stored as cosine values)
+  float innerCutoff = 0.976f;
+  float outerCutoff = 0.953f;
+
+  /**
+   * Computes the smallest sphere enclosing the cone lit by the light.
+   *
+   * @param center Receives the sphere's center
+   * @return The sphere's radius
+   */
+  float boundingSphere(glm::vec3 &center, float cutoff = LIGHT_CUTOFF) const {
+    float range = radius(cutoff);
+    glm::vec3 axis = glm::normalize(direction);
+
+    // Wide cones are bounded by the sphere through the base's rim, narrow ones by the sphere
+    // through the apex and the rim
+    if (outerCutoff <= 0.70710678f) {
+      center = position + axis * (range * outerCutoff);
+      return range * std::sqrt(std::max(0.0f, 1.0f - outerCutoff * outerCutoff));
+    }
+
+    float sphereRadius = range / (2.0f * outerCutoff);
+    center = position + axis * sphereRadius;
+    return sphereRadius;
+  }
+};
+
+/**
+ * Selects the point lights that reach an object, strongest first.
+ *
+ * @param lights The lights to choose from
+ * @param radii Each light's influence radius (see PointLight::radius())
+ * @param bounds The object's world-space bounding box
+ * @param maxLights The maximum number of lights to select
+ * @param selected Receives the indices of the selected lights
+ * @return The number of selected lights
+ */
+inline uint32_t selectLights(const std::vector<PointLight> &lights, const std::vector<float> &radii,
+                             const AABB &bounds, uint32_t maxLights,
+                             std::vector<uint32_t> &selected) {
+  // Attenuated intensity at the point of the box closest to each light
+  static thread_local std::vector<std::pair<float, uint32_t>> candidates;
+  candidates.clear();
+
+  for (uint32_t i = 0; i < (uint32_t) lights.size(); i++) {
+    const PointLight &light = lights[i];
+    glm::vec3 closest = glm::clamp(light.position, bounds.min, bounds.max);
+    float distance = glm::length(closest - light.position);
+
+    if (distance <= radii[i]) {
+      float brightness = std::max(light.color.x, std::max(light.color.y, light.color.z));
+      candidates.emplace_back(brightness / (light.constant + light.linear * distance +
+                                            light.quadratic * distance * distance), i);
+    }
+  }
+
+  uint32_t count = std::min(maxLights, (uint32_t) candidates.size());
+  std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(),
+                    [](const std::pair<float, uint32_t> &a, const std::pair<float, uint32_t> &b) {
+                      return a.first > b.first;
+                    });
+  selected.clear();
+
+  for (uint32_t i = 0; i < count; i++) {
+    selected.push_back(candidates[i].second);
+  }
+
+  return count;
+}
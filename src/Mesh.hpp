@@ -4,7 +4,10 @@
 #include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "Bounds.hpp"
+#include "RenderStats.hpp"
 #include "Shader.hpp"
+#include "StartupProfile.hpp"
 
 struct Vertex {
   glm::vec3 position;
@@ -24,12 +27,16 @@ public:
   std::vector<Vertex> vertices;
   std::vector<uint32_t> indices;
   std::vector<Texture> textures;
+  // Object-space bounding volumes, computed once at load time
+  AABB aabb;
+  BoundingSphere sphere;
 
   Mesh(std::vector<Vertex> vertices, std::vector<uint32_t> indices, std::vector<Texture> textures) {
     this->vertices = std::move(vertices);
     this->indices = std::move(indices);
     this->textures = std::move(textures);
 
+    computeBounds();
     setupMesh();
   }
 
@@ -59,12 +66,37 @@ public:
     glBindVertexArray(vao);
     glDrawElements(GL_TRIANGLES, (GLsizei) indices.size(), GL_UNSIGNED_INT, nullptr);
     glBindVertexArray(0);
+    countDraw((uint32_t) textures.size());
+  }
+
+  // Draws the mesh from its position-only stream, for depth-only passes
+  void drawDepth() {
+    glBindVertexArray(depthVao);
+    glDrawElements(GL_TRIANGLES, (GLsizei) indices.size(), GL_UNSIGNED_INT, nullptr);
+    glBindVertexArray(0);
+    countDraw(0);
   }
 
 private:
   uint32_t vao, vbo, ebo;
+  // Positions only, deinterleaved from the vertices so that depth-only passes fetch less data
+  uint32_t depthVao, positionVbo;
+
+  void countDraw(uint32_t textureBinds) {
+    renderStats.drawCalls++;
+    renderStats.triangles += indices.size() / 3;
+    renderStats.vaoBinds++;
+    renderStats.textureBinds += textureBinds;
+  }
+
+  void computeBounds() {
+    const glm::vec3 *positions = vertices.empty() ? nullptr : &vertices[0].position;
+    aabb = computeAABB(positions, vertices.size(), sizeof(Vertex));
+    sphere = computeBoundingSphere(positions, vertices.size(), sizeof(Vertex), aabb);
+  }
 
   void setupMesh() {
+    StartupPhase phase("mesh upload");
     glGenVertexArrays(1, &vao);
     glGenBuffers(1, &vbo);
     glGenBuffers(2, &ebo);
@@ -91,6 +123,26 @@ private:
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
                           (void *) offsetof(Vertex, texCoords));
 
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+
+    for (const Vertex &vertex : vertices) {
+      positions.push_back(vertex.position);
+    }
+
+    glGenVertexArrays(1, &depthVao);
+    glGenBuffers(1, &positionVbo);
+
+    glBindVertexArray(depthVao);
+    glBindBuffer(GL_ARRAY_BUFFER, positionVbo);
+    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(),
+                 GL_STATIC_DRAW);
+    // Shares the index buffer
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void *) nullptr);
+
     glBindVertexArray(0);
   }
 };
@@ -0,0 +1,388 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "AllocationCounter.hpp"
+#include "Model.hpp"
+#include "NormalMatrix.hpp"
+#include "Shader.hpp"
+#include "StubGL.hpp"
+
+/*
+ * Microbenchmarks of the demos' CPU-side hot paths: model loading, uniform
+ * uploads, texture decoding and transforms. They run without a GPU, with stub
+ * OpenGL functions (see StubGL.hpp), so they only measure the demos' own code.
+ *
+ * Each benchmark is run in a loop lasting at least MIN_REPETITION_SECONDS,
+ * REPETITIONS times, and reports the median time per iteration along with the
+ * spread of the repetitions, and the heap allocations per iteration. Like the
+ * demos, it must be run from the build directory to find the resources. The
+ * results can also be written as JSON:
+ *
+ *   Microbenchmarks [results.json]
+ */
+
+// Times each benchmark is measured
+constexpr uint32_t REPETITIONS = 20;
+// Minimum duration of a repetition, long enough for the clock's resolution not to matter
+constexpr double MIN_REPETITION_SECONDS = 0.01;
+
+struct MicrobenchmarkResult {
+  std::string name;
+  // What an iteration processes, e.g. "vertices"
+  std::string unit;
+  double itemsPerIteration;
+  uint64_t iterations;
+  // Nanoseconds per iteration in each repetition
+  std::vector<double> samples;
+  double allocationsPerIteration;
+};
+
+// Keeps the compiler from optimizing away a value computed by a benchmark
+template <typename T>
+inline void keep(const T &value) {
+#if defined(__GNUC__)
+  asm volatile("" : : "r"(&value) : "memory");
+#else
+  static const void *volatile sink;
+  sink = &value;
+#endif
+}
+
+/**
+ * Measures a benchmark.
+ *
+ * @param name The benchmark's name
+ * @param unit What the benchmark processes, e.g. "vertices"
+ * @param items How many of them an iteration processes
+ * @param iteration Runs an iteration
+ */
+template <typename Function>
+MicrobenchmarkResult measure(const std::string &name, const std::string &unit, double items,
+                             Function &&iteration) {
+  using Clock = std::chrono::steady_clock;
+  auto run = [&](uint64_t iterations) {
+    auto start = Clock::now();
+
+    for (uint64_t i = 0; i < iterations; i++) {
+      iteration();
+    }
+
+    return std::chrono::duration<double>(Clock::now() - start).count();
+  };
+
+  // Warms up the caches, and finds the number of iterations filling a repetition
+  uint64_t iterations = 1;
+  double seconds = run(iterations);
+
+  while (seconds < MIN_REPETITION_SECONDS) {
+    double scale = seconds > 0.0 ? MIN_REPETITION_SECONDS * 1.2 / seconds : 100.0;
+    iterations = (uint64_t) std::ceil((double) iterations * std::clamp(scale, 2.0, 100.0));
+    seconds = run(iterations);
+  }
+
+  MicrobenchmarkResult result = {name, unit, items, iterations, {}, 0.0};
+  uint64_t startAllocations = allocations();
+
+  for (uint32_t i = 0; i < REPETITIONS; i++) {
+    result.samples.push_back(run(iterations) * 1.0e9 / (double) iterations);
+  }
+
+  result.allocationsPerIteration = (double) (allocations() - startAllocations) /
+                                   (double) (iterations * REPETITIONS);
+
+  return result;
+}
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  size_t middle = values.size() / 2;
+  return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+double mean(const std::vector<double> &values) {
+  double sum = 0.0;
+
+  for (double value : values) {
+    sum += value;
+  }
+
+  return sum / (double) values.size();
+}
+
+double standardDeviation(const std::vector<double> &values) {
+  double average = mean(values);
+  double sum = 0.0;
+
+  for (double value : values) {
+    sum += (value - average) * (value - average);
+  }
+
+  return values.size() > 1 ? std::sqrt(sum / (double) (values.size() - 1)) : 0.0;
+}
+
+/**
+ * Times the private loading steps of a model, whose textures were loaded once
+ * beforehand so that they are found in its cache.
+ */
+class ModelMicrobenchmarks {
+public:
+  explicit ModelMicrobenchmarks(const char *path) : model(path) {
+    // The same scene Model::loadModel() processed, which frees it when done
+    scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+  }
+
+  void run(std::vector<MicrobenchmarkResult> &results) {
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+      std::cout << "Skipping the model benchmarks, the model couldn't be loaded." << std::endl;
+      return;
+    }
+
+    double vertices = 0.0;
+    double textureReferences = 0.0;
+
+    for (uint32_t i = 0; i < scene->mNumMeshes; i++) {
+      vertices += scene->mMeshes[i]->mNumVertices;
+    }
+
+    for (uint32_t i = 0; i < scene->mNumMaterials; i++) {
+      textureReferences += scene->mMaterials[i]->GetTextureCount(aiTextureType_DIFFUSE) +
+                           scene->mMaterials[i]->GetTextureCount(aiTextureType_SPECULAR);
+    }
+
+    results.push_back(measure("Model::processMesh", "vertices", vertices, [&] {
+      for (uint32_t i = 0; i < scene->mNumMeshes; i++) {
+        Mesh mesh = model.processMesh(scene->mMeshes[i], scene);
+        keep(mesh);
+      }
+    }));
+
+    results.push_back(measure("Model::loadMaterialTextures (cached)", "textures",
+                              textureReferences, [&] {
+      for (uint32_t i = 0; i < scene->mNumMaterials; i++) {
+        std::vector<Texture> diffuseMaps = model.loadMaterialTextures(
+            scene->mMaterials[i], aiTextureType_DIFFUSE, "texture_diffuse");
+        std::vector<Texture> specularMaps = model.loadMaterialTextures(
+            scene->mMaterials[i], aiTextureType_SPECULAR, "texture_specular");
+        keep(diffuseMaps);
+        keep(specularMaps);
+      }
+    }));
+  }
+
+private:
+  Model model;
+  Assimp::Importer importer;
+  const aiScene *scene = nullptr;
+};
+
+/**
+ * Times setting uniforms, including looking up their locations, with the
+ * MultipleLights container shader.
+ */
+void runShaderBenchmarks(std::vector<MicrobenchmarkResult> &results) {
+  Shader shader("../resources/shaders/multiple_lights.vertex.glsl",
+                "../resources/shaders/multiple_lights.fragment.glsl");
+  glm::mat4 model = glm::translate(glm::mat4(), glm::vec3(1.0f, 2.0f, 3.0f));
+  glm::mat3 normalMatrix = glm::mat3(model);
+  glm::vec3 color = glm::vec3(1.0f, 0.5f, 0.25f);
+
+  results.push_back(measure("Shader::setMat4 (\"model\")", "calls", 1.0, [&] {
+    shader.setMat4("model", model);
+  }));
+
+  // Longer than the strings stored without allocating by common standard libraries
+  results.push_back(measure("Shader::setVec3 (\"directionalLight.diffuse\")", "calls", 1.0, [&] {
+    shader.setVec3("directionalLight.diffuse", color);
+  }));
+
+  // The uniforms set for each cube in MultipleLights, lit by 4 point lights
+  results.push_back(measure("Shader::set* (MultipleLights cube)", "calls", 3.0, [&] {
+    int32_t lights[] = {0, 1, 2, 3};
+    shader.setMat4("model", model);
+    shader.setMat3("normalMatrix", normalMatrix);
+    shader.setInts("objectLights", lights, 4);
+  }));
+}
+
+// Times decoding the textures used by the demos
+void runTextureBenchmarks(std::vector<MicrobenchmarkResult> &results) {
+  const char *textures[] = {
+      "container.jpg",
+      "container2_diffuse.png",
+      "container2_specular.png",
+      "trixiestomp.png",
+  };
+
+  for (const char *texture : textures) {
+    std::string path = std::string("../resources/textures/") + texture;
+    int32_t width, height, components;
+
+    if (!stbi_info(path.c_str(), &width, &height, &components)) {
+      std::cout << "Skipping " << path << ", it couldn't be read." << std::endl;
+      continue;
+    }
+
+    results.push_back(measure(std::string("stbi_load (") + texture + ")", "pixels",
+                              (double) width * height, [&] {
+      uint8_t *data = stbi_load(path.c_str(), &width, &height, &components, 0);
+      keep(data);
+      stbi_image_free(data);
+    }));
+  }
+}
+
+// Times computing the model and normal matrices of cubes, as the lighting demos do
+void runTransformBenchmarks(std::vector<MicrobenchmarkResult> &results) {
+  constexpr uint32_t CUBES = 1000;
+  std::vector<glm::vec3> positions;
+  std::vector<glm::mat4> models(CUBES);
+  std::vector<glm::mat3> normalMatrices(CUBES);
+
+  for (uint32_t i = 0; i < CUBES; i++) {
+    positions.emplace_back((float) (i % 10), (float) (i / 10 % 10), -(float) (i / 100));
+  }
+
+  results.push_back(measure("Cube model matrices", "cubes", CUBES, [&] {
+    for (uint32_t i = 0; i < CUBES; i++) {
+      glm::mat4 model;
+      model = glm::translate(model, positions[i]);
+      float angle = 20.0f * (float) i;
+      model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+      models[i] = model;
+    }
+
+    keep(models[0]);
+  }));
+
+  results.push_back(measure("Cube normal matrices (computeNormalMatrices)", "cubes", CUBES, [&] {
+    computeNormalMatrices(models.data(), normalMatrices.data(), CUBES);
+    keep(normalMatrices[0]);
+  }));
+
+  results.push_back(measure("Cube normal matrices (inverse transpose)", "cubes", CUBES, [&] {
+    for (uint32_t i = 0; i < CUBES; i++) {
+      normalMatrices[i] = glm::mat3(glm::transpose(glm::inverse(models[i])));
+    }
+
+    keep(normalMatrices[0]);
+  }));
+}
+
+// Formats a throughput, e.g. "12.3 M vertices/s"
+std::string formatRate(double itemsPerSecond, const std::string &unit) {
+  const char *prefixes[] = {"", "k", "M", "G"};
+  uint32_t prefix = 0;
+
+  while (itemsPerSecond >= 1000.0 && prefix < 3) {
+    itemsPerSecond /= 1000.0;
+    prefix++;
+  }
+
+  char text[64];
+  std::snprintf(text, sizeof(text), "%.3g %s%s%s/s", itemsPerSecond, prefixes[prefix],
+                prefix > 0 ? " " : "", unit.c_str());
+  return text;
+}
+
+void printResults(const std::vector<MicrobenchmarkResult> &results) {
+  std::printf("%-50s %14s %8s %24s %8s\n", "Benchmark", "Median", "StdDev", "Throughput",
+              "Allocs");
+
+  for (const MicrobenchmarkResult &result : results) {
+    double medianNanoseconds = median(result.samples);
+    double deviation = standardDeviation(result.samples) / mean(result.samples) * 100.0;
+    std::printf("%-50s %11.1f ns %7.1f%% %24s %8.1f\n", result.name.c_str(), medianNanoseconds,
+                deviation,
+                formatRate(result.itemsPerIteration / medianNanoseconds * 1.0e9,
+                           result.unit).c_str(), result.allocationsPerIteration);
+  }
+}
+
+std::string escape(const std::string &text) {
+  std::string escaped;
+
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+
+    escaped += c;
+  }
+
+  return escaped;
+}
+
+bool writeResults(const std::vector<MicrobenchmarkResult> &results, const char *path) {
+  FILE *file = std::fopen(path, "w");
+
+  if (file == nullptr) {
+    return false;
+  }
+
+  std::fprintf(file, "{\"microbenchmarks\": [\n");
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const MicrobenchmarkResult &result = results[i];
+    double medianNanoseconds = median(result.samples);
+
+    std::fprintf(file, "{\n");
+    std::fprintf(file, "  \"name\": \"%s\",\n", escape(result.name).c_str());
+    std::fprintf(file, "  \"unit\": \"%s\",\n", result.unit.c_str());
+    std::fprintf(file, "  \"items\": %.0f,\n", result.itemsPerIteration);
+    std::fprintf(file, "  \"iterations\": %llu,\n", (unsigned long long) result.iterations);
+    std::fprintf(file, "  \"ns\": {\"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f, "
+                       "\"min\": %.3f, \"max\": %.3f},\n", medianNanoseconds, mean(result.samples),
+                 standardDeviation(result.samples),
+                 *std::min_element(result.samples.begin(), result.samples.end()),
+                 *std::max_element(result.samples.begin(), result.samples.end()));
+    std::fprintf(file, "  \"items_per_second\": %.1f,\n",
+                 result.itemsPerIteration / medianNanoseconds * 1.0e9);
+    std::fprintf(file, "  \"allocations\": %.3f,\n", result.allocationsPerIteration);
+    std::fprintf(file, "  \"samples_ns\": [");
+
+    for (size_t j = 0; j < result.samples.size(); j++) {
+      std::fprintf(file, j == 0 ? "%.3f" : ", %.3f", result.samples[j]);
+    }
+
+    std::fprintf(file, i + 1 < results.size() ? "]\n},\n" : "]\n}\n");
+  }
+
+  std::fprintf(file, "]}\n");
+  std::fclose(file);
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  if (!loadStubGL()) {
+    std::cout << "ERROR: Failed to load the stub OpenGL functions." << std::endl;
+    return -1;
+  }
+
+  std::vector<MicrobenchmarkResult> results;
+
+  ModelMicrobenchmarks modelBenchmarks("../resources/models/nanosuit/nanosuit.blend");
+  modelBenchmarks.run(results);
+  runShaderBenchmarks(results);
+  runTextureBenchmarks(results);
+  runTransformBenchmarks(results);
+
+  printResults(results);
+
+  if (argc > 1) {
+    if (!writeResults(results, argv[1])) {
+      std::cout << "ERROR: Failed to write the results to " << argv[1] << "." << std::endl;
+      return -1;
+    }
+
+    std::cout << "Results written to " << argv[1] << "." << std::endl;
+  }
+
+  return 0;
+}
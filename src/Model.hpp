@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -10,6 +11,14 @@
 #include <stb_image.h>
 #include "Shader.hpp"
 #include "Mesh.hpp"
+#include "Culling.hpp"
+#include "OcclusionQueries.hpp"
+#include "GpuProfiler.hpp"
+#include "CpuProfiler.hpp"
+#include "StartupProfile.hpp"
+
+// The shading models of the software draw(), see SoftwareShading.hpp
+class SoftwareShader;
 
 /**
  * Loads a texture from a file.
@@ -20,6 +29,7 @@
  * @return The assigned OpenGL texture ID
  */
 uint32_t textureFromFile(const char *path, const std::string &directory, bool gamma = false) {
+  CPU_PROFILE_SCOPE("textureFromFile");
   std::string filename = std::string(path);
   filename = directory + '/' + filename;
 
@@ -27,7 +37,13 @@ uint32_t textureFromFile(const char *path, const std::string &directory, bool ga
   glGenTextures(1, &textureId);
 
   int32_t width, height, nbComponents;
-  uint8_t *data = stbi_load(filename.c_str(), &width, &height, &nbComponents, 0);
+  uint8_t *data;
+
+  {
+    CPU_PROFILE_SCOPE("stbi_load");
+    StartupPhase phase("image decode");
+    data = stbi_load(filename.c_str(), &width, &height, &nbComponents, 0);
+  }
 
   if (data) {
     GLenum format;
@@ -50,9 +66,18 @@ uint32_t textureFromFile(const char *path, const std::string &directory, bool ga
         break;
     }
 
+    CPU_PROFILE_SCOPE("texture upload");
     glBindTexture(GL_TEXTURE_2D, textureId);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
+
+    {
+      StartupPhase phase("texture upload");
+      glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    }
+
+    {
+      StartupPhase phase("mipmap generation");
+      glGenerateMipmap(GL_TEXTURE_2D);
+    }
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -70,25 +95,190 @@ uint32_t textureFromFile(const char *path, const std::string &directory, bool ga
 
 class Model {
 public:
+  // Object-space bounding volumes enclosing every mesh of the model
+  AABB aabb;
+  BoundingSphere sphere;
+
   explicit Model(const char *path) {
     loadModel(path);
   }
 
   void draw(Shader shader) {
-    for (Mesh mesh : meshes) {
-      mesh.draw(shader);
+    renderStats.modelDraws++;
+    GpuProfiler::Scope scope(profiler, profilerName.c_str());
+
+    for (uint32_t i = 0; i < (uint32_t) meshes.size(); i++) {
+      drawMesh(i, shader);
+    }
+  }
+
+  /**
+   * Draws the meshes with the software rasterizer instead of OpenGL. The
+   * textures aren't sampled, the shader gives the surface's colors. A template,
+   * so that only its callers need to include SoftwareRasterizer.hpp.
+   *
+   * @param rasterizer The SoftwareRasterizer to queue the triangles in, until its next flush()
+   * @param model The model matrix
+   * @param shader The shading model of the meshes
+   */
+  template<typename Rasterizer>
+  void draw(Rasterizer &rasterizer, const glm::mat4 &model, const SoftwareShader &shader) const {
+    for (const Mesh &mesh : meshes) {
+      rasterizer.draw(mesh, model, shader);
+    }
+  }
+
+  /**
+   * Times the draw() calls of the model and of each of its meshes, in scopes
+   * named after the model and "<name>/mesh <index>".
+   *
+   * @param profiler The profiler to record the scopes in, or null to stop profiling
+   * @param name The name of the model's scope
+   */
+  void setGpuProfiler(GpuProfiler *profiler, const std::string &name) {
+    this->profiler = profiler;
+    profilerName = name;
+    meshScopeNames.clear();
+
+    for (uint32_t i = 0; i < (uint32_t) meshes.size(); i++) {
+      meshScopeNames.push_back(name + "/mesh " + std::to_string(i));
+    }
+  }
+
+  /**
+   * Enables skipping hidden meshes with hardware occlusion queries in the culling
+   * version of draw(). Results are one frame late, so objects that become
+   * visible may appear one frame late.
+   */
+  void setOcclusionQueries(OcclusionQueryMode mode) {
+    occlusionQueryMode = mode;
+
+    if (mode == OcclusionQueryMode::NONE) {
+      occlusionQueries.reset();
+    } else {
+      uint32_t count = mode == OcclusionQueryMode::PER_MESH ? (uint32_t) meshes.size() : 1;
+      occlusionQueries = std::make_unique<OcclusionQueries>(count);
+    }
+  }
+
+  /**
+   * Draws the meshes whose bounding boxes intersect the view frustum (and that
+   * weren't hidden in the previous frame, if occlusion queries are enabled).
+   *
+   * @param shader The shader to draw the meshes with
+   * @param frustum The view frustum in world space
+   * @param model The model matrix the model is drawn with
+   * @param depthPrepass Whether the depths were drawn by a depth pre-pass, the meshes then being
+   *                     drawn with GL_EQUAL and without depth writes (see DepthPrepass.hpp)
+   * @return The number of meshes that were culled
+   */
+  uint32_t draw(Shader shader, const Frustum &frustum, const glm::mat4 &model,
+                bool depthPrepass = false) {
+    renderStats.modelDraws++;
+    GpuProfiler::Scope scope(profiler, profilerName.c_str());
+
+    if (occlusionQueries) {
+      occlusionQueries->beginFrame();
+    }
+
+    // The state the occlusion queries restore after drawing the bounding boxes
+    const GLenum depthFunc = depthPrepass ? GL_EQUAL : GL_LESS;
+    const GLboolean depthMask = depthPrepass ? GL_FALSE : GL_TRUE;
+
+    if (!cullMeshes(frustum, model)) {
+      if (occlusionQueries) {
+        occlusionQueries->endFrame(shader.id, depthFunc, depthMask);
+      }
+
+      return (uint32_t) meshes.size();
+    }
+
+    if (!occlusionQueries) {
+      for (uint32_t i : visibleMeshes) {
+        drawMesh(i, shader);
+      }
+    } else if (occlusionQueryMode == OcclusionQueryMode::PER_MODEL) {
+      occlusionQueries->beginConditionalRender(0);
+
+      for (uint32_t i : visibleMeshes) {
+        drawMesh(i, shader);
+      }
+
+      occlusionQueries->endConditionalRender();
+      occlusionQueries->query(0, aabb.transform(model), frustum.viewProjection);
+    } else {
+      for (uint32_t i : visibleMeshes) {
+        occlusionQueries->beginConditionalRender(i);
+        drawMesh(i, shader);
+        occlusionQueries->endConditionalRender();
+      }
+
+      // Query after drawing all the meshes so that they can occlude each other
+      for (uint32_t i : visibleMeshes) {
+        occlusionQueries->query(i, worldMeshBounds[i], frustum.viewProjection);
+      }
+    }
+
+    if (occlusionQueries) {
+      occlusionQueries->endFrame(shader.id, depthFunc, depthMask);
+    }
+
+    return (uint32_t) (meshes.size() - visibleMeshes.size());
+  }
+
+  /**
+   * Draws the depth of the meshes whose bounding boxes intersect the view
+   * frustum, from their position-only streams, for a depth pre-pass (see
+   * DepthPrepass.hpp). Occlusion queries don't apply here.
+   *
+   * @param frustum The view frustum in world space
+   * @param model The model matrix the model is drawn with
+   */
+  void drawDepth(const Frustum &frustum, const glm::mat4 &model) {
+    renderStats.modelDraws++;
+
+    if (!cullMeshes(frustum, model)) {
+      return;
+    }
+
+    for (uint32_t i : visibleMeshes) {
+      meshes[i].drawDepth();
     }
   }
 
 private:
+  // Times the loading steps without a GPU (see Microbenchmarks.cpp)
+  friend class ModelMicrobenchmarks;
+
   std::vector<Mesh> meshes;
   std::string directory;
   // Used for caching
   std::vector<Texture> textures_loaded;
+  // Reused every frame by the culling draw() to avoid allocations
+  BoundsBatch meshBounds;
+  std::vector<AABB> worldMeshBounds;
+  std::vector<uint32_t> visibleMeshes;
+  OcclusionQueryMode occlusionQueryMode = OcclusionQueryMode::NONE;
+  std::unique_ptr<OcclusionQueries> occlusionQueries;
+  GpuProfiler *profiler = nullptr;
+  std::string profilerName;
+  std::vector<std::string> meshScopeNames;
+
+  void drawMesh(uint32_t index, Shader shader) {
+    GpuProfiler::Scope scope(profiler, profiler ? meshScopeNames[index].c_str() : nullptr);
+    meshes[index].draw(shader);
+  }
 
   void loadModel(const std::string &path) {
+    CPU_PROFILE_SCOPE("Model::loadModel");
     Assimp::Importer import;
-    const aiScene *scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    const aiScene *scene;
+
+    {
+      CPU_PROFILE_SCOPE("Assimp::Importer::ReadFile");
+      StartupPhase phase("Assimp import");
+      scene = import.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
+    }
 
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
       std::cout << "ERROR::ASSIMP::" << import.GetErrorString() << std::endl;
@@ -97,6 +287,48 @@ private:
 
     this->directory = path.substr(0, path.find_last_of('/'));
     processNode(scene->mRootNode, scene);
+    computeBounds();
+  }
+
+  /**
+   * Fills visibleMeshes with the meshes intersecting the view frustum, and
+   * worldMeshBounds with every mesh's world-space bounding box.
+   *
+   * @return Whether any part of the model may be visible
+   */
+  bool cullMeshes(const Frustum &frustum, const glm::mat4 &model) {
+    CPU_PROFILE_SCOPE("Model::cullMeshes");
+
+    // Reject the whole model early if possible
+    if (!frustum.intersects(sphere.transform(model))) {
+      return false;
+    }
+
+    meshBounds.clear();
+    worldMeshBounds.clear();
+
+    for (const Mesh &mesh : meshes) {
+      worldMeshBounds.push_back(mesh.aabb.transform(model));
+      meshBounds.add(worldMeshBounds.back());
+    }
+
+    meshBounds.cull(frustum, visibleMeshes);
+    return true;
+  }
+
+  void computeBounds() {
+    for (const Mesh &mesh : meshes) {
+      aabb.expand(mesh.aabb);
+    }
+
+    // Enclose the mesh spheres rather than the box, which is usually looser
+    sphere.center = aabb.isEmpty() ? glm::vec3(0.0f) : aabb.center();
+    sphere.radius = 0.0f;
+
+    for (const Mesh &mesh : meshes) {
+      float distance = glm::length(mesh.sphere.center - sphere.center);
+      sphere.radius = std::fmax(sphere.radius, distance + mesh.sphere.radius);
+    }
   }
 
   void processNode(aiNode *node, const aiScene *scene) {
@@ -113,6 +345,8 @@ private:
   }
 
   Mesh processMesh(aiMesh *mesh, const aiScene *scene) {
+    CPU_PROFILE_SCOPE("Model::processMesh");
+    StartupPhase phase("mesh processing");
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
     std::vector<Texture> textures;
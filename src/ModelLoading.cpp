@@ -5,6 +5,10 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "Model.hpp"
+#include "DepthPrepass.hpp"
+#include "GpuProfiler.hpp"
+#include "StatsOverlay.hpp"
+#include "Window.hpp"
 
 // Stored globally so it can be modified in framebufferSizeCallback() and used in main()
 glm::mat4 projection;
@@ -12,14 +16,37 @@ glm::mat4 projection;
 // The field of view
 constexpr float FOV = 50.0f;
 
+// Whether to lay down the depth in a pre-pass before shading, toggled with P
+bool depthPrepassEnabled = true;
+
+// Whether to print the GPU time of the passes and meshes, requested with G
+bool printGpuProfile = false;
+
+// Whether to toggle the statistics overlay, requested with H
+bool toggleOverlay = false;
+
 void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
   projection = glm::perspective(glm::radians(FOV), (float) width / (float) height, 0.1f, 100.0f);
 }
 
-void processInput(GLFWwindow *window) {
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+    depthPrepassEnabled = !depthPrepassEnabled;
+  }
+
+  if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+    printGpuProfile = true;
+  }
+
+  if (key == GLFW_KEY_H && action == GLFW_PRESS) {
+    toggleOverlay = true;
+  }
+}
+
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
   }
 }
 
@@ -28,30 +55,15 @@ int32_t main() {
   constexpr int32_t SCREEN_WIDTH = 1280;
   constexpr int32_t SCREEN_HEIGHT = 720;
 
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(SCREEN_WIDTH, SCREEN_HEIGHT, "Model Loading");
 
-  GLFWwindow *window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Model Loading",
-                                        nullptr,
-                                        nullptr);
-  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-
-  if (window == nullptr) {
-    std::cout << "Failed to create GLFW window." << std::endl;
-    glfwTerminate();
+  if (!window.isOpen()) {
     return -1;
   }
 
-  // GLFW doesn't mark the context as current automatically
-  // <https://stackoverflow.com/questions/48650497/glad-failing-to-initialize>
-  glfwMakeContextCurrent(window);
-
-  if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-    std::cout << "ERROR: Failed to initialize GLAD." << std::endl;
-    return -1;
-  }
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
+  window.setKeyCallback(keyCallback);
 
   glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
   glEnable(GL_DEPTH_TEST);
@@ -62,13 +74,28 @@ int32_t main() {
   );
 
   Model ourModel = Model("../resources/models/nanosuit/nanosuit.blend");
+  // Skip drawing meshes that were hidden by other meshes in the previous frame
+  ourModel.setOcclusionQueries(OcclusionQueryMode::PER_MESH);
+  DepthPrepass depthPrepass;
+  // Times the passes and each mesh of the model
+  GpuProfiler profiler;
+  ourModel.setGpuProfiler(&profiler, "nanosuit");
+  StatsOverlay overlay;
+  double lastTitleUpdate = 0.0;
 
   // Set the projection matrix here so it's defined on application start too
   projection = glm::perspective(glm::radians(FOV), (float) SCREEN_WIDTH / (float) SCREEN_HEIGHT,
                                 0.1f, 100.0f);
 
-  while (!glfwWindowShouldClose(window)) {
+  while (!window.shouldClose()) {
     processInput(window);
+    profiler.beginFrame();
+    overlay.beginFrame();
+
+    if (toggleOverlay) {
+      overlay.toggle();
+      toggleOverlay = false;
+    }
 
     // Clear the viewport with a constant color
     glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
@@ -76,8 +103,8 @@ int32_t main() {
 
     // Make the camera rotate in a circle around the center point
     float radius = 3.0f;
-    double cameraX = sin(glfwGetTime() * 0.75f) * radius;
-    double cameraZ = cos(glfwGetTime() * 0.75f) * radius;
+    double cameraX = sin(window.time() * 0.75f) * radius;
+    double cameraZ = cos(window.time() * 0.75f) * radius;
     glm::vec3 cameraPosition = glm::vec3(cameraX, 0.0f, cameraZ);
     glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
     // Use an "up" vector to determine the camera's right axis using a cross product
@@ -85,23 +112,52 @@ int32_t main() {
     glm::mat4 view;
     view = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
 
+    glm::mat4 model;
+    model = glm::translate(model, glm::vec3(0.0, -1.75f, 0.0f));
+    model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
+    Frustum frustum = Frustum(projection * view);
+
+    depthPrepass.beginFrame(depthPrepassEnabled);
+
+    if (depthPrepass.isEnabled()) {
+      GpuProfiler::Scope scope(&profiler, "depth pre-pass");
+      Shader &depthShader = depthPrepass.beginDepthPass(view, projection);
+      depthShader.setMat4("model", model);
+      ourModel.drawDepth(frustum, model);
+      depthPrepass.beginShadingPass();
+    }
+
     modelShader.use();
     modelShader.setMat4("projection", projection);
     modelShader.setMat4("view", view);
 
     // Render the loaded model
-    glm::mat4 model;
-    model = glm::translate(model, glm::vec3(0.0, -1.75f, 0.0f));
-    model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
     modelShader.setMat4("model", model);
-    ourModel.draw(modelShader);
-
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    // Meshes outside the view frustum are skipped
+    ourModel.draw(modelShader, frustum, model, depthPrepass.isEnabled());
+    depthPrepass.endFrame();
+    int32_t framebufferWidth, framebufferHeight;
+    window.getFramebufferSize(&framebufferWidth, &framebufferHeight);
+    overlay.draw(framebufferWidth, framebufferHeight);
+    profiler.endFrame();
+
+    if (printGpuProfile) {
+      std::cout << profiler.report();
+      printGpuProfile = false;
+    }
+
+    // Show the measured frame times twice per second
+    if (window.time() - lastTitleUpdate >= 0.5) {
+      std::string title = "Model Loading (" + depthPrepass.frameTimes() + ")";
+      window.setTitle(title);
+      lastTitleUpdate = window.time();
+    }
+
+    window.swapBuffers();
+    window.pollEvents();
   }
 
   // Clean up
-  glfwTerminate();
 
   return 0;
 }
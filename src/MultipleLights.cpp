@@ -9,8 +9,19 @@
 #define STB_IMAGE_IMPLEMENTATION
 
 #include <stb_image.h>
+#include <algorithm>
 #include <array>
+#include <memory>
 #include "Shader.hpp"
+#include "Culling.hpp"
+#include "OcclusionCulling.hpp"
+#include "Lights.hpp"
+#include "NormalMatrix.hpp"
+#include "DepthPrepass.hpp"
+#include "CascadedShadowMap.hpp"
+#include "PointShadowMaps.hpp"
+#include "DynamicResolution.hpp"
+#include "Window.hpp"
 
 // Stored globally so it can be modified in framebufferSizeCallback() and used in main()
 glm::mat4 projection;
@@ -18,14 +29,43 @@ glm::mat4 projection;
 // The field of view
 constexpr float FOV = 50.0f;
 
+// The scene's point lights
+constexpr uint32_t POINT_LIGHTS = 4;
+
+// The maximum number of point lights shading each cube. Each light count up to this number has its
+// own shader variant, compiled once a cube needs it. As the lights' attenuation lets each of them
+// reach every cube, a lower cap would drop lights that visibly light a cube.
+constexpr uint32_t MAX_OBJECT_LIGHTS = 4;
+
+// Whether to lay down the depth in a pre-pass before shading, toggled with P
+bool depthPrepassEnabled = true;
+
+// Whether the rendering resolution follows the GPU frame time budget, toggled with R
+bool dynamicResolutionEnabled = true;
+
+// The GPU time per frame the dynamic resolution aims to stay under, and its range of scales
+constexpr float FRAME_BUDGET_MILLISECONDS = 12.0f;
+constexpr float MIN_RESOLUTION_SCALE = 0.5f;
+constexpr float MAX_RESOLUTION_SCALE = 1.0f;
+
 void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
   projection = glm::perspective(glm::radians(FOV), (float) width / (float) height, 0.1f, 100.0f);
 }
 
-void processInput(GLFWwindow *window) {
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
+void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+  if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+    depthPrepassEnabled = !depthPrepassEnabled;
+  }
+
+  if (key == GLFW_KEY_R && action == GLFW_PRESS) {
+    dynamicResolutionEnabled = !dynamicResolutionEnabled;
+  }
+}
+
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
   }
 }
 
@@ -75,37 +115,36 @@ int32_t main() {
   constexpr int32_t SCREEN_WIDTH = 1280;
   constexpr int32_t SCREEN_HEIGHT = 720;
 
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(SCREEN_WIDTH, SCREEN_HEIGHT, "Multiple Lights");
 
-  GLFWwindow *window = glfwCreateWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "Multiple Lights",
-                                        nullptr,
-                                        nullptr);
-  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-
-  if (window == nullptr) {
-    std::cout << "Failed to create GLFW window." << std::endl;
-    glfwTerminate();
+  if (!window.isOpen()) {
     return -1;
   }
 
-  // GLFW doesn't mark the context as current automatically
-  // <https://stackoverflow.com/questions/48650497/glad-failing-to-initialize>
-  glfwMakeContextCurrent(window);
-
-  if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-    std::cout << "ERROR: Failed to initialize GLAD." << std::endl;
-    return -1;
-  }
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
+  window.setKeyCallback(keyCallback);
 
   glViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
-  Shader containerShader = Shader(
-      "../resources/shaders/multiple_lights.vertex.glsl",
-      "../resources/shaders/multiple_lights.fragment.glsl"
-  );
+  // The directional light's shadows, from cascades fit to the camera and re-rendered every frame.
+  // The cubes are culled against each cascade on the worker threads.
+  ThreadPool threadPool;
+  CascadedShadowMap cascadedShadowMap = CascadedShadowMap(threadPool, 3, 2048);
+  constexpr float SHADOW_DISTANCE = 20.0f;
+  constexpr int32_t SHADOW_MAP_UNIT = 2;
+  glm::vec3 directionalLightDirection = glm::vec3(-0.2f, -1.0f, -0.3f);
+
+  // The point lights' shadows need cube map arrays, without them only the directional light casts
+  // shadows
+  bool pointShadowsSupported = PointShadowMaps::isSupported();
+  std::string pointShadowDefines = pointShadowsSupported ? PointShadowMaps::defines() : "";
+  constexpr int32_t POINT_SHADOW_MAP_UNIT = 3;
+
+  if (!pointShadowsSupported) {
+    std::cout << "WARNING: Cube map arrays are not supported, point light shadows are disabled."
+              << std::endl;
+  }
 
   // The cube's vertice and normal coordinates
   float vertices[] = {
@@ -167,8 +206,54 @@ int32_t main() {
       glm::vec3(0.0f, 0.0f, -1.0f),
   };
 
+  // Compute the cubes' model matrices and world-space bounding boxes once, as the cubes never move
+  constexpr uint32_t CUBES = sizeof(cubePositions) / sizeof(cubePositions[0]);
+  AABB cubeAabb;
+  cubeAabb.min = glm::vec3(-0.5f);
+  cubeAabb.max = glm::vec3(0.5f);
+  glm::mat4 cubeModels[CUBES];
+  glm::mat3 cubeNormalMatrices[CUBES];
+  BoundsBatch cubeBounds;
+  std::vector<AABB> cubeWorldBounds;
+  std::vector<uint32_t> visibleCubes;
+  // The cubes are solid, so their own triangles are used as occluders
+  std::vector<glm::vec3> occluderTriangles;
+
+  for (uint32_t i = 0; i < CUBES; i++) {
+    glm::mat4 model;
+    model = glm::translate(model, cubePositions[i]);
+    float angle = 20.0f * i;
+    model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
+    cubeModels[i] = model;
+    cubeWorldBounds.push_back(cubeAabb.transform(model));
+    cubeBounds.add(cubeWorldBounds.back());
+
+    for (uint32_t vertex = 0; vertex < 36; vertex++) {
+      glm::vec3 position = glm::vec3(vertices[vertex * 8], vertices[vertex * 8 + 1],
+                                     vertices[vertex * 8 + 2]);
+      occluderTriangles.push_back(glm::vec3(model * glm::vec4(position, 1.0f)));
+    }
+  }
+
+  // The cubes are only rotated and translated, so their normal matrices are the model matrices'
+  // upper 3x3 part
+  computeNormalMatrices(cubeModels, cubeNormalMatrices, CUBES, true);
+
+  // Every cube casts shadows, but only onto the others as there is no floor
+  AABB sceneBounds;
+
+  for (const AABB &bounds : cubeWorldBounds) {
+    sceneBounds.expand(bounds);
+  }
+
+  OcclusionCuller occlusionCuller = OcclusionCuller(threadPool);
+  occlusionCuller.setOccluders(occluderTriangles);
+  uint32_t previousOccludedCubes = UINT32_MAX;
+  DepthPrepass depthPrepass;
+  double lastTitleUpdate = 0.0;
+
   // Point light definitions
-  std::array<std::array<glm::vec3, 2>, 4> pointLights = {{
+  std::array<std::array<glm::vec3, 2>, POINT_LIGHTS> pointLightDefinitions = {{
       {
           glm::vec3(0.7f, 0.2f, 2.0f),   // Position
           glm::vec3(1.0f, 0.25f, 0.25f), // Color
@@ -186,6 +271,66 @@ int32_t main() {
           glm::vec3(1.0f, 1.0f, 1.0f),
       },
   }};
+  std::vector<PointLight> pointLights;
+  std::vector<float> pointLightRadii;
+
+  for (const std::array<glm::vec3, 2> &definition : pointLightDefinitions) {
+    PointLight light;
+    light.position = definition[0];
+    light.color = definition[1];
+    light.constant = 1.0f;
+    light.linear = 0.14f;
+    light.quadratic = 0.07f;
+    pointLights.push_back(light);
+    pointLightRadii.push_back(light.radius());
+  }
+
+  // One cube map per point light, each rendered in a single pass
+  std::unique_ptr<PointShadowMaps> pointShadowMaps;
+
+  if (pointShadowsSupported) {
+    pointShadowMaps = std::make_unique<PointShadowMaps>((uint32_t) pointLights.size(), 512);
+  }
+
+  // One shader variant per number of lights shading a cube, compiled the first time a cube needs
+  // it. The point lights never change, so their properties are only set once per variant, and each
+  // cube then only sets the indices of the lights shading it.
+  std::vector<std::unique_ptr<Shader>> containerShaders(MAX_OBJECT_LIGHTS + 1);
+  auto createContainerShader = [&](uint32_t lights) {
+    auto shader = std::make_unique<Shader>(
+        "../resources/shaders/multiple_lights.vertex.glsl",
+        "../resources/shaders/multiple_lights.fragment.glsl",
+        "#define SCENE_POINT_LIGHTS " + std::to_string(POINT_LIGHTS) + "\n#define POINT_LIGHTS " +
+        std::to_string(lights) + "\n" + cascadedShadowMap.defines() + pointShadowDefines);
+    shader->use();
+
+    for (uint32_t i = 0; i < (uint32_t) pointLights.size() && lights > 0; i++) {
+      const PointLight &light = pointLights[i];
+      std::string prefix = "pointLights[" + std::to_string(i) + "].";
+      glm::vec3 position = light.position;
+      glm::vec3 color = light.color;
+
+      shader->setVec3(prefix + "position", position);
+      shader->setFloat(prefix + "constant", light.constant);
+      shader->setFloat(prefix + "linear", light.linear);
+      shader->setFloat(prefix + "quadratic", light.quadratic);
+      shader->setVec3(prefix + "ambient", 0.0f, 0.0f, 0.0f);
+      shader->setVec3(prefix + "diffuse", color);
+      shader->setVec3(prefix + "specular", color);
+
+      if (pointShadowMaps) {
+        shader->setInt(prefix + "shadowMap", (int32_t) i);
+        shader->setFloat(prefix + "shadowFar", pointLightRadii[i]);
+      }
+    }
+
+    return shader;
+  };
+
+  // Visible cubes sorted by the number of lights reaching them, so that each shader variant is
+  // only bound once per frame
+  std::vector<std::pair<uint32_t, uint32_t>> cubeDraws;
+  std::vector<std::vector<uint32_t>> cubeLights(CUBES);
 
   // Load textures
   unsigned int textureDiffuse = loadTexture("../resources/textures/container2_diffuse.png");
@@ -220,21 +365,31 @@ int32_t main() {
   glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void *) (6 * sizeof(float)));
   glEnableVertexAttribArray(2);
 
+  // The depth pre-pass only reads the positions
+  uint32_t depthVbo;
+  uint32_t depthVao = createPositionVao(deinterleavePositions(vertices, 36, 8), depthVbo);
+
   // Set the projection matrix here so it's defined on application start too
   projection = glm::perspective(glm::radians(FOV), (float) SCREEN_WIDTH / (float) SCREEN_HEIGHT,
                                 0.1f, 100.0f);
 
-  while (!glfwWindowShouldClose(window)) {
+  // The scene is rendered offscreen, at a resolution keeping the GPU time within the budget
+  DynamicResolution dynamicResolution = DynamicResolution(FRAME_BUDGET_MILLISECONDS,
+                                                          MIN_RESOLUTION_SCALE,
+                                                          MAX_RESOLUTION_SCALE);
+
+  while (!window.shouldClose()) {
     processInput(window);
 
-    // Clear the viewport with a constant color
-    glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    int32_t windowWidth, windowHeight;
+    window.getFramebufferSize(&windowWidth, &windowHeight);
+    dynamicResolution.enabled = dynamicResolutionEnabled;
+    dynamicResolution.beginFrame(windowWidth, windowHeight);
 
     // Make the camera rotate in a circle around the center point
     float radius = 3.0f;
-    double cameraX = sin(glfwGetTime() * 0.75f) * radius;
-    double cameraZ = cos(glfwGetTime() * 0.75f) * radius;
+    double cameraX = sin(window.time() * 0.75f) * radius;
+    double cameraZ = cos(window.time() * 0.75f) * radius;
     glm::vec3 cameraPosition = glm::vec3(cameraX, 0.0f, cameraZ);
     glm::vec3 cameraTarget = glm::vec3(0.0f, 0.0f, 0.0f);
     // Use an "up" vector to determine the camera's right axis using a cross product
@@ -242,72 +397,177 @@ int32_t main() {
     glm::mat4 view;
     view = glm::lookAt(cameraPosition, cameraTarget, cameraUp);
 
-    containerShader.use();
-    containerShader.setMat4("view", view);
-    containerShader.setMat4("projection", projection);
-    containerShader.setVec3("viewPos", cameraPosition);
-
-    // Set material properties
-    // Set diffuse and specular to the appropriate texture ID
-    containerShader.setInt("material.diffuse", 0);
-    containerShader.setInt("material.specular", 1);
-    containerShader.setFloat("material.glossiness", 24.0f);
-
-    // Set directional light properties
-    containerShader.setVec3("directionalLight.direction", -0.2f, -1.0f, -0.3f);
-    containerShader.setVec3("directionalLight.ambient", 0.08f, 0.08f, 0.08f);
-    containerShader.setVec3("directionalLight.diffuse", 0.5f, 0.5f, 0.5f);
-    containerShader.setVec3("directionalLight.specular", 0.5f, 0.5f, 0.5f);
-
-    // Set point light properties
-    for (int32_t pointLight = 0; pointLight < pointLights.size(); pointLight++) {
-      std::string positionUniform = "pointLights[" + std::to_string(pointLight) + "].position";
-      std::string constantUniform = "pointLights[" + std::to_string(pointLight) + "].constant";
-      std::string linearUniform = "pointLights[" + std::to_string(pointLight) + "].linear";
-      std::string quadraticUniform = "pointLights[" + std::to_string(pointLight) + "].quadratic";
-      std::string ambientUniform = "pointLights[" + std::to_string(pointLight) + "].ambient";
-      std::string diffuseUniform = "pointLights[" + std::to_string(pointLight) + "].diffuse";
-      std::string specularUniform = "pointLights[" + std::to_string(pointLight) + "].specular";
-
-      containerShader.setVec3(positionUniform, pointLights[pointLight][0]);
-      containerShader.setFloat(constantUniform, 1.0f);
-      containerShader.setFloat(linearUniform, 0.14f);
-      containerShader.setFloat(quadraticUniform, 0.07f);
-      containerShader.setVec3(ambientUniform, 0.0f, 0.0f, 0.0f);
-      containerShader.setVec3(diffuseUniform, pointLights[pointLight][1]);
-      containerShader.setVec3(specularUniform, pointLights[pointLight][1]);
+    // Frustum cull the cubes, then start occlusion culling the remaining ones on worker threads
+    // while the uniforms are set up
+    cubeBounds.cull(Frustum(projection * view), visibleCubes);
+    occlusionCuller.begin(projection * view);
+
+    // Render the cascades, drawing each cube once into every cascade it is visible in
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    cascadedShadowMap.update(view, glm::radians(FOV), (float) viewport[2] / (float) viewport[3],
+                             0.1f, SHADOW_DISTANCE, directionalLightDirection, sceneBounds,
+                             cubeWorldBounds);
+    Shader &casterShader = cascadedShadowMap.begin();
+    glBindVertexArray(depthVao);
+
+    for (const CascadedShadowMap::CasterDraw &draw : cascadedShadowMap.draws()) {
+      casterShader.setInt("cascadeMask", draw.cascadeMask);
+      casterShader.setMat4("model", cubeModels[draw.caster]);
+      glDrawArrays(GL_TRIANGLES, 0, 36);
+    }
+
+    cascadedShadowMap.end();
+
+    // Render the point lights' cube maps, drawing each cube once into every face it is visible in
+    if (pointShadowMaps) {
+      pointShadowMaps->begin();
+
+      for (uint32_t light = 0; light < (uint32_t) pointLights.size(); light++) {
+        Shader &pointCasterShader = pointShadowMaps->renderLight(
+            light, pointLights[light].position, pointLightRadii[light], cubeWorldBounds);
+
+        for (const PointShadowMaps::CasterDraw &draw : pointShadowMaps->draws()) {
+          pointCasterShader.setInt("faceMask", draw.faceMask);
+          pointCasterShader.setMat4("model", cubeModels[draw.caster]);
+          glDrawArrays(GL_TRIANGLES, 0, 36);
+        }
+      }
+
+      pointShadowMaps->end();
+    }
+
+    // Only draw the container cubes that are visible
+    uint32_t occludedCubes = occlusionCuller.cull(cubeWorldBounds, visibleCubes);
+
+    // Show the measured frame times twice per second
+    if (occludedCubes != previousOccludedCubes || window.time() - lastTitleUpdate >= 0.5) {
+      std::string title = "Multiple Lights (" + std::to_string(occludedCubes) +
+                          " cubes occlusion culled, " + depthPrepass.frameTimes() + ", " +
+                          dynamicResolution.status() + ")";
+      window.setTitle(title);
+      previousOccludedCubes = occludedCubes;
+      lastTitleUpdate = window.time();
+    }
+
+    // Pick the lights reaching each visible cube, strongest first
+    cubeDraws.clear();
+
+    for (uint32_t i : visibleCubes) {
+      uint32_t lights = selectLights(pointLights, pointLightRadii, cubeWorldBounds[i],
+                                     MAX_OBJECT_LIGHTS, cubeLights[i]);
+      cubeDraws.emplace_back(lights, i);
+    }
+
+    std::sort(cubeDraws.begin(), cubeDraws.end());
+
+    // Set the uniforms shared by every cube in each shader variant drawn this frame
+    for (uint32_t variant = 0; variant <= MAX_OBJECT_LIGHTS; variant++) {
+      bool drawn = std::any_of(cubeDraws.begin(), cubeDraws.end(),
+                               [&](const std::pair<uint32_t, uint32_t> &draw) {
+                                 return draw.first == variant;
+                               });
+
+      if (!drawn) {
+        continue;
+      }
+
+      if (!containerShaders[variant]) {
+        containerShaders[variant] = createContainerShader(variant);
+      }
+
+      Shader &containerShader = *containerShaders[variant];
+      containerShader.use();
+      containerShader.setMat4("view", view);
+      containerShader.setMat4("projection", projection);
+      containerShader.setVec3("viewPos", cameraPosition);
+
+      // Set material properties
+      // Set diffuse and specular to the appropriate texture ID
+      containerShader.setInt("material.diffuse", 0);
+      containerShader.setInt("material.specular", 1);
+      containerShader.setFloat("material.glossiness", 24.0f);
+
+      // Set directional light properties
+      containerShader.setVec3("directionalLight.direction", directionalLightDirection);
+      containerShader.setVec3("directionalLight.ambient", 0.08f, 0.08f, 0.08f);
+      containerShader.setVec3("directionalLight.diffuse", 0.5f, 0.5f, 0.5f);
+      containerShader.setVec3("directionalLight.specular", 0.5f, 0.5f, 0.5f);
+
+      // Set spot light properties
+      containerShader.setVec3("spotLight.position", cameraPosition);
+      glm::vec3 spotLightDirection = -cameraPosition;
+      containerShader.setVec3("spotLight.direction", spotLightDirection);
+      containerShader.setFloat("spotLight.innerCutoff", glm::cos(glm::radians(5.0f)));
+      containerShader.setFloat("spotLight.outerCutoff", glm::cos(glm::radians(10.0f)));
+      containerShader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
+      containerShader.setVec3("spotLight.diffuse", 0.7f, 0.7f, 0.7f);
+      containerShader.setVec3("spotLight.specular", 0.7f, 0.7f, 0.7f);
+
+      cascadedShadowMap.setUniforms(containerShader, SHADOW_MAP_UNIT);
+
+      if (pointShadowMaps) {
+        pointShadowMaps->setUniforms(containerShader, POINT_SHADOW_MAP_UNIT);
+      }
+    }
+
+    // Render the scene offscreen, clearing it with a constant color
+    dynamicResolution.bindTarget();
+    glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    depthPrepass.beginFrame(depthPrepassEnabled);
+
+    if (depthPrepass.isEnabled()) {
+      Shader &depthShader = depthPrepass.beginDepthPass(view, projection);
+      glBindVertexArray(depthVao);
+
+      for (const std::pair<uint32_t, uint32_t> &draw : cubeDraws) {
+        depthShader.setMat4("model", cubeModels[draw.second]);
+        glDrawArrays(GL_TRIANGLES, 0, 36);
+      }
+
+      depthPrepass.beginShadingPass();
     }
 
-    // Set spot light properties
-    containerShader.setVec3("spotLight.position", cameraPosition);
-    glm::vec3 spotLightDirection = -cameraPosition;
-    containerShader.setVec3("spotLight.direction", spotLightDirection);
-    containerShader.setFloat("spotLight.innerCutoff", glm::cos(glm::radians(5.0f)));
-    containerShader.setFloat("spotLight.outerCutoff", glm::cos(glm::radians(10.0f)));
-    containerShader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-    containerShader.setVec3("spotLight.diffuse", 0.7f, 0.7f, 0.7f);
-    containerShader.setVec3("spotLight.specular", 0.7f, 0.7f, 0.7f);
-
-    // Draw container cubes
     glBindVertexArray(vao);
+    uint32_t boundVariant = UINT32_MAX;
+
+    for (const std::pair<uint32_t, uint32_t> &draw : cubeDraws) {
+      Shader &containerShader = *containerShaders[draw.first];
+
+      if (draw.first != boundVariant) {
+        containerShader.use();
+        boundVariant = draw.first;
+      }
+
+      containerShader.setMat4("model", cubeModels[draw.second]);
+      containerShader.setMat3("normalMatrix", cubeNormalMatrices[draw.second]);
+
+      // The lights shading the cube, among the scene's
+      if (draw.first > 0) {
+        std::array<int32_t, MAX_OBJECT_LIGHTS> lights;
+        std::copy(cubeLights[draw.second].begin(), cubeLights[draw.second].end(), lights.begin());
+        containerShader.setInts("objectLights", lights.data(), (int32_t) draw.first);
+      }
 
-    for (uint32_t i = 0; i < 10; i++) {
-      glm::mat4 model;
-      model = glm::translate(model, cubePositions[i]);
-      float angle = 20.0f * i;
-      model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-      containerShader.setMat4("model", model);
       glDrawArrays(GL_TRIANGLES, 0, 36);
     }
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    depthPrepass.endFrame();
+
+    // Upscale the scene to the window
+    dynamicResolution.endFrame();
+
+    window.swapBuffers();
+    window.pollEvents();
   }
 
   // Clean up
   glDeleteVertexArrays(1, &vao);
   glDeleteBuffers(1, &vbo);
-  glfwTerminate();
+  glDeleteVertexArrays(1, &depthVao);
+  glDeleteBuffers(1, &depthVbo);
 
   return 0;
 }
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+/*
+ * Normal matrices, computed on the CPU once per object instead of with
+ * mat3(transpose(inverse(model))) in every vertex shader invocation.
+ *
+ * The lighting shaders normalize their normals, so the matrices only need to
+ * be correct up to a positive scale factor. This allows using the cofactor
+ * matrix (the inverse transpose multiplied by the determinant), which only
+ * takes three cross products, instead of a full inverse.
+ */
+
+/**
+ * Computes the matrix transforming an object's normals.
+ *
+ * @param model The object's model matrix
+ * @param rigid Whether the matrix only rotates, translates and scales uniformly, in which case its
+ *              upper 3x3 part can be used directly
+ */
+inline glm::mat3 normalMatrix(const glm::mat4 &model, bool rigid = false) {
+  glm::mat3 matrix = glm::mat3(model);
+
+  if (rigid) {
+    return matrix;
+  }
+
+  glm::vec3 column0 = glm::cross(matrix[1], matrix[2]);
+  glm::vec3 column1 = glm::cross(matrix[2], matrix[0]);
+  glm::vec3 column2 = glm::cross(matrix[0], matrix[1]);
+  // Mirroring transforms have a negative determinant, which would flip the normals
+  float sign = glm::dot(matrix[0], column0) < 0.0f ? -1.0f : 1.0f;
+
+  return glm::mat3(column0 * sign, column1 * sign, column2 * sign);
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+namespace normal_matrix_detail {
+// a.yzx * b.zxy - a.zxy * b.yzx
+inline __m128 cross(__m128 a, __m128 b) {
+  __m128 aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+  __m128 bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+  // Computing a * b.yzx - a.yzx * b gives the cross product in zxy order
+  __m128 result = _mm_sub_ps(_mm_mul_ps(a, bYzx), _mm_mul_ps(aYzx, b));
+  return _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+}
+}
+#endif
+
+/**
+ * Computes the normal matrices of many objects at once, typically right after
+ * their model matrices.
+ *
+ * @param models The model matrices
+ * @param normalMatrices Receives the normal matrices (count elements)
+ * @param count The number of matrices
+ * @param rigid Whether all the matrices only rotate, translate and scale uniformly (see
+ *              normalMatrix())
+ */
+inline void computeNormalMatrices(const glm::mat4 *models, glm::mat3 *normalMatrices,
+                                  size_t count, bool rigid = false) {
+  if (rigid) {
+    for (size_t i = 0; i < count; i++) {
+      normalMatrices[i] = glm::mat3(models[i]);
+    }
+
+    return;
+  }
+
+#if defined(__SSE2__) || defined(_M_X64)
+  using normal_matrix_detail::cross;
+  const __m128 signMask = _mm_set1_ps(-0.0f);
+
+  for (size_t i = 0; i < count; i++) {
+    // The columns' fourth component is 0 for affine matrices, and cancels out in the products
+    // anyway
+    const float *model = &models[i][0][0];
+    __m128 column0 = _mm_loadu_ps(model);
+    __m128 column1 = _mm_loadu_ps(model + 4);
+    __m128 column2 = _mm_loadu_ps(model + 8);
+
+    __m128 cofactor0 = cross(column1, column2);
+    __m128 cofactor1 = cross(column2, column0);
+    __m128 cofactor2 = cross(column0, column1);
+
+    // Determinant = dot(column0, cofactor0), its sign bit is applied to every component
+    __m128 products = _mm_mul_ps(column0, cofactor0);
+    __m128 determinant = _mm_add_ss(
+        _mm_add_ss(products, _mm_shuffle_ps(products, products, _MM_SHUFFLE(1, 1, 1, 1))),
+        _mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 2, 2, 2)));
+    __m128 sign = _mm_and_ps(_mm_shuffle_ps(determinant, determinant, 0), signMask);
+    cofactor0 = _mm_xor_ps(cofactor0, sign);
+    cofactor1 = _mm_xor_ps(cofactor1, sign);
+    cofactor2 = _mm_xor_ps(cofactor2, sign);
+
+    // The 3-component columns are tightly packed: the fourth component of each store is
+    // overwritten by the next one, and the last column is stored in two parts
+    float *normalMatrix = &normalMatrices[i][0][0];
+    _mm_storeu_ps(normalMatrix, cofactor0);
+    _mm_storeu_ps(normalMatrix + 3, cofactor1);
+    _mm_storel_pi((__m64 *) (normalMatrix + 6), cofactor2);
+    _mm_store_ss(normalMatrix + 8, _mm_shuffle_ps(cofactor2, cofactor2, _MM_SHUFFLE(2, 2, 2, 2)));
+  }
+#else
+  for (size_t i = 0; i < count; i++) {
+    normalMatrices[i] = normalMatrix(models[i]);
+  }
+#endif
+}
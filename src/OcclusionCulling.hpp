@@ -0,0 +1,342 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Bounds.hpp"
+#include "CpuProfiler.hpp"
+#include "ThreadPool.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+/**
+ * CPU occlusion culling. Simplified occluder geometry is rasterized into a
+ * low-resolution depth buffer, which is then reduced to a hierarchical depth
+ * buffer holding the farthest depth of every tile. An object whose nearest
+ * depth is behind the farthest depth of every tile it covers is hidden.
+ *
+ * Rasterization is split into horizontal bands processed by worker threads.
+ * begin() only queues that work, so it runs while the main thread records the
+ * frame and the GPU is still busy with the previous one; cull() waits for it.
+ */
+class OcclusionCuller {
+public:
+  static constexpr int32_t TILE_WIDTH = 8;
+  static constexpr int32_t TILE_HEIGHT = 4;
+
+  /**
+   * @param pool The worker threads to rasterize and test bounds on
+   * @param width The depth buffer width (rounded up to a multiple of TILE_WIDTH)
+   * @param height The depth buffer height (rounded up to a multiple of TILE_HEIGHT)
+   */
+  explicit OcclusionCuller(ThreadPool &pool, int32_t width = 320, int32_t height = 180)
+      : pool(pool) {
+    this->width = (width + TILE_WIDTH - 1) / TILE_WIDTH * TILE_WIDTH;
+    this->height = (height + TILE_HEIGHT - 1) / TILE_HEIGHT * TILE_HEIGHT;
+    tilesX = this->width / TILE_WIDTH;
+    tilesY = this->height / TILE_HEIGHT;
+    depth.resize((size_t) this->width * this->height);
+    hiZ.resize((size_t) tilesX * tilesY);
+  }
+
+  /**
+   * Sets the occluder geometry. Occluders should be simple and lie inside the
+   * objects they stand for (boxes, large flat faces...), as anything they
+   * cover is considered hidden.
+   *
+   * @param triangles World-space triangles (three vertices each)
+   */
+  void setOccluders(std::vector<glm::vec3> triangles) {
+    occluders = std::move(triangles);
+  }
+
+  /**
+   * Starts rasterizing the occluders on the worker threads.
+   *
+   * @param viewProjection The combined projection and view matrix of the frame
+   */
+  void begin(const glm::mat4 &viewProjection) {
+    this->viewProjection = viewProjection;
+    projectOccluders();
+
+    // One band per worker, aligned to tile rows so that bands can build their part of the HiZ
+    uint32_t bands = std::max(1u, std::min(pool.size(), (uint32_t) tilesY));
+    uint32_t tileRowsPerBand = (tilesY + bands - 1) / bands;
+    pending.clear();
+
+    for (int32_t tileRow = 0; tileRow < tilesY; tileRow += tileRowsPerBand) {
+      int32_t firstRow = tileRow * TILE_HEIGHT;
+      int32_t lastRow = std::min(tilesY, tileRow + (int32_t) tileRowsPerBand) * TILE_HEIGHT;
+      pending.push_back(pool.submit([this, firstRow, lastRow] { renderBand(firstRow, lastRow); }));
+    }
+  }
+
+  /**
+   * Waits for the occluders to be rasterized, then removes hidden objects from a list.
+   *
+   * @param bounds World-space bounding boxes of every object
+   * @param indices Indices into `bounds` of the objects to test; hidden ones are removed
+   * @return The number of objects that were culled
+   */
+  uint32_t cull(const std::vector<AABB> &bounds, std::vector<uint32_t> &indices) {
+    CPU_PROFILE_SCOPE("OcclusionCulling::cull");
+
+    for (std::future<void> &future : pending) {
+      future.get();
+    }
+
+    pending.clear();
+    visibility.assign(indices.size(), 1);
+
+    // Small batches aren't worth dispatching to other threads
+    if (indices.size() < 256) {
+      testRange(bounds, indices, 0, (uint32_t) indices.size());
+    } else {
+      pool.parallelFor((uint32_t) indices.size(), [&](uint32_t begin, uint32_t end) {
+        testRange(bounds, indices, begin, end);
+      });
+    }
+
+    size_t kept = 0;
+
+    for (size_t i = 0; i < indices.size(); i++) {
+      if (visibility[i]) {
+        indices[kept++] = indices[i];
+      }
+    }
+
+    culled = (uint32_t) (indices.size() - kept);
+    indices.resize(kept);
+    return culled;
+  }
+
+  // The number of objects culled by the last call to cull()
+  uint32_t culledCount() const {
+    return culled;
+  }
+
+  /**
+   * Tests a single world-space box against the depth buffer. Only valid after
+   * cull() has been called for the current frame.
+   */
+  bool isVisible(const AABB &aabb) const {
+    glm::vec2 screenMin = glm::vec2(std::numeric_limits<float>::max());
+    glm::vec2 screenMax = glm::vec2(-std::numeric_limits<float>::max());
+    float nearestDepth = 1.0f;
+
+    for (int32_t corner = 0; corner < 8; corner++) {
+      glm::vec3 position = glm::vec3(corner & 1 ? aabb.max.x : aabb.min.x,
+                                     corner & 2 ? aabb.max.y : aabb.min.y,
+                                     corner & 4 ? aabb.max.z : aabb.min.z);
+      glm::vec4 clip = viewProjection * glm::vec4(position, 1.0f);
+
+      // Boxes crossing the near plane can't be projected reliably, assume they are visible
+      if (clip.w <= NEAR_EPSILON) {
+        return true;
+      }
+
+      glm::vec3 screen = toScreen(clip);
+      screenMin = glm::vec2(std::fmin(screenMin.x, screen.x), std::fmin(screenMin.y, screen.y));
+      screenMax = glm::vec2(std::fmax(screenMax.x, screen.x), std::fmax(screenMax.y, screen.y));
+      nearestDepth = std::fmin(nearestDepth, screen.z);
+    }
+
+    // Leave boxes outside the screen to frustum culling
+    if (screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x >= (float) width ||
+        screenMin.y >= (float) height) {
+      return true;
+    }
+
+    int32_t tileMinX = std::max(0, (int32_t) screenMin.x / TILE_WIDTH);
+    int32_t tileMinY = std::max(0, (int32_t) screenMin.y / TILE_HEIGHT);
+    int32_t tileMaxX = std::min(tilesX - 1, (int32_t) screenMax.x / TILE_WIDTH);
+    int32_t tileMaxY = std::min(tilesY - 1, (int32_t) screenMax.y / TILE_HEIGHT);
+
+    for (int32_t tileY = tileMinY; tileY <= tileMaxY; tileY++) {
+      for (int32_t tileX = tileMinX; tileX <= tileMaxX; tileX++) {
+        if (hiZ[tileY * tilesX + tileX] >= nearestDepth) {
+          return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+private:
+  // Screen-space triangle, ready to be rasterized
+  struct ProjectedTriangle {
+    glm::vec3 vertices[3];
+  };
+
+  static constexpr float NEAR_EPSILON = 1e-4f;
+
+  ThreadPool &pool;
+  int32_t width, height;
+  int32_t tilesX, tilesY;
+  glm::mat4 viewProjection;
+  std::vector<glm::vec3> occluders;
+  std::vector<ProjectedTriangle> projected;
+  // Depth in [0, 1], 1 being the far plane
+  std::vector<float> depth;
+  // Farthest depth of every tile
+  std::vector<float> hiZ;
+  std::vector<std::future<void>> pending;
+  std::vector<uint8_t> visibility;
+  uint32_t culled = 0;
+
+  glm::vec3 toScreen(const glm::vec4 &clip) const {
+    glm::vec3 ndc = glm::vec3(clip) / clip.w;
+    return glm::vec3((ndc.x * 0.5f + 0.5f) * (float) width, (ndc.y * 0.5f + 0.5f) * (float) height,
+                     ndc.z * 0.5f + 0.5f);
+  }
+
+  void projectOccluders() {
+    projected.clear();
+
+    for (size_t i = 0; i + 2 < occluders.size(); i += 3) {
+      ProjectedTriangle triangle;
+      bool behindNearPlane = false;
+
+      for (int32_t vertex = 0; vertex < 3; vertex++) {
+        glm::vec4 clip = viewProjection * glm::vec4(occluders[i + vertex], 1.0f);
+        // Skipping occluders is always safe, so don't bother clipping them
+        behindNearPlane |= clip.w <= NEAR_EPSILON;
+        triangle.vertices[vertex] = behindNearPlane ? glm::vec3(0.0f) : toScreen(clip);
+      }
+
+      if (!behindNearPlane) {
+        projected.push_back(triangle);
+      }
+    }
+  }
+
+  void renderBand(int32_t firstRow, int32_t lastRow) {
+    std::fill(depth.begin() + (size_t) firstRow * width, depth.begin() + (size_t) lastRow * width,
+              1.0f);
+
+    for (const ProjectedTriangle &triangle : projected) {
+      rasterizeTriangle(triangle, firstRow, lastRow);
+    }
+
+    // Reduce the band to its HiZ tiles
+    for (int32_t tileY = firstRow / TILE_HEIGHT; tileY < lastRow / TILE_HEIGHT; tileY++) {
+      for (int32_t tileX = 0; tileX < tilesX; tileX++) {
+        float farthest = 0.0f;
+
+        for (int32_t y = tileY * TILE_HEIGHT; y < (tileY + 1) * TILE_HEIGHT; y++) {
+          const float *row = &depth[(size_t) y * width + tileX * TILE_WIDTH];
+
+          for (int32_t x = 0; x < TILE_WIDTH; x++) {
+            farthest = std::fmax(farthest, row[x]);
+          }
+        }
+
+        hiZ[tileY * tilesX + tileX] = farthest;
+      }
+    }
+  }
+
+  void rasterizeTriangle(const ProjectedTriangle &triangle, int32_t firstRow, int32_t lastRow) {
+    glm::vec3 v0 = triangle.vertices[0];
+    glm::vec3 v1 = triangle.vertices[1];
+    glm::vec3 v2 = triangle.vertices[2];
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+
+    if (std::abs(area) < 1e-6f) {
+      return;
+    }
+
+    // Occluders are rasterized double-sided, so make the winding consistent
+    if (area < 0.0f) {
+      std::swap(v1, v2);
+      area = -area;
+    }
+
+    int32_t minX = std::max(0, (int32_t) std::floor(std::fmin(v0.x, std::fmin(v1.x, v2.x))));
+    int32_t maxX = std::min(width - 1, (int32_t) std::ceil(std::fmax(v0.x, std::fmax(v1.x, v2.x))));
+    int32_t minY = std::max(firstRow, (int32_t) std::floor(std::fmin(v0.y, std::fmin(v1.y, v2.y))));
+    int32_t maxY = std::min(lastRow - 1,
+                            (int32_t) std::ceil(std::fmax(v0.y, std::fmax(v1.y, v2.y))));
+
+    if (minX > maxX || minY > maxY) {
+      return;
+    }
+
+    // Edge functions E(x, y) = a * x + b * y + c, positive inside the triangle
+    const glm::vec3 edgeVertices[3][2] = {{v1, v2}, {v2, v0}, {v0, v1}};
+    float a[3], b[3], c[3];
+
+    for (int32_t edge = 0; edge < 3; edge++) {
+      const glm::vec3 &from = edgeVertices[edge][0];
+      const glm::vec3 &to = edgeVertices[edge][1];
+      a[edge] = from.y - to.y;
+      b[edge] = to.x - from.x;
+      c[edge] = from.x * to.y - from.y * to.x;
+    }
+
+    // Depth is interpolated linearly in screen space: z(x, y) = zA * x + zB * y + zC
+    float zA = (a[0] * v0.z + a[1] * v1.z + a[2] * v2.z) / area;
+    float zB = (b[0] * v0.z + b[1] * v1.z + b[2] * v2.z) / area;
+    float zC = (c[0] * v0.z + c[1] * v1.z + c[2] * v2.z) / area;
+
+    // Process pixels four at a time, starting on a 4-pixel boundary
+    minX &= ~3;
+
+    for (int32_t y = minY; y <= maxY; y++) {
+      float centerY = (float) y + 0.5f;
+      float *row = &depth[(size_t) y * width];
+
+#if defined(__SSE2__) || defined(_M_X64)
+      const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+      const __m128 zero = _mm_setzero_ps();
+
+      for (int32_t x = minX; x <= maxX; x += 4) {
+        __m128 centerX = _mm_add_ps(_mm_set1_ps((float) x), offsets);
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+        for (int32_t edge = 0; edge < 3; edge++) {
+          __m128 value = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[edge]), centerX),
+                                    _mm_set1_ps(b[edge] * centerY + c[edge]));
+          inside = _mm_and_ps(inside, _mm_cmpge_ps(value, zero));
+        }
+
+        if (_mm_movemask_ps(inside) == 0) {
+          continue;
+        }
+
+        __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), centerX),
+                              _mm_set1_ps(zB * centerY + zC));
+        __m128 previous = _mm_loadu_ps(&row[x]);
+        __m128 nearest = _mm_min_ps(previous, z);
+        _mm_storeu_ps(&row[x], _mm_or_ps(_mm_and_ps(inside, nearest),
+                                         _mm_andnot_ps(inside, previous)));
+      }
+#else
+      for (int32_t x = minX; x <= maxX; x++) {
+        float centerX = (float) x + 0.5f;
+        bool inside = true;
+
+        for (int32_t edge = 0; edge < 3; edge++) {
+          inside &= a[edge] * centerX + b[edge] * centerY + c[edge] >= 0.0f;
+        }
+
+        if (inside) {
+          row[x] = std::fmin(row[x], zA * centerX + zB * centerY + zC);
+        }
+      }
+#endif
+    }
+  }
+
+  void testRange(const std::vector<AABB> &bounds, const std::vector<uint32_t> &indices,
+                 uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      visibility[i] = isVisible(bounds[indices[i]]);
+    }
+  }
+};
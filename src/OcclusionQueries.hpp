@@ -0,0 +1,185 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Bounds.hpp"
+#include "Shader.hpp"
+
+enum class OcclusionQueryMode {
+  // Always draw
+  NONE,
+  // One query for the whole model
+  PER_MODEL,
+  // One query per mesh
+  PER_MESH,
+};
+
+/**
+ * Hardware occlusion queries on bounding boxes, used to skip drawing hidden
+ * objects with conditional rendering.
+ *
+ * Boxes are queried after the objects have been drawn, and the results are
+ * used by the next frame's conditional rendering with GL_QUERY_NO_WAIT. The
+ * CPU never waits for a result: if it isn't ready yet, the GPU draws the
+ * object anyway. Two sets of queries are alternated so that a frame never
+ * overwrites the queries the GPU may still be using for conditional rendering.
+ */
+class OcclusionQueries {
+public:
+  explicit OcclusionQueries(uint32_t count)
+      : boxShader(Shader("../resources/shaders/bounding_box.vertex.glsl",
+                         "../resources/shaders/bounding_box.fragment.glsl")) {
+    for (int32_t set = 0; set < 2; set++) {
+      queries[set].resize(count);
+      glGenQueries((GLsizei) count, queries[set].data());
+      issued[set].assign(count, false);
+    }
+
+    transformLocation = glGetUniformLocation(boxShader.id, "transform");
+    setupBox();
+  }
+
+  OcclusionQueries(const OcclusionQueries &) = delete;
+  OcclusionQueries &operator=(const OcclusionQueries &) = delete;
+
+  ~OcclusionQueries() {
+    for (int32_t set = 0; set < 2; set++) {
+      glDeleteQueries((GLsizei) queries[set].size(), queries[set].data());
+    }
+
+    glDeleteVertexArrays(1, &boxVao);
+    glDeleteBuffers(1, &boxVbo);
+  }
+
+  /**
+   * Starts drawing an object that is skipped by the GPU if its bounding box was
+   * hidden in the previous frame.
+   */
+  void beginConditionalRender(uint32_t index) {
+    conditional = issued[current ^ 1][index];
+
+    if (conditional) {
+      glBeginConditionalRender(queries[current ^ 1][index], GL_QUERY_NO_WAIT);
+    }
+  }
+
+  void endConditionalRender() {
+    if (conditional) {
+      glEndConditionalRender();
+      conditional = false;
+    }
+  }
+
+  // Must be called before issuing the frame's queries with query()
+  void beginFrame() {
+    issued[current].assign(issued[current].size(), false);
+  }
+
+  /**
+   * Issues a query for an object's bounding box. Should be called after the
+   * occluders have been drawn.
+   *
+   * @param index The object's index
+   * @param aabb The object's world-space bounding box
+   * @param viewProjection The combined projection and view matrix
+   */
+  void query(uint32_t index, const AABB &aabb, const glm::mat4 &viewProjection) {
+    // Boxes crossing the near plane (or containing the camera) are not drawn reliably, so the
+    // object is drawn unconditionally next frame
+    for (int32_t corner = 0; corner < 8; corner++) {
+      glm::vec3 position = glm::vec3(corner & 1 ? aabb.max.x : aabb.min.x,
+                                     corner & 2 ? aabb.max.y : aabb.min.y,
+                                     corner & 4 ? aabb.max.z : aabb.min.z);
+
+      if ((viewProjection * glm::vec4(position, 1.0f)).w <= 0.0f) {
+        return;
+      }
+    }
+
+    if (!drawingBoxes) {
+      // Only depth testing is needed, nothing should be written
+      boxShader.use();
+      glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+      glDepthMask(GL_FALSE);
+      // The objects may be drawn with GL_EQUAL after a depth pre-pass, which the boxes would fail
+      glDepthFunc(GL_LEQUAL);
+      glBindVertexArray(boxVao);
+      drawingBoxes = true;
+    }
+
+    // Grow the box slightly so that it doesn't end up at the exact depth of flat or box-shaped
+    // objects, which would make it fail the depth test
+    glm::vec3 size = aabb.extents() * 2.0f * 1.01f + glm::vec3(0.001f);
+    glm::mat4 transform = glm::translate(viewProjection, aabb.center());
+    transform = glm::scale(transform, size);
+    glUniformMatrix4fv(transformLocation, 1, GL_FALSE, &transform[0][0]);
+
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, queries[current][index]);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+    issued[current][index] = true;
+  }
+
+  /**
+   * Restores the state changed by query() and makes the results available to
+   * the next frame. The state the objects were drawn with is given rather than
+   * read back with glGet*(), which may stall the pipeline.
+   *
+   * @param program The program to bind back
+   * @param depthFunc The depth function to restore
+   * @param depthMask The depth write mask to restore
+   */
+  void endFrame(uint32_t program, GLenum depthFunc = GL_LESS, GLboolean depthMask = GL_TRUE) {
+    if (drawingBoxes) {
+      glBindVertexArray(0);
+      glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+      glDepthMask(depthMask);
+      glDepthFunc(depthFunc);
+      glUseProgram(program);
+      drawingBoxes = false;
+    }
+
+    current ^= 1;
+  }
+
+private:
+  Shader boxShader;
+  int32_t transformLocation;
+  uint32_t boxVao, boxVbo;
+  // Queries are written to the current set and read from the other one
+  std::vector<uint32_t> queries[2];
+  std::vector<bool> issued[2];
+  uint32_t current = 0;
+  bool conditional = false;
+  bool drawingBoxes = false;
+
+  void setupBox() {
+    // A unit cube centered on the origin
+    const float corners[8][3] = {
+        {-0.5f, -0.5f, -0.5f}, {0.5f, -0.5f, -0.5f}, {0.5f, 0.5f, -0.5f}, {-0.5f, 0.5f, -0.5f},
+        {-0.5f, -0.5f, 0.5f}, {0.5f, -0.5f, 0.5f}, {0.5f, 0.5f, 0.5f}, {-0.5f, 0.5f, 0.5f},
+    };
+    const uint32_t faces[36] = {
+        0, 1, 2, 2, 3, 0, 4, 5, 6, 6, 7, 4, 0, 4, 7, 7, 3, 0,
+        1, 5, 6, 6, 2, 1, 0, 1, 5, 5, 4, 0, 3, 2, 6, 6, 7, 3,
+    };
+    float vertices[36 * 3];
+
+    for (uint32_t i = 0; i < 36; i++) {
+      for (uint32_t axis = 0; axis < 3; axis++) {
+        vertices[i * 3 + axis] = corners[faces[i]][axis];
+      }
+    }
+
+    glGenVertexArrays(1, &boxVao);
+    glGenBuffers(1, &boxVbo);
+    glBindVertexArray(boxVao);
+    glBindBuffer(GL_ARRAY_BUFFER, boxVbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *) nullptr);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+  }
+};
@@ -0,0 +1,646 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Json.hpp"
+
+/*
+ * Compares benchmark results with a baseline, and fails if they regressed, for
+ * the performance tests (see CMakeLists.txt):
+ *
+ *   PerfGate [options] baseline.json results.json [-- command...]
+ *   PerfGate --record [--runs=N] baseline.json results.json -- command...
+ *
+ * The files are written by the benchmarks target (benchmarks.json) or by the
+ * Microbenchmarks executable. If a command is given, it's run several times,
+ * as separate processes each writing results.json, and the runs are gathered
+ * into results.json as {"runs": [...]} before being compared, or into the
+ * baseline with --record. Files holding a single run are also accepted.
+ *
+ * The frames of a scene, or the repetitions of a microbenchmark, are
+ * correlated within a process, so each run is reduced to one value per
+ * metric: the median of its samples. Timings are compared by the medians of
+ * the runs' values, and only count as regressions if they are also
+ * significantly slower according to a one-sided Mann-Whitney U test of the
+ * runs' values against the baseline's, so that noise doesn't fail the gate.
+ * Allocation counts are compared with the tolerance alone.
+ *
+ * The baselines depend on the machine and its drivers, so they're recorded on
+ * each machine running the tests (the update_perf_baselines target), and a
+ * missing baseline fails.
+ *
+ * Options:
+ *   --tolerance=T       Relative slowdown of the median times allowed (0.1 by default)
+ *   --load-tolerance=T  Relative slowdown of the load times allowed (0.25 by default)
+ *   --alpha=A           Significance level of the test (0.01 by default)
+ *   --runs=N            Runs of the command (5 by default)
+ *   --record            Writes the runs of the command to the baseline instead of comparing them
+ *
+ * Exits with 0 if nothing regressed, 1 if something did, 2 if the files or
+ * the command are invalid, and 3 if there's no baseline.
+ */
+
+constexpr int32_t EXIT_REGRESSED = 1;
+constexpr int32_t EXIT_INVALID = 2;
+constexpr int32_t EXIT_NO_BASELINE = 3;
+// The largest runs for which the test's exact distribution is computed, instead of its normal
+// approximation
+constexpr size_t MAX_EXACT_RUNS = 50;
+// Differences always allowed, as load times of a few milliseconds vary by as much
+constexpr double LOAD_SLACK_MILLISECONDS = 5.0;
+constexpr double ALLOCATION_SLACK = 0.5;
+
+struct Options {
+  double tolerance = 0.1;
+  double loadTolerance = 0.25;
+  double alpha = 0.01;
+  uint32_t runs = 5;
+  bool record = false;
+};
+
+enum class Verdict {
+  UNCHANGED,
+  IMPROVED,
+  REGRESSED,
+  // Changes that aren't regressions either way, e.g. draw calls
+  CHANGED,
+};
+
+struct Comparison {
+  std::string metric;
+  double baseline;
+  double result;
+  Verdict verdict;
+  // E.g. the test's p-value
+  std::string detail;
+};
+
+double median(std::vector<double> values) {
+  if (values.empty()) {
+    return 0.0;
+  }
+
+  std::sort(values.begin(), values.end());
+  size_t middle = values.size() / 2;
+  return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+// The number of ways of choosing k of n values
+double binomial(size_t n, size_t k) {
+  double result = 1.0;
+
+  for (size_t i = 1; i <= k; i++) {
+    result = result * (double) (n - k + i) / (double) i;
+  }
+
+  return result;
+}
+
+/**
+ * The exact probability of the Mann-Whitney U statistic being at least u,
+ * without ties.
+ *
+ * @param n1 The size of the sample U is computed for
+ * @param n2 The size of the other sample
+ */
+double exactMannWhitneyPValue(double u, size_t n1, size_t n2) {
+  // counts[j][k]: the orderings of i values of the first sample and j of the second with U = k,
+  // for i going from 0 to n1
+  size_t maxU = n1 * n2;
+  std::vector<std::vector<double>> counts(n2 + 1, std::vector<double>(maxU + 1, 0.0));
+
+  for (size_t j = 0; j <= n2; j++) {
+    counts[j][0] = 1.0;
+  }
+
+  for (size_t i = 1; i <= n1; i++) {
+    std::vector<std::vector<double>> next(n2 + 1, std::vector<double>(maxU + 1, 0.0));
+
+    // The largest value is either from the first sample, exceeding the j others, or not
+    for (size_t j = 0; j <= n2; j++) {
+      for (size_t k = 0; k <= maxU; k++) {
+        next[j][k] = (k >= j ? counts[j][k - j] : 0.0) + (j > 0 ? next[j - 1][k] : 0.0);
+      }
+    }
+
+    counts = std::move(next);
+  }
+
+  double atLeast = 0.0;
+
+  for (size_t k = (size_t) std::ceil(u); k <= maxU; k++) {
+    atLeast += counts[n2][k];
+  }
+
+  return atLeast / binomial(n1 + n2, n1);
+}
+
+/**
+ * One-sided Mann-Whitney U test: exact for small samples without ties, with
+ * the normal approximation and a correction for ties otherwise.
+ *
+ * @return The probability of the samples being at least this much larger than the baseline's if
+ *         they came from the same distribution
+ */
+double mannWhitneyPValue(const std::vector<double> &samples, const std::vector<double> &baseline) {
+  std::vector<std::pair<double, bool>> values;
+
+  for (double value : samples) {
+    values.emplace_back(value, true);
+  }
+
+  for (double value : baseline) {
+    values.emplace_back(value, false);
+  }
+
+  std::sort(values.begin(), values.end());
+
+  // Tied values share the average of their ranks
+  double n = (double) values.size();
+  double rankSum = 0.0;
+  double tieCorrection = 0.0;
+
+  for (size_t i = 0; i < values.size();) {
+    size_t end = i;
+
+    while (end < values.size() && values[end].first == values[i].first) {
+      end++;
+    }
+
+    double rank = (double) (i + 1 + end) / 2.0;
+    double ties = (double) (end - i);
+    tieCorrection += ties * ties * ties - ties;
+
+    for (size_t j = i; j < end; j++) {
+      if (values[j].second) {
+        rankSum += rank;
+      }
+    }
+
+    i = end;
+  }
+
+  double n1 = (double) samples.size();
+  double n2 = (double) baseline.size();
+  double u = rankSum - n1 * (n1 + 1.0) / 2.0;
+
+  if (tieCorrection == 0.0 && samples.size() <= MAX_EXACT_RUNS &&
+      baseline.size() <= MAX_EXACT_RUNS) {
+    return exactMannWhitneyPValue(u, samples.size(), baseline.size());
+  }
+
+  double mean = n1 * n2 / 2.0;
+  double variance = n1 * n2 / 12.0 * ((n + 1.0) - tieCorrection / (n * (n - 1.0)));
+
+  // Every value is the same
+  if (variance <= 0.0) {
+    return 1.0;
+  }
+
+  // With a continuity correction
+  double z = (u - mean - 0.5) / std::sqrt(variance);
+  return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+/**
+ * Compares timings, larger being worse.
+ *
+ * @param metric The timings' name
+ * @param baseline The baseline's runs, one value each
+ * @param runs The results' runs, one value each
+ * @param tolerance The relative slowdown allowed
+ * @param slack The absolute slowdown allowed
+ */
+Comparison compareRuns(const std::string &metric, const std::vector<double> &baseline,
+                       const std::vector<double> &runs, double tolerance, double slack,
+                       const Options &options) {
+  Comparison comparison = {metric, median(baseline), median(runs), Verdict::UNCHANGED, ""};
+  bool slower = comparison.result > comparison.baseline * (1.0 + tolerance) + slack;
+  bool faster = comparison.result < comparison.baseline * (1.0 - tolerance) - slack;
+
+  // With too few runs, even the most extreme ordering isn't significant and the medians decide
+  // alone, e.g. with 3 runs on each side, whose smallest p-value is 1/20
+  if (1.0 / binomial(baseline.size() + runs.size(), runs.size()) < options.alpha) {
+    double slowerP = mannWhitneyPValue(runs, baseline);
+    double fasterP = mannWhitneyPValue(baseline, runs);
+    slower = slower && slowerP < options.alpha;
+    faster = faster && fasterP < options.alpha;
+
+    char detail[32];
+    std::snprintf(detail, sizeof(detail), "p=%.2g",
+                  comparison.result >= comparison.baseline ? slowerP : fasterP);
+    comparison.detail = detail;
+  }
+
+  if (slower) {
+    comparison.verdict = Verdict::REGRESSED;
+  } else if (faster) {
+    comparison.verdict = Verdict::IMPROVED;
+  }
+
+  return comparison;
+}
+
+/**
+ * Compares single values, larger being worse.
+ *
+ * @param tolerance The relative difference allowed
+ * @param slack The absolute difference allowed
+ */
+Comparison compareValues(const std::string &metric, double baseline, double result,
+                         double tolerance, double slack) {
+  Comparison comparison = {metric, baseline, result, Verdict::UNCHANGED, ""};
+
+  if (result > baseline * (1.0 + tolerance) + slack) {
+    comparison.verdict = Verdict::REGRESSED;
+  } else if (result < baseline * (1.0 - tolerance) - slack) {
+    comparison.verdict = Verdict::IMPROVED;
+  }
+
+  return comparison;
+}
+
+// Reports any change of values that are neither better nor worse, e.g. draw calls
+Comparison compareCounts(const std::string &metric, double baseline, double result) {
+  Verdict verdict = std::abs(result - baseline) > 0.5 ? Verdict::CHANGED : Verdict::UNCHANGED;
+  return {metric, baseline, result, verdict, ""};
+}
+
+// The runs of an entry, e.g. a scene, from the runs having it
+using EntryRuns = std::vector<const JsonValue *>;
+
+/**
+ * Reduces each run of an entry to a single value, skipping the runs without it.
+ *
+ * @param field The entry's value: a number, or an array of samples reduced to their median
+ */
+template <typename Field>
+std::vector<double> runValues(const EntryRuns &entries, Field field) {
+  std::vector<double> values;
+
+  for (const JsonValue *entry : entries) {
+    const JsonValue &value = field(*entry);
+
+    if (value.type == JsonValue::Type::NUMBER) {
+      values.push_back(value.number);
+    } else if (value.type == JsonValue::Type::ARRAY && !value.asNumbers().empty()) {
+      values.push_back(median(value.asNumbers()));
+    }
+  }
+
+  return values;
+}
+
+std::vector<Comparison> compareScenes(const EntryRuns &baseline, const EntryRuns &result,
+                                      const Options &options) {
+  std::vector<Comparison> comparisons;
+  const std::string &baselineRenderer = (*baseline[0])["renderer"].string;
+  const std::string &renderer = (*result[0])["renderer"].string;
+
+  // Timings from different GPUs or drivers can't be compared
+  if (baselineRenderer == renderer) {
+    for (const char *metric : {"cpu_ms", "frame_ms", "gpu_ms"}) {
+      auto samples = [&](const JsonValue &scene) -> const JsonValue & {
+        return scene["samples"][metric];
+      };
+      std::vector<double> baselineRuns = runValues(baseline, samples);
+      std::vector<double> runs = runValues(result, samples);
+
+      if (!baselineRuns.empty() && !runs.empty()) {
+        comparisons.push_back(compareRuns(metric, baselineRuns, runs, options.tolerance, 0.0,
+                                          options));
+      }
+    }
+
+    auto load = [](const JsonValue &scene) -> const JsonValue & {
+      return scene["load_ms"];
+    };
+    std::vector<double> baselineLoads = runValues(baseline, load);
+    std::vector<double> loads = runValues(result, load);
+
+    if (!baselineLoads.empty() && !loads.empty()) {
+      comparisons.push_back(compareRuns("load_ms", baselineLoads, loads, options.loadTolerance,
+                                        LOAD_SLACK_MILLISECONDS, options));
+    }
+  } else {
+    std::cout << "  Renderer changed from \"" << baselineRenderer << "\" to \"" << renderer
+              << "\", only comparing the counts." << std::endl;
+  }
+
+  auto allocations = [](const JsonValue &scene) -> const JsonValue & {
+    return scene["allocations"]["mean"];
+  };
+  std::vector<double> baselineAllocations = runValues(baseline, allocations);
+  std::vector<double> resultAllocations = runValues(result, allocations);
+
+  if (!baselineAllocations.empty() && !resultAllocations.empty()) {
+    comparisons.push_back(compareValues("allocations", median(baselineAllocations),
+                                        median(resultAllocations), options.tolerance,
+                                        ALLOCATION_SLACK));
+  }
+
+  for (const char *metric : {"draw_calls", "triangles"}) {
+    auto count = [&](const JsonValue &scene) -> const JsonValue & {
+      return scene[metric]["mean"];
+    };
+    comparisons.push_back(compareCounts(metric, median(runValues(baseline, count)),
+                                        median(runValues(result, count))));
+  }
+
+  return comparisons;
+}
+
+std::vector<Comparison> compareMicrobenchmarks(const EntryRuns &baseline, const EntryRuns &result,
+                                               const Options &options) {
+  std::vector<Comparison> comparisons;
+  auto samples = [](const JsonValue &benchmark) -> const JsonValue & {
+    return benchmark["samples_ns"];
+  };
+  comparisons.push_back(compareRuns("ns", runValues(baseline, samples), runValues(result, samples),
+                                    options.tolerance, 0.0, options));
+
+  auto allocations = [](const JsonValue &benchmark) -> const JsonValue & {
+    return benchmark["allocations"];
+  };
+  std::vector<double> baselineAllocations = runValues(baseline, allocations);
+  std::vector<double> resultAllocations = runValues(result, allocations);
+
+  if (!baselineAllocations.empty() && !resultAllocations.empty()) {
+    comparisons.push_back(compareValues("allocations", median(baselineAllocations),
+                                        median(resultAllocations), options.tolerance,
+                                        ALLOCATION_SLACK));
+  }
+
+  return comparisons;
+}
+
+const char *verdictLabel(Verdict verdict) {
+  switch (verdict) {
+    case Verdict::IMPROVED:
+      return "improved";
+    case Verdict::REGRESSED:
+      return "REGRESSED";
+    case Verdict::CHANGED:
+      return "changed";
+    default:
+      return "";
+  }
+}
+
+// The runs of a results file: the elements of its "runs" array, or the file itself for a single run
+std::vector<const JsonValue *> runsOf(const JsonValue &file) {
+  std::vector<const JsonValue *> runs;
+
+  if (file["runs"].type == JsonValue::Type::ARRAY) {
+    for (const JsonValue &run : file["runs"].elements) {
+      runs.push_back(&run);
+    }
+  } else {
+    runs.push_back(&file);
+  }
+
+  return runs;
+}
+
+// The entry named name of the given kind in each run having it
+EntryRuns entryRuns(const std::vector<const JsonValue *> &runs, const char *kind,
+                    const std::string &name) {
+  EntryRuns entries;
+
+  for (const JsonValue *run : runs) {
+    for (const JsonValue &entry : (*run)[kind].elements) {
+      if (entry["name"].string == name) {
+        entries.push_back(&entry);
+        break;
+      }
+    }
+  }
+
+  return entries;
+}
+
+/**
+ * Compares the entries of an array of the results, e.g. the scenes, with the
+ * baseline's, and prints the differences.
+ *
+ * @param kind The entries' kind, e.g. "scenes"
+ * @param compare Compares the runs of an entry with the baseline's
+ * @return The number of regressions
+ */
+template <typename Compare>
+uint32_t compareEntries(const std::vector<const JsonValue *> &baseline,
+                        const std::vector<const JsonValue *> &results, const char *kind,
+                        Compare compare) {
+  uint32_t regressions = 0;
+
+  for (const JsonValue &baselineEntry : (*baseline[0])[kind].elements) {
+    const std::string &name = baselineEntry["name"].string;
+    EntryRuns resultRuns = entryRuns(results, kind, name);
+    std::cout << name << std::endl;
+
+    if (resultRuns.empty()) {
+      std::cout << "  REGRESSED: missing from the results" << std::endl;
+      regressions++;
+      continue;
+    }
+
+    for (const Comparison &comparison : compare(entryRuns(baseline, kind, name), resultRuns)) {
+      double change = comparison.baseline != 0.0
+                          ? (comparison.result / comparison.baseline - 1.0) * 100.0
+                          : 0.0;
+      std::printf("  %-12s %14.4f -> %14.4f %+8.1f%% %-8s %s\n", comparison.metric.c_str(),
+                  comparison.baseline, comparison.result, change, comparison.detail.c_str(),
+                  verdictLabel(comparison.verdict));
+
+      if (comparison.verdict == Verdict::REGRESSED) {
+        regressions++;
+      }
+    }
+  }
+
+  for (const JsonValue &entry : (*results[0])[kind].elements) {
+    if (entryRuns(baseline, kind, entry["name"].string).empty()) {
+      std::cout << entry["name"].string << "\n  Not in the baseline yet" << std::endl;
+    }
+  }
+
+  return regressions;
+}
+
+/**
+ * Runs the command several times, each run writing its results to the same
+ * file, and gathers the runs into a single document.
+ *
+ * @param resultsPath The file the command writes its results to
+ * @param gathered Receives the runs, as {"runs": [...]}
+ * @return Whether every run succeeded
+ */
+bool runCommand(const std::string &command, const std::string &resultsPath, uint32_t runs,
+                std::string &gathered) {
+  gathered = "{\"runs\": [\n";
+
+  for (uint32_t run = 0; run < runs; run++) {
+    std::cout << "Run " << run + 1 << " of " << runs << std::endl;
+    std::remove(resultsPath.c_str());
+
+    if (std::system(command.c_str()) != 0) {
+      std::cout << "ERROR: Failed to run " << command << "." << std::endl;
+      return false;
+    }
+
+    std::ifstream file(resultsPath);
+    std::stringstream text;
+    text << file.rdbuf();
+    std::string error;
+
+    if (JsonValue::parse(text.str(), error).isNull()) {
+      std::cout << "ERROR: Failed to read the results of " << command << " (" << error << ")."
+                << std::endl;
+      return false;
+    }
+
+    gathered += text.str() + (run + 1 < runs ? ",\n" : "]}\n");
+  }
+
+  return true;
+}
+
+bool writeFile(const std::string &path, const std::string &text) {
+  std::ofstream file(path);
+  file << text;
+  return (bool) file;
+}
+
+// Quotes an argument for the shell running the command
+std::string quote(const std::string &argument) {
+#ifdef _WIN32
+  return "\"" + argument + "\"";
+#else
+  std::string quoted = "'";
+
+  for (char c : argument) {
+    quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+  }
+
+  return quoted + "'";
+#endif
+}
+
+bool parseOption(const std::string &argument, const char *name, double &value) {
+  std::string prefix = std::string(name) + "=";
+
+  if (argument.compare(0, prefix.size(), prefix) != 0) {
+    return false;
+  }
+
+  value = std::atof(argument.c_str() + prefix.size());
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  Options options;
+  std::vector<std::string> paths;
+  std::string command;
+  double runs = options.runs;
+
+  for (int32_t i = 1; i < argc; i++) {
+    std::string argument = argv[i];
+
+    if (argument == "--") {
+      for (int32_t j = i + 1; j < argc; j++) {
+        command += (command.empty() ? "" : " ") + quote(argv[j]);
+      }
+
+      break;
+    }
+
+    if (argument == "--record") {
+      options.record = true;
+    } else if (!parseOption(argument, "--tolerance", options.tolerance) &&
+               !parseOption(argument, "--load-tolerance", options.loadTolerance) &&
+               !parseOption(argument, "--alpha", options.alpha) &&
+               !parseOption(argument, "--runs", runs)) {
+      paths.push_back(argument);
+    }
+  }
+
+  options.runs = (uint32_t) std::max(runs, 1.0);
+
+  if (paths.size() != 2 || (options.record && command.empty())) {
+    std::cout << "Usage: PerfGate [--tolerance=T] [--load-tolerance=T] [--alpha=A] [--runs=N] "
+                 "baseline.json results.json [-- command...]\n"
+                 "       PerfGate --record [--runs=N] baseline.json results.json -- command..."
+              << std::endl;
+    return EXIT_INVALID;
+  }
+
+  std::string error;
+  JsonValue baseline;
+
+  if (!options.record) {
+    baseline = JsonValue::parseFile(paths[0], error);
+
+    if (baseline.isNull()) {
+      std::cout << "ERROR: No baseline to compare with (" << error << "). The baselines depend "
+                   "on the machine: record them on this one with the update_perf_baselines "
+                   "target." << std::endl;
+      return EXIT_NO_BASELINE;
+    }
+  }
+
+  if (!command.empty()) {
+    std::string gathered;
+
+    if (!runCommand(command, paths[1], options.runs, gathered) ||
+        !writeFile(options.record ? paths[0] : paths[1], gathered)) {
+      return EXIT_INVALID;
+    }
+
+    if (options.record) {
+      std::cout << "Baseline of " << options.runs << " runs written to " << paths[0] << "."
+                << std::endl;
+      return 0;
+    }
+  }
+
+  JsonValue results = JsonValue::parseFile(paths[1], error);
+
+  if (results.isNull()) {
+    std::cout << "ERROR: Failed to read the results (" << error << ")." << std::endl;
+    return EXIT_INVALID;
+  }
+
+  std::vector<const JsonValue *> baselineRuns = runsOf(baseline);
+  std::vector<const JsonValue *> resultRuns = runsOf(results);
+
+  if (baselineRuns.empty() || resultRuns.empty()) {
+    std::cout << "ERROR: No runs to compare." << std::endl;
+    return EXIT_INVALID;
+  }
+
+  uint32_t regressions =
+      compareEntries(baselineRuns, resultRuns, "scenes",
+                     [&](const EntryRuns &baselineScene, const EntryRuns &scene) {
+                       return compareScenes(baselineScene, scene, options);
+                     }) +
+      compareEntries(baselineRuns, resultRuns, "microbenchmarks",
+                     [&](const EntryRuns &baselineBenchmark, const EntryRuns &benchmark) {
+                       return compareMicrobenchmarks(baselineBenchmark, benchmark, options);
+                     });
+
+  if (regressions > 0) {
+    std::cout << "\n" << regressions << " regression(s) compared with " << paths[0] << "."
+              << std::endl;
+    return EXIT_REGRESSED;
+  }
+
+  std::cout << "\nNo regressions compared with " << paths[0] << "." << std::endl;
+  return 0;
+}
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Bounds.hpp"
+#include "Culling.hpp"
+#include "Frustum.hpp"
+#include "Shader.hpp"
+
+// Cube map arrays are core in OpenGL 4.0, and available in 3.3 contexts through
+// ARB_texture_cube_map_array
+#ifndef GL_TEXTURE_CUBE_MAP_ARRAY
+#define GL_TEXTURE_CUBE_MAP_ARRAY 0x9009
+#endif
+
+/**
+ * Omnidirectional shadow maps for point lights, stored in a cube map array with
+ * one cube map per light, so that a shader can sample the shadows of any
+ * number of lights through a single sampler.
+ *
+ * Each light's cube map is rendered in a single pass: every caster is drawn
+ * once, and a geometry shader copies its triangles to the layers of the cube
+ * faces it was found visible in, after culling it against each face's frustum
+ * on the CPU.
+ *
+ * The depth is stored as the faces' perspective depth, which the lighting
+ * shaders recompute from the major axis of the light-to-fragment vector, so
+ * that the casters can use the fixed-function depth output and polygon offset.
+ */
+class PointShadowMaps {
+public:
+  static constexpr uint32_t FACES = 6;
+
+  /**
+   * A caster to draw, and the cube faces it is visible in.
+   */
+  struct CasterDraw {
+    uint32_t caster;
+    // Bit i is set if the caster is visible in face i (+X, -X, +Y, -Y, +Z, -Z)
+    int32_t faceMask;
+  };
+
+  uint32_t lights;
+  int32_t size;
+  // The near plane distance of every face's projection
+  float near;
+
+  /**
+   * @param lights The number of cube maps in the array
+   * @param size The width and height of each cube face
+   * @param near The distance from the light within which casters are ignored
+   */
+  explicit PointShadowMaps(uint32_t lights, int32_t size = 512, float near = 0.05f)
+      : lights(lights),
+        size(size),
+        near(near),
+        casterShader(Shader("../resources/shaders/cascade_shadow.vertex.glsl",
+                            "../resources/shaders/point_shadow.geometry.glsl",
+                            "../resources/shaders/depth_prepass.fragment.glsl", "")) {
+    glGenTextures(1, &depthArray);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, depthArray);
+    // Layer-faces are ordered by cube map, then by face
+    glTexImage3D(GL_TEXTURE_CUBE_MAP_ARRAY, 0, GL_DEPTH_COMPONENT24, size, size,
+                 (GLsizei) (lights * FACES), 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    // Sampled with hardware depth comparisons, which are bilinearly filtered
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP_ARRAY, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, 0);
+
+    // Attaching the whole array makes the framebuffer layered, the geometry shader selects the
+    // layer-face of each primitive
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthArray, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cout << "ERROR: The point shadow map framebuffer is incomplete." << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  /**
+   * @return Whether the current context supports cube map arrays, which must
+   *         be checked before creating point shadow maps
+   */
+  static bool isSupported() {
+    int32_t major = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+
+    if (major >= 4) {
+      return true;
+    }
+
+    int32_t extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+
+    for (int32_t i = 0; i < extensions; i++) {
+      const char *name = (const char *) glGetStringi(GL_EXTENSIONS, (GLuint) i);
+
+      if (std::strcmp(name, "GL_ARB_texture_cube_map_array") == 0) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  /**
+   * Binds and clears every cube map, before rendering the lights' shadows with
+   * renderLight().
+   */
+  void begin() {
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, size, size);
+    glDepthMask(GL_TRUE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    // Slope-scaled bias, pushing the casters' depth back to avoid self-shadowing artifacts
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+    casterShader.use();
+  }
+
+  /**
+   * Culls the casters against each face of a light's cube map, and prepares the
+   * caster shader to render them into it. Its "model" and "faceMask" uniforms
+   * must then be set for each caster drawn (see draws()).
+   *
+   * @param light The index of the light's cube map
+   * @param position The light's position
+   * @param far The light's influence radius, beyond which no shadows are cast
+   * @param casterBounds The world-space bounding box of each caster
+   * @return The shader to draw the casters with
+   */
+  Shader &renderLight(uint32_t light, const glm::vec3 &position, float far,
+                      const std::vector<AABB> &casterBounds) {
+    // The faces' orientations expected by cube map sampling
+    static const glm::vec3 directions[FACES] = {
+        glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+        glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+    };
+    static const glm::vec3 ups[FACES] = {
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+        glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+    };
+
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, near, far);
+    casterBatch.clear();
+
+    for (const AABB &bounds : casterBounds) {
+      casterBatch.add(bounds);
+    }
+
+    casterMasks.assign(casterBounds.size(), 0);
+
+    for (uint32_t face = 0; face < FACES; face++) {
+      glm::mat4 faceSpace = projection * glm::lookAt(position, position + directions[face],
+                                                     ups[face]);
+      casterShader.setMat4("faceSpaces[" + std::to_string(face) + "]", faceSpace);
+      casterBatch.cull(Frustum(faceSpace), visibleCasters);
+
+      for (uint32_t caster : visibleCasters) {
+        casterMasks[caster] |= 1 << face;
+      }
+    }
+
+    casterDraws.clear();
+
+    for (uint32_t caster = 0; caster < (uint32_t) casterMasks.size(); caster++) {
+      if (casterMasks[caster] != 0) {
+        casterDraws.push_back({caster, casterMasks[caster]});
+      }
+    }
+
+    casterShader.setInt("firstLayer", (int32_t) (light * FACES));
+    return casterShader;
+  }
+
+  // The casters to draw for the last light passed to renderLight(), in the order they were given
+  const std::vector<CasterDraw> &draws() const {
+    return casterDraws;
+  }
+
+  // Restores the default framebuffer and the viewport
+  void end() {
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  }
+
+  /**
+   * Sets the uniforms shared by every light in the lighting shaders' point
+   * shadow sampling code, and binds the cube map array. Each light's far
+   * distance and cube map index must be set by the caller.
+   *
+   * @param shader The lighting shader, which must be bound
+   * @param unit The texture unit to bind the cube map array to
+   */
+  void setUniforms(Shader &shader, int32_t unit) {
+    shader.setFloat("pointShadowNear", near);
+    shader.setInt("pointShadowMaps", unit);
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_CUBE_MAP_ARRAY, depthArray);
+  }
+
+  // The directives the lighting shaders must be compiled with
+  static std::string defines() {
+    return "#extension GL_ARB_texture_cube_map_array : enable\n#define POINT_SHADOWS\n";
+  }
+
+private:
+  Shader casterShader;
+  uint32_t fbo, depthArray;
+  int32_t viewport[4];
+
+  BoundsBatch casterBatch;
+  std::vector<uint32_t> visibleCasters;
+  std::vector<int32_t> casterMasks;
+  std::vector<CasterDraw> casterDraws;
+};
@@ -0,0 +1,579 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "GpuProfiler.hpp"
+
+/**
+ * The size and format of a render graph texture.
+ */
+struct TextureDesc {
+  int32_t width;
+  int32_t height;
+  // A sized internal format, e.g. GL_RGBA8 or GL_DEPTH24_STENCIL8
+  GLenum internalFormat;
+
+  bool operator==(const TextureDesc &other) const {
+    return width == other.width && height == other.height &&
+           internalFormat == other.internalFormat;
+  }
+};
+
+/**
+ * A declarative description of a frame: passes declare the textures they read
+ * and write, and the graph works out the rest.
+ *
+ * The graph is rebuilt every frame: reset(), then createTexture() and
+ * addPass() for each resource and pass, then compile() and execute().
+ * Compiling:
+ *
+ * - Links each read to the last pass declared before the reader that writes
+ *   the texture, and checks that such a pass exists. Passes execute in the
+ *   order they were declared, which is therefore a valid execution order.
+ * - Culls the passes whose outputs never reach the backbuffer, following
+ *   those links backwards from the passes writing it.
+ * - Computes the lifetime of each transient texture, from the first to the
+ *   last remaining pass using it, and assigns it a texture from a pool kept
+ *   across frames. Textures with the same size and format whose lifetimes
+ *   don't overlap share the same pool texture, the OpenGL equivalent of
+ *   aliasing their memory.
+ *
+ * Executing binds a framebuffer with each pass' outputs attached (depth
+ * formats to the depth attachment, others to the color attachments in order),
+ * sets the viewport to their size, and calls the pass. Passes clear their
+ * outputs themselves if needed, as aliased textures keep the contents of
+ * whichever texture last used them.
+ */
+class RenderGraph {
+public:
+  using Execute = std::function<void(RenderGraph &graph)>;
+
+  RenderGraph() = default;
+  RenderGraph(const RenderGraph &) = delete;
+  RenderGraph &operator=(const RenderGraph &) = delete;
+
+  ~RenderGraph() {
+    for (const PooledTexture &pooled : pool) {
+      glDeleteTextures(1, &pooled.texture);
+    }
+
+    for (const auto &entry : framebuffers) {
+      glDeleteFramebuffers(1, &entry.second);
+    }
+  }
+
+  // Times each pass executed from now on in a scope named after it, until set to null
+  void setProfiler(GpuProfiler *profiler) {
+    this->profiler = profiler;
+  }
+
+  // Removes the passes and resources of the previous frame, keeping the texture pool
+  void reset() {
+    resources.clear();
+    passes.clear();
+    order.clear();
+    compiled = false;
+  }
+
+  /**
+   * Declares a transient texture, which only exists during the frame.
+   *
+   * @return The handle passes refer to the texture with
+   */
+  uint32_t createTexture(const std::string &name, const TextureDesc &desc) {
+    resources.push_back({name, desc, false});
+    return (uint32_t) resources.size() - 1;
+  }
+
+  /**
+   * Declares the default framebuffer. Passes writing it are the graph's roots,
+   * and are never culled.
+   */
+  uint32_t importBackbuffer(const std::string &name, int32_t width, int32_t height) {
+    resources.push_back({name, {width, height, GL_RGBA8}, true});
+    return (uint32_t) resources.size() - 1;
+  }
+
+  /**
+   * Declares a pass.
+   *
+   * @param inputs The textures the pass reads, which must be written by a
+   *               pass declared before it
+   * @param outputs The textures the pass renders into. A texture both read
+   *                and written, e.g. a depth buffer tested against, is listed
+   *                in both.
+   * @param execute Issues the pass' commands, with its framebuffer bound
+   */
+  void addPass(const std::string &name, const std::vector<uint32_t> &inputs,
+               const std::vector<uint32_t> &outputs, Execute execute) {
+    passes.push_back({name, inputs, outputs, std::move(execute)});
+  }
+
+  /**
+   * Links, culls and allocates the passes and textures declared since reset().
+   *
+   * @return Whether the graph is valid, otherwise the errors are printed and
+   *         execute() does nothing
+   */
+  bool compile() {
+    bool valid = true;
+
+    // Link each read to its writer
+    std::vector<int32_t> lastWriter(resources.size(), -1);
+
+    for (uint32_t pass = 0; pass < (uint32_t) passes.size(); pass++) {
+      Pass &current = passes[pass];
+      current.dependencies.clear();
+
+      for (uint32_t resource : current.inputs) {
+        if (lastWriter[resource] < 0) {
+          std::cout << "ERROR: The render graph pass \"" << current.name << "\" reads \""
+                    << resources[resource].name << "\", which no earlier pass writes."
+                    << std::endl;
+          valid = false;
+          continue;
+        }
+
+        current.dependencies.push_back((uint32_t) lastWriter[resource]);
+      }
+
+      for (uint32_t resource : current.outputs) {
+        lastWriter[resource] = (int32_t) pass;
+      }
+    }
+
+    if (!valid) {
+      return false;
+    }
+
+    // Keep the passes leading to the backbuffer, walking the links backwards from the last pass
+    for (Pass &pass : passes) {
+      pass.culled = true;
+    }
+
+    for (int32_t pass = (int32_t) passes.size() - 1; pass >= 0; pass--) {
+      Pass &current = passes[pass];
+      bool root = std::any_of(current.outputs.begin(), current.outputs.end(),
+                              [&](uint32_t resource) { return resources[resource].imported; });
+
+      if (root) {
+        current.culled = false;
+      }
+
+      if (!current.culled) {
+        for (uint32_t dependency : current.dependencies) {
+          passes[dependency].culled = false;
+        }
+      }
+    }
+
+    order.clear();
+
+    for (uint32_t pass = 0; pass < (uint32_t) passes.size(); pass++) {
+      if (!passes[pass].culled) {
+        order.push_back(pass);
+      }
+    }
+
+    // Lifetimes, as indices into the execution order
+    for (Resource &resource : resources) {
+      resource.firstUse = -1;
+      resource.lastUse = -1;
+      resource.pooled = -1;
+    }
+
+    for (uint32_t index = 0; index < (uint32_t) order.size(); index++) {
+      const Pass &pass = passes[order[index]];
+
+      for (const std::vector<uint32_t> *list : {&pass.inputs, &pass.outputs}) {
+        for (uint32_t resource : *list) {
+          Resource &used = resources[resource];
+          used.firstUse = used.firstUse < 0 ? (int32_t) index : used.firstUse;
+          used.lastUse = (int32_t) index;
+        }
+      }
+    }
+
+    allocate();
+    compiled = true;
+    return true;
+  }
+
+  // Runs the passes that weren't culled, in order
+  void execute() {
+    if (!compiled) {
+      return;
+    }
+
+    for (uint32_t pass : order) {
+      Pass &current = passes[pass];
+      GpuProfiler::Scope scope(profiler, current.name.c_str());
+      bindOutputs(current.outputs);
+      current.execute(*this);
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  // The OpenGL texture assigned to a transient texture, valid from compile() until the next reset()
+  uint32_t texture(uint32_t resource) const {
+    return pool[resources[resource].pooled].texture;
+  }
+
+  void bindTexture(uint32_t resource, int32_t unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, texture(resource));
+  }
+
+  /**
+   * Copies a texture into another (or the backbuffer), scaled to its size.
+   * The pass must declare the source as an input and the destination as an
+   * output.
+   */
+  void blit(uint32_t source, uint32_t destination, GLbitfield mask, GLenum filter) {
+    const TextureDesc &from = resources[source].desc;
+    const TextureDesc &to = resources[destination].desc;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer({source}));
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer({destination}));
+    glBlitFramebuffer(0, 0, from.width, from.height, 0, 0, to.width, to.height, mask, filter);
+  }
+
+  // A summary of the compiled graph: the execution order, the culled passes and the memory used
+  std::string dump() const {
+    std::string text = "Render graph: " + std::to_string(order.size()) + " of " +
+                       std::to_string(passes.size()) + " passes, " +
+                       std::to_string(resources.size()) + " resources\n";
+    char line[160];
+
+    for (uint32_t index = 0; index < (uint32_t) order.size(); index++) {
+      const Pass &pass = passes[order[index]];
+      snprintf(line, sizeof(line), "  %u. %-16s reads: %s, writes: %s\n", index,
+               pass.name.c_str(), names(pass.inputs).c_str(), names(pass.outputs).c_str());
+      text += line;
+    }
+
+    for (const Pass &pass : passes) {
+      if (pass.culled) {
+        text += "  culled: " + pass.name + "\n";
+      }
+    }
+
+    size_t declared = 0;
+    size_t allocated = 0;
+    std::vector<bool> counted(pool.size(), false);
+
+    for (const Resource &resource : resources) {
+      if (resource.imported) {
+        continue;
+      }
+
+      size_t bytes = (size_t) resource.desc.width * (size_t) resource.desc.height *
+                     bytesPerPixel(resource.desc.internalFormat);
+
+      if (resource.pooled < 0) {
+        snprintf(line, sizeof(line), "  %-16s unused\n", resource.name.c_str());
+        text += line;
+        continue;
+      }
+
+      snprintf(line, sizeof(line), "  %-16s %dx%d %-8s %6.2f MiB, passes %d-%d, texture %d\n",
+               resource.name.c_str(), resource.desc.width, resource.desc.height,
+               formatName(resource.desc.internalFormat), (double) bytes / (1024.0 * 1024.0),
+               resource.firstUse, resource.lastUse, resource.pooled);
+      text += line;
+      declared += bytes;
+
+      if (!counted[resource.pooled]) {
+        counted[resource.pooled] = true;
+        allocated += bytes;
+      }
+    }
+
+    snprintf(line, sizeof(line), "Transient memory: %.2f MiB, %.2f MiB with aliasing\n",
+             (double) declared / (1024.0 * 1024.0), (double) allocated / (1024.0 * 1024.0));
+    return text + line;
+  }
+
+private:
+  // Pool textures unused for this many frames are deleted
+  static constexpr uint32_t FRAMES_BEFORE_EVICTION = 60;
+
+  struct Resource {
+    std::string name;
+    TextureDesc desc;
+    bool imported;
+    // Indices into the execution order, -1 if unused
+    int32_t firstUse = -1, lastUse = -1;
+    // Index into the pool, -1 if unused or imported
+    int32_t pooled = -1;
+  };
+
+  struct Pass {
+    std::string name;
+    std::vector<uint32_t> inputs, outputs;
+    Execute execute;
+    // The passes writing the inputs
+    std::vector<uint32_t> dependencies;
+    bool culled = false;
+  };
+
+  struct PooledTexture {
+    TextureDesc desc;
+    uint32_t texture;
+    // The last use of the texture in this frame's execution order, -1 if free
+    int32_t busyUntil;
+    uint32_t framesUnused;
+  };
+
+  std::vector<Resource> resources;
+  std::vector<Pass> passes;
+  std::vector<uint32_t> order;
+  bool compiled = false;
+  std::vector<PooledTexture> pool;
+  // Framebuffers by the textures attached to them, 0 standing for the backbuffer
+  std::map<std::vector<uint32_t>, uint32_t> framebuffers;
+  GpuProfiler *profiler = nullptr;
+
+  void allocate() {
+    for (PooledTexture &pooled : pool) {
+      pooled.busyUntil = -1;
+    }
+
+    // Greedy assignment in order of first use, which is optimal for intervals
+    std::vector<uint32_t> transients;
+
+    for (uint32_t resource = 0; resource < (uint32_t) resources.size(); resource++) {
+      if (!resources[resource].imported && resources[resource].firstUse >= 0) {
+        transients.push_back(resource);
+      }
+    }
+
+    std::stable_sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b) {
+      return resources[a].firstUse < resources[b].firstUse;
+    });
+
+    std::vector<bool> used(pool.size(), false);
+
+    for (uint32_t resource : transients) {
+      Resource &current = resources[resource];
+      int32_t match = -1;
+
+      for (uint32_t pooled = 0; pooled < (uint32_t) pool.size(); pooled++) {
+        if (pool[pooled].desc == current.desc && pool[pooled].busyUntil < current.firstUse) {
+          match = (int32_t) pooled;
+          break;
+        }
+      }
+
+      if (match < 0) {
+        pool.push_back({current.desc, createTexture(current.desc), -1, 0});
+        used.push_back(false);
+        match = (int32_t) pool.size() - 1;
+      }
+
+      pool[match].busyUntil = current.lastUse;
+      used[match] = true;
+      current.pooled = match;
+    }
+
+    // Evict the textures that haven't been needed for a while, e.g. after a resize
+    std::vector<uint32_t> remap(pool.size());
+    std::vector<PooledTexture> kept;
+
+    for (uint32_t pooled = 0; pooled < (uint32_t) pool.size(); pooled++) {
+      pool[pooled].framesUnused = used[pooled] ? 0 : pool[pooled].framesUnused + 1;
+
+      if (pool[pooled].framesUnused > FRAMES_BEFORE_EVICTION) {
+        forgetFramebuffers(pool[pooled].texture);
+        glDeleteTextures(1, &pool[pooled].texture);
+        continue;
+      }
+
+      remap[pooled] = (uint32_t) kept.size();
+      kept.push_back(pool[pooled]);
+    }
+
+    if (kept.size() != pool.size()) {
+      pool = std::move(kept);
+
+      for (Resource &resource : resources) {
+        resource.pooled = resource.pooled < 0 ? -1 : (int32_t) remap[resource.pooled];
+      }
+    }
+  }
+
+  static bool isDepthFormat(GLenum internalFormat) {
+    return internalFormat == GL_DEPTH_COMPONENT16 || internalFormat == GL_DEPTH_COMPONENT24 ||
+           internalFormat == GL_DEPTH_COMPONENT32F || internalFormat == GL_DEPTH24_STENCIL8 ||
+           internalFormat == GL_DEPTH32F_STENCIL8;
+  }
+
+  static bool hasStencil(GLenum internalFormat) {
+    return internalFormat == GL_DEPTH24_STENCIL8 || internalFormat == GL_DEPTH32F_STENCIL8;
+  }
+
+  static uint32_t createTexture(const TextureDesc &desc) {
+    // Any format and type compatible with the internal format, as no data is uploaded
+    GLenum format = hasStencil(desc.internalFormat) ? GL_DEPTH_STENCIL
+                    : isDepthFormat(desc.internalFormat) ? GL_DEPTH_COMPONENT
+                    : GL_RGBA;
+    GLenum type = desc.internalFormat == GL_DEPTH24_STENCIL8 ? GL_UNSIGNED_INT_24_8
+                  : desc.internalFormat == GL_DEPTH32F_STENCIL8
+                    ? GL_FLOAT_32_UNSIGNED_INT_24_8_REV
+                    : GL_FLOAT;
+
+    uint32_t texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, (GLint) desc.internalFormat, desc.width, desc.height, 0,
+                 format, type, nullptr);
+    // Render targets are read one texel per pixel
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+  }
+
+  // Binds the framebuffer rendering into the given resources, and sets the viewport to their size
+  void bindOutputs(const std::vector<uint32_t> &outputs) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer(outputs));
+
+    if (!outputs.empty()) {
+      const TextureDesc &desc = resources[outputs[0]].desc;
+      glViewport(0, 0, desc.width, desc.height);
+    }
+  }
+
+  uint32_t framebuffer(const std::vector<uint32_t> &attachments) {
+    std::vector<uint32_t> textures;
+
+    for (uint32_t resource : attachments) {
+      textures.push_back(resources[resource].imported ? 0 : texture(resource));
+    }
+
+    // The backbuffer can't be combined with textures
+    if (textures.empty() || textures[0] == 0) {
+      return 0;
+    }
+
+    auto found = framebuffers.find(textures);
+
+    if (found != framebuffers.end()) {
+      return found->second;
+    }
+
+    uint32_t fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    std::vector<GLenum> drawBuffers;
+
+    for (uint32_t resource : attachments) {
+      GLenum internalFormat = resources[resource].desc.internalFormat;
+      GLenum attachment;
+
+      if (isDepthFormat(internalFormat)) {
+        attachment = hasStencil(internalFormat) ? GL_DEPTH_STENCIL_ATTACHMENT
+                                                : GL_DEPTH_ATTACHMENT;
+      } else {
+        attachment = GL_COLOR_ATTACHMENT0 + (GLenum) drawBuffers.size();
+        drawBuffers.push_back(attachment);
+      }
+
+      glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture(resource), 0);
+    }
+
+    if (drawBuffers.empty()) {
+      glDrawBuffer(GL_NONE);
+      glReadBuffer(GL_NONE);
+    } else {
+      glDrawBuffers((GLsizei) drawBuffers.size(), drawBuffers.data());
+    }
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cout << "ERROR: A render graph framebuffer is incomplete." << std::endl;
+    }
+
+    framebuffers[textures] = fbo;
+    return fbo;
+  }
+
+  // Deletes the framebuffers a texture about to be deleted is attached to
+  void forgetFramebuffers(uint32_t texture) {
+    for (auto entry = framebuffers.begin(); entry != framebuffers.end();) {
+      if (std::find(entry->first.begin(), entry->first.end(), texture) != entry->first.end()) {
+        glDeleteFramebuffers(1, &entry->second);
+        entry = framebuffers.erase(entry);
+      } else {
+        ++entry;
+      }
+    }
+  }
+
+  std::string names(const std::vector<uint32_t> &list) const {
+    if (list.empty()) {
+      return "-";
+    }
+
+    std::string text;
+
+    for (uint32_t resource : list) {
+      text += (text.empty() ? "" : " ") + resources[resource].name;
+    }
+
+    return text;
+  }
+
+  static size_t bytesPerPixel(GLenum internalFormat) {
+    switch (internalFormat) {
+      case GL_R8:
+        return 1;
+      case GL_RG8:
+      case GL_R16F:
+      case GL_DEPTH_COMPONENT16:
+        return 2;
+      case GL_RGBA16F:
+      case GL_RG32F:
+      case GL_DEPTH32F_STENCIL8:
+        return 8;
+      case GL_RGBA32F:
+        return 16;
+      default:
+        // 8-bit RGBA, 32-bit single-channel and packed formats, and 24-bit depth (with or without
+        // stencil), which is padded to 32 bits
+        return 4;
+    }
+  }
+
+  static const char *formatName(GLenum internalFormat) {
+    switch (internalFormat) {
+      case GL_RGBA8:
+        return "RGBA8";
+      case GL_RGBA16F:
+        return "RGBA16F";
+      case GL_RGBA32F:
+        return "RGBA32F";
+      case GL_R8:
+        return "R8";
+      case GL_R16F:
+        return "R16F";
+      case GL_R32F:
+        return "R32F";
+      case GL_DEPTH_COMPONENT24:
+        return "D24";
+      case GL_DEPTH_COMPONENT32F:
+        return "D32F";
+      case GL_DEPTH24_STENCIL8:
+        return "D24S8";
+      default:
+        return "other";
+    }
+  }
+};
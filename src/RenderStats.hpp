@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Counts of the rendering work issued through Shader, Mesh and Model in the
+ * current frame, shown by the statistics overlay (see StatsOverlay.hpp).
+ * Calls made directly to OpenGL aren't counted.
+ */
+struct RenderStats {
+  uint64_t drawCalls = 0;
+  uint64_t triangles = 0;
+  // Shader::use() calls
+  uint64_t programBinds = 0;
+  uint64_t textureBinds = 0;
+  uint64_t vaoBinds = 0;
+  // Shader::set*() calls
+  uint64_t uniformUploads = 0;
+  // Model::draw() and drawDepth() calls
+  uint64_t modelDraws = 0;
+
+  void reset() {
+    *this = RenderStats();
+  }
+};
+
+inline RenderStats renderStats;
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "GL43.hpp"
+#include "GLCapture.hpp"
+#include "Window.hpp"
+
+/*
+ * Replays a capture of the OpenGL calls of a demo (see GLCapture.hpp) as fast
+ * as possible, and reports the throughput:
+ *
+ *   GL_CAPTURE=scene.glcapture GL_CAPTURE_FRAMES=50 ./ModelLoading
+ *   Replay scene.glcapture [loops]
+ *
+ * The setup calls are issued once, then the captured frames are issued loops
+ * times (1 by default), each followed by a buffer swap. The frames' time ends
+ * once the GPU has finished them. Runs headless with HEADLESS set, like the
+ * demos (see Window.hpp).
+ */
+
+int32_t main(int32_t argc, char **argv) {
+  if (argc < 2) {
+    std::cout << "Usage: Replay capture-file [loops]" << std::endl;
+    return 2;
+  }
+
+  std::unique_ptr<GlReplay> replay = GlReplay::load(argv[1]);
+
+  if (replay == nullptr) {
+    return 2;
+  }
+
+  uint32_t loops = argc > 2 ? (uint32_t) std::max(1, std::atoi(argv[2])) : 1;
+  const gl_capture_detail::Header &header = replay->header();
+  Window window(header.width, header.height, "Replay", header.majorVersion, header.minorVersion,
+                WindowMode::HIDDEN);
+
+  if (!window.isOpen()) {
+    return -1;
+  }
+
+  // The functions the demo may have loaded, which the replay checks before issuing them
+  if (header.majorVersion > 4 || (header.majorVersion == 4 && header.minorVersion >= 3)) {
+    loadGL43(window.procAddressLoader());
+  }
+
+  auto setupStart = std::chrono::steady_clock::now();
+  bool hasFrames = replay->replaySetup();
+  glFinish();
+  double setupMilliseconds = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - setupStart).count();
+  uint64_t setupCalls = replay->calls();
+  uint64_t setupBytes = replay->payloadBytes();
+
+  uint32_t frames = 0;
+  auto framesStart = std::chrono::steady_clock::now();
+
+  for (uint32_t loop = 0; loop < loops && hasFrames && replay->error().empty(); loop++) {
+    if (loop > 0) {
+      replay->rewind();
+    }
+
+    while (replay->replayFrame()) {
+      window.swapBuffers();
+      window.pollEvents();
+      frames++;
+    }
+  }
+
+  glFinish();
+  double frameMilliseconds = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - framesStart).count();
+
+  if (!replay->error().empty()) {
+    std::cout << "ERROR: " << replay->error() << std::endl;
+    return 1;
+  }
+
+  uint64_t frameCalls = replay->calls() - setupCalls;
+  double frameMegabytes = (double) (replay->payloadBytes() - setupBytes) / 1.0e6;
+  double seconds = std::max(frameMilliseconds, 1.0e-3) / 1.0e3;
+  char line[160];
+  snprintf(line, sizeof(line), "Replayed %s (%d x %d, OpenGL %d.%d)\n", argv[1], header.width,
+           header.height, header.majorVersion, header.minorVersion);
+  std::string text = line;
+  snprintf(line, sizeof(line), "  setup: %10.2f ms, %llu calls, %.1f MB of data\n",
+           setupMilliseconds, (unsigned long long) setupCalls,
+           (double) setupBytes / 1.0e6);
+  text += line;
+  snprintf(line, sizeof(line), "  frames: %9.2f ms for %u frames (%u per loop), %.3f ms per "
+                               "frame, %.1f frames/s\n",
+           frameMilliseconds, frames, header.frames, frameMilliseconds / std::max(frames, 1u),
+           (double) frames / seconds);
+  text += line;
+  snprintf(line, sizeof(line), "  %llu calls, %.0f calls/s, %.1f MB of data, %.1f MB/s\n",
+           (unsigned long long) frameCalls, (double) frameCalls / seconds, frameMegabytes,
+           frameMegabytes / seconds);
+  std::cout << text << line;
+  return 0;
+}
@@ -1,143 +1,224 @@
 #pragma once
 
 #include <fstream>
+#include <initializer_list>
 #include <iostream>
 #include <sstream>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "CpuProfiler.hpp"
+#include "GL43.hpp"
+#include "RenderStats.hpp"
+#include "StartupProfile.hpp"
 
 class Shader {
 public:
   uint32_t id;
 
   Shader(const GLchar *vertexPath, const GLchar *fragmentPath) {
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    // Ensure ifstream objects can throw exceptions
-    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-    fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-
-    try {
-      vShaderFile.open(vertexPath);
-      fShaderFile.open(fragmentPath);
-      std::stringstream vShaderStream, fShaderStream;
-      // Read file's buffer contents into streams
-      vShaderStream << vShaderFile.rdbuf();
-      fShaderStream << fShaderFile.rdbuf();
-      // Close file handles
-      fShaderFile.close();
-      vShaderFile.close();
-      // Convert streams into strings
-      vertexCode = vShaderStream.str();
-      fragmentCode = fShaderStream.str();
-    } catch (std::ifstream::failure &e) {
-      std::cout << "ERROR: Failed reading a shader file." << std::endl;
-    }
-
-    const char *vShaderCode = vertexCode.c_str();
-    const char *fShaderCode = fragmentCode.c_str();
-    uint32_t vertexShader, fragmentShader;
-    int32_t success;
-    char infoLog[512];
-
-    // Compile the vertex shader
-    vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vShaderCode, nullptr);
-    glCompileShader(vertexShader);
-
-    // Check for vertex shader compilation errors
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-
-    if (!success) {
-      glGetShaderInfoLog(vertexShader, 512, nullptr, infoLog);
-      std::cout << "ERROR: Failed compiling a vertex shader.\n       " << infoLog << std::endl;
-    }
-
-    // Compile the fragment shader
-    fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fShaderCode, nullptr);
-    glCompileShader(fragmentShader);
-
-    // Check for fragment shader compilation errors
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-
-    if (!success) {
-      glGetShaderInfoLog(fragmentShader, 512, nullptr, infoLog);
-      std::cout << "ERROR: Failed compiling a fragment shader.\n       " << infoLog << std::endl;
-    }
-
-    // Create the shader program
-    this->id = glCreateProgram();
-    glAttachShader(id, vertexShader);
-    glAttachShader(id, fragmentShader);
-    glLinkProgram(this->id);
+    CPU_PROFILE_SCOPE("Shader::Shader");
+    uint32_t vertexShader = compileShader(GL_VERTEX_SHADER, "vertex", readFile(vertexPath));
+    uint32_t fragmentShader = compileShader(GL_FRAGMENT_SHADER, "fragment",
+                                            readFile(fragmentPath));
+    linkProgram({vertexShader, fragmentShader});
+  }
 
-    // Check for shader program linking errors
-    glGetProgramiv(this->id, GL_LINK_STATUS, &success);
+  /**
+   * Creates a variant of a shader program, with preprocessor definitions
+   * inserted after the `#version` directive of both stages.
+   *
+   * @param defines Definitions such as "#define POINT_LIGHTS 2\n"
+   */
+  Shader(const GLchar *vertexPath, const GLchar *fragmentPath, const std::string &defines) {
+    CPU_PROFILE_SCOPE("Shader::Shader");
+    uint32_t vertexShader = compileShader(GL_VERTEX_SHADER, "vertex",
+                                          insertDefines(readFile(vertexPath), defines));
+    uint32_t fragmentShader = compileShader(GL_FRAGMENT_SHADER, "fragment",
+                                            insertDefines(readFile(fragmentPath), defines));
+    linkProgram({vertexShader, fragmentShader});
+  }
 
-    if (!success) {
-      glGetProgramInfoLog(this->id, 512, nullptr, infoLog);
-      std::cout << "ERROR: Failed linking a shader program.\n       " << infoLog << std::endl;
-    }
+  /**
+   * Creates a shader program with a geometry stage, with preprocessor
+   * definitions inserted after the `#version` directive of every stage.
+   *
+   * @param defines Definitions such as "#define CASCADES 4\n" (may be empty)
+   */
+  Shader(const GLchar *vertexPath, const GLchar *geometryPath, const GLchar *fragmentPath,
+         const std::string &defines) {
+    CPU_PROFILE_SCOPE("Shader::Shader");
+    uint32_t vertexShader = compileShader(GL_VERTEX_SHADER, "vertex",
+                                          insertDefines(readFile(vertexPath), defines));
+    uint32_t geometryShader = compileShader(GL_GEOMETRY_SHADER, "geometry",
+                                            insertDefines(readFile(geometryPath), defines));
+    uint32_t fragmentShader = compileShader(GL_FRAGMENT_SHADER, "fragment",
+                                            insertDefines(readFile(fragmentPath), defines));
+    linkProgram({vertexShader, geometryShader, fragmentShader});
+  }
 
-    // Delete shaders as they are now linked and no longer needed
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+  /**
+   * Creates a compute shader program. Requires an OpenGL 4.3 context and the
+   * functions loaded by loadGL43() (see GL43.hpp).
+   *
+   * @param computePath Path to the compute shader source
+   */
+  explicit Shader(const GLchar *computePath) {
+    CPU_PROFILE_SCOPE("Shader::Shader");
+    linkProgram({compileShader(GL_COMPUTE_SHADER, "compute", readFile(computePath))});
   }
 
   void use() {
+    renderStats.programBinds++;
     glUseProgram(this->id);
   }
 
   void setBool(const std::string &name, bool value) const {
+    renderStats.uniformUploads++;
     glUniform1i(glGetUniformLocation(this->id, name.c_str()), (int32_t) value);
   }
 
   void setInt(const std::string &name, int32_t value) const {
+    renderStats.uniformUploads++;
     glUniform1i(glGetUniformLocation(this->id, name.c_str()), value);
   }
 
+  // Sets the first count elements of an array of ints
+  void setInts(const std::string &name, const int32_t *values, int32_t count) const {
+    renderStats.uniformUploads++;
+    glUniform1iv(glGetUniformLocation(this->id, name.c_str()), count, values);
+  }
+
   void setFloat(const std::string &name, float_t value) const {
+    renderStats.uniformUploads++;
     glUniform1f(glGetUniformLocation(this->id, name.c_str()), value);
   }
 
   void setVec2(const std::string &name, glm::vec2 &value) const {
+    renderStats.uniformUploads++;
     glUniform2fv(glGetUniformLocation(this->id, name.c_str()), 1, &value[0]);
   }
 
   void setVec2(const std::string &name, float_t x, float_t y) const {
+    renderStats.uniformUploads++;
     glUniform2f(glGetUniformLocation(this->id, name.c_str()), x, y);
   }
 
   void setVec3(const std::string &name, glm::vec3 &value) const {
+    renderStats.uniformUploads++;
     glUniform3fv(glGetUniformLocation(this->id, name.c_str()), 1, &value[0]);
   }
 
   void setVec3(const std::string &name, float_t x, float_t y, float_t z) const {
+    renderStats.uniformUploads++;
     glUniform3f(glGetUniformLocation(this->id, name.c_str()), x, y, z);
   }
 
   void setVec4(const std::string &name, glm::vec4 &value) const {
+    renderStats.uniformUploads++;
     glUniform4fv(glGetUniformLocation(this->id, name.c_str()), 1, &value[0]);
   }
 
   void setVec4(const std::string &name, float_t x, float_t y, float_t z, float_t w) const {
+    renderStats.uniformUploads++;
     glUniform4f(glGetUniformLocation(this->id, name.c_str()), x, y, z, w);
   }
 
   void setMat2(const std::string &name, glm::mat2 &matrix) const {
+    renderStats.uniformUploads++;
     glUniformMatrix2fv(glGetUniformLocation(this->id, name.c_str()), 1, GL_FALSE, &matrix[0][0]);
   }
 
   void setMat3(const std::string &name, glm::mat3 &matrix) const {
+    renderStats.uniformUploads++;
     glUniformMatrix3fv(glGetUniformLocation(this->id, name.c_str()), 1, GL_FALSE, &matrix[0][0]);
   }
 
   void setMat4(const std::string &name, glm::mat4 &matrix) const {
+    renderStats.uniformUploads++;
     glUniformMatrix4fv(glGetUniformLocation(this->id, name.c_str()), 1, GL_FALSE, &matrix[0][0]);
   }
+
+private:
+  static std::string readFile(const GLchar *path) {
+    std::ifstream file;
+    // Ensure ifstream objects can throw exceptions
+    file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+    try {
+      file.open(path);
+      std::stringstream stream;
+      // Read file's buffer contents into streams
+      stream << file.rdbuf();
+      file.close();
+      return stream.str();
+    } catch (std::ifstream::failure &e) {
+      std::cout << "ERROR: Failed reading a shader file." << std::endl;
+      return "";
+    }
+  }
+
+  static std::string insertDefines(const std::string &code, const std::string &defines) {
+    // The version directive must come first
+    size_t lineEnd = code.rfind("#version", 0) == 0 ? code.find('\n') : std::string::npos;
+
+    if (lineEnd == std::string::npos) {
+      return defines + code;
+    }
+
+    return code.substr(0, lineEnd + 1) + defines + code.substr(lineEnd + 1);
+  }
+
+  static uint32_t compileShader(GLenum type, const char *typeName, const std::string &code) {
+    CPU_PROFILE_SCOPE("Shader::compileShader");
+    StartupPhase phase("shader compile");
+    const char *shaderCode = code.c_str();
+    int32_t success;
+    char infoLog[512];
+
+    uint32_t shader = glCreateShader(type);
+    glShaderSource(shader, 1, &shaderCode, nullptr);
+    glCompileShader(shader);
+
+    // Check for compilation errors
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+
+    if (!success) {
+      glGetShaderInfoLog(shader, 512, nullptr, infoLog);
+      std::cout << "ERROR: Failed compiling a " << typeName << " shader.\n       " << infoLog
+                << std::endl;
+    }
+
+    return shader;
+  }
+
+  void linkProgram(std::initializer_list<uint32_t> shaders) {
+    CPU_PROFILE_SCOPE("Shader::linkProgram");
+    StartupPhase phase("shader link");
+    int32_t success;
+    char infoLog[512];
+
+    // Create the shader program
+    this->id = glCreateProgram();
+
+    for (uint32_t shader : shaders) {
+      glAttachShader(this->id, shader);
+    }
+
+    glLinkProgram(this->id);
+
+    // Check for shader program linking errors
+    glGetProgramiv(this->id, GL_LINK_STATUS, &success);
+
+    if (!success) {
+      glGetProgramInfoLog(this->id, 512, nullptr, infoLog);
+      std::cout << "ERROR: Failed linking a shader program.\n       " << infoLog << std::endl;
+    }
+
+    // Delete shaders as they are now linked and no longer needed
+    for (uint32_t shader : shaders) {
+      glDeleteShader(shader);
+    }
+  }
 };
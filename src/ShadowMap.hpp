@@ -0,0 +1,218 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Bounds.hpp"
+#include "Lights.hpp"
+#include "Shader.hpp"
+
+/**
+ * Computes the light-space matrix of a directional light, with an orthographic
+ * projection fit tightly around the scene.
+ *
+ * @param direction The direction the light shines in
+ * @param sceneBounds The world-space bounds of every shadow caster and receiver
+ * @return The combined projection and view matrix
+ */
+inline glm::mat4 directionalLightSpace(const glm::vec3 &direction, const AABB &sceneBounds) {
+  glm::vec3 forward = glm::normalize(direction);
+  // Any up vector works as long as it isn't parallel to the light
+  glm::vec3 up = std::fabs(forward.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f)
+                                              : glm::vec3(0.0f, 1.0f, 0.0f);
+  glm::vec3 center = sceneBounds.center();
+  glm::mat4 view = glm::lookAt(center - forward, center, up);
+
+  // Bounds of the scene in light space
+  AABB lightBounds;
+
+  for (int32_t corner = 0; corner < 8; corner++) {
+    glm::vec3 position = glm::vec3(corner & 1 ? sceneBounds.max.x : sceneBounds.min.x,
+                                   corner & 2 ? sceneBounds.max.y : sceneBounds.min.y,
+                                   corner & 4 ? sceneBounds.max.z : sceneBounds.min.z);
+    lightBounds.expand(glm::vec3(view * glm::vec4(position, 1.0f)));
+  }
+
+  // The view looks down -Z
+  glm::mat4 projection = glm::ortho(lightBounds.min.x, lightBounds.max.x, lightBounds.min.y,
+                                    lightBounds.max.y, -lightBounds.max.z, -lightBounds.min.z);
+  return projection * view;
+}
+
+/**
+ * Computes the light-space matrix of a spot light, with a perspective
+ * projection enclosing its cone up to its influence radius.
+ *
+ * @param light The spot light
+ * @param near The distance of the near plane from the light
+ * @return The combined projection and view matrix
+ */
+inline glm::mat4 spotLightSpace(const SpotLight &light, float near = 0.1f) {
+  glm::vec3 forward = glm::normalize(light.direction);
+  glm::vec3 up = std::fabs(forward.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f)
+                                              : glm::vec3(0.0f, 1.0f, 0.0f);
+  glm::mat4 view = glm::lookAt(light.position, light.position + forward, up);
+  float fov = 2.0f * std::acos(light.outerCutoff);
+  glm::mat4 projection = glm::perspective(fov, 1.0f, near, std::fmax(light.radius(), near * 2.0f));
+  return projection * view;
+}
+
+/**
+ * A shadow map whose static casters are rendered once and cached.
+ *
+ * The depth of the static casters is kept in its own texture, and is only
+ * re-rendered when invalidated: when the light moves (its light-space matrix
+ * changes) or explicitly with invalidate(). Every frame, it is copied into the
+ * sampled shadow map, and only the dynamic casters are drawn on top of it.
+ *
+ * Casters are drawn with the depth pre-pass shader (see
+ * depth_prepass.vertex.glsl), whose "model" uniform must be set for each
+ * object.
+ */
+class ShadowMap {
+public:
+  int32_t size;
+  // The combined projection and view matrix of the light, transforming world space to the shadow
+  // map's clip space
+  glm::mat4 lightSpace;
+  // The number of times the static casters were rendered, for statistics
+  uint32_t staticRenders = 0;
+
+  explicit ShadowMap(int32_t size = 2048)
+      : size(size),
+        lightSpace(glm::mat4(0.0f)),
+        casterShader(Shader("../resources/shaders/depth_prepass.vertex.glsl",
+                            "../resources/shaders/depth_prepass.fragment.glsl")) {
+    glGenFramebuffers(1, &staticFbo);
+    glGenFramebuffers(1, &fbo);
+    glGenTextures(1, &staticDepth);
+    glGenTextures(1, &depth);
+
+    setupTarget(staticFbo, staticDepth);
+    setupTarget(fbo, depth);
+
+    // Sampled with hardware depth comparisons, which are bilinearly filtered
+    glBindTexture(GL_TEXTURE_2D, depth);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+
+  /**
+   * Sets the light's light-space matrix, invalidating the cached static depth
+   * if it changed.
+   */
+  void setLightSpace(const glm::mat4 &matrix) {
+    if (matrix != lightSpace) {
+      lightSpace = matrix;
+      staticValid = false;
+    }
+  }
+
+  // Forces the static casters to be re-rendered, e.g. after adding or moving a static object
+  void invalidate() {
+    staticValid = false;
+  }
+
+  /**
+   * Starts re-rendering the static casters, if the cached depth is invalid.
+   *
+   * @return The shader to draw the static casters with, or nullptr if the
+   *         cached depth can be reused (the static casters must not be drawn)
+   */
+  Shader *beginStaticCasters() {
+    if (staticValid) {
+      return nullptr;
+    }
+
+    beginTarget(staticFbo);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    staticValid = true;
+    staticRenders++;
+    return &casterShader;
+  }
+
+  /**
+   * Starts drawing the dynamic casters, on top of the cached static depth.
+   *
+   * @return The shader to draw the dynamic casters with
+   */
+  Shader &beginDynamicCasters() {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fbo);
+    glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    beginTarget(fbo);
+    return casterShader;
+  }
+
+  // Restores the default framebuffer and the viewport
+  void end() {
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    rendering = false;
+  }
+
+  // Binds the shadow map, to be sampled with a sampler2DShadow
+  void bindTexture(int32_t unit) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, depth);
+  }
+
+private:
+  Shader casterShader;
+  uint32_t staticFbo, fbo;
+  uint32_t staticDepth, depth;
+  bool staticValid = false;
+  bool rendering = false;
+  int32_t viewport[4];
+
+  void setupTarget(uint32_t target, uint32_t texture) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT,
+                 GL_UNSIGNED_INT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // Everything outside of the shadow map is lit
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    const float border[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, texture, 0);
+    // No color is written
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+      std::cout << "ERROR: The shadow map framebuffer is incomplete." << std::endl;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  }
+
+  void beginTarget(uint32_t target) {
+    if (!rendering) {
+      glGetIntegerv(GL_VIEWPORT, viewport);
+      rendering = true;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, target);
+    glViewport(0, 0, size, size);
+    glDepthMask(GL_TRUE);
+    // Slope-scaled bias, pushing the casters' depth back to avoid self-shadowing artifacts
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+
+    // The caster shader's view is the identity, its projection the light-space matrix
+    glm::mat4 identity = glm::mat4(1.0f);
+    casterShader.use();
+    casterShader.setMat4("view", identity);
+    casterShader.setMat4("projection", lightSpace);
+  }
+};
@@ -0,0 +1,543 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <vector>
+#include <glm/glm.hpp>
+#include "CpuProfiler.hpp"
+#include "Mesh.hpp"
+#include "NormalMatrix.hpp"
+#include "SoftwareShading.hpp"
+#include "ThreadPool.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+/**
+ * A multithreaded tile-based rasterizer running entirely on the CPU, for
+ * rendering without a GPU. It draws the same vertex data as Mesh and Model
+ * (see Model::draw(SoftwareRasterizer &, ...)), transformed like the lighting
+ * demos' vertex shaders, and shades the pixels with the C++ shading models of
+ * SoftwareShading.hpp. Like OpenGL, it depth tests with
+ * GL_LESS, doesn't cull faces, and stores the rows of its framebuffer from the
+ * bottom up.
+ *
+ * Drawing is split in two steps:
+ *
+ * - draw() transforms the vertices, clips the triangles against the near and
+ *   far planes, sets up their edge and depth equations, and bins them into the
+ *   screen tiles their bounding boxes overlap, in parallel on the thread pool.
+ * - flush() rasterizes the tiles in parallel, each worker taking the next
+ *   tile left. Each tile is only touched by one thread and processes its
+ *   triangles in the order they were drawn, so the output is deterministic.
+ *
+ * Within a tile, the edge functions and the depth test are evaluated for 8
+ * (AVX) or 4 (SSE) pixels of a row at once, and the shader only runs for the
+ * pixels passing both.
+ */
+class SoftwareRasterizer {
+public:
+  // The width and height of the tiles triangles are binned into
+  static constexpr int32_t TILE_SIZE = 64;
+
+  /**
+   * @param threadCount The number of worker threads (0 to use one per hardware thread, minus the
+   *                    main thread)
+   */
+  SoftwareRasterizer(int32_t width, int32_t height, uint32_t threadCount = 0)
+      : pool(threadCount) {
+    resize(width, height);
+  }
+
+  // Reallocates the framebuffer, whose contents are then undefined until clear()
+  void resize(int32_t newWidth, int32_t newHeight) {
+    width = newWidth;
+    height = newHeight;
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    // Padded to whole tiles, so that the SIMD loops never need a remainder loop
+    stride = tilesX * TILE_SIZE;
+    color.assign((size_t) stride * (size_t) (tilesY * TILE_SIZE), 0);
+    depth.assign(color.size(), 1.0f);
+    bins.assign((size_t) (tilesX * tilesY), {});
+  }
+
+  uint32_t threadCount() const {
+    return pool.size();
+  }
+
+  // Clears the color to the given value and the depth to 1
+  void clear(const glm::vec3 &clearColor) {
+    std::fill(color.begin(), color.end(), packColor(clearColor));
+    std::fill(depth.begin(), depth.end(), 1.0f);
+  }
+
+  // Sets the matrices the following draws are transformed with
+  void setCamera(const glm::mat4 &view, const glm::mat4 &projection) {
+    viewProjection = projection * view;
+  }
+
+  /**
+   * Queues indexed triangles to be rasterized by the next flush().
+   *
+   * @param vertices The vertices, in object space
+   * @param indices Three indices per triangle
+   * @param model The model matrix
+   * @param shader The shader to shade the triangles' pixels with, which must
+   *               stay alive and unchanged until flush()
+   */
+  void draw(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+            const glm::mat4 &model, const SoftwareShader &shader) {
+    CPU_PROFILE_SCOPE("SoftwareRasterizer::draw");
+    const glm::mat4 modelViewProjection = viewProjection * model;
+    const glm::mat3 normals = normalMatrix(model);
+    transformed.resize(vertices.size());
+
+    pool.parallelFor((uint32_t) vertices.size(), [&](uint32_t begin, uint32_t end) {
+      for (uint32_t i = begin; i < end; i++) {
+        const Vertex &vertex = vertices[i];
+        ClipVertex &output = transformed[i];
+        output.clip = modelViewProjection * glm::vec4(vertex.position, 1.0f);
+        output.position = glm::vec3(model * glm::vec4(vertex.position, 1.0f));
+        output.normal = normals * vertex.normal;
+        output.texCoords = vertex.texCoords;
+      }
+    });
+
+    // Each chunk of triangles is set up into its own list, appended in the order of the chunks
+    // afterwards. The lists are claimed in any order, but keep their capacity between draws.
+    const uint32_t triangleCount = (uint32_t) indices.size() / 3;
+    chunkTriangles.resize(std::max(1u, pool.size()));
+    std::atomic<uint32_t> nextChunk(0);
+
+    pool.parallelFor(triangleCount, [&](uint32_t begin, uint32_t end) {
+      ChunkTriangles &chunk = chunkTriangles[nextChunk++];
+      chunk.begin = begin;
+      chunk.triangles.clear();
+
+      for (uint32_t i = begin; i < end; i++) {
+        setupTriangle(transformed[indices[i * 3]], transformed[indices[i * 3 + 1]],
+                      transformed[indices[i * 3 + 2]], shader, chunk.triangles);
+      }
+    });
+
+    CPU_PROFILE_SCOPE("SoftwareRasterizer::bin");
+    const uint32_t chunkCount = nextChunk;
+    std::sort(chunkTriangles.begin(), chunkTriangles.begin() + chunkCount,
+              [](const ChunkTriangles &a, const ChunkTriangles &b) { return a.begin < b.begin; });
+
+    for (uint32_t i = 0; i < chunkCount; i++) {
+      for (const Triangle &triangle : chunkTriangles[i].triangles) {
+        bin(triangle);
+      }
+
+      chunkTriangles[i].triangles.clear();
+    }
+  }
+
+  // Queues a mesh's triangles, see draw() above
+  void draw(const Mesh &mesh, const glm::mat4 &model, const SoftwareShader &shader) {
+    draw(mesh.vertices, mesh.indices, model, shader);
+  }
+
+  // Rasterizes the triangles queued since the last flush(), and waits for them to be done
+  void flush() {
+    CPU_PROFILE_SCOPE("SoftwareRasterizer::flush");
+    std::atomic<int32_t> nextTile(0);
+    const int32_t tileCount = tilesX * tilesY;
+    std::vector<std::future<void>> futures;
+
+    for (uint32_t worker = 0; worker < pool.size(); worker++) {
+      futures.push_back(pool.submit([&] {
+        for (int32_t tile = nextTile++; tile < tileCount; tile = nextTile++) {
+          rasterizeTile(tile);
+        }
+      }));
+    }
+
+    for (std::future<void> &future : futures) {
+      future.get();
+    }
+
+    for (std::vector<uint32_t> &bin : bins) {
+      bin.clear();
+    }
+
+    triangles.clear();
+  }
+
+  /**
+   * Copies the framebuffer's colors as 8-bit RGBA, the bottom row first, like
+   * glReadPixels() with GL_RGBA and GL_UNSIGNED_BYTE.
+   */
+  void readPixels(std::vector<uint8_t> &pixels) const {
+    pixels.resize((size_t) width * (size_t) height * 4);
+
+    for (int32_t y = 0; y < height; y++) {
+      const uint32_t *row = &color[(size_t) y * stride];
+
+      for (int32_t x = 0; x < width; x++) {
+        uint8_t *pixel = &pixels[((size_t) y * width + x) * 4];
+        pixel[0] = (uint8_t) (row[x] & 0xFFu);
+        pixel[1] = (uint8_t) ((row[x] >> 8) & 0xFFu);
+        pixel[2] = (uint8_t) ((row[x] >> 16) & 0xFFu);
+        pixel[3] = (uint8_t) (row[x] >> 24);
+      }
+    }
+  }
+
+private:
+  // A vertex shader output
+  struct ClipVertex {
+    glm::vec4 clip;
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec2 texCoords;
+  };
+
+  struct Triangle {
+    // Edge functions a * x + b * y + c, positive inside the triangle, the edge opposite each vertex
+    float edgeA[3], edgeB[3], edgeC[3];
+    // Whether each edge is a top or left edge, whose pixel centers are inside (fill convention)
+    bool topLeft[3];
+    // The window-space depth as a function of the window position
+    float depthA, depthB, depthC;
+    float inverseArea;
+    // The vertices' 1 / w, and attributes divided by w, for perspective-correct interpolation
+    float inverseW[3];
+    glm::vec3 position[3], normal[3];
+    glm::vec2 texCoords[3];
+    // The bounding box in pixels, clamped to the framebuffer
+    int32_t minX, minY, maxX, maxY;
+    const SoftwareShader *shader;
+  };
+
+  ThreadPool pool;
+  int32_t width = 0, height = 0;
+  int32_t tilesX = 0, tilesY = 0, stride = 0;
+  // RGBA8 colors and window-space depths, the bottom row first
+  std::vector<uint32_t> color;
+  std::vector<float> depth;
+  glm::mat4 viewProjection;
+
+  // The triangles set up from the chunk of triangles starting at begin
+  struct ChunkTriangles {
+    uint32_t begin;
+    std::vector<Triangle> triangles;
+  };
+
+  std::vector<ClipVertex> transformed;
+  std::vector<ChunkTriangles> chunkTriangles;
+  std::vector<Triangle> triangles;
+  // The indices of the triangles overlapping each tile, in drawing order
+  std::vector<std::vector<uint32_t>> bins;
+
+  static uint32_t packColor(const glm::vec3 &value) {
+    glm::vec3 clamped = glm::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f;
+    return (uint32_t) clamped.x | ((uint32_t) clamped.y << 8) | ((uint32_t) clamped.z << 16) |
+           0xFF000000u;
+  }
+
+  static ClipVertex lerp(const ClipVertex &a, const ClipVertex &b, float t) {
+    return {a.clip + (b.clip - a.clip) * t, a.position + (b.position - a.position) * t,
+            a.normal + (b.normal - a.normal) * t, a.texCoords + (b.texCoords - a.texCoords) * t};
+  }
+
+  /**
+   * Clips a polygon against the plane where distance() is 0, keeping the side
+   * where it's positive (Sutherland-Hodgman).
+   */
+  template<typename Distance>
+  static void clipPolygon(std::vector<ClipVertex> &polygon, std::vector<ClipVertex> &scratch,
+                          Distance distance) {
+    scratch.clear();
+
+    for (size_t i = 0; i < polygon.size(); i++) {
+      const ClipVertex &current = polygon[i];
+      const ClipVertex &next = polygon[(i + 1) % polygon.size()];
+      float currentDistance = distance(current.clip);
+      float nextDistance = distance(next.clip);
+
+      if (currentDistance >= 0.0f) {
+        scratch.push_back(current);
+      }
+
+      if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f)) {
+        scratch.push_back(lerp(current, next, currentDistance / (currentDistance - nextDistance)));
+      }
+    }
+
+    polygon.swap(scratch);
+  }
+
+  void setupTriangle(const ClipVertex &v0, const ClipVertex &v1, const ClipVertex &v2,
+                     const SoftwareShader &shader, std::vector<Triangle> &output) const {
+    auto outsideNear = [](const ClipVertex &v) { return v.clip.z < -v.clip.w; };
+    auto outsideFar = [](const ClipVertex &v) { return v.clip.z > v.clip.w; };
+
+    // Trivially rejected if entirely outside a plane
+    for (auto outside : {+[](const glm::vec4 &c) { return c.x < -c.w; },
+                         +[](const glm::vec4 &c) { return c.x > c.w; },
+                         +[](const glm::vec4 &c) { return c.y < -c.w; },
+                         +[](const glm::vec4 &c) { return c.y > c.w; },
+                         +[](const glm::vec4 &c) { return c.z < -c.w; },
+                         +[](const glm::vec4 &c) { return c.z > c.w; }}) {
+      if (outside(v0.clip) && outside(v1.clip) && outside(v2.clip)) {
+        return;
+      }
+    }
+
+    // Only the near and far planes need clipping, the bounding boxes being clamped to the screen.
+    // The near plane also keeps w positive.
+    if (!outsideNear(v0) && !outsideNear(v1) && !outsideNear(v2) && !outsideFar(v0) &&
+        !outsideFar(v1) && !outsideFar(v2)) {
+      setupClipped(v0, v1, v2, shader, output);
+      return;
+    }
+
+    thread_local std::vector<ClipVertex> polygon, scratch;
+    polygon.assign({v0, v1, v2});
+    clipPolygon(polygon, scratch, [](const glm::vec4 &c) { return c.z + c.w; });
+    clipPolygon(polygon, scratch, [](const glm::vec4 &c) { return c.w - c.z; });
+
+    for (size_t i = 2; i < polygon.size(); i++) {
+      setupClipped(polygon[0], polygon[i - 1], polygon[i], shader, output);
+    }
+  }
+
+  void setupClipped(const ClipVertex &v0, const ClipVertex &v1, const ClipVertex &v2,
+                    const SoftwareShader &shader, std::vector<Triangle> &output) const {
+    const ClipVertex *vertices[3] = {&v0, &v1, &v2};
+    glm::vec3 window[3];
+
+    for (uint32_t i = 0; i < 3; i++) {
+      const glm::vec4 &clip = vertices[i]->clip;
+      glm::vec3 ndc = glm::vec3(clip) / clip.w;
+      // Snapped to 1/16th of a pixel like GPUs do, so that the edges shared by triangles are
+      // computed identically
+      window[i] = glm::vec3(std::round((ndc.x * 0.5f + 0.5f) * (float) width * 16.0f) / 16.0f,
+                            std::round((ndc.y * 0.5f + 0.5f) * (float) height * 16.0f) / 16.0f,
+                            ndc.z * 0.5f + 0.5f);
+    }
+
+    // Twice the signed area, positive for counter-clockwise triangles
+    float area = (window[1].x - window[0].x) * (window[2].y - window[0].y) -
+                 (window[2].x - window[0].x) * (window[1].y - window[0].y);
+
+    if (area == 0.0f || !std::isfinite(area)) {
+      return;
+    }
+
+    // Faces aren't culled, clockwise triangles are drawn as if they were counter-clockwise
+    if (area < 0.0f) {
+      std::swap(vertices[1], vertices[2]);
+      std::swap(window[1], window[2]);
+      area = -area;
+    }
+
+    Triangle triangle;
+    triangle.inverseArea = 1.0f / area;
+    triangle.depthA = triangle.depthB = triangle.depthC = 0.0f;
+
+    for (uint32_t i = 0; i < 3; i++) {
+      // The edge from vertex j to vertex k, opposite vertex i
+      const glm::vec3 &j = window[(i + 1) % 3];
+      const glm::vec3 &k = window[(i + 2) % 3];
+      triangle.edgeA[i] = j.y - k.y;
+      triangle.edgeB[i] = k.x - j.x;
+      triangle.edgeC[i] = (float) -((double) triangle.edgeA[i] * j.x +
+                                    (double) triangle.edgeB[i] * j.y);
+      // Counter-clockwise with y up, left edges go down and top edges go left
+      triangle.topLeft[i] = k.y < j.y || (k.y == j.y && k.x < j.x);
+
+      // The barycentric coordinate of vertex i is its edge function divided by the area
+      triangle.depthA += triangle.edgeA[i] * triangle.inverseArea * window[i].z;
+      triangle.depthB += triangle.edgeB[i] * triangle.inverseArea * window[i].z;
+      triangle.depthC += triangle.edgeC[i] * triangle.inverseArea * window[i].z;
+
+      const ClipVertex &vertex = *vertices[i];
+      triangle.inverseW[i] = 1.0f / vertex.clip.w;
+      triangle.position[i] = vertex.position * triangle.inverseW[i];
+      triangle.normal[i] = vertex.normal * triangle.inverseW[i];
+      triangle.texCoords[i] = vertex.texCoords * triangle.inverseW[i];
+    }
+
+    // Pixels whose centers may be covered
+    float minX = std::min({window[0].x, window[1].x, window[2].x});
+    float maxX = std::max({window[0].x, window[1].x, window[2].x});
+    float minY = std::min({window[0].y, window[1].y, window[2].y});
+    float maxY = std::max({window[0].y, window[1].y, window[2].y});
+    triangle.minX = std::max(0, (int32_t) std::floor(minX - 0.5f));
+    triangle.maxX = std::min(width - 1, (int32_t) std::ceil(maxX - 0.5f));
+    triangle.minY = std::max(0, (int32_t) std::floor(minY - 0.5f));
+    triangle.maxY = std::min(height - 1, (int32_t) std::ceil(maxY - 0.5f));
+
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+      return;
+    }
+
+    triangle.shader = &shader;
+    output.push_back(triangle);
+  }
+
+  void bin(const Triangle &triangle) {
+    const uint32_t index = (uint32_t) triangles.size();
+    triangles.push_back(triangle);
+
+    for (int32_t tileY = triangle.minY / TILE_SIZE; tileY <= triangle.maxY / TILE_SIZE; tileY++) {
+      for (int32_t tileX = triangle.minX / TILE_SIZE; tileX <= triangle.maxX / TILE_SIZE;
+           tileX++) {
+        bins[tileY * tilesX + tileX].push_back(index);
+      }
+    }
+  }
+
+  void rasterizeTile(int32_t tile) {
+    const int32_t tileMinX = (tile % tilesX) * TILE_SIZE;
+    const int32_t tileMinY = (tile / tilesX) * TILE_SIZE;
+
+#if defined(__AVX__)
+    constexpr int32_t LANES = 8;
+#elif defined(__SSE2__) || defined(_M_X64)
+    constexpr int32_t LANES = 4;
+#else
+    constexpr int32_t LANES = 1;
+#endif
+
+    for (uint32_t index : bins[tile]) {
+      const Triangle &triangle = triangles[index];
+      // Start on a whole SIMD group, which can't go past the padded framebuffer
+      const int32_t minX = std::max(tileMinX, triangle.minX) / LANES * LANES;
+      const int32_t maxX = std::min(tileMinX + TILE_SIZE - 1, triangle.maxX);
+      const int32_t minY = std::max(tileMinY, triangle.minY);
+      const int32_t maxY = std::min(tileMinY + TILE_SIZE - 1, triangle.maxY);
+
+      for (int32_t y = minY; y <= maxY; y++) {
+        const float pixelY = (float) y + 0.5f;
+        float *depthRow = &depth[(size_t) y * stride];
+
+        for (int32_t x = minX; x <= maxX; x += LANES) {
+          uint32_t mask = testPixels(triangle, x, pixelY, &depthRow[x]);
+
+          for (int32_t lane = 0; mask != 0; lane++, mask >>= 1) {
+            if (mask & 1u) {
+              shadePixel(triangle, x + lane, y);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /**
+   * Tests the coverage and depth of the pixels of a row starting at x, writing
+   * the depth of those passing both.
+   *
+   * @return A bit mask of the pixels passing
+   */
+#if defined(__AVX__)
+  static uint32_t testPixels(const Triangle &triangle, int32_t x, float pixelY, float *depthRow) {
+    const __m256 pixelX = _mm256_add_ps(_mm256_set1_ps((float) x + 0.5f),
+                                        _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256 zero = _mm256_setzero_ps();
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+    for (uint32_t i = 0; i < 3; i++) {
+      __m256 edge = _mm256_add_ps(
+          _mm256_mul_ps(_mm256_set1_ps(triangle.edgeA[i]), pixelX),
+          _mm256_set1_ps(triangle.edgeB[i] * pixelY + triangle.edgeC[i]));
+      __m256 edgeInside = triangle.topLeft[i] ? _mm256_cmp_ps(edge, zero, _CMP_GE_OQ)
+                                              : _mm256_cmp_ps(edge, zero, _CMP_GT_OQ);
+      inside = _mm256_and_ps(inside, edgeInside);
+    }
+
+    if (_mm256_movemask_ps(inside) == 0) {
+      return 0;
+    }
+
+    __m256 z = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.depthA), pixelX),
+                             _mm256_set1_ps(triangle.depthB * pixelY + triangle.depthC));
+    __m256 stored = _mm256_loadu_ps(depthRow);
+    __m256 pass = _mm256_and_ps(inside, _mm256_cmp_ps(z, stored, _CMP_LT_OQ));
+    _mm256_storeu_ps(depthRow, _mm256_blendv_ps(stored, z, pass));
+    return (uint32_t) _mm256_movemask_ps(pass);
+  }
+#elif defined(__SSE2__) || defined(_M_X64)
+  static uint32_t testPixels(const Triangle &triangle, int32_t x, float pixelY, float *depthRow) {
+    const __m128 pixelX = _mm_add_ps(_mm_set1_ps((float) x + 0.5f), _mm_setr_ps(0, 1, 2, 3));
+    const __m128 zero = _mm_setzero_ps();
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+    for (uint32_t i = 0; i < 3; i++) {
+      __m128 edge = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeA[i]), pixelX),
+                               _mm_set1_ps(triangle.edgeB[i] * pixelY + triangle.edgeC[i]));
+      __m128 edgeInside = triangle.topLeft[i] ? _mm_cmpge_ps(edge, zero)
+                                              : _mm_cmpgt_ps(edge, zero);
+      inside = _mm_and_ps(inside, edgeInside);
+    }
+
+    if (_mm_movemask_ps(inside) == 0) {
+      return 0;
+    }
+
+    __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.depthA), pixelX),
+                          _mm_set1_ps(triangle.depthB * pixelY + triangle.depthC));
+    __m128 stored = _mm_loadu_ps(depthRow);
+    __m128 pass = _mm_and_ps(inside, _mm_cmplt_ps(z, stored));
+    // No blend instruction in SSE2
+    _mm_storeu_ps(depthRow, _mm_or_ps(_mm_and_ps(pass, z), _mm_andnot_ps(pass, stored)));
+    return (uint32_t) _mm_movemask_ps(pass);
+  }
+#else
+  static uint32_t testPixels(const Triangle &triangle, int32_t x, float pixelY, float *depthRow) {
+    const float pixelX = (float) x + 0.5f;
+
+    for (uint32_t i = 0; i < 3; i++) {
+      float edge = triangle.edgeA[i] * pixelX + triangle.edgeB[i] * pixelY + triangle.edgeC[i];
+
+      if (edge < 0.0f || (edge == 0.0f && !triangle.topLeft[i])) {
+        return 0;
+      }
+    }
+
+    float z = triangle.depthA * pixelX + triangle.depthB * pixelY + triangle.depthC;
+
+    if (z >= *depthRow) {
+      return 0;
+    }
+
+    *depthRow = z;
+    return 1;
+  }
+#endif
+
+  void shadePixel(const Triangle &triangle, int32_t x, int32_t y) {
+    const float pixelX = (float) x + 0.5f;
+    const float pixelY = (float) y + 0.5f;
+    float weights[3];
+    float inverseW = 0.0f;
+
+    for (uint32_t i = 0; i < 3; i++) {
+      weights[i] = (triangle.edgeA[i] * pixelX + triangle.edgeB[i] * pixelY + triangle.edgeC[i]) *
+                   triangle.inverseArea;
+      inverseW += weights[i] * triangle.inverseW[i];
+    }
+
+    SoftwareFragment fragment = {glm::vec3(0.0f), glm::vec3(0.0f), glm::vec2(0.0f)};
+
+    for (uint32_t i = 0; i < 3; i++) {
+      float weight = weights[i] / inverseW;
+      fragment.position += triangle.position[i] * weight;
+      fragment.normal += triangle.normal[i] * weight;
+      fragment.texCoords += triangle.texCoords[i] * weight;
+    }
+
+    color[(size_t) y * stride + x] = packColor(triangle.shader->shade(fragment));
+  }
+};
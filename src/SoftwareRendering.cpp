@@ -0,0 +1,395 @@
+#include <iostream>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "Model.hpp"
+#include "NormalMatrix.hpp"
+#include "Shader.hpp"
+#include "SoftwareRasterizer.hpp"
+#include "SoftwareShading.hpp"
+#include "Window.hpp"
+
+/*
+ * Renders a grid of lit cubes with the software rasterizer, without needing a
+ * GPU, and reports its frame time for an increasing number of threads. If an
+ * OpenGL context is available, the same scene is then rendered with the
+ * lighting demos' shaders, and the two images compared, and the nanosuit model
+ * is rendered with the software rasterizer too.
+ */
+
+// The size of the rendered images
+constexpr int32_t IMAGE_WIDTH = 1280;
+constexpr int32_t IMAGE_HEIGHT = 720;
+
+// The field of view
+constexpr float FOV = 45.0f;
+
+// The number of cubes on each side of the grid
+constexpr int32_t GRID_SIZE = 8;
+
+// The number of frames timed for each thread count
+constexpr uint32_t FRAMES = 30;
+
+/**
+ * The scene, described once for both renderers. Even columns of cubes use
+ * Phong lighting, odd columns use materials, and the light is drawn as a small
+ * unlit cube.
+ */
+struct Scene {
+  glm::mat4 view, projection;
+  glm::vec3 cameraPosition;
+  std::vector<glm::mat4> cubeModels;
+  glm::mat4 lightModel;
+  PhongShading phong;
+  MaterialShading material;
+  BasicShading light;
+};
+
+Scene createScene() {
+  Scene scene;
+  scene.cameraPosition = glm::vec3(0.0f, 7.0f, 13.0f);
+  scene.view = glm::lookAt(scene.cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f),
+                           glm::vec3(0.0f, 1.0f, 0.0f));
+  scene.projection = glm::perspective(glm::radians(FOV),
+                                      (float) IMAGE_WIDTH / (float) IMAGE_HEIGHT, 0.1f, 100.0f);
+
+  for (int32_t x = 0; x < GRID_SIZE; x++) {
+    for (int32_t z = 0; z < GRID_SIZE; z++) {
+      glm::mat4 model;
+      model = glm::translate(model, glm::vec3(x - GRID_SIZE / 2, 0.0f, z - GRID_SIZE / 2) * 1.5f);
+      model = glm::rotate(model, glm::radians(20.0f * (x + z)), glm::vec3(0.3f, 1.0f, 0.0f));
+      scene.cubeModels.push_back(model);
+    }
+  }
+
+  glm::vec3 lightPos = glm::vec3(1.0f, 2.5f, 2.0f);
+  scene.lightModel = glm::scale(glm::translate(glm::mat4(), lightPos), glm::vec3(0.2f));
+
+  scene.phong.viewPos = scene.cameraPosition;
+  scene.phong.lightPos = lightPos;
+  scene.phong.objectColor = glm::vec3(1.0f, 0.5f, 0.31f);
+
+  scene.material.viewPos = scene.cameraPosition;
+  scene.material.material.ambient = glm::vec3(0.4f, 1.0f, 0.2f);
+  scene.material.material.diffuse = glm::vec3(0.4f, 1.0f, 0.2f);
+  scene.material.material.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+  scene.material.material.glossiness = 24.0f;
+  scene.material.light.position = lightPos;
+  return scene;
+}
+
+// The cube, with the same vertices as the lighting demos
+void createCube(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+  const float data[] = {
+      -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f,
+      0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, 0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f,
+      -0.5f, 0.5f, -0.5f, 0.0f, 0.0f, -1.0f, -0.5f, -0.5f, -0.5f, 0.0f, 0.0f, -1.0f,
+
+      -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, 0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f,
+      -0.5f, 0.5f, 0.5f, 0.0f, 0.0f, 1.0f, -0.5f, -0.5f, 0.5f, 0.0f, 0.0f, 1.0f,
+
+      -0.5f, 0.5f, 0.5f, -1.0f, 0.0f, 0.0f, -0.5f, 0.5f, -0.5f, -1.0f, 0.0f, 0.0f,
+      -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f, -0.5f, -0.5f, -0.5f, -1.0f, 0.0f, 0.0f,
+      -0.5f, -0.5f, 0.5f, -1.0f, 0.0f, 0.0f, -0.5f, 0.5f, 0.5f, -1.0f, 0.0f, 0.0f,
+
+      0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f, -0.5f, 1.0f, 0.0f, 0.0f,
+      0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f, 0.5f, -0.5f, -0.5f, 1.0f, 0.0f, 0.0f,
+      0.5f, -0.5f, 0.5f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f, 0.5f, 1.0f, 0.0f, 0.0f,
+
+      -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f, 0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f,
+      0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, 0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f,
+      -0.5f, -0.5f, 0.5f, 0.0f, -1.0f, 0.0f, -0.5f, -0.5f, -0.5f, 0.0f, -1.0f, 0.0f,
+
+      -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f, 0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f,
+      0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, 0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f,
+      -0.5f, 0.5f, 0.5f, 0.0f, 1.0f, 0.0f, -0.5f, 0.5f, -0.5f, 0.0f, 1.0f, 0.0f,
+  };
+
+  for (uint32_t i = 0; i < 36; i++) {
+    const float *vertex = &data[i * 6];
+    vertices.push_back({glm::vec3(vertex[0], vertex[1], vertex[2]),
+                        glm::vec3(vertex[3], vertex[4], vertex[5]), glm::vec2(0.0f)});
+    indices.push_back(i);
+  }
+}
+
+void renderSoftware(SoftwareRasterizer &rasterizer, const Scene &scene,
+                    const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices) {
+  rasterizer.clear(glm::vec3(0.15f, 0.15f, 0.15f));
+  rasterizer.setCamera(scene.view, scene.projection);
+
+  for (size_t i = 0; i < scene.cubeModels.size(); i++) {
+    const SoftwareShader &shader = (i / GRID_SIZE) % 2 == 0
+                                   ? (const SoftwareShader &) scene.phong : scene.material;
+    rasterizer.draw(vertices, indices, scene.cubeModels[i], shader);
+  }
+
+  rasterizer.draw(vertices, indices, scene.lightModel, scene.light);
+  rasterizer.flush();
+}
+
+/**
+ * Renders the scene with OpenGL into an offscreen framebuffer.
+ *
+ * @return Whether an OpenGL context could be created
+ */
+bool renderGL(const Scene &scene, const std::vector<Vertex> &vertices,
+              std::vector<uint8_t> &pixels) {
+  // A hidden window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(IMAGE_WIDTH, IMAGE_HEIGHT, "Software Rendering", 3, 3, WindowMode::HIDDEN);
+
+  if (!window.isOpen()) {
+    return false;
+  }
+
+  Shader phongShader = Shader(
+      "../resources/shaders/basic_lighting.vertex.glsl",
+      "../resources/shaders/basic_lighting.fragment.glsl"
+  );
+  Shader materialShader = Shader(
+      "../resources/shaders/materials.vertex.glsl",
+      "../resources/shaders/materials.fragment.glsl"
+  );
+  Shader lightShader = Shader(
+      "../resources/shaders/light_colors.vertex.glsl",
+      "../resources/shaders/light_colors.fragment.glsl"
+  );
+
+  // Hidden windows may not have a readable default framebuffer
+  uint32_t fbo, colorBuffer, depthBuffer;
+  glGenFramebuffers(1, &fbo);
+  glGenRenderbuffers(1, &colorBuffer);
+  glGenRenderbuffers(1, &depthBuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, IMAGE_WIDTH, IMAGE_HEIGHT);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, IMAGE_WIDTH, IMAGE_HEIGHT);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+  uint32_t vao, vbo;
+  glGenVertexArrays(1, &vao);
+  glGenBuffers(1, &vbo);
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(),
+               GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        (void *) offsetof(Vertex, position));
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                        (void *) offsetof(Vertex, normal));
+  glEnableVertexAttribArray(1);
+
+  glViewport(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT);
+  glEnable(GL_DEPTH_TEST);
+  glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  // The shaders only take non-const references
+  Scene uniforms = scene;
+
+  for (Shader *shader : {&phongShader, &materialShader, &lightShader}) {
+    shader->use();
+    shader->setMat4("view", uniforms.view);
+    shader->setMat4("projection", uniforms.projection);
+  }
+
+  phongShader.use();
+  phongShader.setVec3("viewPos", uniforms.phong.viewPos);
+  phongShader.setVec3("lightPos", uniforms.phong.lightPos);
+  phongShader.setVec3("lightColor", uniforms.phong.lightColor);
+  phongShader.setVec3("objectColor", uniforms.phong.objectColor);
+
+  materialShader.use();
+  materialShader.setVec3("viewPos", uniforms.material.viewPos);
+  materialShader.setVec3("material.ambient", uniforms.material.material.ambient);
+  materialShader.setVec3("material.diffuse", uniforms.material.material.diffuse);
+  materialShader.setVec3("material.specular", uniforms.material.material.specular);
+  materialShader.setFloat("material.glossiness", uniforms.material.material.glossiness);
+  materialShader.setVec3("light.position", uniforms.material.light.position);
+  materialShader.setVec3("light.ambient", uniforms.material.light.ambient);
+  materialShader.setVec3("light.diffuse", uniforms.material.light.diffuse);
+  materialShader.setVec3("light.specular", uniforms.material.light.specular);
+
+  for (size_t i = 0; i < uniforms.cubeModels.size(); i++) {
+    Shader &shader = (i / GRID_SIZE) % 2 == 0 ? phongShader : materialShader;
+    glm::mat3 cubeNormalMatrix = normalMatrix(uniforms.cubeModels[i]);
+    shader.use();
+    shader.setMat4("model", uniforms.cubeModels[i]);
+    shader.setMat3("normalMatrix", cubeNormalMatrix);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei) vertices.size());
+  }
+
+  lightShader.use();
+  lightShader.setMat4("model", uniforms.lightModel);
+  lightShader.setVec3("objectColor", uniforms.light.objectColor);
+  lightShader.setVec3("lightColor", uniforms.light.lightColor);
+  glDrawArrays(GL_TRIANGLES, 0, (GLsizei) vertices.size());
+
+  pixels.resize((size_t) IMAGE_WIDTH * IMAGE_HEIGHT * 4);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteRenderbuffers(1, &colorBuffer);
+  glDeleteRenderbuffers(1, &depthBuffer);
+  glDeleteFramebuffers(1, &fbo);
+  return true;
+}
+
+/**
+ * Renders the nanosuit model with the software rasterizer, as seen by the model
+ * loading demo. Loading the model creates its OpenGL buffers and textures, so it
+ * needs an OpenGL context too.
+ *
+ * @param milliseconds Set to the mean time of a frame
+ * @return Whether an OpenGL context could be created
+ */
+bool renderModel(std::vector<uint8_t> &pixels, double &milliseconds) {
+  Window window(IMAGE_WIDTH, IMAGE_HEIGHT, "Software Rendering", 3, 3, WindowMode::HIDDEN);
+
+  if (!window.isOpen()) {
+    return false;
+  }
+
+  Model nanosuit = Model("../resources/models/nanosuit/nanosuit.blend");
+  glm::vec3 cameraPosition = glm::vec3(0.0f, 0.0f, 3.0f);
+  glm::mat4 view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f),
+                               glm::vec3(0.0f, 1.0f, 0.0f));
+  glm::mat4 projection = glm::perspective(glm::radians(FOV),
+                                          (float) IMAGE_WIDTH / (float) IMAGE_HEIGHT, 0.1f, 100.0f);
+  glm::mat4 model;
+  model = glm::translate(model, glm::vec3(0.0, -1.75f, 0.0f));
+  model = glm::scale(model, glm::vec3(0.2f, 0.2f, 0.2f));
+
+  PhongShading shading;
+  shading.viewPos = cameraPosition;
+  shading.lightPos = glm::vec3(1.0f, 2.5f, 2.0f);
+  shading.objectColor = glm::vec3(0.8f, 0.8f, 0.8f);
+
+  SoftwareRasterizer rasterizer(IMAGE_WIDTH, IMAGE_HEIGHT);
+  auto start = std::chrono::steady_clock::now();
+
+  for (uint32_t frame = 0; frame < FRAMES; frame++) {
+    rasterizer.clear(glm::vec3(0.15f, 0.15f, 0.15f));
+    rasterizer.setCamera(view, projection);
+    nanosuit.draw(rasterizer, model, shading);
+    rasterizer.flush();
+  }
+
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  milliseconds = elapsed.count() / FRAMES;
+  rasterizer.readPixels(pixels);
+  return true;
+}
+
+// Writes an RGBA image whose bottom row comes first as a binary PPM
+void writePPM(const char *path, const std::vector<uint8_t> &pixels) {
+  FILE *file = fopen(path, "wb");
+
+  if (file == nullptr) {
+    std::cout << "ERROR: Failed to write " << path << "." << std::endl;
+    return;
+  }
+
+  fprintf(file, "P6\n%d %d\n255\n", IMAGE_WIDTH, IMAGE_HEIGHT);
+
+  for (int32_t y = IMAGE_HEIGHT - 1; y >= 0; y--) {
+    for (int32_t x = 0; x < IMAGE_WIDTH; x++) {
+      fwrite(&pixels[((size_t) y * IMAGE_WIDTH + x) * 4], 1, 3, file);
+    }
+  }
+
+  fclose(file);
+}
+
+int32_t main() {
+  Scene scene = createScene();
+  std::vector<Vertex> vertices;
+  std::vector<uint32_t> indices;
+  createCube(vertices, indices);
+
+  // Double the thread count up to the number of hardware threads
+  uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<uint32_t> threadCounts;
+
+  for (uint32_t threads = 1; threads < hardwareThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+
+  threadCounts.push_back(hardwareThreads);
+  double singleThreadMilliseconds = 0.0;
+  std::vector<uint8_t> softwarePixels;
+
+  for (uint32_t threads : threadCounts) {
+    SoftwareRasterizer rasterizer(IMAGE_WIDTH, IMAGE_HEIGHT, threads);
+    // Warm up the caches and the thread pool
+    renderSoftware(rasterizer, scene, vertices, indices);
+    auto start = std::chrono::steady_clock::now();
+
+    for (uint32_t frame = 0; frame < FRAMES; frame++) {
+      renderSoftware(rasterizer, scene, vertices, indices);
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    double milliseconds = elapsed.count() / FRAMES;
+    singleThreadMilliseconds = threads == 1 ? milliseconds : singleThreadMilliseconds;
+    printf("%2u thread(s): %7.2f ms/frame, %5.2fx\n", threads, milliseconds,
+           singleThreadMilliseconds / milliseconds);
+    rasterizer.readPixels(softwarePixels);
+  }
+
+  writePPM("software.ppm", softwarePixels);
+  std::cout << "Wrote software.ppm." << std::endl;
+
+  std::vector<uint8_t> glPixels;
+
+  if (!renderGL(scene, vertices, glPixels)) {
+    std::cout << "No OpenGL context available, skipping the comparison and the model." << std::endl;
+    return 0;
+  }
+
+  writePPM("opengl.ppm", glPixels);
+
+  // Edges may be rasterized slightly differently, so count the pixels that differ noticeably
+  uint64_t totalDifference = 0;
+  uint32_t differentPixels = 0;
+
+  for (size_t pixel = 0; pixel < glPixels.size(); pixel += 4) {
+    int32_t maxDifference = 0;
+
+    for (size_t channel = 0; channel < 3; channel++) {
+      int32_t difference = std::abs((int32_t) glPixels[pixel + channel] -
+                                    (int32_t) softwarePixels[pixel + channel]);
+      totalDifference += (uint64_t) difference;
+      maxDifference = std::max(maxDifference, difference);
+    }
+
+    differentPixels += maxDifference > 2 ? 1 : 0;
+  }
+
+  uint32_t pixelCount = (uint32_t) (glPixels.size() / 4);
+  printf("Wrote opengl.ppm. Mean difference: %.3f/255, pixels differing by more than 2/255: "
+         "%u (%.3f%%)\n", (double) totalDifference / (pixelCount * 3.0), differentPixels,
+         100.0 * differentPixels / pixelCount);
+
+  std::vector<uint8_t> modelPixels;
+  double modelMilliseconds;
+
+  if (renderModel(modelPixels, modelMilliseconds)) {
+    writePPM("software_model.ppm", modelPixels);
+    printf("Wrote software_model.ppm, the model took %.2f ms/frame.\n", modelMilliseconds);
+  }
+
+  return 0;
+}
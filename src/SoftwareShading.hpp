@@ -0,0 +1,112 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+
+/*
+ * C++ versions of the lighting demos' fragment shaders, for the software
+ * rasterizer (see SoftwareRasterizer.hpp). Their public members correspond to
+ * the shaders' uniforms, and they compute the same colors.
+ */
+
+/**
+ * The interpolated vertex shader outputs at a pixel.
+ */
+struct SoftwareFragment {
+  // In world space
+  glm::vec3 position;
+  // Not normalized, like the shaders' interpolated inputs
+  glm::vec3 normal;
+  glm::vec2 texCoords;
+};
+
+class SoftwareShader {
+public:
+  virtual ~SoftwareShader() = default;
+
+  // Returns the fragment's color, clamped to [0, 1] when written to the framebuffer
+  virtual glm::vec3 shade(const SoftwareFragment &fragment) const = 0;
+};
+
+// A constant color, as in light_colors.fragment.glsl
+class BasicShading : public SoftwareShader {
+public:
+  glm::vec3 objectColor = glm::vec3(1.0f);
+  glm::vec3 lightColor = glm::vec3(1.0f);
+
+  glm::vec3 shade(const SoftwareFragment &) const override {
+    return lightColor * objectColor;
+  }
+};
+
+// Phong lighting with a single white-ish light, as in basic_lighting.fragment.glsl
+class PhongShading : public SoftwareShader {
+public:
+  glm::vec3 viewPos = glm::vec3(0.0f);
+  glm::vec3 lightPos = glm::vec3(0.0f);
+  glm::vec3 lightColor = glm::vec3(1.0f);
+  glm::vec3 objectColor = glm::vec3(1.0f);
+
+  glm::vec3 shade(const SoftwareFragment &fragment) const override {
+    // Ambient lighting
+    float ambientStrength = 0.1f;
+    glm::vec3 ambient = ambientStrength * lightColor;
+
+    // Diffuse lighting
+    glm::vec3 norm = glm::normalize(fragment.normal);
+    glm::vec3 lightDir = glm::normalize(lightPos - fragment.position);
+    float diff = std::max(glm::dot(norm, lightDir), 0.0f);
+    glm::vec3 diffuse = objectColor * diff * lightColor;
+
+    // Specular lighting
+    float specularStrength = 0.5f;
+    glm::vec3 viewDir = glm::normalize(viewPos - fragment.position);
+    glm::vec3 reflectDir = glm::reflect(-lightDir, norm);
+    float spec = std::pow(std::max(glm::dot(viewDir, reflectDir), 0.0f), 32.0f);
+    glm::vec3 specular = specularStrength * spec * lightColor;
+
+    return ambient + diffuse + specular;
+  }
+};
+
+// Phong lighting with material and light colors, as in materials.fragment.glsl
+class MaterialShading : public SoftwareShader {
+public:
+  struct Material {
+    glm::vec3 ambient = glm::vec3(1.0f);
+    glm::vec3 diffuse = glm::vec3(1.0f);
+    glm::vec3 specular = glm::vec3(0.5f);
+    float glossiness = 32.0f;
+  };
+
+  struct Light {
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 ambient = glm::vec3(0.2f);
+    glm::vec3 diffuse = glm::vec3(0.5f);
+    glm::vec3 specular = glm::vec3(1.0f);
+  };
+
+  glm::vec3 viewPos = glm::vec3(0.0f);
+  Material material;
+  Light light;
+
+  glm::vec3 shade(const SoftwareFragment &fragment) const override {
+    // Ambient lighting
+    glm::vec3 ambient = light.ambient * material.ambient;
+
+    // Diffuse lighting
+    glm::vec3 norm = glm::normalize(fragment.normal);
+    glm::vec3 lightDir = glm::normalize(light.position - fragment.position);
+    float diff = std::max(glm::dot(norm, lightDir), 0.0f);
+    glm::vec3 diffuse = light.diffuse * material.diffuse * diff;
+
+    // Specular lighting
+    glm::vec3 viewDir = glm::normalize(viewPos - fragment.position);
+    glm::vec3 reflectDir = glm::reflect(-lightDir, norm);
+    float spec = std::pow(std::max(glm::dot(viewDir, reflectDir), 0.0f), material.glossiness);
+    glm::vec3 specular = light.specular * material.specular * spec;
+
+    return ambient + diffuse + specular;
+  }
+};
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * Splits the time from the program's start to its first presented frame into
+ * phases (window creation, shader compilation, model import, ...), measuring
+ * both the wall time and the main thread's CPU time of each.
+ *
+ * Phases are marked with StartupPhase on the main thread, and may nest: each
+ * phase is reported with the time spent in it minus its nested phases, so
+ * that the phases and the "other" line add up to the total. A phase that runs
+ * several times, e.g. loading a texture, is reported once with the sum of its
+ * runs. Time spent in OpenGL calls only covers the CPU side, as the driver may
+ * run the work later.
+ *
+ * Window reports the breakdown after the first frame (see Window.hpp) when the
+ * STARTUP_REPORT environment variable is set: printed if it is 1, written as
+ * JSON to the file it names otherwise. Nothing is measured without it, and
+ * phases marked after the first frame are ignored.
+ */
+class StartupProfile {
+public:
+  static StartupProfile &get() {
+    static StartupProfile profile;
+    return profile;
+  }
+
+  // Whether phases are still being measured, i.e. a report was requested and the first frame
+  // hasn't been presented yet
+  bool isRecording() const {
+    return recording;
+  }
+
+  // Starts a phase ended by the next end(), see StartupPhase
+  void begin(const char *name) {
+    if (!recording) {
+      return;
+    }
+
+    uint32_t phase = 0;
+
+    while (phase < phases.size() && phases[phase].name != name) {
+      phase++;
+    }
+
+    if (phase == phases.size()) {
+      phases.push_back({name, {}, 0});
+    }
+
+    open.push_back({phase, Times::now(), {}});
+  }
+
+  void end() {
+    if (!recording || open.empty()) {
+      return;
+    }
+
+    OpenPhase current = open.back();
+    open.pop_back();
+    Times elapsed = Times::now() - current.start;
+    Phase &phase = phases[current.phase];
+    phase.self = phase.self + (elapsed - current.nested);
+    phase.count++;
+
+    if (!open.empty()) {
+      open.back().nested = open.back().nested + elapsed;
+    }
+  }
+
+  /**
+   * Stops measuring, once the first frame has been presented, and reports the
+   * phases as requested by STARTUP_REPORT.
+   *
+   * @param name The program's name, included in the report
+   */
+  void finish(const std::string &name) {
+    if (!recording) {
+      return;
+    }
+
+    recording = false;
+    const char *report = requestedReport();
+
+    // The thread and process clocks start with the process, the wall time since static
+    // initialization is the closest to it
+    Times total = Times::now();
+    total.wall = total.wall - programStart;
+    double processMs = cpuTimeMs(CLOCK_PROCESS_CPUTIME_ID);
+
+    Times accounted;
+
+    for (const Phase &phase : phases) {
+      accounted = accounted + phase.self;
+    }
+
+    Times other = total - accounted;
+
+    if (std::string(report) == "1") {
+      printReport(name, total, processMs, other);
+    } else {
+      writeJson(report, name, total, processMs, other);
+    }
+  }
+
+private:
+  // A wall time and a thread CPU time, in milliseconds
+  struct Times {
+    double wall = 0.0;
+    double thread = 0.0;
+
+    static Times now() {
+      double wall = std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now().time_since_epoch()).count();
+      return {wall, cpuTimeMs(CLOCK_THREAD_CPUTIME_ID)};
+    }
+
+    Times operator+(const Times &other) const {
+      return {wall + other.wall, thread + other.thread};
+    }
+
+    Times operator-(const Times &other) const {
+      return {wall - other.wall, thread - other.thread};
+    }
+  };
+
+  struct Phase {
+    std::string name;
+    // The time spent in the phase but not in its nested phases
+    Times self;
+    uint32_t count;
+  };
+
+  struct OpenPhase {
+    uint32_t phase;
+    Times start;
+    // The time spent in the nested phases so far
+    Times nested;
+  };
+
+  // Static initialization happens right before main(), at the start of the program
+  static inline const double programStart = Times::now().wall;
+
+  bool recording = requestedReport() != nullptr;
+  std::vector<Phase> phases;
+  std::vector<OpenPhase> open;
+
+  // STARTUP_REPORT, or null if it's unset or 0
+  static const char *requestedReport() {
+    const char *report = std::getenv("STARTUP_REPORT");
+
+    if (report == nullptr || report[0] == '\0' || std::string(report) == "0") {
+      return nullptr;
+    }
+
+    return report;
+  }
+
+  static double cpuTimeMs(clockid_t clock) {
+    timespec time{};
+    clock_gettime(clock, &time);
+    return (double) time.tv_sec * 1.0e3 + (double) time.tv_nsec / 1.0e6;
+  }
+
+  void printReport(const std::string &name, const Times &total, double processMs,
+                   const Times &other) const {
+    char line[160];
+    snprintf(line, sizeof(line),
+             "Startup of %s: %.1f ms to the first frame (main thread CPU %.1f ms, process CPU "
+             "%.1f ms)\n", name.c_str(), total.wall, total.thread, processMs);
+    std::string text = line;
+    snprintf(line, sizeof(line), "  %-28s %10s %10s %6s\n", "Phase", "Wall ms", "Thread ms",
+             "Count");
+    text += line;
+
+    for (const Phase &phase : phases) {
+      snprintf(line, sizeof(line), "  %-28s %10.2f %10.2f %6u\n", phase.name.c_str(),
+               phase.self.wall, phase.self.thread, phase.count);
+      text += line;
+    }
+
+    snprintf(line, sizeof(line), "  %-28s %10.2f %10.2f\n", "other", other.wall, other.thread);
+    std::cout << text << line;
+  }
+
+  void writeJson(const char *path, const std::string &name, const Times &total,
+                 double processMs, const Times &other) const {
+    FILE *file = std::fopen(path, "w");
+
+    if (file == nullptr) {
+      std::cout << "ERROR: Failed to write the startup report to " << path << std::endl;
+      return;
+    }
+
+    std::fprintf(file, "{\n  \"name\": \"%s\",\n  \"wall_ms\": %.3f,\n  \"thread_ms\": %.3f,\n"
+                       "  \"process_ms\": %.3f,\n  \"phases\": [\n",
+                 name.c_str(), total.wall, total.thread, processMs);
+
+    for (const Phase &phase : phases) {
+      std::fprintf(file, "    {\"name\": \"%s\", \"wall_ms\": %.3f, \"thread_ms\": %.3f, "
+                         "\"count\": %u},\n",
+                   phase.name.c_str(), phase.self.wall, phase.self.thread, phase.count);
+    }
+
+    std::fprintf(file, "    {\"name\": \"other\", \"wall_ms\": %.3f, \"thread_ms\": %.3f, "
+                       "\"count\": 0}\n  ]\n}\n", other.wall, other.thread);
+    std::fclose(file);
+    std::cout << "Wrote the startup report to " << path << std::endl;
+  }
+};
+
+/**
+ * Accounts the time between its construction and destruction to a startup
+ * phase (see StartupProfile). Does nothing after the first frame.
+ */
+class StartupPhase {
+public:
+  explicit StartupPhase(const char *name) {
+    StartupProfile::get().begin(name);
+  }
+
+  ~StartupPhase() {
+    StartupProfile::get().end();
+  }
+
+  StartupPhase(const StartupPhase &) = delete;
+  StartupPhase &operator=(const StartupPhase &) = delete;
+};
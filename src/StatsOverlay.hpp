@@ -0,0 +1,462 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "GpuTimer.hpp"
+#include "RenderStats.hpp"
+#include "Shader.hpp"
+
+namespace stats_overlay_detail {
+// A 5x7 pixel glyph: one byte per row from the top, bit 4 being the leftmost pixel
+struct Glyph {
+  char character;
+  uint8_t rows[7];
+};
+
+// The characters the overlay uses, lowercase letters being drawn in uppercase
+constexpr Glyph GLYPHS[] = {
+    {'0', {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}},
+    {'1', {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'2', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}},
+    {'3', {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}},
+    {'4', {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}},
+    {'5', {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}},
+    {'6', {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}},
+    {'7', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}},
+    {'8', {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}},
+    {'9', {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}},
+    {'A', {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}},
+    {'B', {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}},
+    {'C', {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}},
+    {'D', {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}},
+    {'E', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}},
+    {'F', {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}},
+    {'G', {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}},
+    {'H', {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}},
+    {'I', {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}},
+    {'J', {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}},
+    {'K', {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}},
+    {'L', {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}},
+    {'M', {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}},
+    {'N', {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}},
+    {'O', {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'P', {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}},
+    {'Q', {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}},
+    {'R', {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}},
+    {'S', {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}},
+    {'T', {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}},
+    {'U', {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}},
+    {'V', {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}},
+    {'W', {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}},
+    {'X', {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}},
+    {'Y', {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}},
+    {'Z', {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}},
+    {'.', {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}},
+    {':', {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}},
+    {'/', {0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00}},
+    {'%', {0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03}},
+    {'-', {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}},
+    {'(', {0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02}},
+    {')', {0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08}},
+    {'?', {0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04}},
+};
+}
+
+/**
+ * A heads-up display of the frame's statistics: CPU and GPU frame time
+ * graphs, the counts of draw calls, triangles, state changes and uniform
+ * uploads made through Shader, Mesh and Model (see RenderStats.hpp), and the
+ * GPU memory in use if the driver reports it.
+ *
+ * Text and graphs are textured quads sampling a single glyph atlas, which
+ * also holds a solid cell for the graphs and background, so the overlay is
+ * drawn in one draw call from a vertex buffer rebuilt every frame. It assumes
+ * the viewport covers the whole framebuffer.
+ *
+ * Usage, every frame:
+ *
+ *   overlay.beginFrame();
+ *   ... // Render the frame
+ *   overlay.draw(width, height);
+ *   window.swapBuffers();
+ */
+class StatsOverlay {
+public:
+  explicit StatsOverlay(bool visible = false)
+      : visible(visible),
+        previousDraw(std::chrono::steady_clock::now()),
+        shader("../resources/shaders/stats_overlay.vertex.glsl",
+               "../resources/shaders/stats_overlay.fragment.glsl") {
+    createAtlas();
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          (void *) offsetof(Vertex, position));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          (void *) offsetof(Vertex, texCoords));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex),
+                          (void *) offsetof(Vertex, color));
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+
+    detectMemoryInfo();
+  }
+
+  StatsOverlay(const StatsOverlay &) = delete;
+  StatsOverlay &operator=(const StatsOverlay &) = delete;
+
+  ~StatsOverlay() {
+    glDeleteTextures(1, &atlas);
+    glDeleteBuffers(1, &vbo);
+    glDeleteVertexArrays(1, &vao);
+  }
+
+  void toggle() {
+    visible = !visible;
+    memoryQueried = false;
+  }
+
+  bool isVisible() const {
+    return visible;
+  }
+
+  // Starts measuring the frame and resets the render statistics
+  void beginFrame() {
+    frameStart = std::chrono::steady_clock::now();
+    renderStats.reset();
+    timer.begin();
+  }
+
+  /**
+   * Stops measuring the frame and draws the overlay if visible, on top of
+   * the current framebuffer.
+   *
+   * @param width The framebuffer's width
+   * @param height The framebuffer's height
+   */
+  void draw(int32_t width, int32_t height) {
+    auto now = std::chrono::steady_clock::now();
+    double cpuMs = std::chrono::duration<double, std::milli>(now - frameStart).count();
+    double frameMs = std::chrono::duration<double, std::milli>(now - previousDraw).count();
+    previousDraw = now;
+    // The overlay's own calls are counted in the next frame, and reset by beginFrame()
+    RenderStats stats = renderStats;
+    timer.end();
+
+    cpuHistory[historyIndex % HISTORY] = (float) cpuMs;
+
+    // The GPU time arrives a few frames late
+    if (timer.resultCount() != gpuResults) {
+      gpuResults = timer.resultCount();
+      gpuHistory[historyIndex % HISTORY] = (float) timer.milliseconds();
+    }
+
+    historyIndex++;
+
+    if (!visible) {
+      return;
+    }
+
+    if (!memoryQueried || historyIndex - memoryQueriedAt >= MEMORY_QUERY_INTERVAL) {
+      queryMemory();
+      memoryQueried = true;
+      memoryQueriedAt = historyIndex;
+    }
+
+    vertices.clear();
+    buildOverlay(stats, frameMs, cpuMs);
+    render(width, height);
+  }
+
+private:
+  struct Vertex {
+    glm::vec2 position;
+    glm::vec2 texCoords;
+    // RGBA, 8 bits per channel
+    uint32_t color;
+  };
+
+  enum class MemoryInfo {
+    NONE,
+    // GL_NVX_gpu_memory_info: total and available memory
+    NVX,
+    // GL_ATI_meminfo: free memory only
+    ATI,
+  };
+
+  // Atlas cells of 6x8 pixels, i.e. a 5x7 glyph and its spacing
+  static constexpr int32_t CELL_WIDTH = 6;
+  static constexpr int32_t CELL_HEIGHT = 8;
+  static constexpr int32_t ATLAS_COLUMNS = 16;
+  static constexpr int32_t ATLAS_ROWS = 5;
+  // The cells hold the ASCII characters from ' ' to '_', then the solid cell
+  static constexpr int32_t SOLID_CELL = 64;
+  // Screen pixels per atlas pixel
+  static constexpr float SCALE = 2.0f;
+  static constexpr float LINE_HEIGHT = CELL_HEIGHT * SCALE + 4.0f;
+  static constexpr float MARGIN = 8.0f;
+  static constexpr float PADDING = 8.0f;
+  static constexpr float PANEL_WIDTH = 31 * CELL_WIDTH * SCALE + 2.0f * PADDING;
+  // Samples in each graph, one per frame, each 2 pixels wide
+  static constexpr uint32_t HISTORY = 88;
+  static constexpr float GRAPH_HEIGHT = 48.0f;
+  // The time at the top of the graphs, the line halfway being 60 frames per second
+  static constexpr float GRAPH_MAX_MS = 1000.0f / 30.0f;
+  // Querying the memory may synchronize with the driver, so only do it every so often
+  static constexpr uint64_t MEMORY_QUERY_INTERVAL = 30;
+
+  static constexpr GLenum GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX = 0x9048;
+  static constexpr GLenum GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX = 0x9049;
+  static constexpr GLenum TEXTURE_FREE_MEMORY_ATI = 0x87FC;
+
+  static constexpr uint32_t WHITE = 0xFFFFFFFF;
+  static constexpr uint32_t GRAY = 0xFF909090;
+  static constexpr uint32_t BACKGROUND = 0xB0000000;
+  static constexpr uint32_t CPU_COLOR = 0xFF40C0FF;
+  static constexpr uint32_t GPU_COLOR = 0xFF60FF60;
+
+  bool visible;
+  std::chrono::steady_clock::time_point frameStart;
+  std::chrono::steady_clock::time_point previousDraw;
+  Shader shader;
+  uint32_t atlas, vao, vbo;
+  GpuTimer timer;
+  uint64_t gpuResults = 0;
+  float cpuHistory[HISTORY] = {};
+  float gpuHistory[HISTORY] = {};
+  uint64_t historyIndex = 0;
+  MemoryInfo memoryInfo = MemoryInfo::NONE;
+  // In kilobytes, as reported by the extensions
+  int32_t memoryTotal = 0;
+  int32_t memoryAvailable = 0;
+  bool memoryQueried = false;
+  uint64_t memoryQueriedAt = 0;
+  // Reused every frame to avoid allocations
+  std::vector<Vertex> vertices;
+
+  void createAtlas() {
+    const int32_t width = ATLAS_COLUMNS * CELL_WIDTH;
+    const int32_t height = ATLAS_ROWS * CELL_HEIGHT;
+    std::vector<uint8_t> pixels((size_t) (width * height), 0);
+
+    for (const stats_overlay_detail::Glyph &glyph : stats_overlay_detail::GLYPHS) {
+      int32_t cell = glyph.character - ' ';
+      int32_t cellX = cell % ATLAS_COLUMNS * CELL_WIDTH;
+      int32_t cellY = cell / ATLAS_COLUMNS * CELL_HEIGHT;
+
+      for (int32_t y = 0; y < 7; y++) {
+        for (int32_t x = 0; x < 5; x++) {
+          if (glyph.rows[y] & (0x10 >> x)) {
+            pixels[(size_t) ((cellY + y) * width + cellX + x)] = 255;
+          }
+        }
+      }
+    }
+
+    int32_t solidX = SOLID_CELL % ATLAS_COLUMNS * CELL_WIDTH;
+    int32_t solidY = SOLID_CELL / ATLAS_COLUMNS * CELL_HEIGHT;
+
+    for (int32_t y = 0; y < CELL_HEIGHT; y++) {
+      std::memset(&pixels[(size_t) ((solidY + y) * width + solidX)], 255, CELL_WIDTH);
+    }
+
+    glGenTextures(1, &atlas);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height, 0, GL_RED, GL_UNSIGNED_BYTE,
+                 pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+
+  void detectMemoryInfo() {
+    int32_t extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+
+    for (int32_t i = 0; i < extensions; i++) {
+      const char *name = (const char *) glGetStringi(GL_EXTENSIONS, (GLuint) i);
+
+      if (std::strcmp(name, "GL_NVX_gpu_memory_info") == 0) {
+        memoryInfo = MemoryInfo::NVX;
+      } else if (std::strcmp(name, "GL_ATI_meminfo") == 0 && memoryInfo == MemoryInfo::NONE) {
+        memoryInfo = MemoryInfo::ATI;
+      }
+    }
+  }
+
+  void queryMemory() {
+    if (memoryInfo == MemoryInfo::NVX) {
+      glGetIntegerv(GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &memoryTotal);
+      glGetIntegerv(GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &memoryAvailable);
+    } else if (memoryInfo == MemoryInfo::ATI) {
+      // Free memory in the texture pool, then the largest free block and auxiliary memory
+      int32_t info[4] = {};
+      glGetIntegerv(TEXTURE_FREE_MEMORY_ATI, info);
+      memoryAvailable = info[0];
+    }
+  }
+
+  void addQuad(float x, float y, float width, float height, int32_t cell, uint32_t color) {
+    float u0 = (float) (cell % ATLAS_COLUMNS) / (float) ATLAS_COLUMNS;
+    float v0 = (float) (cell / ATLAS_COLUMNS) / (float) ATLAS_ROWS;
+    float u1 = u0 + 1.0f / (float) ATLAS_COLUMNS;
+    float v1 = v0 + 1.0f / (float) ATLAS_ROWS;
+
+    // Solid quads sample the middle of their cell, whatever their size
+    if (cell == SOLID_CELL) {
+      u0 = u1 = (u0 + u1) * 0.5f;
+      v0 = v1 = (v0 + v1) * 0.5f;
+    }
+
+    const Vertex corners[] = {
+        {{x, y}, {u0, v0}, color},
+        {{x + width, y}, {u1, v0}, color},
+        {{x + width, y + height}, {u1, v1}, color},
+        {{x, y + height}, {u0, v1}, color},
+    };
+    const int32_t triangles[] = {0, 1, 2, 0, 2, 3};
+
+    for (int32_t corner : triangles) {
+      vertices.push_back(corners[corner]);
+    }
+  }
+
+  void addRect(float x, float y, float width, float height, uint32_t color) {
+    addQuad(x, y, width, height, SOLID_CELL, color);
+  }
+
+  void addText(float x, float y, const char *text, uint32_t color) {
+    for (const char *c = text; *c != '\0'; c++, x += CELL_WIDTH * SCALE) {
+      char character = (char) std::toupper((unsigned char) *c);
+
+      if (character == ' ') {
+        continue;
+      }
+
+      if (character < ' ' || character > '_') {
+        character = '?';
+      }
+
+      addQuad(x, y, CELL_WIDTH * SCALE, CELL_HEIGHT * SCALE, character - ' ', color);
+    }
+  }
+
+  // Draws the history of a time as bars, the latest on the right
+  void addGraph(float x, float y, const float *history, const char *label, uint32_t color) {
+    const float width = HISTORY * 2.0f;
+    addRect(x, y, width, GRAPH_HEIGHT, 0x60000000);
+    // 60 frames per second
+    addRect(x, y + GRAPH_HEIGHT * 0.5f, width, 1.0f, GRAY);
+
+    for (uint32_t i = 0; i < HISTORY; i++) {
+      float value = history[(historyIndex + i) % HISTORY];
+      float height = std::min(value / GRAPH_MAX_MS, 1.0f) * GRAPH_HEIGHT;
+      addRect(x + (float) i * 2.0f, y + GRAPH_HEIGHT - height, 2.0f, height, color);
+    }
+
+    addText(x + 4.0f, y + 4.0f, label, WHITE);
+  }
+
+  void buildOverlay(const RenderStats &stats, double frameMs, double cpuMs) {
+    char line[64];
+    float x = MARGIN + PADDING;
+    float y = MARGIN + PADDING;
+    const float graphWidth = HISTORY * 2.0f;
+    const float panelHeight = 2.0f * PADDING + 6.0f * LINE_HEIGHT + GRAPH_HEIGHT + 4.0f;
+    addRect(MARGIN, MARGIN, PANEL_WIDTH, panelHeight, BACKGROUND);
+
+    snprintf(line, sizeof(line), "Frame %.2f ms (%.0f fps)", frameMs,
+             frameMs > 0.0 ? 1000.0 / frameMs : 0.0);
+    addText(x, y, line, WHITE);
+    y += LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "CPU %.2f ms", cpuMs);
+    addText(x, y, line, CPU_COLOR);
+    snprintf(line, sizeof(line), "GPU %.2f ms", timer.milliseconds());
+    addText(x + graphWidth + PADDING, y, line, GPU_COLOR);
+    y += LINE_HEIGHT;
+
+    addGraph(x, y, cpuHistory, "CPU", CPU_COLOR);
+    addGraph(x + graphWidth + PADDING, y, gpuHistory, "GPU", GPU_COLOR);
+    y += GRAPH_HEIGHT + 4.0f;
+
+    snprintf(line, sizeof(line), "Draws %llu  Tris %llu", (unsigned long long) stats.drawCalls,
+             (unsigned long long) stats.triangles);
+    addText(x, y, line, WHITE);
+    y += LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "Programs %llu  VAOs %llu  Models %llu",
+             (unsigned long long) stats.programBinds, (unsigned long long) stats.vaoBinds,
+             (unsigned long long) stats.modelDraws);
+    addText(x, y, line, WHITE);
+    y += LINE_HEIGHT;
+
+    snprintf(line, sizeof(line), "Textures %llu  Uniforms %llu",
+             (unsigned long long) stats.textureBinds, (unsigned long long) stats.uniformUploads);
+    addText(x, y, line, WHITE);
+    y += LINE_HEIGHT;
+
+    if (memoryInfo == MemoryInfo::NVX) {
+      snprintf(line, sizeof(line), "GPU memory %d / %d MB", (memoryTotal - memoryAvailable) / 1024,
+               memoryTotal / 1024);
+    } else if (memoryInfo == MemoryInfo::ATI) {
+      snprintf(line, sizeof(line), "GPU memory free %d MB", memoryAvailable / 1024);
+    } else {
+      snprintf(line, sizeof(line), "GPU memory N/A");
+    }
+
+    addText(x, y, line, GRAY);
+  }
+
+  void render(int32_t width, int32_t height) {
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    shader.use();
+    shader.setVec2("screenSize", (float) width, (float) height);
+    shader.setInt("glyphAtlas", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    // Orphan the previous frame's buffer rather than waiting for the GPU to be done with it
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (vertices.size() * sizeof(Vertex)),
+                 vertices.data(), GL_STREAM_DRAW);
+    glDrawArrays(GL_TRIANGLES, 0, (GLsizei) vertices.size());
+    glBindVertexArray(0);
+
+    if (depthTest) {
+      glEnable(GL_DEPTH_TEST);
+    }
+
+    if (!blend) {
+      glDisable(GL_BLEND);
+    }
+
+    if (cullFace) {
+      glEnable(GL_CULL_FACE);
+    }
+  }
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <glad/glad.h>
+
+/*
+ * An OpenGL "driver" whose functions do nothing, for running the CPU side of
+ * the demos' code without a context or a GPU, e.g. in microbenchmarks (see
+ * Microbenchmarks.cpp). Functions creating objects return new names and
+ * queries report success, so loading code takes the same paths as with a
+ * real driver.
+ *
+ * Functions without a stub below share a single one doing nothing and
+ * returning 0. This relies on callers cleaning up their own arguments, as in
+ * the calling conventions of every platform the demos build on.
+ */
+
+namespace stub_gl_detail {
+
+// The names handed out by the glGen*() and glCreate*() stubs
+inline uint32_t lastName = 0;
+
+inline uintptr_t APIENTRY noOp() {
+  return 0;
+}
+
+inline const GLubyte *APIENTRY getString(GLenum name) {
+  switch (name) {
+    case GL_VERSION:
+      return (const GLubyte *) "3.3.0 Stub";
+    case GL_SHADING_LANGUAGE_VERSION:
+      return (const GLubyte *) "3.30";
+    case GL_VENDOR:
+    case GL_RENDERER:
+      return (const GLubyte *) "Stub";
+    default:
+      return (const GLubyte *) "";
+  }
+}
+
+inline const GLubyte *APIENTRY getStringi(GLenum name, GLuint index) {
+  return (const GLubyte *) "";
+}
+
+inline void APIENTRY getIntegerv(GLenum name, GLint *data) {
+  // glad fails to load without any extension
+  *data = name == GL_NUM_EXTENSIONS ? 1 : 0;
+}
+
+inline void APIENTRY generate(GLsizei count, GLuint *names) {
+  for (GLsizei i = 0; i < count; i++) {
+    names[i] = ++lastName;
+  }
+}
+
+inline GLuint APIENTRY createShader(GLenum type) {
+  return ++lastName;
+}
+
+inline GLuint APIENTRY createProgram() {
+  return ++lastName;
+}
+
+// Compilation and linking succeed, without any log
+inline void APIENTRY getObjectiv(GLuint object, GLenum name, GLint *value) {
+  *value = name == GL_INFO_LOG_LENGTH ? 0 : GL_TRUE;
+}
+
+inline GLint APIENTRY getUniformLocation(GLuint program, const GLchar *name) {
+  return 0;
+}
+
+inline GLenum APIENTRY checkFramebufferStatus(GLenum target) {
+  return GL_FRAMEBUFFER_COMPLETE;
+}
+
+/**
+ * The loader passed to gladLoadGLLoader().
+ *
+ * @param name The OpenGL function's name
+ * @return Its stub
+ */
+inline void *getProcAddress(const char *name) {
+  static const struct {
+    const char *name;
+    void *function;
+  } stubs[] = {
+      {"glGetString", (void *) getString},
+      {"glGetStringi", (void *) getStringi},
+      {"glGetIntegerv", (void *) getIntegerv},
+      {"glGenBuffers", (void *) generate},
+      {"glGenVertexArrays", (void *) generate},
+      {"glGenTextures", (void *) generate},
+      {"glGenFramebuffers", (void *) generate},
+      {"glGenRenderbuffers", (void *) generate},
+      {"glGenQueries", (void *) generate},
+      {"glCreateShader", (void *) createShader},
+      {"glCreateProgram", (void *) createProgram},
+      {"glGetShaderiv", (void *) getObjectiv},
+      {"glGetProgramiv", (void *) getObjectiv},
+      {"glGetUniformLocation", (void *) getUniformLocation},
+      {"glCheckFramebufferStatus", (void *) checkFramebufferStatus},
+  };
+
+  for (const auto &stub : stubs) {
+    if (std::strcmp(stub.name, name) == 0) {
+      return stub.function;
+    }
+  }
+
+  return (void *) noOp;
+}
+
+}
+
+/**
+ * Loads the stub functions in place of an OpenGL driver's.
+ *
+ * @return Whether glad accepted them
+ */
+inline bool loadStubGL() {
+  return gladLoadGLLoader(stub_gl_detail::getProcAddress);
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+#include "CpuProfiler.hpp"
+
+/**
+ * A fixed-size pool of worker threads used to run CPU-side rendering work
+ * (culling, light binning, ...) in parallel with the main thread.
+ */
+class ThreadPool {
+public:
+  /**
+   * @param threadCount The number of worker threads (0 to use one per hardware thread, minus the
+   *                    main thread)
+   */
+  explicit ThreadPool(uint32_t threadCount = 0) {
+    if (threadCount == 0) {
+      threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+    }
+
+    for (uint32_t i = 0; i < threadCount; i++) {
+      workers.emplace_back([this] { workerLoop(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+
+    condition.notify_all();
+
+    for (std::thread &worker : workers) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  uint32_t size() const {
+    return (uint32_t) workers.size();
+  }
+
+  /**
+   * Queues a job to be run on a worker thread.
+   *
+   * @return A future that becomes ready once the job has run
+   */
+  std::future<void> submit(std::function<void()> job) {
+    auto task = std::make_shared<std::packaged_task<void()>>(std::move(job));
+    std::future<void> future = task->get_future();
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      jobs.emplace([task] { (*task)(); });
+    }
+
+    condition.notify_one();
+    return future;
+  }
+
+  /**
+   * Splits the range [0, count) into one contiguous chunk per worker and queues them.
+   *
+   * @param count The number of items to process
+   * @param job Called as job(begin, end) for each chunk
+   * @param futures Receives one future per queued chunk
+   */
+  void parallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)> &job,
+                   std::vector<std::future<void>> &futures) {
+    uint32_t chunks = std::min(count, size());
+    uint32_t chunkSize = chunks > 0 ? (count + chunks - 1) / chunks : 0;
+
+    for (uint32_t begin = 0; begin < count; begin += chunkSize) {
+      uint32_t end = std::min(count, begin + chunkSize);
+      futures.push_back(submit([job, begin, end] { job(begin, end); }));
+    }
+  }
+
+  // Blocking version of parallelFor()
+  void parallelFor(uint32_t count, const std::function<void(uint32_t, uint32_t)> &job) {
+    std::vector<std::future<void>> futures;
+    parallelFor(count, job, futures);
+
+    for (std::future<void> &future : futures) {
+      future.get();
+    }
+  }
+
+private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> jobs;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping = false;
+
+  void workerLoop() {
+    while (true) {
+      std::function<void()> job;
+
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return stopping || !jobs.empty(); });
+
+        if (stopping && jobs.empty()) {
+          return;
+        }
+
+        job = std::move(jobs.front());
+        jobs.pop();
+      }
+
+      CPU_PROFILE_SCOPE("ThreadPool job");
+      job();
+    }
+  }
+};
@@ -10,40 +10,27 @@
 
 #include <stb_image.h>
 #include "Shader.hpp"
+#include "Window.hpp"
 
 void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
   glViewport(0, 0, width, height);
 }
 
-void processInput(GLFWwindow *window) {
-  if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-    glfwSetWindowShouldClose(window, true);
+void processInput(Window &window) {
+  if (window.isKeyPressed(GLFW_KEY_ESCAPE)) {
+    window.close();
   }
 }
 
 int32_t main() {
-  glfwInit();
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  // A window, or an offscreen context when the HEADLESS environment variable is set
+  Window window(800, 800, "Transforms");
 
-  GLFWwindow *window = glfwCreateWindow(800, 800, "Transforms", nullptr, nullptr);
-  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
-
-  if (window == nullptr) {
-    std::cout << "Failed to create GLFW window." << std::endl;
-    glfwTerminate();
+  if (!window.isOpen()) {
     return -1;
   }
 
-  // GLFW doesn't mark the context as current automatically
-  // <https://stackoverflow.com/questions/48650497/glad-failing-to-initialize>
-  glfwMakeContextCurrent(window);
-
-  if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-    std::cout << "ERROR: Failed to initialize GLAD." << std::endl;
-    return -1;
-  }
+  window.setFramebufferSizeCallback(framebufferSizeCallback);
 
   glViewport(0, 0, 800, 800);
 
@@ -175,7 +162,7 @@ int32_t main() {
   // Set the texture unit that should be sampled as the overlay texture
   shaderProgram.setInt("textureOverlay", 1);
 
-  while (!glfwWindowShouldClose(window)) {
+  while (!window.shouldClose()) {
     processInput(window);
 
     // Clear the viewport with a constant color
@@ -185,10 +172,10 @@ int32_t main() {
     // The transformation matrices (has to be updated every frame here)
     glm::mat4 translation;
     translation = glm::translate(translation, glm::vec3(0.5f, -0.5f, 0.0f));
-    translation = glm::rotate(translation, (float) glfwGetTime(), glm::vec3(0.0f, 0.0f, 1.0f));
+    translation = glm::rotate(translation, (float) window.time(), glm::vec3(0.0f, 0.0f, 1.0f));
 
     glm::mat4 translation2;
-    double scaleFactor = sin(glfwGetTime()) / 2.5 + 0.6f;
+    double scaleFactor = sin(window.time()) / 2.5 + 0.6f;
     translation2 = glm::translate(translation2, glm::vec3(-0.5f, 0.5f, 0.0f));
     translation2 = glm::scale(translation2, glm::vec3(scaleFactor, scaleFactor, 1.0f));
 
@@ -201,15 +188,14 @@ int32_t main() {
     glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(translation2));
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
 
-    glfwSwapBuffers(window);
-    glfwPollEvents();
+    window.swapBuffers();
+    window.pollEvents();
   }
 
   // Clean up
   glDeleteVertexArrays(1, &vao);
   glDeleteBuffers(1, &vbo);
   glDeleteBuffers(1, &ebo);
-  glfwTerminate();
 
   return 0;
 }
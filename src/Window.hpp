@@ -0,0 +1,485 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "Benchmark.hpp"
+#include "CpuProfiler.hpp"
+#include "GLCapture.hpp"
+#include "GLInterceptor.hpp"
+#include "StartupProfile.hpp"
+
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+enum class WindowMode {
+  VISIBLE,
+  // Only used as an OpenGL context, e.g. to render offscreen
+  HIDDEN,
+};
+
+/**
+ * The window the demos render into, with its OpenGL context, or an offscreen
+ * context for running them without a display, e.g. with Mesa's llvmpipe on a
+ * server without a GPU.
+ *
+ * The offscreen mode is enabled by environment variables, and requires
+ * building with EGL (see CMakeLists.txt):
+ *
+ * - HEADLESS=1 renders at the requested size, HEADLESS=1920x1080 at another
+ *   one, reported to the framebuffer size callback before the first frame
+ * - HEADLESS_FRAMES=N closes the window after N frames (100 by default)
+ * - HEADLESS_SCREENSHOT=path.ppm saves the last frame
+ *
+ * Setting BENCHMARK, with or without HEADLESS, measures the demo instead for
+ * a fixed number of frames with a fixed time step (see Benchmark.hpp).
+ *
+ * The offscreen context renders into an EGL pbuffer surface rather than a
+ * framebuffer object, so that the demos can keep rendering and blitting into
+ * the default framebuffer. It receives no input.
+ *
+ * Setting GL_CAPTURE=path records the OpenGL calls of the setup and of the
+ * first GL_CAPTURE_FRAMES frames into a file for the Replay executable, then
+ * closes the window (see GLCapture.hpp). Benchmarking and GL_INTERCEPT are
+ * disabled meanwhile.
+ *
+ * Setting GL_INTERCEPT=N counts the OpenGL calls of each frame and reports
+ * those of every Nth frame (see GLInterceptor.hpp). It is ignored when
+ * benchmarking, as the counting wrappers slow every call down.
+ *
+ * Setting STARTUP_REPORT reports the time taken by each startup phase up to
+ * the first frame (see StartupProfile.hpp).
+ *
+ * In builds with CPU_PROFILING, the CPU trace is written when the window is
+ * destroyed if CPU_TRACE is set, each frame spanning from one shouldClose()
+ * call to the next (see CpuProfiler.hpp).
+ */
+class Window {
+public:
+  /**
+   * Creates the window and its context, makes it current and loads the OpenGL
+   * functions. Errors are printed, and leave isOpen() false.
+   */
+  Window(int32_t width, int32_t height, const char *title, int32_t majorVersion = 3,
+         int32_t minorVersion = 3, WindowMode mode = WindowMode::VISIBLE)
+      : name(title),
+        width(width),
+        height(height),
+        start(std::chrono::steady_clock::now()) {
+    CPU_PROFILE_SCOPE("Window::Window");
+    const char *headlessSize = std::getenv("HEADLESS");
+
+    if (headlessSize != nullptr && headlessSize[0] != '\0' && std::string(headlessSize) != "0") {
+      headless = true;
+      createHeadless(headlessSize, majorVersion, minorVersion);
+    } else {
+      createWindow(title, majorVersion, minorVersion, mode);
+    }
+
+    if (open) {
+      capture = GlCapture::fromEnvironment(this->width, this->height, majorVersion, minorVersion);
+    }
+
+    if (open && capture == nullptr) {
+      benchmark = Benchmark::fromEnvironment(title, start);
+
+      if (benchmark == nullptr) {
+        interceptor = GlInterceptor::fromEnvironment();
+      }
+    }
+  }
+
+  Window(const Window &) = delete;
+  Window &operator=(const Window &) = delete;
+
+  ~Window() {
+    // Its queries belong to the context
+    benchmark.reset();
+    interceptor.reset();
+    capture.reset();
+
+#ifdef CPU_PROFILING
+    CpuProfiler::writeTraceFromEnvironment();
+#endif
+
+    if (!headless) {
+      glfwTerminate();
+      return;
+    }
+
+#ifdef HEADLESS_EGL
+    if (display != EGL_NO_DISPLAY) {
+      eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+      if (context != EGL_NO_CONTEXT) {
+        eglDestroyContext(display, context);
+      }
+
+      if (surface != EGL_NO_SURFACE) {
+        eglDestroySurface(display, surface);
+      }
+
+      eglTerminate(display);
+    }
+#endif
+  }
+
+  // Whether the window and its context were created
+  bool isOpen() const {
+    return open;
+  }
+
+  bool isHeadless() const {
+    return headless;
+  }
+
+  // The function loading OpenGL functions, e.g. for loadGL43()
+  GLADloadproc procAddressLoader() const {
+#ifdef HEADLESS_EGL
+    if (headless) {
+      return (GLADloadproc) eglGetProcAddress;
+    }
+#endif
+
+    return (GLADloadproc) glfwGetProcAddress;
+  }
+
+  void setFramebufferSizeCallback(GLFWframebuffersizefun callback) {
+    if (headless) {
+      sizeCallback = callback;
+    } else {
+      glfwSetFramebufferSizeCallback(window, callback);
+    }
+  }
+
+  void setKeyCallback(GLFWkeyfun callback) {
+    if (!headless) {
+      glfwSetKeyCallback(window, callback);
+    }
+  }
+
+  bool shouldClose() {
+    if (!firstFrameStarted) {
+      StartupProfile::get().begin("first frame");
+      firstFrameStarted = true;
+    }
+
+#ifdef CPU_PROFILING
+    int64_t now = CpuProfiler::now();
+
+    if (frameStart >= 0) {
+      CpuProfiler::record("frame", frameStart, now);
+    }
+
+    frameStart = now;
+#endif
+
+    bool closing;
+
+    if (!headless) {
+      closing = glfwWindowShouldClose(window);
+    } else {
+      // The size differs from the one the demo set up
+      if (sizeCallback != nullptr && resizePending) {
+        resizePending = false;
+        sizeCallback(nullptr, width, height);
+      }
+
+      closing = closeRequested || (benchmark == nullptr && frame >= frameLimit);
+    }
+
+    if (capture != nullptr) {
+      // The first call ends the setup
+      capture->endFrame();
+
+      if (closing || capture->isComplete()) {
+        capture->finish();
+        return true;
+      }
+    }
+
+    if (benchmark != nullptr) {
+      if (closing || benchmark->isComplete()) {
+        int32_t framebufferWidth, framebufferHeight;
+        getFramebufferSize(&framebufferWidth, &framebufferHeight);
+        benchmark->finish(framebufferWidth, framebufferHeight);
+        return true;
+      }
+
+      benchmark->beginFrame();
+    }
+
+    if (interceptor != nullptr && !closing) {
+      interceptor->beginFrame();
+    }
+
+    return closing;
+  }
+
+  void close() {
+    if (headless) {
+      closeRequested = true;
+    } else {
+      glfwSetWindowShouldClose(window, true);
+    }
+  }
+
+  void swapBuffers() {
+    CPU_PROFILE_SCOPE("Window::swapBuffers");
+
+    if (benchmark != nullptr) {
+      benchmark->endFrame();
+    }
+
+    if (!headless) {
+      glfwSwapBuffers(window);
+      finishStartup();
+      return;
+    }
+
+    frame++;
+
+    if (frame == frameLimit && std::getenv("HEADLESS_SCREENSHOT") != nullptr) {
+      saveScreenshot(std::getenv("HEADLESS_SCREENSHOT"));
+    }
+
+#ifdef HEADLESS_EGL
+    eglSwapBuffers(display, surface);
+#endif
+    finishStartup();
+  }
+
+  void pollEvents() {
+    if (!headless) {
+      glfwPollEvents();
+    }
+  }
+
+  // The time since the window was created, in seconds, or the benchmark's clock
+  double time() const {
+    if (benchmark != nullptr) {
+      return benchmark->time();
+    }
+
+    if (!headless) {
+      return glfwGetTime();
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  bool isKeyPressed(int32_t key) const {
+    return !headless && glfwGetKey(window, key) == GLFW_PRESS;
+  }
+
+  void setTitle(const std::string &title) {
+    if (!headless) {
+      glfwSetWindowTitle(window, title.c_str());
+    }
+  }
+
+  void getFramebufferSize(int32_t *framebufferWidth, int32_t *framebufferHeight) const {
+    if (headless) {
+      *framebufferWidth = width;
+      *framebufferHeight = height;
+    } else {
+      glfwGetFramebufferSize(window, framebufferWidth, framebufferHeight);
+    }
+  }
+
+private:
+  // The number of frames rendered in headless mode, unless set by HEADLESS_FRAMES
+  static constexpr uint32_t DEFAULT_HEADLESS_FRAMES = 100;
+
+  bool open = false;
+  bool headless = false;
+  std::string name;
+  bool firstFrameStarted = false;
+  int32_t width, height;
+  std::chrono::steady_clock::time_point start;
+  GLFWwindow *window = nullptr;
+  std::unique_ptr<Benchmark> benchmark;
+  std::unique_ptr<GlInterceptor> interceptor;
+  std::unique_ptr<GlCapture> capture;
+#ifdef CPU_PROFILING
+  // When the current frame started, -1 before the first one
+  int64_t frameStart = -1;
+#endif
+
+  // Headless state
+  GLFWframebuffersizefun sizeCallback = nullptr;
+  bool resizePending = false;
+  bool closeRequested = false;
+  uint32_t frame = 0;
+  uint32_t frameLimit = DEFAULT_HEADLESS_FRAMES;
+#ifdef HEADLESS_EGL
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLSurface surface = EGL_NO_SURFACE;
+  EGLContext context = EGL_NO_CONTEXT;
+#endif
+
+  void createWindow(const char *title, int32_t majorVersion, int32_t minorVersion,
+                    WindowMode mode) {
+    {
+      StartupPhase phase("glfwInit");
+      glfwInit();
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, majorVersion);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minorVersion);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, mode == WindowMode::VISIBLE ? GLFW_TRUE : GLFW_FALSE);
+
+    {
+      StartupPhase phase("window creation");
+      window = glfwCreateWindow(width, height, title, nullptr, nullptr);
+
+      if (window == nullptr) {
+        std::cout << "Failed to create GLFW window." << std::endl;
+        return;
+      }
+
+      // GLFW doesn't mark the context as current automatically
+      // <https://stackoverflow.com/questions/48650497/glad-failing-to-initialize>
+      glfwMakeContextCurrent(window);
+    }
+
+    StartupPhase phase("gladLoadGLLoader");
+
+    if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+      std::cout << "ERROR: Failed to initialize GLAD." << std::endl;
+      return;
+    }
+
+    open = true;
+  }
+
+  void createHeadless(const char *size, int32_t majorVersion, int32_t minorVersion) {
+    int32_t requestedWidth = width, requestedHeight = height;
+
+    if (std::sscanf(size, "%dx%d", &requestedWidth, &requestedHeight) == 2 &&
+        requestedWidth > 0 && requestedHeight > 0) {
+      resizePending = requestedWidth != width || requestedHeight != height;
+      width = requestedWidth;
+      height = requestedHeight;
+    }
+
+    if (std::getenv("HEADLESS_FRAMES") != nullptr) {
+      frameLimit = (uint32_t) std::max(1, std::atoi(std::getenv("HEADLESS_FRAMES")));
+    }
+
+#ifdef HEADLESS_EGL
+    StartupPhase contextPhase("context creation");
+    // Mesa's surfaceless platform needs neither a display server nor a GPU
+    const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress(
+        "eglGetPlatformDisplayEXT");
+
+    if (clientExtensions != nullptr && getPlatformDisplay != nullptr &&
+        std::string(clientExtensions).find("EGL_MESA_platform_surfaceless") !=
+        std::string::npos) {
+      display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    } else {
+      display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr) ||
+        !eglBindAPI(EGL_OPENGL_API)) {
+      std::cout << "ERROR: Failed to initialize EGL." << std::endl;
+      return;
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24, EGL_STENCIL_SIZE, 8,
+        EGL_NONE,
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) ||
+        configCount == 0) {
+      std::cout << "ERROR: No EGL configuration supports offscreen OpenGL rendering."
+                << std::endl;
+      return;
+    }
+
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE};
+    surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, majorVersion,
+        EGL_CONTEXT_MINOR_VERSION, minorVersion,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE,
+    };
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+
+    if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(display, surface, surface, context)) {
+      std::cout << "ERROR: Failed to create an offscreen OpenGL " << majorVersion << "."
+                << minorVersion << " context." << std::endl;
+      return;
+    }
+
+    StartupPhase loadPhase("gladLoadGLLoader");
+
+    if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+      std::cout << "ERROR: Failed to initialize GLAD." << std::endl;
+      return;
+    }
+
+    open = true;
+#else
+    std::cout << "ERROR: Headless mode requires building with EGL." << std::endl;
+#endif
+  }
+
+  // Reports the startup phases once the first frame has been presented, if requested
+  void finishStartup() {
+    if (StartupProfile::get().isRecording()) {
+      // Include the GPU's work on the frame, only waited for when reporting
+      glFinish();
+      StartupProfile::get().end();
+      StartupProfile::get().finish(name);
+    }
+  }
+
+  // Writes the default framebuffer's colors as a binary PPM
+  void saveScreenshot(const char *path) const {
+    std::vector<uint8_t> pixels((size_t) width * (size_t) height * 3);
+    int32_t readFramebuffer;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, (uint32_t) readFramebuffer);
+
+    FILE *file = std::fopen(path, "wb");
+
+    if (file == nullptr) {
+      std::cout << "ERROR: Failed to write the screenshot to " << path << "." << std::endl;
+      return;
+    }
+
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+    // OpenGL stores the bottom row first
+    for (int32_t y = height - 1; y >= 0; y--) {
+      std::fwrite(&pixels[(size_t) y * width * 3], 1, (size_t) width * 3, file);
+    }
+
+    std::fclose(file);
+  }
+};